@@ -1,5 +1,7 @@
 #include "app.h"
 
+#include <algorithm>
+#include <array>
 #include <deque>
 #include <format>
 #include <gsl/gsl>
@@ -164,23 +166,47 @@ void app::Application::MainLoop() {
     }
 
     // Emulator
+    frame_timer_.Start(metrics::Subsystem::kCpu);
     if (running_) {
       try {
-        cpu_.Cycle();
+        // Run-ahead works in whole frames and would stop on breakpoints
+        // inside its speculative frames, or profile them. HLE and
+        // watchpoints would log their TTY output and hits again on every
+        // frame.
+        if (run_ahead_enabled_ && cpu_.GetBreakpoints().IsEmpty() &&
+            cpu_.GetWatchpoints().IsEmpty() &&
+            !cpu_.GetProfiler().IsRunning() &&
+            cpu_.GetHleMode() == hle::Mode::kOff) {
+          run_ahead_.RunFrame(cpu_);
+        } else {
+          cpu_.RunFor(1);
+        }
+
+        if (rewind_enabled_) {
+          frame_timer_.Start(metrics::Subsystem::kRewind);
+          rewind_buffer_.Update(cpu_);
+        }
       } catch (const std::exception& e) {
         std::snprintf(error_message_.data(), error_message_.size(), "%s",
                       std::format("CPU Exception: {}", e.what()).c_str());
         show_error_popup_ = true;
       }
 
-      if (step_to_pc_ && cpu_.GetPC() == target_pc_) {
+      if (cpu_.IsStoppedAtBreakpoint()) {
         running_ = false;
-        step_to_pc_ = false;
       }
     }
 
+    frame_timer_.Start(metrics::Subsystem::kUi);
     RenderFrame();
+    frame_timer_.Start(metrics::Subsystem::kPresent);
     PresentFrame();
+    frame_timer_.EndFrame(cpu_.GetStepCount());
+
+    if (metrics_dump_enabled_ &&
+        std::chrono::steady_clock::now() >= next_metrics_dump_) {
+      DumpMetrics();
+    }
   }
 
   // Wait for device to be idle before cleanup
@@ -218,6 +244,9 @@ void app::Application::RenderFrame() {
     DrawCPUStateWindow();
     DrawControlWindow();
     DrawCpuDisassembler();
+    DrawProfilerWindow();
+    DrawPerformanceWindow();
+    DrawInstructionMixWindow();
   }
 
   DrawMainViewWindow();
@@ -392,6 +421,8 @@ void app::Application::DrawCPUStateWindow() const {
   if (ImGui::Begin("PolyStation - CPU State")) {
     // Cycle Count
     ImGui::Text("Step Count: %llu", cpu_.GetStepCount());
+    ImGui::Text("Cycle Count: %llu",
+                static_cast<unsigned long long>(cpu_.GetCycleCount()));
     ImGui::Separator();
     // Program Counter - separate line
     ImGui::TextUnformatted("PC (Program Counter)");
@@ -531,6 +562,52 @@ void app::Application::DrawControlWindow() {
 
     ImGui::Text("FPS: %.2f", ImGui::GetIO().Framerate);
 
+    if (bool accurate = cpu_.GetAccuracy() == cpu::Accuracy::kAccurate;
+        ImGui::Checkbox("Cycle accurate I-cache", &accurate)) {
+      cpu_.SetAccuracy(accurate ? cpu::Accuracy::kAccurate
+                                : cpu::Accuracy::kFast);
+    }
+
+    if (bool idle_skipping = cpu_.IsIdleSkipping();
+        ImGui::Checkbox("Skip idle loops", &idle_skipping)) {
+      cpu_.SetIdleSkipping(idle_skipping);
+    }
+    if (cpu_.IsIdleSkipping()) {
+      ImGui::Text("Idle cycles skipped: %llu",
+                  static_cast<unsigned long long>(
+                      cpu_.GetIdleLoopStats().cycles_skipped));
+    }
+
+    if (bool fusion = cpu_.IsFusing();
+        ImGui::Checkbox("Fuse instructions", &fusion)) {
+      cpu_.SetFusion(fusion);
+    }
+
+    constexpr std::array<const char*, 2> kBackends = {"Interpreter",
+                                                      "Cached interpreter"};
+    if (int backend = static_cast<int>(cpu_.GetBackend());
+        ImGui::Combo("CPU backend", &backend, kBackends.data(),
+                     static_cast<int>(kBackends.size()))) {
+      cpu_.SetBackend(static_cast<cpu::Backend>(backend));
+    }
+    if (cpu_.GetBackend() == cpu::Backend::kCachedInterpreter) {
+      const block_cache::Stats& stats = cpu_.GetBlockCache().GetStats();
+      ImGui::Text("Blocks translated: %llu, loaded: %llu, run: %llu",
+                  stats.translated, stats.loaded, stats.executed);
+    }
+
+    constexpr std::array<const char*, 3> kHleModes = {"Off", "On", "Verify"};
+    if (int hle_mode = static_cast<int>(cpu_.GetHleMode());
+        ImGui::Combo("BIOS HLE", &hle_mode, kHleModes.data(),
+                     static_cast<int>(kHleModes.size()))) {
+      cpu_.SetHleMode(static_cast<hle::Mode>(hle_mode));
+    }
+    if (cpu_.GetHleMode() != hle::Mode::kOff) {
+      const hle::Stats& stats = cpu_.GetHleStats();
+      ImGui::Text("HLE calls: %llu, mismatches: %llu", stats.calls,
+                  stats.mismatches);
+    }
+
     ImGui::Separator();
 
     if (ImGui::Button("Step one", ImVec2(available_width, 0.0)) && !running_) {
@@ -552,20 +629,546 @@ void app::Application::DrawControlWindow() {
 
     if (ImGui::Button("Step to PC", ImVec2(available_width, 0.0)) &&
         !running_) {
+      if (!cpu_.GetBreakpoints().Has(target_pc_)) {
+        cpu_.GetBreakpoints().Add(
+            breakpoint::Breakpoint{.address = target_pc_, .temporary = true});
+      }
       running_ = true;
-      step_to_pc_ = true;
     }
 
     ImGui::Separator();
 
+    DrawBreakpointControls();
+
+    ImGui::Separator();
+
+    DrawWatchpointControls();
+
+    ImGui::Separator();
+
     if (ImGui::Button("Reset", ImVec2(available_width, 0.0)) && !running_) {
       cpu_.Reset();
+      rewind_buffer_.Clear();
       target_pc_ = bios::kBiosBase;
     }
+
+    ImGui::Separator();
+
+    if (ImGui::Button("Save state", ImVec2(available_width, 0.0))) {
+      SaveQuickState();
+    }
+
+    if (ImGui::Button("Load state", ImVec2(available_width, 0.0))) {
+      LoadQuickState();
+    }
+
+    ImGui::Separator();
+
+    DrawRewindControls();
+
+    ImGui::Separator();
+
+    DrawRunAheadControls();
   }
   ImGui::End();
 }
 
+void app::Application::DrawRewindControls() {
+  if (ImGui::Checkbox("Rewind", &rewind_enabled_) && !rewind_enabled_) {
+    rewind_buffer_.Clear();
+  }
+
+  if (!rewind_enabled_) {
+    return;
+  }
+
+  rewind_buffer::Config config = rewind_buffer_.GetConfig();
+  auto budget_megabytes = static_cast<int>(config.memory_budget >> 20U);
+  auto interval_frames = static_cast<int>(config.interval_frames);
+
+  bool changed = ImGui::SliderInt("Interval (frames)", &interval_frames, 1, 60);
+  changed |= ImGui::SliderInt("Budget (MB)", &budget_megabytes, 8, 1024);
+  if (changed) {
+    config.interval_frames = static_cast<uint32_t>(interval_frames);
+    config.memory_budget = static_cast<size_t>(budget_megabytes) << 20U;
+    rewind_buffer_.SetConfig(config);
+  }
+
+  ImGui::Text("Snapshots: %zu (%.1f MB)", rewind_buffer_.GetSnapshotCount(),
+              static_cast<double>(rewind_buffer_.GetMemoryUsage()) / (1 << 20));
+
+  ImGui::Button("Hold to rewind",
+                ImVec2(ImGui::GetContentRegionAvail().x, 0.0));
+  if (ImGui::IsItemActive()) {
+    try {
+      rewind_buffer_.StepBack(cpu_);
+    } catch (const std::exception& e) {
+      std::snprintf(error_message_.data(), error_message_.size(), "%s",
+                    std::format("Rewind Error: {}", e.what()).c_str());
+      show_error_popup_ = true;
+    }
+  }
+}
+
+void app::Application::DrawRunAheadControls() {
+  ImGui::Checkbox("Run-ahead", &run_ahead_enabled_);
+
+  if (!run_ahead_enabled_) {
+    return;
+  }
+
+  if (auto frames = static_cast<int>(run_ahead_.GetFrames());
+      ImGui::SliderInt("Frames ahead", &frames, 0,
+                       static_cast<int>(run_ahead::kMaxFrames))) {
+    run_ahead_.SetFrames(static_cast<uint32_t>(frames));
+  }
+
+  const run_ahead::FrameTiming& timing = run_ahead_.GetTiming();
+  ImGui::Text("Frame: %.3f ms", timing.GetTotal());
+  ImGui::Text("Emulate %.3f / Save %.3f / Ahead %.3f / Restore %.3f",
+              timing.emulate, timing.save, timing.run_ahead, timing.restore);
+}
+
+void app::Application::DrawBreakpointControls() {
+  constexpr std::array<const char*, 6> kComparisons = {"==", "!=", "<",
+                                                       "<=", ">",  ">="};
+  constexpr uint32_t kAddressStep = 4;
+  constexpr uint32_t kAddressFastStep = 400;
+
+  ImGui::InputScalar("Breakpoint", ImGuiDataType_U32,
+                     &new_breakpoint_.address, &kAddressStep,
+                     &kAddressFastStep, "%08X");
+  ImGui::InputScalar("Ignore hits", ImGuiDataType_U64,
+                     &new_breakpoint_.ignore);
+
+  ImGui::Checkbox("Condition", &new_breakpoint_conditional_);
+  if (new_breakpoint_conditional_) {
+    if (auto index = static_cast<int>(new_breakpoint_condition_.register_index);
+        ImGui::SliderInt("Register", &index, 0,
+                         static_cast<int>(cpu::kNumberOfRegisters) - 1)) {
+      new_breakpoint_condition_.register_index = static_cast<uint8_t>(index);
+    }
+    if (auto comparison =
+            static_cast<int>(new_breakpoint_condition_.comparison);
+        ImGui::Combo("Comparison", &comparison, kComparisons.data(),
+                     static_cast<int>(kComparisons.size()))) {
+      new_breakpoint_condition_.comparison =
+          static_cast<breakpoint::Comparison>(comparison);
+    }
+    ImGui::InputScalar("Value", ImGuiDataType_U32,
+                       &new_breakpoint_condition_.value, nullptr, nullptr,
+                       "%08X");
+  }
+
+  const float available_width = ImGui::GetContentRegionAvail().x;
+  if (ImGui::Button("Add breakpoint", ImVec2(available_width, 0.0))) {
+    breakpoint::Breakpoint breakpoint = new_breakpoint_;
+    if (new_breakpoint_conditional_) {
+      breakpoint.condition = new_breakpoint_condition_;
+    }
+    cpu_.GetBreakpoints().Add(breakpoint);
+  }
+
+  std::optional<uint32_t> removed;
+  for (const auto& [physical, breakpoint] :
+       cpu_.GetBreakpoints().GetBreakpoints()) {
+    ImGui::PushID(static_cast<int>(physical));
+    if (ImGui::SmallButton("x")) {
+      removed = breakpoint.address;
+    }
+    ImGui::SameLine();
+    ImGui::Text("%08X hits: %llu", breakpoint.address, breakpoint.hits);
+    if (const std::optional<breakpoint::Condition>& condition =
+            breakpoint.condition) {
+      ImGui::SameLine();
+      ImGui::Text("if R%u %s %08X", condition->register_index,
+                  gsl::at(kComparisons,
+                          static_cast<size_t>(condition->comparison)),
+                  condition->value);
+    }
+    ImGui::PopID();
+  }
+  if (removed.has_value()) {
+    cpu_.GetBreakpoints().Remove(removed.value());
+  }
+
+  if (!cpu_.GetBreakpoints().IsEmpty() &&
+      ImGui::Button("Clear breakpoints", ImVec2(available_width, 0.0))) {
+    cpu_.GetBreakpoints().Clear();
+  }
+}
+
+void app::Application::DrawWatchpointControls() {
+  constexpr size_t kShownHits = 8;
+
+  ImGui::InputScalar("Watchpoint", ImGuiDataType_U32,
+                     &new_watchpoint_.address, nullptr, nullptr, "%08X");
+  ImGui::InputScalar("Length", ImGuiDataType_U32, &new_watchpoint_.length);
+
+  bool read = (new_watchpoint_.kinds & watchpoint::kRead) != 0;
+  bool write = (new_watchpoint_.kinds & watchpoint::kWrite) != 0;
+  ImGui::Checkbox("Read", &read);
+  ImGui::SameLine();
+  ImGui::Checkbox("Write", &write);
+  const int kinds =
+      (read ? watchpoint::kRead : 0) | (write ? watchpoint::kWrite : 0);
+  new_watchpoint_.kinds = static_cast<uint8_t>(kinds);
+
+  watchpoint::Set& watchpoints = cpu_.GetWatchpoints();
+  const float available_width = ImGui::GetContentRegionAvail().x;
+  if (ImGui::Button("Add watchpoint", ImVec2(available_width, 0.0)) &&
+      new_watchpoint_.kinds != 0) {
+    try {
+      watchpoints.Add(new_watchpoint_);
+    } catch (const std::exception& e) {
+      std::snprintf(error_message_.data(), error_message_.size(), "%s",
+                    std::format("Watchpoint Error: {}", e.what()).c_str());
+      show_error_popup_ = true;
+    }
+  }
+
+  std::optional<uint32_t> removed;
+  for (const watchpoint::Watchpoint& watchpoint :
+       watchpoints.GetWatchpoints()) {
+    ImGui::PushID(&watchpoint);
+    if (ImGui::SmallButton("x")) {
+      removed = watchpoint.address;
+    }
+    ImGui::SameLine();
+    ImGui::Text("%08X+%u %s%s hits: %llu", watchpoint.address,
+                watchpoint.length,
+                (watchpoint.kinds & watchpoint::kRead) != 0 ? "R" : "",
+                (watchpoint.kinds & watchpoint::kWrite) != 0 ? "W" : "",
+                watchpoint.hits);
+    ImGui::PopID();
+  }
+  if (removed.has_value()) {
+    watchpoints.Remove(removed.value());
+  }
+
+  const std::deque<watchpoint::Hit>& hits = watchpoints.GetHits();
+  for (auto hit = hits.size() > kShownHits ? hits.end() - kShownHits
+                                           : hits.begin();
+       hit != hits.end(); ++hit) {
+    ImGui::Text("%08X %s %08X/%u = %08X", hit->pc,
+                hit->write ? "W" : "R", hit->address, hit->width, hit->value);
+  }
+
+  if (!watchpoints.IsEmpty() &&
+      ImGui::Button("Clear watchpoints", ImVec2(available_width, 0.0))) {
+    watchpoints.Clear();
+    watchpoints.ClearHits();
+  }
+}
+
+void app::Application::DrawProfilerWindow() {
+  constexpr size_t kShownFunctions = 64;
+  constexpr size_t kShownAddresses = 32;
+  constexpr ImGuiTableFlags kTableFlags = ImGuiTableFlags_Borders |
+                                          ImGuiTableFlags_RowBg |
+                                          ImGuiTableFlags_ScrollY;
+
+  if (!ImGui::Begin("PolyStation - Profiler")) {
+    ImGui::End();
+    return;
+  }
+
+  profiler::Profiler& profiler = cpu_.GetProfiler();
+  const float available_width = ImGui::GetContentRegionAvail().x;
+
+  if (const auto* label = profiler.IsRunning() ? "Stop profiling"
+                                               : "Start profiling";
+      ImGui::Button(label, ImVec2(available_width, 0.0))) {
+    if (profiler.IsRunning()) {
+      cpu_.StopProfiling();
+    } else {
+      cpu_.StartProfiling();
+    }
+  }
+
+  if (auto interval = profiler.GetInterval();
+      ImGui::InputScalar("Interval (cycles)", ImGuiDataType_U64, &interval)) {
+    profiler.SetInterval(interval);
+  }
+
+  ImGui::InputText("Symbols", symbols_path_.data(), symbols_path_.size());
+  if (ImGui::Button("Load symbols")) {
+    try {
+      profiler.GetSymbols().Load(symbols_path_.data());
+    } catch (const std::exception& e) {
+      std::snprintf(error_message_.data(), error_message_.size(), "%s",
+                    std::format("Symbols Error: {}", e.what()).c_str());
+      show_error_popup_ = true;
+    }
+  }
+  ImGui::SameLine();
+  ImGui::Text("%zu symbols", profiler.GetSymbols().GetCount());
+
+  if (ImGui::Button("Export flamegraph")) {
+    try {
+      profiler.WriteCollapsed(kProfilePath);
+    } catch (const std::exception& e) {
+      std::snprintf(error_message_.data(), error_message_.size(), "%s",
+                    std::format("Profiler Error: {}", e.what()).c_str());
+      show_error_popup_ = true;
+    }
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear")) {
+    profiler.Clear();
+  }
+
+  const uint64_t sample_count = profiler.GetSampleCount();
+  ImGui::Text("Samples: %llu, call depth: %zu",
+              static_cast<unsigned long long>(sample_count),
+              profiler.GetDepth());
+  if (sample_count == 0) {
+    ImGui::End();
+    return;
+  }
+
+  const auto percent = [sample_count](const uint64_t samples) {
+    return 100.0 * static_cast<double>(samples) /
+           static_cast<double>(sample_count);
+  };
+
+  const float functions_height = ImGui::GetContentRegionAvail().y * 0.6F;
+  if (ImGui::BeginTable("ProfilerFunctions", 3, kTableFlags,
+                        ImVec2(0.0F, functions_height))) {
+    ImGui::TableSetupColumn("Function");
+    ImGui::TableSetupColumn("Self %");
+    ImGui::TableSetupColumn("Total %");
+    ImGui::TableHeadersRow();
+
+    const std::vector<profiler::FunctionSamples> functions =
+        profiler.GetFunctions();
+    for (size_t i = 0; i < std::min(functions.size(), kShownFunctions); i++) {
+      const profiler::FunctionSamples& function = gsl::at(functions, i);
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(profiler.Describe(function.function).c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", percent(function.self));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", percent(function.total));
+    }
+    ImGui::EndTable();
+  }
+
+  if (ImGui::BeginTable("ProfilerAddresses", 3, kTableFlags)) {
+    ImGui::TableSetupColumn("Address");
+    ImGui::TableSetupColumn("Self %");
+    ImGui::TableSetupColumn("Location");
+    ImGui::TableHeadersRow();
+
+    for (const profiler::AddressSamples& address :
+         profiler.GetHotAddresses(kShownAddresses)) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%08X", address.address);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", percent(address.samples));
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(profiler.Describe(address.address).c_str());
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+void app::Application::DrawPerformanceWindow() {
+  constexpr std::array<const char*, 2> kFormats = {"Prometheus", "JSON"};
+  constexpr ImGuiTableFlags kTableFlags = ImGuiTableFlags_Borders |
+                                          ImGuiTableFlags_RowBg |
+                                          ImGuiTableFlags_ScrollY;
+
+  if (!ImGui::Begin("PolyStation - Performance")) {
+    ImGui::End();
+    return;
+  }
+
+  ImGui::Text("Frame: %.3f ms, %.2f MIPS",
+              frame_timer_.GetTotalMilliseconds(), frame_timer_.GetMips());
+  for (size_t i = 0; i < metrics::kSubsystemCount; i++) {
+    const auto subsystem = static_cast<metrics::Subsystem>(i);
+    const std::string_view name = metrics::GetSubsystemName(subsystem);
+    ImGui::SameLine();
+    ImGui::Text("/ %.*s %.3f", static_cast<int>(name.size()), name.data(),
+                frame_timer_.GetMilliseconds(subsystem));
+  }
+
+  ImGui::Combo("Format", &metrics_format_, kFormats.data(),
+               static_cast<int>(kFormats.size()));
+  if (ImGui::Checkbox("Dump periodically", &metrics_dump_enabled_)) {
+    next_metrics_dump_ = std::chrono::steady_clock::now();
+  }
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(ImGui::GetFontSize() * 8);
+  if (ImGui::InputInt("Interval (s)", &metrics_dump_interval_)) {
+    metrics_dump_interval_ = std::max(metrics_dump_interval_, 1);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Dump now")) {
+    DumpMetrics();
+  }
+
+  if (ImGui::BeginTable("Metrics", 3, kTableFlags)) {
+    ImGui::TableSetupColumn("Metric");
+    ImGui::TableSetupColumn("Label");
+    ImGui::TableSetupColumn("Value");
+    ImGui::TableHeadersRow();
+
+    for (const metrics::Sample& sample :
+         metrics::Collect(cpu_, &frame_timer_)) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%.*s", static_cast<int>(sample.name.size()),
+                  sample.name.data());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.*s", static_cast<int>(sample.label_value.size()),
+                  sample.label_value.data());
+      ImGui::TableNextColumn();
+      if (sample.type == metrics::Type::kCounter) {
+        ImGui::Text("%.0f", sample.value);
+      } else {
+        ImGui::Text("%.3f", sample.value);
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+void app::Application::DrawInstructionMixWindow() {
+  constexpr size_t kShownPairs = 64;
+  constexpr ImGuiTableFlags kTableFlags = ImGuiTableFlags_Borders |
+                                          ImGuiTableFlags_RowBg |
+                                          ImGuiTableFlags_ScrollY;
+
+  if (!ImGui::Begin("PolyStation - Instruction Mix")) {
+    ImGui::End();
+    return;
+  }
+
+  if constexpr (!histogram::kEnabled) {
+    ImGui::TextWrapped(
+        "Built without POLYSTATION_OPCODE_HISTOGRAM, reconfigure with "
+        "-DPOLYSTATION_OPCODE_HISTOGRAM=ON to count opcodes.");
+    ImGui::End();
+    return;
+  }
+
+  histogram::OpcodeHistogram& histogram = cpu_.GetOpcodeHistogram();
+  const uint64_t total = histogram.GetTotal();
+
+  if (ImGui::Button("Export CSV")) {
+    try {
+      histogram.WriteCsv(kOpcodesPath);
+    } catch (const std::exception& e) {
+      std::snprintf(error_message_.data(), error_message_.size(), "%s",
+                    std::format("Histogram Error: {}", e.what()).c_str());
+      show_error_popup_ = true;
+    }
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear")) {
+    histogram.Clear();
+  }
+  ImGui::SameLine();
+  ImGui::Text("Instructions: %llu", static_cast<unsigned long long>(total));
+  if (total == 0) {
+    ImGui::End();
+    return;
+  }
+
+  const auto percent = [total](const uint64_t count) {
+    return 100.0 * static_cast<double>(count) / static_cast<double>(total);
+  };
+
+  const ImVec2 table_size(ImGui::GetContentRegionAvail().x * 0.5F, 0.0F);
+  if (ImGui::BeginTable("Opcodes", 2, kTableFlags, table_size)) {
+    ImGui::TableSetupColumn("Opcode");
+    ImGui::TableSetupColumn("%");
+    ImGui::TableHeadersRow();
+
+    for (const histogram::OpcodeCount& opcode : histogram.GetOpcodes()) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(isa::GetDecodeName(opcode.index).c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", percent(opcode.count));
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::SameLine();
+  if (ImGui::BeginTable("OpcodePairs", 3, kTableFlags)) {
+    ImGui::TableSetupColumn("First");
+    ImGui::TableSetupColumn("Second");
+    ImGui::TableSetupColumn("%");
+    ImGui::TableHeadersRow();
+
+    for (const histogram::PairCount& pair : histogram.GetPairs(kShownPairs)) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(isa::GetDecodeName(pair.first).c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(isa::GetDecodeName(pair.second).c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", percent(pair.count));
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+void app::Application::DumpMetrics() {
+  next_metrics_dump_ = std::chrono::steady_clock::now() +
+                       std::chrono::seconds(metrics_dump_interval_);
+  try {
+    metrics::WriteFile(gsl::at(kMetricsPaths, metrics_format_),
+                       metrics::Collect(cpu_, &frame_timer_));
+  } catch (const std::exception& e) {
+    metrics_dump_enabled_ = false;
+    std::snprintf(error_message_.data(), error_message_.size(), "%s",
+                  std::format("Metrics Error: {}", e.what()).c_str());
+    show_error_popup_ = true;
+  }
+}
+
+void app::Application::SaveQuickState() {
+  try {
+    constexpr auto kCompression = savestate::Compression::kZeroRun;
+
+    if (const size_t size = cpu_.GetStateSize(kCompression);
+        state_buffer_.size() < size) {
+      state_buffer_.resize(size);
+    }
+    const size_t size = cpu_.SaveState(state_buffer_, kCompression);
+    savestate::WriteFile(kQuickSavePath,
+                         std::span(state_buffer_).first(size));
+  } catch (const std::exception& e) {
+    std::snprintf(error_message_.data(), error_message_.size(), "%s",
+                  std::format("Savestate Error: {}", e.what()).c_str());
+    show_error_popup_ = true;
+  }
+}
+
+void app::Application::LoadQuickState() {
+  try {
+    const savestate::MappedFile file(kQuickSavePath);
+    cpu_.LoadState(file.GetData());
+    rewind_buffer_.Clear();
+  } catch (const std::exception& e) {
+    std::snprintf(error_message_.data(), error_message_.size(), "%s",
+                  std::format("Savestate Error: {}", e.what()).c_str());
+    show_error_popup_ = true;
+  }
+}
+
 void app::Application::DrawCpuDisassembler() const {
   constexpr uint32_t kMaxInstructions = 25;
 
@@ -596,12 +1199,7 @@ void app::Application::DrawCpuDisassembler() const {
       continue;
     }
 
-    uint32_t instruction_data = 0;
-    try {
-      instruction_data = cpu_.Load32(pc);
-    } catch (const std::exception&) {
-      continue;
-    }
+    const uint32_t instruction_data = cpu_.Peek32(pc);
 
     const cpu::Instruction instruction(instruction_data);
 
@@ -755,6 +1353,10 @@ void app::Application::SetupDockingLayout() {
 
       ImGui::DockBuilderDockWindow("PolyStation - Controls", dock_top_left);
       ImGui::DockBuilderDockWindow("PolyStation - CPU State", dock_bottom);
+      ImGui::DockBuilderDockWindow("PolyStation - Profiler", dock_bottom);
+      ImGui::DockBuilderDockWindow("PolyStation - Performance", dock_bottom);
+      ImGui::DockBuilderDockWindow("PolyStation - Instruction Mix",
+                                   dock_bottom);
       ImGui::DockBuilderDockWindow("PolyStation - Display", dock_top_center);
       ImGui::DockBuilderDockWindow("PolyStation - CPU Disassembler",
                                    dock_top_right);
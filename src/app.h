@@ -3,10 +3,18 @@
 #include <SDL.h>
 #include <SDL_vulkan.h>
 
+#include <chrono>
 #include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "cpu.h"
+#include "metrics.h"
+#include "rewind_buffer.h"
+#include "run_ahead.h"
+#include "worker_pool.h"
 #include "imgui.h"
 #include "imgui_impl_vulkan.h"
 
@@ -20,6 +28,12 @@ constexpr bool kEnableValidationLayers = true;
 constexpr bool kEnableSimplifiedUI = false;
 #endif
 
+constexpr const char* kQuickSavePath = "quicksave.pss";
+constexpr const char* kProfilePath = "profile.folded";
+constexpr const char* kOpcodesPath = "opcodes.csv";
+constexpr std::array<const char*, 2> kMetricsPaths = {"metrics.prom",
+                                                      "metrics.json"};
+
 VkResult CreateDebugMessengerEXT(
     VkInstance instance,
     const VkDebugUtilsMessengerCreateInfoEXT* p_create_info,
@@ -35,7 +49,14 @@ void CheckVkResult(VkResult err);
 namespace app {
 class Application {
  public:
-  explicit Application(const std::string& bios_path) : cpu_(bios_path) {}
+  explicit Application(const std::string& bios_path,
+                       const std::optional<std::string>& exe_path = std::nullopt)
+      : cpu_(bios_path) {
+    cpu_.SetMdecPool(std::make_shared<worker_pool::WorkerPool>());
+    if (exe_path.has_value()) {
+      cpu_.Sideload(std::make_shared<const exe::Executable>(exe_path.value()));
+    }
+  }
 
   void Run();
 
@@ -63,9 +84,32 @@ class Application {
   bool show_error_popup_ = false;
   std::array<char, 1024> error_message_{};
 
-  bool step_to_pc_ = false;
   uint32_t target_pc_ = bios::kBiosBase;
 
+  breakpoint::Breakpoint new_breakpoint_;
+  bool new_breakpoint_conditional_ = false;
+  breakpoint::Condition new_breakpoint_condition_;
+
+  watchpoint::Watchpoint new_watchpoint_;
+
+  std::array<char, 256> symbols_path_{};
+
+  // Reused across quick saves, it only grows.
+  std::vector<std::byte> state_buffer_;
+
+  bool rewind_enabled_ = false;
+  rewind_buffer::RewindBuffer rewind_buffer_;
+
+  bool run_ahead_enabled_ = false;
+  run_ahead::RunAhead run_ahead_;
+
+  metrics::FrameTimer frame_timer_;
+  // Index into kMetricsPaths, the extension picks the format.
+  int metrics_format_ = 0;
+  bool metrics_dump_enabled_ = false;
+  int metrics_dump_interval_ = 5;
+  std::chrono::steady_clock::time_point next_metrics_dump_;
+
   void InitSDL();
   void InitVulkan();
   void InitImGui() const;
@@ -87,6 +131,16 @@ class Application {
   void DrawControlWindow();
   void DrawCpuDisassembler() const;
   void DrawErrorPopup();
+  void SaveQuickState();
+  void LoadQuickState();
+  void DrawRewindControls();
+  void DrawRunAheadControls();
+  void DrawBreakpointControls();
+  void DrawWatchpointControls();
+  void DrawProfilerWindow();
+  void DrawPerformanceWindow();
+  void DrawInstructionMixWindow();
+  void DumpMetrics();
   static void DrawMainViewWindow();
   static void SetupDockingLayout();
   static void DrawTableCell(const char* reg_name, uint32_t reg_value);
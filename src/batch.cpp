@@ -0,0 +1,330 @@
+#include "batch.h"
+
+#include <chrono>
+#include <format>
+#include <gsl/gsl>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#include "core.h"
+#include "metrics.h"
+#include "worker_pool.h"
+
+namespace {
+constexpr uint64_t kFnvOffsetBasis = 0xCBF29CE484222325ULL;
+constexpr uint64_t kFnvPrime = 0x100000001B3ULL;
+
+std::string EscapeJson(const std::string_view text) {
+  std::string escaped;
+  escaped.reserve(text.size());
+  for (const char character : text) {
+    switch (character) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(character) < 0x20) {
+          escaped += std::format("\\u{:04x}", character);
+        } else {
+          escaped += character;
+        }
+    }
+  }
+  return escaped;
+}
+
+batch::Job ParseJob(const std::string& line, const size_t line_number) {
+  batch::Job job;
+  job.name = std::format("job{}", line_number);
+
+  std::istringstream tokens(line);
+  std::string token;
+  while (tokens >> token) {
+    const size_t separator = token.find('=');
+    const std::string key = token.substr(0, separator);
+    const std::string value =
+        separator == std::string::npos ? "" : token.substr(separator + 1);
+
+    if (key == "accurate") {
+      job.accuracy = cpu::Accuracy::kAccurate;
+    } else if (key == "idle_skip") {
+      job.idle_skipping = true;
+    } else if (key == "no_fusion") {
+      job.fusion = false;
+    } else if (key == "cached_interpreter") {
+      job.backend = cpu::Backend::kCachedInterpreter;
+    } else if (key == "hle") {
+      job.hle_mode = hle::Mode::kOn;
+    } else if (key == "hle_verify") {
+      job.hle_mode = hle::Mode::kVerify;
+    } else if (key == "hash") {
+      job.hash = true;
+    } else if (value.empty()) {
+      throw std::runtime_error(
+          std::format("line {}: {} needs a value", line_number, key));
+    } else if (key == "name") {
+      job.name = value;
+    } else if (key == "bios") {
+      job.bios_path = value;
+    } else if (key == "exe") {
+      job.exe_path = value;
+    } else if (key == "cycles") {
+      job.cycles = std::stoull(value);
+    } else if (key == "frames") {
+      job.cycles = std::stoull(value) * cpu::kCyclesPerFrame;
+    } else if (key == "seconds") {
+      job.cycles = std::stoull(value) * cpu::kCpuClock;
+    } else if (key == "block_cache") {
+      job.block_cache_path = value;
+    } else if (key == "dump_ram") {
+      job.dump_ram_path = value;
+    } else if (key == "save_state") {
+      job.save_state_path = value;
+    } else if (key == "trace") {
+      job.trace_path = value;
+    } else if (key == "profile") {
+      job.profile_path = value;
+    } else if (key == "profile_interval") {
+      job.profile_interval = std::stoull(value);
+    } else if (key == "symbols") {
+      job.symbols_path = value;
+    } else if (key == "metrics") {
+      job.metrics_path = value;
+    } else if (key == "opcodes") {
+      job.opcodes_path = value;
+    } else {
+      throw std::runtime_error(
+          std::format("line {}: unknown key {}", line_number, key));
+    }
+  }
+
+  if (job.bios_path.empty()) {
+    throw std::runtime_error(std::format("line {}: missing bios", line_number));
+  }
+  return job;
+}
+}  // namespace
+
+std::string batch::Result::ToJson() const {
+  std::string json = std::format(
+      R"({{"name":"{}","cycles":{},"instructions":{},"host_seconds":{:.6f})",
+      EscapeJson(name), cycles, instructions, host_seconds);
+  if (hle.has_value()) {
+    json += std::format(
+        R"(,"hle_calls":{},"hle_verified":{},"hle_mismatches":{})",
+        hle->calls, hle->verified, hle->mismatches);
+  }
+  if (idle_loop.has_value()) {
+    json += std::format(R"(,"idle_loops_skipped":{},"idle_cycles_skipped":{})",
+                        idle_loop->loops_skipped, idle_loop->cycles_skipped);
+  }
+  if (ram_hash.has_value()) {
+    json += std::format(R"(,"ram_hash":"{:016X}")", ram_hash.value());
+  }
+  if (state_hash.has_value()) {
+    json += std::format(R"(,"state_hash":"{:016X}")", state_hash.value());
+  }
+  if (error.has_value()) {
+    json += std::format(R"(,"error":"{}")", EscapeJson(error.value()));
+  }
+  json += '}';
+  return json;
+}
+
+std::vector<batch::Job> batch::ParseJobs(std::istream& input) {
+  std::vector<Job> jobs;
+  std::string line;
+  size_t line_number = 0;
+
+  while (std::getline(input, line)) {
+    line_number++;
+    const size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#') {
+      continue;
+    }
+    jobs.push_back(ParseJob(line, line_number));
+  }
+
+  return jobs;
+}
+
+batch::Result batch::RunJob(
+    const Job& job, std::shared_ptr<const bios::Image> bios,
+    std::shared_ptr<worker_pool::WorkerPool> mdec_pool) {
+  Result result{.name = job.name};
+
+  try {
+    core::Machine machine{core::Config{.bios_path = job.bios_path,
+                                       .bios_image = std::move(bios),
+                                       .exe_path = job.exe_path,
+                                       .accuracy = job.accuracy,
+                                       .hle_mode = job.hle_mode,
+                                       .idle_skipping = job.idle_skipping,
+                                       .fusion = job.fusion,
+                                       .backend = job.backend,
+                                       .mdec_pool = std::move(mdec_pool),
+                                       .name = job.name,
+                                       .log_level = spdlog::level::warn}};
+    cpu::CPU& cpu = machine.GetCpu();
+    if (job.block_cache_path.has_value()) {
+      cpu.GetBlockCache().Load(job.block_cache_path.value());
+    }
+    if (job.trace_path.has_value()) {
+      cpu.StartTrace(job.trace_path.value());
+    }
+    if (job.profile_path.has_value()) {
+      profiler::Profiler& profiler = cpu.GetProfiler();
+      profiler.SetInterval(job.profile_interval);
+      if (job.symbols_path.has_value()) {
+        profiler.GetSymbols().Load(job.symbols_path.value());
+      }
+      cpu.StartProfiling();
+    }
+    if (job.opcodes_path.has_value() && !histogram::kEnabled) {
+      throw std::runtime_error(
+          "opcode counts need a POLYSTATION_OPCODE_HISTOGRAM build");
+    }
+
+    metrics::FrameTimer timer;
+    timer.Start(metrics::Subsystem::kCpu);
+    machine.RunFor(job.cycles);
+    timer.EndFrame(cpu.GetStepCount());
+    cpu.StopTrace();
+    if (job.profile_path.has_value()) {
+      cpu.StopProfiling();
+      cpu.GetProfiler().WriteCollapsed(job.profile_path.value());
+    }
+
+    result.cycles = cpu.GetCycleCount();
+    result.instructions = cpu.GetStepCount();
+    result.host_seconds =
+        timer.GetMilliseconds(metrics::Subsystem::kCpu) / 1000.0;
+    if (job.hle_mode != hle::Mode::kOff) {
+      result.hle = cpu.GetHleStats();
+    }
+    if (job.idle_skipping) {
+      result.idle_loop = cpu.GetIdleLoopStats();
+    }
+    if (job.block_cache_path.has_value()) {
+      cpu.GetBlockCache().Save(job.block_cache_path.value());
+    }
+    if (job.opcodes_path.has_value()) {
+      cpu.GetOpcodeHistogram().WriteCsv(job.opcodes_path.value());
+    }
+    if (job.metrics_path.has_value()) {
+      metrics::WriteFile(job.metrics_path.value(),
+                         metrics::Collect(cpu, &timer));
+    }
+
+    if (job.hash || job.dump_ram_path.has_value()) {
+      std::vector<std::byte> ram(ram::kRamSize);
+      for (uint32_t page = 0; page < ram::kPageCount; page++) {
+        const auto source = cpu.GetRam().GetPage(page);
+        const auto offset = static_cast<std::ptrdiff_t>(page * ram::kPageSize);
+        std::copy(source.begin(), source.end(), ram.begin() + offset);
+      }
+
+      if (job.hash) {
+        result.ram_hash = HashBytes(ram);
+      }
+      if (job.dump_ram_path.has_value()) {
+        savestate::WriteFile(job.dump_ram_path.value(), ram);
+      }
+    }
+
+    if (job.hash || job.save_state_path.has_value()) {
+      constexpr auto kCompression = savestate::Compression::kNone;
+      std::vector<std::byte> state(machine.GetStateSize(kCompression));
+      state.resize(machine.SaveState(state, kCompression));
+
+      if (job.hash) {
+        result.state_hash = HashBytes(state);
+      }
+      if (job.save_state_path.has_value()) {
+        savestate::WriteFile(job.save_state_path.value(), state);
+      }
+    }
+  } catch (const std::exception& e) {
+    result.error = e.what();
+  }
+
+  return result;
+}
+
+uint64_t batch::HashBytes(const std::span<const std::byte> data) {
+  uint64_t hash = kFnvOffsetBasis;
+  for (const std::byte byte : data) {
+    hash = (hash ^ std::to_integer<uint64_t>(byte)) * kFnvPrime;
+  }
+  return hash;
+}
+
+batch::Summary batch::RunJobs(const std::span<const Job> jobs,
+                              const size_t thread_count,
+                              std::ostream& output) {
+  // Mapped up front so workers only ever take references to shared images.
+  std::map<std::string, std::shared_ptr<const bios::Image>> images;
+  std::map<std::string, std::string> image_errors;
+  for (const Job& job : jobs) {
+    if (images.contains(job.bios_path) ||
+        image_errors.contains(job.bios_path)) {
+      continue;
+    }
+    try {
+      images.emplace(job.bios_path, bios::Image::Open(job.bios_path));
+    } catch (const std::exception& e) {
+      image_errors.emplace(job.bios_path, e.what());
+    }
+  }
+
+  Summary summary{.jobs = jobs.size()};
+  std::mutex output_mutex;
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // Every job thread takes part in its own MDEC decodes, so only the
+  // remaining hardware threads go to the shared pool.
+  const size_t hardware_threads =
+      worker_pool::WorkerPool::DefaultThreadCount() + 1;
+  std::shared_ptr<worker_pool::WorkerPool> mdec_pool;
+  if (hardware_threads > thread_count) {
+    mdec_pool = std::make_shared<worker_pool::WorkerPool>(hardware_threads -
+                                                          thread_count);
+  }
+
+  // The calling thread takes part in ParallelFor as well.
+  worker_pool::WorkerPool pool(thread_count > 1 ? thread_count - 1 : 0);
+  pool.ParallelFor(jobs.size(), [&](const size_t index) {
+    const Job& job = gsl::at(jobs, index);
+
+    Result result;
+    if (const auto error = image_errors.find(job.bios_path);
+        error != image_errors.end()) {
+      result = Result{.name = job.name, .error = error->second};
+    } else {
+      result = RunJob(job, images.at(job.bios_path), mdec_pool);
+    }
+
+    const std::string line = result.ToJson();
+    const std::scoped_lock lock(output_mutex);
+    output << line << '\n' << std::flush;
+    summary.instructions += result.instructions;
+    if (result.error.has_value()) {
+      summary.failures++;
+    }
+  });
+
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  summary.host_seconds = elapsed.count();
+
+  return summary;
+}
@@ -0,0 +1,90 @@
+#ifndef POLYSTATION_BATCH_H
+#define POLYSTATION_BATCH_H
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "worker_pool.h"
+
+namespace batch {
+constexpr uint64_t kDefaultFrames = 60;
+
+struct Job {
+  std::string name;
+  std::string bios_path;
+  std::optional<std::string> exe_path = std::nullopt;
+  uint64_t cycles = kDefaultFrames * cpu::kCyclesPerFrame;
+  cpu::Accuracy accuracy = cpu::Accuracy::kFast;
+  hle::Mode hle_mode = hle::Mode::kOff;
+  bool idle_skipping = false;
+  bool fusion = true;
+  cpu::Backend backend = cpu::Backend::kInterpreter;
+  // Translated blocks kept across runs, see block_cache::Cache::Load.
+  std::optional<std::string> block_cache_path = std::nullopt;
+  bool hash = false;
+  std::optional<std::string> dump_ram_path = std::nullopt;
+  std::optional<std::string> save_state_path = std::nullopt;
+  std::optional<std::string> trace_path = std::nullopt;
+  // Collapsed call stacks, see profiler::Profiler::WriteCollapsed.
+  std::optional<std::string> profile_path = std::nullopt;
+  uint64_t profile_interval = profiler::kDefaultInterval;
+  std::optional<std::string> symbols_path = std::nullopt;
+  // Host-side counters at the end of the run, see metrics::WriteFile.
+  std::optional<std::string> metrics_path = std::nullopt;
+  // Opcode and pair counts, needs a build with histogram::kEnabled.
+  std::optional<std::string> opcodes_path = std::nullopt;
+} __attribute__((aligned(128)));
+
+struct Result {
+  std::string name;
+  uint64_t cycles = 0;
+  unsigned long long instructions = 0;
+  double host_seconds = 0.0;
+  std::optional<hle::Stats> hle = std::nullopt;
+  std::optional<idle_loop::Stats> idle_loop = std::nullopt;
+  std::optional<uint64_t> ram_hash = std::nullopt;
+  std::optional<uint64_t> state_hash = std::nullopt;
+  std::optional<std::string> error = std::nullopt;
+
+  [[nodiscard]] std::string ToJson() const;
+} __attribute__((aligned(128)));
+
+struct Summary {
+  size_t jobs = 0;
+  size_t failures = 0;
+  unsigned long long instructions = 0;
+  double host_seconds = 0.0;
+} __attribute__((aligned(32)));
+
+// One job per line, whitespace separated key=value pairs:
+//   name=boot bios=scph1001.bin frames=600 accurate hash
+// Recognized keys are name, bios, exe, cycles, frames, seconds, accurate,
+// hle, hle_verify, idle_skip, no_fusion, cached_interpreter, block_cache,
+// hash, dump_ram, save_state, trace, profile, profile_interval, symbols,
+// metrics and opcodes. Blank lines and lines starting with '#' are skipped.
+[[nodiscard]] std::vector<Job> ParseJobs(std::istream& input);
+
+// Runs a single job on the calling thread, large MDEC batches are split
+// across `mdec_pool` when given. Failures are reported in the result instead
+// of thrown.
+[[nodiscard]] Result RunJob(
+    const Job& job, std::shared_ptr<const bios::Image> bios,
+    std::shared_ptr<worker_pool::WorkerPool> mdec_pool = nullptr);
+
+[[nodiscard]] uint64_t HashBytes(std::span<const std::byte> data);
+
+// Runs every job on its own machine across `thread_count` threads and
+// streams one JSON line per job to `output` as soon as it finishes. Jobs
+// naming the same BIOS share one read-only mapping of it, and all of them
+// share one MDEC pool sized to the hardware threads the jobs leave free.
+Summary RunJobs(std::span<const Job> jobs, size_t thread_count,
+                std::ostream& output);
+}  // namespace batch
+
+#endif  // POLYSTATION_BATCH_H
@@ -1,14 +1,58 @@
 #include "bios.h"
 
-#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-bios::Bios::Bios(const std::string& path) {
-  data_.resize(kBiosSize);
-  std::ifstream input(path, std::ios::binary);
-  input.read(reinterpret_cast<char*>(data_.data()), kBiosSize);
-  input.close();
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+std::shared_ptr<const bios::Image> bios::Image::Open(const std::string& path) {
+  const int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (descriptor < 0) {
+    throw std::runtime_error(std::format("failed to open BIOS {}", path));
+  }
+
+  struct stat status {};
+  if (fstat(descriptor, &status) != 0) {
+    close(descriptor);
+    throw std::runtime_error(std::format("failed to read BIOS {}", path));
+  }
+
+  // Reserve the whole BIOS range first so a short image reads back zeros
+  // past its end instead of faulting.
+  void* data = mmap(nullptr, kBiosSize, PROT_READ,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  const auto file_size = std::min(static_cast<size_t>(status.st_size),
+                                  static_cast<size_t>(kBiosSize));
+  if (data != MAP_FAILED && file_size != 0 &&
+      mmap(data, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, descriptor,
+           0) == MAP_FAILED) {
+    munmap(data, kBiosSize);
+    data = MAP_FAILED;
+  }
+  close(descriptor);
+
+  if (data == MAP_FAILED) {
+    throw std::runtime_error(std::format("failed to map BIOS {}", path));
+  }
+  return std::shared_ptr<const Image>(new Image(data));
+}
+
+bios::Image::~Image() { munmap(data_, kBiosSize); }
+
+std::span<const std::byte, bios::kBiosSize> bios::Image::GetData() const {
+  return std::span<const std::byte, kBiosSize>(
+      static_cast<const std::byte*>(data_), kBiosSize);
 }
 
+bios::Bios::Bios(const std::string& path) : Bios(Image::Open(path)) {}
+
+bios::Bios::Bios(std::shared_ptr<const Image> image)
+    : image_(std::move(image)), data_(image_->GetData()) {}
+
 uint32_t bios::Bios::Load32(const uint32_t offset) const {
   const auto byte_0 = std::to_integer<uint32_t>(data_[offset + 0]);
   const auto byte_1 = std::to_integer<uint32_t>(data_[offset + 1]);
@@ -18,6 +62,13 @@ uint32_t bios::Bios::Load32(const uint32_t offset) const {
   return byte_0 | byte_1 << 8U | byte_2 << 16U | byte_3 << 24U;
 }
 
+uint16_t bios::Bios::Load16(const uint32_t offset) const {
+  const auto byte_0 = std::to_integer<uint32_t>(data_[offset + 0]);
+  const auto byte_1 = std::to_integer<uint32_t>(data_[offset + 1]);
+
+  return static_cast<uint16_t>(byte_0 | byte_1 << 8U);
+}
+
 uint8_t bios::Bios::Load8(const uint32_t offset) const {
   return std::to_integer<uint8_t>(data_[offset]);
 }
\ No newline at end of file
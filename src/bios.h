@@ -1,21 +1,45 @@
 #ifndef POLYSTATION_BIOS_H
 #define POLYSTATION_BIOS_H
 #include <filesystem>
-#include <vector>
+#include <memory>
+#include <span>
 
 namespace bios {
 constexpr uint32_t kBiosBase = 0xBFC00000;
 constexpr uint32_t kBiosSize = 0x80000;
 
+// Read-only mapping of a BIOS file. Machines hold it through a shared_ptr,
+// so any number of them in a process share the same physical pages.
+class Image {
+ public:
+  static std::shared_ptr<const Image> Open(const std::string& path);
+  ~Image();
+
+  Image(const Image&) = delete;
+  Image& operator=(const Image&) = delete;
+  Image(Image&&) = delete;
+  Image& operator=(Image&&) = delete;
+
+  [[nodiscard]] std::span<const std::byte, kBiosSize> GetData() const;
+
+ private:
+  explicit Image(void* data) : data_(data) {}
+
+  void* data_;
+};
+
 class Bios {
  public:
   explicit Bios(const std::string& path);
+  explicit Bios(std::shared_ptr<const Image> image);
 
   [[nodiscard]] uint32_t Load32(uint32_t offset) const;
+  [[nodiscard]] uint16_t Load16(uint32_t offset) const;
   [[nodiscard]] uint8_t Load8(uint32_t offset) const;
 
  private:
-  std::vector<std::byte> data_;
+  std::shared_ptr<const Image> image_;
+  std::span<const std::byte, kBiosSize> data_;
 };
 }  // namespace bios
 
@@ -0,0 +1,372 @@
+#include "block_cache.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <gsl/gsl>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#include "exe.h"
+#include "hle.h"
+
+namespace {
+constexpr uint32_t kInstructionLength = 4;
+constexpr uint32_t kRegisterCount = 32;
+
+constexpr uint32_t kFileMagic = savestate::MakeTag("PSXB");
+// Bumped whenever translation or the ops change, older files are ignored.
+constexpr uint32_t kFileVersion = 1;
+
+constexpr uint64_t kFnvOffsetBasis = 0xCBF29CE484222325ULL;
+constexpr uint64_t kFnvPrime = 0x100000001B3ULL;
+
+// Blocks are compared with RAM and saved as raw bytes.
+static_assert(std::endian::native == std::endian::little);
+
+struct FileHeader {
+  uint32_t magic = kFileMagic;
+  uint32_t version = kFileVersion;
+  uint32_t op_size = sizeof(ir::Op);
+  uint32_t count = 0;
+} __attribute__((aligned(16)));
+
+// Followed by the block's code words and ops.
+struct BlockHeader {
+  uint32_t start = 0;
+  uint64_t code_hash = 0;
+  uint16_t code_size = 0;
+  uint16_t op_count = 0;
+  ir::Value next = ir::kNoValue;
+  ir::Value pending_value = ir::kNoValue;
+  uint8_t pending_register = 0;
+  bool delay_slot_pending = false;
+} __attribute__((aligned(32)));
+
+// Where a block may start, and the range its code must stay within.
+std::optional<bus::MemoryRange> GetCodeRange(const uint32_t address) {
+  if (bus::kRamMemoryRange.InRange(address)) {
+    return bus::kRamMemoryRange;
+  }
+  if (bus::kBiosMemoryRange.InRange(address)) {
+    return bus::kBiosMemoryRange;
+  }
+  return std::nullopt;
+}
+
+// A block never runs past a PC the CPU has to intercept, those start
+// blocks of their own.
+bool IsEntryPoint(const uint32_t pc) {
+  return pc == exe::kShellEntry || hle::GetTable(pc).has_value();
+}
+
+ir::Block Translate(const uint32_t pc, const bus::Bus& bus) {
+  const uint32_t address = bus::MaskRegion(pc);
+  const std::optional<bus::MemoryRange> range = GetCodeRange(address);
+  if (!range.has_value()) {
+    return ir::Translate(pc, {});
+  }
+
+  std::array<uint32_t, ir::kMaxInstructions> code{};
+  size_t count = 0;
+  for (; count < code.size(); count++) {
+    const auto offset = static_cast<uint32_t>(count * kInstructionLength);
+    if (!range->InRange(address + offset) ||
+        (count != 0 && IsEntryPoint(pc + offset))) {
+      break;
+    }
+    gsl::at(code, count) = bus.Peek32(pc + offset);
+  }
+
+  ir::Block block = ir::Translate(pc, std::span(code).first(count));
+  ir::Optimize(block);
+  return block;
+}
+
+// Whether memory at `start` still holds `code`.
+bool Matches(const uint32_t start, const std::span<const uint32_t> code,
+             const bus::Bus& bus) {
+  const uint32_t address = bus::MaskRegion(start);
+  const std::optional<bus::MemoryRange> range = GetCodeRange(address);
+  const auto size = static_cast<uint32_t>(code.size_bytes());
+  if (!range.has_value() || size == 0 ||
+      !range->InRange(address + size - 1)) {
+    return false;
+  }
+
+  if (bus::kRamMemoryRange.InRange(address)) {
+    const uint32_t offset = address - bus::kRamMemoryRange.base;
+    return std::memcmp(code.data(),
+                       bus.GetRam().GetData().subspan(offset, size).data(),
+                       size) == 0;
+  }
+  for (size_t i = 0; i < code.size(); i++) {
+    const auto offset = static_cast<uint32_t>(i * kInstructionLength);
+    if (bus.Peek32(start + offset) != code[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t HashCode(const std::span<const uint32_t> code) {
+  uint64_t hash = kFnvOffsetBasis;
+  for (const std::byte byte : std::as_bytes(code)) {
+    hash = (hash ^ std::to_integer<uint64_t>(byte)) * kFnvPrime;
+  }
+  return hash;
+}
+
+size_t GetBlockSize(const BlockHeader& header) {
+  return sizeof(BlockHeader) + header.code_size * sizeof(uint32_t) +
+         header.op_count * sizeof(ir::Op);
+}
+
+BlockHeader ReadBlockHeader(const std::span<const std::byte> data) {
+  BlockHeader header{};
+  std::memcpy(&header, data.data(), sizeof(header));
+  return header;
+}
+
+// Files come from another run, a block whose ops refer to anything but
+// earlier results or to registers and instructions that do not exist, or
+// whose enums are out of range, is not used. Backends trust address tags
+// without checks, so each must be the one ClassifyAddresses gives.
+bool IsWellFormed(const ir::Block& block) {
+  const auto refers_back = [](const ir::Value value, const size_t limit) {
+    return value == ir::kNoValue || value < limit;
+  };
+  for (size_t i = 0; i < block.ops.size(); i++) {
+    const ir::Op& op = block.ops[i];
+    if (op.opcode > ir::Opcode::kInterpret || op.access > ir::Access::kWord ||
+        op.condition > ir::Condition::kGreaterOrEqualZero ||
+        op.address > ir::Address::kIo || !refers_back(op.a, i) ||
+        !refers_back(op.b, i)) {
+      return false;
+    }
+    const bool indexes_code = op.opcode == ir::Opcode::kInstruction ||
+                              op.opcode == ir::Opcode::kInterpret;
+    if (op.index >= (indexes_code ? block.code.size() : kRegisterCount) ||
+        op.address != ir::ClassifyAddress(block, op)) {
+      return false;
+    }
+  }
+  return refers_back(block.next, block.ops.size()) &&
+         refers_back(block.pending_value, block.ops.size()) &&
+         block.pending_register < kRegisterCount;
+}
+
+void AppendBytes(std::vector<std::byte>& data,
+                 const std::span<const std::byte> bytes) {
+  data.insert(data.end(), bytes.begin(), bytes.end());
+}
+
+// Headers and ops are filled in over zeroed bytes, so the padding between
+// their members is written as zeros and the same blocks give the same file.
+void AppendOp(std::vector<std::byte>& data, const ir::Op& op) {
+  ir::Op copy;
+  std::memset(static_cast<void*>(&copy), 0, sizeof(copy));
+  copy.opcode = op.opcode;
+  copy.index = op.index;
+  copy.access = op.access;
+  copy.condition = op.condition;
+  copy.address = op.address;
+  copy.a = op.a;
+  copy.b = op.b;
+  copy.immediate = op.immediate;
+  AppendBytes(data, std::as_bytes(std::span(&copy, 1)));
+}
+
+void AppendBlock(std::vector<std::byte>& data, const ir::Block& block) {
+  BlockHeader header;
+  std::memset(static_cast<void*>(&header), 0, sizeof(header));
+  header.start = block.start;
+  header.code_hash = HashCode(block.code);
+  header.code_size = static_cast<uint16_t>(block.code.size());
+  header.op_count = static_cast<uint16_t>(block.ops.size());
+  header.next = block.next;
+  header.pending_value = block.pending_value;
+  header.pending_register = block.pending_register;
+  header.delay_slot_pending = block.delay_slot_pending;
+  AppendBytes(data, std::as_bytes(std::span(&header, 1)));
+  AppendBytes(data, std::as_bytes(std::span(block.code)));
+  for (const ir::Op& op : block.ops) {
+    AppendOp(data, op);
+  }
+}
+
+// Unique per process and per call, so saves never share a temporary file.
+std::filesystem::path GetTemporaryPath(const std::filesystem::path& path) {
+  static std::atomic<uint64_t> counter{0};
+  std::filesystem::path temporary = path;
+  temporary += std::format(".{}.{}.tmp", getpid(), counter++);
+  return temporary;
+}
+}  // namespace
+
+const ir::Block& block_cache::Cache::Get(const uint32_t pc,
+                                         const bus::Bus& bus) {
+  auto [entry, inserted] = blocks_.try_emplace(pc);
+  ir::Block& block = entry->second;
+  if (!inserted) {
+    if (!bus::kRamMemoryRange.InRange(bus::MaskRegion(pc)) ||
+        block.code.empty() || Matches(pc, block.code, bus)) {
+      return block;
+    }
+    stats_.invalidated++;
+  }
+
+  if (Restore(pc, bus, block)) {
+    stats_.loaded++;
+    return block;
+  }
+  block = Translate(pc, bus);
+  stats_.translated++;
+  return block;
+}
+
+void block_cache::Cache::Load(const std::filesystem::path& path) {
+  file_.reset();
+  file_blocks_.clear();
+  if (!std::filesystem::exists(path) || std::filesystem::is_empty(path)) {
+    return;
+  }
+
+  auto file = std::make_unique<savestate::MappedFile>(path);
+  const std::span<const std::byte> data = file->GetData();
+  FileHeader header{};
+  if (data.size() < sizeof(header)) {
+    throw std::runtime_error(
+        std::format("block cache {} truncated", path.string()));
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != kFileMagic) {
+    throw std::runtime_error(
+        std::format("{} is not a block cache", path.string()));
+  }
+  if (header.version != kFileVersion || header.op_size != sizeof(ir::Op)) {
+    return;
+  }
+
+  size_t offset = sizeof(header);
+  for (uint32_t i = 0; i < header.count; i++) {
+    if (data.size() - offset < sizeof(BlockHeader)) {
+      throw std::runtime_error(
+          std::format("block cache {} truncated", path.string()));
+    }
+    const BlockHeader block = ReadBlockHeader(data.subspan(offset));
+    if (block.code_size == 0 || block.code_size > ir::kMaxInstructions ||
+        block.op_count > ir::kMaxOps ||
+        data.size() - offset < GetBlockSize(block)) {
+      throw std::runtime_error(
+          std::format("block cache {} is corrupt", path.string()));
+    }
+    file_blocks_.emplace(block.start, offset);
+    offset += GetBlockSize(block);
+  }
+  file_ = std::move(file);
+}
+
+void block_cache::Cache::Save(const std::filesystem::path& path) const {
+  std::vector<const ir::Block*> blocks;
+  for (const auto& [pc, block] : blocks_) {
+    if (!block.code.empty()) {
+      blocks.push_back(&block);
+    }
+  }
+  std::ranges::sort(blocks, {}, &ir::Block::start);
+
+  std::vector<size_t> file_offsets;
+  for (const auto& [pc, offset] : file_blocks_) {
+    file_offsets.push_back(offset);
+  }
+  std::ranges::sort(file_offsets);
+
+  FileHeader header{};
+  std::vector<std::byte> data(sizeof(header));
+  std::set<std::pair<uint32_t, uint64_t>> saved;
+  for (const ir::Block* block : blocks) {
+    saved.emplace(block->start, HashCode(block->code));
+    AppendBlock(data, *block);
+    header.count++;
+  }
+  for (const size_t offset : file_offsets) {
+    const std::span<const std::byte> file = file_->GetData().subspan(offset);
+    const BlockHeader block = ReadBlockHeader(file);
+    if (saved.emplace(block.start, block.code_hash).second) {
+      AppendBytes(data, file.first(GetBlockSize(block)));
+      header.count++;
+    }
+  }
+  std::memcpy(data.data(), &header, sizeof(header));
+
+  const std::filesystem::path temporary = GetTemporaryPath(path);
+  std::error_code error;
+  {
+    std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+    output.write(reinterpret_cast<const char*>(data.data()),
+                 static_cast<std::streamsize>(data.size()));
+    output.close();
+    if (!output) {
+      std::filesystem::remove(temporary, error);
+      throw std::runtime_error(std::format("failed to write block cache {}",
+                                           temporary.string()));
+    }
+  }
+
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    const std::string message = error.message();
+    std::filesystem::remove(temporary, error);
+    throw std::runtime_error(std::format("failed to write block cache {}: {}",
+                                         path.string(), message));
+  }
+}
+
+const block_cache::Stats& block_cache::Cache::GetStats() const {
+  return stats_;
+}
+
+block_cache::Stats& block_cache::Cache::GetStats() { return stats_; }
+
+bool block_cache::Cache::Restore(const uint32_t pc, const bus::Bus& bus,
+                                 ir::Block& block) const {
+  const auto [first, last] = file_blocks_.equal_range(pc);
+  for (auto entry = first; entry != last; ++entry) {
+    const std::span<const std::byte> data =
+        file_->GetData().subspan(entry->second);
+    const BlockHeader header = ReadBlockHeader(data);
+
+    std::vector<uint32_t> code(header.code_size);
+    const size_t code_offset = sizeof(BlockHeader);
+    std::memcpy(code.data(), &data[code_offset],
+                code.size() * sizeof(uint32_t));
+    if (!Matches(pc, code, bus)) {
+      continue;
+    }
+
+    ir::Block restored{.start = pc,
+                       .code = std::move(code),
+                       .ops = std::vector<ir::Op>(header.op_count),
+                       .next = header.next,
+                       .delay_slot_pending = header.delay_slot_pending,
+                       .pending_register = header.pending_register,
+                       .pending_value = header.pending_value};
+    const size_t ops_offset =
+        code_offset + restored.code.size() * sizeof(uint32_t);
+    std::memcpy(restored.ops.data(), &data[ops_offset],
+                restored.ops.size() * sizeof(ir::Op));
+    if (IsWellFormed(restored)) {
+      block = std::move(restored);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,59 @@
+#ifndef POLYSTATION_BLOCK_CACHE_H
+#define POLYSTATION_BLOCK_CACHE_H
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+
+#include "bus.h"
+#include "ir.h"
+#include "savestate.h"
+
+namespace block_cache {
+struct Stats {
+  unsigned long long translated = 0;
+  // Taken from a file written by an earlier run instead of translated.
+  unsigned long long loaded = 0;
+  // Counted by the CPU as it runs them.
+  unsigned long long executed = 0;
+  // Blocks in RAM translated again because their code changed.
+  unsigned long long invalidated = 0;
+} __attribute__((aligned(32)));
+
+// Optimized blocks by PC. A block in RAM is compared with memory whenever
+// it is looked up and translated again if its code changed, so neither
+// self-modifying code nor loaded executables need to invalidate anything.
+class Cache {
+ public:
+  // The block at `pc`, which has no code when its first instruction has to
+  // be left to the interpreter or `pc` is outside RAM and the BIOS.
+  [[nodiscard]] const ir::Block& Get(uint32_t pc, const bus::Bus& bus);
+
+  // Maps a file written by Save. Its blocks are used in place of
+  // translating whenever their code still matches memory, so runs booting
+  // the same BIOS or game only translate what earlier runs never reached.
+  // A missing or empty file, or one from another version, is ignored.
+  void Load(const std::filesystem::path& path);
+  // Writes the blocks translated so far, along with the loaded file's
+  // blocks, and replaces the file in one step. Every save writes its own
+  // temporary file, so runs sharing a file can save concurrently and the
+  // last one wins.
+  void Save(const std::filesystem::path& path) const;
+
+  [[nodiscard]] const Stats& GetStats() const;
+  Stats& GetStats();
+
+ private:
+  std::unordered_map<uint32_t, ir::Block> blocks_;
+  std::unique_ptr<savestate::MappedFile> file_;
+  // Offsets of the loaded file's blocks by start address. Code at an
+  // address can change, so there may be several blocks for one.
+  std::unordered_multimap<uint32_t, size_t> file_blocks_;
+  Stats stats_;
+
+  [[nodiscard]] bool Restore(uint32_t pc, const bus::Bus& bus,
+                             ir::Block& block) const;
+};
+}  // namespace block_cache
+
+#endif  // POLYSTATION_BLOCK_CACHE_H
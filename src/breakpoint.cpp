@@ -0,0 +1,122 @@
+#include "breakpoint.h"
+
+#include <gsl/gsl>
+
+namespace {
+// KUSEG, KSEG0 and KSEG1 all mirror the low 512 MiB.
+constexpr uint32_t kPhysicalMask = 0x1FFFFFFFU;
+constexpr uint32_t kPageOffsetMask = breakpoint::kPageSize - 1;
+
+uint32_t GetPhysicalAddress(const uint32_t address) {
+  return address & kPhysicalMask;
+}
+
+uint32_t GetWordIndex(const uint32_t physical_address) {
+  return (physical_address & kPageOffsetMask) >> 2U;
+}
+}  // namespace
+
+bool breakpoint::Condition::Evaluate(
+    const std::span<const uint32_t, 32> registers) const {
+  const uint32_t lhs = gsl::at(registers, register_index);
+
+  switch (comparison) {
+    case Comparison::kEqual:
+      return lhs == value;
+    case Comparison::kNotEqual:
+      return lhs != value;
+    case Comparison::kLess:
+      return lhs < value;
+    case Comparison::kLessEqual:
+      return lhs <= value;
+    case Comparison::kGreater:
+      return lhs > value;
+    case Comparison::kGreaterEqual:
+      return lhs >= value;
+  }
+  return false;
+}
+
+void breakpoint::Set::Add(const Breakpoint& breakpoint) {
+  const uint32_t physical = GetPhysicalAddress(breakpoint.address);
+  const uint32_t word = GetWordIndex(physical);
+
+  breakpoints_.insert_or_assign(physical, breakpoint);
+
+  Page& page = pages_[physical >> kPageShift];
+  gsl::at(page, word / 64) |= uint64_t{1} << (word % 64);
+  cached_page_ = kNoPage;
+}
+
+void breakpoint::Set::Remove(const uint32_t address) {
+  const uint32_t physical = GetPhysicalAddress(address);
+  if (breakpoints_.erase(physical) == 0) {
+    return;
+  }
+
+  const auto page = pages_.find(physical >> kPageShift);
+  const uint32_t word = GetWordIndex(physical);
+  gsl::at(page->second, word / 64) &= ~(uint64_t{1} << (word % 64));
+
+  if (page->second == Page{}) {
+    pages_.erase(page);
+  }
+  cached_page_ = kNoPage;
+}
+
+void breakpoint::Set::Clear() {
+  breakpoints_.clear();
+  pages_.clear();
+  cached_page_ = kNoPage;
+}
+
+bool breakpoint::Set::Has(const uint32_t address) const {
+  return breakpoints_.contains(GetPhysicalAddress(address));
+}
+
+bool breakpoint::Set::IsEmpty() const { return breakpoints_.empty(); }
+
+const std::map<uint32_t, breakpoint::Breakpoint>&
+breakpoint::Set::GetBreakpoints() const {
+  return breakpoints_;
+}
+
+bool breakpoint::Set::Check(const uint32_t address,
+                            const std::span<const uint32_t, 32> registers) {
+  const uint32_t physical = GetPhysicalAddress(address);
+
+  if (const uint32_t page = physical >> kPageShift; page != cached_page_) {
+    const auto found = pages_.find(page);
+    cached_page_ = page;
+    cached_bits_ = found != pages_.end() ? &found->second : nullptr;
+  }
+
+  if (cached_bits_ == nullptr) [[likely]] {
+    return false;
+  }
+
+  const uint32_t word = GetWordIndex(physical);
+  if ((gsl::at(*cached_bits_, word / 64) & uint64_t{1} << (word % 64)) == 0U) {
+    return false;
+  }
+  return Hit(physical, registers);
+}
+
+bool breakpoint::Set::Hit(const uint32_t address,
+                          const std::span<const uint32_t, 32> registers) {
+  Breakpoint& breakpoint = breakpoints_.at(address);
+
+  if (breakpoint.condition.has_value() &&
+      !breakpoint.condition->Evaluate(registers)) {
+    return false;
+  }
+
+  if (++breakpoint.hits <= breakpoint.ignore) {
+    return false;
+  }
+
+  if (breakpoint.temporary) {
+    Remove(address);
+  }
+  return true;
+}
@@ -0,0 +1,76 @@
+#ifndef POLYSTATION_BREAKPOINT_H
+#define POLYSTATION_BREAKPOINT_H
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+namespace breakpoint {
+constexpr uint32_t kPageShift = 12;
+constexpr uint32_t kPageSize = 1U << kPageShift;
+constexpr uint32_t kWordsPerPage = kPageSize / 4;
+constexpr uint32_t kNoPage = UINT32_MAX;
+
+enum class Comparison : uint8_t {
+  kEqual,
+  kNotEqual,
+  kLess,
+  kLessEqual,
+  kGreater,
+  kGreaterEqual,
+};
+
+// Compares a general purpose register, unsigned, against `value`.
+struct Condition {
+  uint8_t register_index = 0;
+  Comparison comparison = Comparison::kEqual;
+  uint32_t value = 0;
+
+  [[nodiscard]] bool Evaluate(std::span<const uint32_t, 32> registers) const;
+} __attribute__((aligned(8)));
+
+struct Breakpoint {
+  uint32_t address = 0;
+  std::optional<Condition> condition = std::nullopt;
+  // Hits with the condition met, stops only once they exceed `ignore`.
+  unsigned long long hits = 0;
+  unsigned long long ignore = 0;
+  // Removed by its first stop, used for "Step to PC".
+  bool temporary = false;
+} __attribute__((aligned(64)));
+
+// Execution breakpoints, matched on the physical address so a breakpoint
+// catches every segment mirror. Each 4 KiB page with breakpoints owns a
+// bitmap of its words; pages without any cost one lookup when execution
+// enters them and nothing after that.
+class Set {
+ public:
+  void Add(const Breakpoint& breakpoint);
+  void Remove(uint32_t address);
+  void Clear();
+
+  [[nodiscard]] bool Has(uint32_t address) const;
+  [[nodiscard]] bool IsEmpty() const;
+  [[nodiscard]] const std::map<uint32_t, Breakpoint>& GetBreakpoints() const;
+
+  // Called before every instruction while the set is not empty. Counts the
+  // hit and returns true when execution should stop at `address`.
+  [[nodiscard]] bool Check(uint32_t address,
+                           std::span<const uint32_t, 32> registers);
+
+ private:
+  using Page = std::array<uint64_t, kWordsPerPage / 64>;
+
+  std::map<uint32_t, Breakpoint> breakpoints_;
+  std::unordered_map<uint32_t, Page> pages_;
+  uint32_t cached_page_ = kNoPage;
+  const Page* cached_bits_ = nullptr;
+
+  [[nodiscard]] bool Hit(uint32_t address,
+                         std::span<const uint32_t, 32> registers);
+};
+}  // namespace breakpoint
+
+#endif  // POLYSTATION_BREAKPOINT_H
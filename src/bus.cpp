@@ -1,11 +1,33 @@
 #include "bus.h"
 
-#include <format>
 #include <gsl/util>
+#include <initializer_list>
 #include <iostream>
+#include <utility>
 
 #include "logger.h"
 
+namespace {
+constexpr uint32_t kStateTag = savestate::MakeTag("BUS ");
+constexpr uint32_t kStateVersion = 1;
+
+constexpr std::array<std::string_view, bus::kMemoryRegionCount>
+    kMemoryRegionNames = {
+        "bios",
+        "memory_control",
+        "ram_size",
+        "cache_control",
+        "ram",
+        "spu_control",
+        "expansion2",
+        "expansion1",
+        "interrupt_control",
+        "timers",
+        "dma",
+        "mdec",
+};
+}  // namespace
+
 bool bus::MemoryRange::InRange(const uint32_t address) const {
   return address >= base && address < base + size;
 }
@@ -47,23 +69,42 @@ std::optional<bus::MemoryRegion> bus::GetMemoryRegionByAddress(
   if (kTimersRange.InRange(address)) {
     return MemoryRegion::kTimers;
   }
+  if (kDmaMemoryRange.InRange(address)) {
+    return MemoryRegion::kDma;
+  }
+  if (kMdecMemoryRange.InRange(address)) {
+    return MemoryRegion::kMdec;
+  }
   return std::nullopt;
 }
 
-uint32_t bus::Bus::Load32(uint32_t address) const {
-  address = MaskRegion(address);
+std::string_view bus::GetMemoryRegionName(const MemoryRegion region) {
+  return gsl::at(kMemoryRegionNames, static_cast<size_t>(region));
+}
 
-  if (address % 4 != 0) {
-    throw std::runtime_error(
-        std::format("unaligned load address: {:08X}", address));
+std::optional<uint32_t> bus::GetScratchpadOffset(const uint32_t address) {
+  const uint32_t offset = (address & 0x7FFFFFFFU) - kScratchpadMemoryRange.base;
+  if (offset < kScratchpadMemoryRange.size) {
+    return offset;
   }
+  return std::nullopt;
+}
+
+uint32_t bus::Bus::Load32(uint32_t address) {
+  if (const std::optional<uint32_t> offset = GetScratchpadOffset(address)) {
+    stats_.scratchpad_loads++;
+    return scratchpad_.Load32(offset.value());
+  }
+
+  address = MaskRegion(address);
 
   const std::optional<MemoryRegion> region = GetMemoryRegionByAddress(address);
 
-  if (!region.has_value()) {
-    throw std::runtime_error(
-        std::format("unhandled store into address: {:08X}", address));
+  if (!region.has_value()) [[unlikely]] {
+    SignalBusError(address);
+    return 0;
   }
+  gsl::at(stats_.loads, static_cast<size_t>(region.value()))++;
 
   switch (region.value()) {
     case MemoryRegion::kBios: {
@@ -77,21 +118,83 @@ uint32_t bus::Bus::Load32(uint32_t address) const {
     case MemoryRegion::kInterruptControl:
       LOG_INFO_BUS("Unhandled read at Interrupt Control");
       return 0;
+    case MemoryRegion::kDma:
+      return dma_.Load32(address - kDmaMemoryRange.base);
+    case MemoryRegion::kMdec:
+      if (address == kMdecMemoryRange.base) {
+        const uint32_t value = mdec_.ReadData();
+        RunMdecDma();
+        return value;
+      }
+      return mdec_.ReadStatus();
+    default:
+      ReportUnhandled(region.value(), "32-bit load from", address);
+      return 0;
+  }
+}
+
+uint32_t bus::Bus::Peek32(uint32_t address) const {
+  if (const std::optional<uint32_t> offset = GetScratchpadOffset(address)) {
+    return scratchpad_.Load32(offset.value() & ~0x3U);
+  }
+
+  address = MaskRegion(address) & ~0x3U;
+
+  if (kBiosMemoryRange.InRange(address)) {
+    return bios_.Load32(address - kBiosMemoryRange.base);
+  }
+  if (kRamMemoryRange.InRange(address)) {
+    return ram_.Load32(address - kRamMemoryRange.base);
+  }
+  return 0;
+}
+
+uint16_t bus::Bus::Load16(uint32_t address) {
+  if (const std::optional<uint32_t> offset = GetScratchpadOffset(address)) {
+    stats_.scratchpad_loads++;
+    return scratchpad_.Load16(offset.value());
+  }
+
+  address = MaskRegion(address);
+
+  const std::optional<MemoryRegion> region = GetMemoryRegionByAddress(address);
+
+  if (!region.has_value()) [[unlikely]] {
+    SignalBusError(address);
+    return 0;
+  }
+  gsl::at(stats_.loads, static_cast<size_t>(region.value()))++;
+
+  switch (region.value()) {
+    case MemoryRegion::kBios: {
+      const uint32_t offset = address - kBiosMemoryRange.base;
+      return bios_.Load16(offset);
+    }
+    case MemoryRegion::kRam: {
+      const uint32_t offset = address - kRamMemoryRange.base;
+      return ram_.Load16(offset);
+    }
     default:
-      throw std::runtime_error(
-          std::format("unhandled load in address: {:08X}", address));
+      ReportUnhandled(region.value(), "16-bit load from", address);
+      return 0;
   }
 }
 
-uint8_t bus::Bus::Load8(uint32_t address) const {
+uint8_t bus::Bus::Load8(uint32_t address) {
+  if (const std::optional<uint32_t> offset = GetScratchpadOffset(address)) {
+    stats_.scratchpad_loads++;
+    return scratchpad_.Load8(offset.value());
+  }
+
   address = MaskRegion(address);
 
   const std::optional<MemoryRegion> region = GetMemoryRegionByAddress(address);
 
-  if (!region.has_value()) {
-    throw std::runtime_error(
-        std::format("unhandled load in address: {:08X}", address));
+  if (!region.has_value()) [[unlikely]] {
+    SignalBusError(address);
+    return 0;
   }
+  gsl::at(stats_.loads, static_cast<size_t>(region.value()))++;
 
   switch (region.value()) {
     case MemoryRegion::kBios: {
@@ -105,39 +208,39 @@ uint8_t bus::Bus::Load8(uint32_t address) const {
       return ram_.Load8(offset);
     }
     default:
-      throw std::runtime_error(
-          std::format("unhandled load in address: {:08X}", address));
+      ReportUnhandled(region.value(), "8-bit load from", address);
+      return 0;
   }
 }
 
 void bus::Bus::Store32(uint32_t address, uint32_t value) {
-  address = MaskRegion(address);
-
-  if (address % 4 != 0) {
-    throw std::runtime_error(
-        std::format("unaligned store address: {:08X}", address));
+  if (const std::optional<uint32_t> offset = GetScratchpadOffset(address)) {
+    stats_.scratchpad_stores++;
+    scratchpad_.Store32(offset.value(), value);
+    return;
   }
 
+  address = MaskRegion(address);
+
   const std::optional<MemoryRegion> region = GetMemoryRegionByAddress(address);
 
-  if (!region.has_value()) {
-    throw std::runtime_error(
-        std::format("unhandled store into address: {:08X}", address));
+  if (!region.has_value()) [[unlikely]] {
+    SignalBusError(address);
+    return;
   }
+  gsl::at(stats_.stores, static_cast<size_t>(region.value()))++;
 
   switch (region.value()) {
     case MemoryRegion::kMemoryControl:
       switch (address - kMemoryControlMemoryRange.base) {
         case 0:
           if (value != 0x1f000000) {
-            throw std::runtime_error(std::format(
-                "tried remapping expansion 1 base address to {:08X}", value));
+            LOG_WARN_BUS("Ignoring expansion 1 remap to {:08X}", value);
           }
           break;
         case 4:
           if (value != 0x1f802000) {
-            throw std::runtime_error(std::format(
-                "tried remapping expansion 2 base address to {:08X}", value));
+            LOG_WARN_BUS("Ignoring expansion 2 remap to {:08X}", value);
           }
           break;
         default:
@@ -149,7 +252,7 @@ void bus::Bus::Store32(uint32_t address, uint32_t value) {
       LOG_INFO_BUS("Unhandled write to RAM_SIZE");
       break;
     case MemoryRegion::kCacheControl:
-      LOG_INFO_BUS("Unhandled write to Cache Control");
+      cache_control_ = value;
       break;
     case MemoryRegion::kRam: {
       const uint32_t offset = address - kRamMemoryRange.base;
@@ -162,28 +265,49 @@ void bus::Bus::Store32(uint32_t address, uint32_t value) {
     case MemoryRegion::kInterruptControl:
       LOG_INFO_BUS("Unhandled write to Interrupt Control");
       break;
+    case MemoryRegion::kDma:
+      if (const std::optional<dma::Port> port =
+              dma_.Store32(address - kDmaMemoryRange.base, value)) {
+        RunDma(port.value());
+      }
+      break;
+    case MemoryRegion::kMdec:
+      if (address == kMdecMemoryRange.base) {
+        mdec_.WriteCommand(value);
+      } else {
+        mdec_.WriteControl(value);
+      }
+      RunMdecDma();
+      break;
     default:
-      throw std::runtime_error(
-          std::format("unhandled store into address: {:08X}", address));
+      ReportUnhandled(region.value(), "32-bit store to", address);
+      break;
   }
 }
 
 void bus::Bus::Store16(uint32_t address, uint16_t value) {
-  address = MaskRegion(address);
-
-  if (address % 2 != 0) {
-    throw std::runtime_error(
-        std::format("unaligned store address: {:08X}", address));
+  if (const std::optional<uint32_t> offset = GetScratchpadOffset(address)) {
+    stats_.scratchpad_stores++;
+    scratchpad_.Store16(offset.value(), value);
+    return;
   }
 
+  address = MaskRegion(address);
+
   const std::optional<MemoryRegion> region = GetMemoryRegionByAddress(address);
 
-  if (!region.has_value()) {
-    throw std::runtime_error(
-        std::format("unhandled store into address: {:08X}", address));
+  if (!region.has_value()) [[unlikely]] {
+    SignalBusError(address);
+    return;
   }
+  gsl::at(stats_.stores, static_cast<size_t>(region.value()))++;
 
   switch (region.value()) {
+    case MemoryRegion::kRam: {
+      const uint32_t offset = address - kRamMemoryRange.base;
+      ram_.Store16(offset, value);
+      break;
+    }
     case MemoryRegion::kSpuControl:
       LOG_INFO_BUS("Unhandled write to SPU Control");
       break;
@@ -191,20 +315,27 @@ void bus::Bus::Store16(uint32_t address, uint16_t value) {
       LOG_INFO_BUS("Unhandled write to timers registers");
       break;
     default:
-      throw std::runtime_error(
-          std::format("unhandled store into address: {:08X}", address));
+      ReportUnhandled(region.value(), "16-bit store to", address);
+      break;
   }
 }
 
 void bus::Bus::Store8(uint32_t address, uint8_t value) {
+  if (const std::optional<uint32_t> offset = GetScratchpadOffset(address)) {
+    stats_.scratchpad_stores++;
+    scratchpad_.Store8(offset.value(), value);
+    return;
+  }
+
   address = MaskRegion(address);
 
   const std::optional<MemoryRegion> region = GetMemoryRegionByAddress(address);
 
-  if (!region.has_value()) {
-    throw std::runtime_error(
-        std::format("unhandled store into address: {:08X}", address));
+  if (!region.has_value()) [[unlikely]] {
+    SignalBusError(address);
+    return;
   }
+  gsl::at(stats_.stores, static_cast<size_t>(region.value()))++;
 
   switch (region.value()) {
     case MemoryRegion::kExpansionRegion2IntDipPost:
@@ -216,7 +347,149 @@ void bus::Bus::Store8(uint32_t address, uint8_t value) {
       break;
     }
     default:
-      throw std::runtime_error(
-          std::format("unhandled store into address: {:08X}", address));
+      ReportUnhandled(region.value(), "8-bit store to", address);
+      break;
   }
-}
\ No newline at end of file
+}
+
+bool bus::Bus::TakeBusError() {
+  return std::exchange(bus_error_, false);
+}
+
+void bus::Bus::ReportUnhandled(const MemoryRegion region,
+                               const std::string_view access,
+                               const uint32_t address) {
+  stats_.unhandled++;
+  // The BIOS polls devices that are not emulated in tight loops, warning on
+  // every access would flush the log each time.
+  const uint32_t bit = 1U << static_cast<uint32_t>(region);
+  if ((reported_regions_ & bit) == 0U) {
+    reported_regions_ |= bit;
+    LOG_WARN_BUS("Unhandled {} {:08X}, further {} accesses are only counted",
+                 access, address, GetMemoryRegionName(region));
+  }
+}
+
+void bus::Bus::SignalBusError(const uint32_t address) {
+  LOG_WARN_BUS("Bus error at {:08X}", address);
+  bus_error_ = true;
+  stats_.bus_errors++;
+}
+
+uint32_t bus::Bus::GetCacheControl() const { return cache_control_; }
+
+const bus::Stats& bus::Bus::GetStats() const { return stats_; }
+
+bus::Stats& bus::Bus::GetStats() { return stats_; }
+
+ram::Ram& bus::Bus::GetRam() { return ram_; }
+
+const ram::Ram& bus::Bus::GetRam() const { return ram_; }
+
+void bus::Bus::SetMdecPool(std::shared_ptr<worker_pool::WorkerPool> pool) {
+  mdec_.SetWorkerPool(std::move(pool));
+}
+
+void bus::Bus::Save(savestate::Writer& writer) const {
+  writer.BeginSection(kStateTag, kStateVersion);
+  writer.Write(cache_control_);
+  writer.EndSection();
+
+  ram_.Save(writer);
+  scratchpad_.Save(writer);
+  dma_.Save(writer);
+  mdec_.Save(writer);
+}
+
+void bus::Bus::Load(savestate::Reader& reader) {
+  // Read into copies first, a bad state then throws before anything changes.
+  uint32_t cache_control = 0;
+  reader.BeginSection(kStateTag, kStateVersion);
+  reader.Read(cache_control);
+  reader.EndSection();
+
+  const std::optional<std::span<const std::byte>> ram =
+      ram_.PrepareLoad(reader);
+  scratchpad::Scratchpad scratchpad = scratchpad_;
+  scratchpad.Load(reader);
+  dma::Dma dma = dma_;
+  dma.Load(reader);
+  mdec::Mdec mdec = mdec_;
+  mdec.Load(reader);
+
+  cache_control_ = cache_control;
+  ram_.FinishLoad(reader, ram);
+  scratchpad_ = scratchpad;
+  dma_ = dma;
+  mdec_ = std::move(mdec);
+}
+
+void bus::Bus::RunDma(const dma::Port port) {
+  // Left started until the device asks for it.
+  if (!IsDmaRequested(port)) {
+    return;
+  }
+
+  const dma::Channel& channel = dma_.GetChannel(port);
+  const uint32_t words = channel.GetTransferSize();
+  const uint32_t step = channel.IsStepBackward() ? -4U : 4U;
+  uint32_t address = channel.base_address;
+  stats_.dma_transfers++;
+  stats_.dma_words += words;
+
+  switch (port) {
+    case dma::Port::kMdecIn:
+      for (uint32_t i = 0; i < words; i++, address += step) {
+        mdec_.WriteCommand(ram_.Load32(address & 0x1FFFFCU));
+      }
+      break;
+    case dma::Port::kMdecOut:
+      for (uint32_t i = 0; i < words; i++, address += step) {
+        ram_.Store32(address & 0x1FFFFCU, mdec_.ReadData());
+      }
+      break;
+    case dma::Port::kOrderingTable:
+      // Builds an empty ordering table backwards, each entry linking to the
+      // previous word and the last one holding the end marker.
+      for (uint32_t i = 0; i < words; i++, address -= 4) {
+        const uint32_t value =
+            i == words - 1 ? 0xFFFFFF : (address - 4) & 0x1FFFFCU;
+        ram_.Store32(address & 0x1FFFFCU, value);
+      }
+      break;
+    default:
+      LOG_INFO_BUS("Unhandled DMA transfer on port {}",
+                   static_cast<uint8_t>(port));
+      break;
+  }
+
+  dma_.Complete(port);
+
+  // Feeding or draining the MDEC can raise the other channel's request.
+  if (port == dma::Port::kMdecIn || port == dma::Port::kMdecOut) {
+    RunMdecDma();
+  }
+}
+
+void bus::Bus::RunMdecDma() {
+  for (const dma::Port port : {dma::Port::kMdecIn, dma::Port::kMdecOut}) {
+    if (dma_.IsStarted(port) && IsDmaRequested(port)) {
+      RunDma(port);
+      return;
+    }
+  }
+}
+
+bool bus::Bus::IsDmaRequested(const dma::Port port) const {
+  if (dma_.GetChannel(port).GetSyncMode() != dma::SyncMode::kRequest) {
+    return true;
+  }
+  switch (port) {
+    case dma::Port::kMdecIn:
+      return mdec_.IsDataInRequested();
+    case dma::Port::kMdecOut:
+      return mdec_.IsDataOutRequested();
+    default:
+      return true;
+  }
+}
@@ -1,9 +1,16 @@
 #ifndef POLYSTATION_BUS_H
 #define POLYSTATION_BUS_H
+#include <memory>
 #include <optional>
+#include <string_view>
 
 #include "bios.h"
+#include "dma.h"
+#include "mdec.h"
 #include "ram.h"
+#include "savestate.h"
+#include "scratchpad.h"
+#include "worker_pool.h"
 
 namespace bus {
 struct MemoryRange {
@@ -14,7 +21,8 @@ struct MemoryRange {
 } __attribute__((aligned(8)));
 
 constexpr MemoryRange kBiosMemoryRange = {.base = 0x1FC00000, .size = 0x80000};
-constexpr MemoryRange kRamMemoryRange = {.base = 0x00000000, .size = 0x200000};
+constexpr MemoryRange kRamMemoryRange = {.base = 0x00000000,
+                                         .size = ram::kRamSize};
 constexpr MemoryRange kMemoryControlMemoryRange = {.base = 0x1F801000,
                                                    .size = 0x24};
 constexpr MemoryRange kRamSizeMemoryRange = {.base = 0x1F801060, .size = 0x4};
@@ -29,6 +37,10 @@ constexpr MemoryRange kExpansion1MemoryRange = {.base = 0x1F000000,
 constexpr MemoryRange kInterruptControlMemoryRange = {.base = 0x1F801070,
                                                       .size = 0x08};
 constexpr MemoryRange kTimersRange = {.base = 0x1F801100, .size = 0x40};
+constexpr MemoryRange kDmaMemoryRange = {.base = 0x1F801080, .size = 0x80};
+constexpr MemoryRange kMdecMemoryRange = {.base = 0x1F801820, .size = 0x8};
+constexpr MemoryRange kScratchpadMemoryRange = {
+    .base = 0x1F800000, .size = scratchpad::kScratchpadSize};
 
 constexpr std::array<uint32_t, 8> kRegionMask{
     0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
@@ -45,27 +57,93 @@ enum class MemoryRegion : uint8_t {
   kExpansionRegion2IntDipPost,
   kExpansion1,
   kInterruptControl,
-  kTimers
+  kTimers,
+  kDma,
+  kMdec
 };
 
+constexpr size_t kMemoryRegionCount =
+    static_cast<size_t>(MemoryRegion::kMdec) + 1;
+
+// Host-side access counts, never saved or reset with the machine.
+struct Stats {
+  // Indexed by MemoryRegion, instruction fetches count as loads. Translated
+  // blocks fetch nothing, they count the RAM accesses they make directly.
+  std::array<unsigned long long, kMemoryRegionCount> loads{};
+  std::array<unsigned long long, kMemoryRegionCount> stores{};
+  unsigned long long scratchpad_loads = 0;
+  unsigned long long scratchpad_stores = 0;
+  // Accesses no device handles, only the first per region is logged.
+  unsigned long long unhandled = 0;
+  unsigned long long bus_errors = 0;
+  unsigned long long dma_transfers = 0;
+  unsigned long long dma_words = 0;
+} __attribute__((aligned(128)));
+
 uint32_t MaskRegion(uint32_t address);
 
 std::optional<MemoryRegion> GetMemoryRegionByAddress(uint32_t address);
 
+// Lower case, usable as a metric label.
+[[nodiscard]] std::string_view GetMemoryRegionName(MemoryRegion region);
+
+// Returns the scratchpad offset for an unmasked address, the scratchpad is
+// not mirrored in KSEG1.
+std::optional<uint32_t> GetScratchpadOffset(uint32_t address);
+
 class Bus {
  public:
   explicit Bus(const std::string& path) : bios_(path) {}
+  explicit Bus(std::shared_ptr<const bios::Image> bios)
+      : bios_(std::move(bios)) {}
 
-  [[nodiscard]] uint32_t Load32(uint32_t address) const;
-  [[nodiscard]] uint8_t Load8(uint32_t address) const;
+  // Addresses must be naturally aligned, the CPU raises address errors
+  // before getting here. Unmapped addresses read as 0, drop stores and
+  // latch a bus error for the CPU to collect with TakeBusError.
+  [[nodiscard]] uint32_t Load32(uint32_t address);
+  [[nodiscard]] uint16_t Load16(uint32_t address);
+  [[nodiscard]] uint8_t Load8(uint32_t address);
+  // Side-effect free read for the debugger, devices read back as 0.
+  [[nodiscard]] uint32_t Peek32(uint32_t address) const;
 
   void Store32(uint32_t address, uint32_t value);
   void Store16(uint32_t address, uint16_t value);
   void Store8(uint32_t address, uint8_t value);
 
+  // Returns whether an access since the last call hit an unmapped address.
+  [[nodiscard]] bool TakeBusError();
+
+  [[nodiscard]] uint32_t GetCacheControl() const;
+  [[nodiscard]] const Stats& GetStats() const;
+  Stats& GetStats();
+  [[nodiscard]] ram::Ram& GetRam();
+  [[nodiscard]] const ram::Ram& GetRam() const;
+  void SetMdecPool(std::shared_ptr<worker_pool::WorkerPool> pool);
+
+  void Save(savestate::Writer& writer) const;
+  // Throws on a bad state before anything has changed.
+  void Load(savestate::Reader& reader);
+
  private:
   bios::Bios bios_;
   ram::Ram ram_;
+  scratchpad::Scratchpad scratchpad_;
+  uint32_t cache_control_ = 0;
+  dma::Dma dma_;
+  mdec::Mdec mdec_;
+  bool bus_error_ = false;
+  Stats stats_;
+  // One bit per MemoryRegion already warned about, see ReportUnhandled.
+  uint32_t reported_regions_ = 0;
+  static_assert(kMemoryRegionCount <= 32);
+
+  void ReportUnhandled(MemoryRegion region, std::string_view access,
+                       uint32_t address);
+  void SignalBusError(uint32_t address);
+  void RunDma(dma::Port port);
+  // Runs the MDEC transfers that were started and are now requested.
+  void RunMdecDma();
+  [[nodiscard]] bool IsDmaRequested(dma::Port port) const;
 };
 }  // namespace bus
 
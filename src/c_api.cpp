@@ -0,0 +1,118 @@
+#include "c_api.h"
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core.h"
+
+struct PolyStation {
+  core::Machine machine;
+};
+
+namespace {
+constexpr auto kCompression = savestate::Compression::kZeroRun;
+
+thread_local std::string last_error;
+
+template <typename Function>
+int Guard(Function&& function) {
+  try {
+    function();
+    return 0;
+  } catch (const std::exception& e) {
+    last_error = e.what();
+    return -1;
+  }
+}
+}  // namespace
+
+PolyStation* polystation_create(const PolyStationConfig* config) {
+  if (config == nullptr || config->bios_path == nullptr) {
+    last_error = "missing BIOS path";
+    return nullptr;
+  }
+  if (config->hle_mode < 0 ||
+      config->hle_mode > static_cast<int>(hle::Mode::kVerify)) {
+    last_error = "invalid HLE mode";
+    return nullptr;
+  }
+
+  core::Config machine_config{
+      .bios_path = config->bios_path,
+      .accuracy = config->accurate != 0 ? cpu::Accuracy::kAccurate
+                                        : cpu::Accuracy::kFast,
+      .hle_mode = static_cast<hle::Mode>(config->hle_mode),
+      .idle_skipping = config->idle_skip != 0};
+  if (config->exe_path != nullptr) {
+    machine_config.exe_path = config->exe_path;
+  }
+  if (config->name != nullptr) {
+    machine_config.name = config->name;
+  }
+  if (config->log_path != nullptr) {
+    machine_config.log_path = config->log_path;
+  }
+
+  PolyStation* machine = nullptr;
+  Guard([&] { machine = new PolyStation{core::Machine(machine_config)}; });
+  return machine;
+}
+
+void polystation_destroy(PolyStation* machine) { delete machine; }
+
+int polystation_reset(PolyStation* machine) {
+  return Guard([&] { machine->machine.Reset(); });
+}
+
+int polystation_run_frame(PolyStation* machine) {
+  return Guard([&] { machine->machine.RunFrame(); });
+}
+
+int polystation_run_cycles(PolyStation* machine, const uint64_t cycles) {
+  return Guard([&] { machine->machine.RunFor(cycles); });
+}
+
+uint64_t polystation_get_cycle_count(const PolyStation* machine) {
+  return machine->machine.GetCpu().GetCycleCount();
+}
+
+size_t polystation_get_state_size(const PolyStation* machine) {
+  return machine->machine.GetStateSize(kCompression);
+}
+
+size_t polystation_save_state(const PolyStation* machine, void* buffer,
+                              const size_t size) {
+  size_t written = 0;
+  Guard([&] {
+    written = machine->machine.SaveState(
+        std::span(static_cast<std::byte*>(buffer), size), kCompression);
+  });
+  return written;
+}
+
+int polystation_load_state(PolyStation* machine, const void* buffer,
+                           const size_t size) {
+  return Guard([&] {
+    machine->machine.LoadState(
+        std::span(static_cast<const std::byte*>(buffer), size));
+  });
+}
+
+int polystation_fork(const PolyStation* machine, PolyStation** clones,
+                     const size_t count) {
+  return Guard([&] {
+    std::vector<std::unique_ptr<PolyStation>> wrapped;
+    for (core::Machine& clone : machine->machine.Fork(count)) {
+      wrapped.push_back(std::make_unique<PolyStation>(std::move(clone)));
+    }
+
+    const std::span output(clones, count);
+    for (size_t i = 0; i < count; i++) {
+      output[i] = wrapped[i].release();
+    }
+  });
+}
+
+const char* polystation_get_last_error(void) { return last_error.c_str(); }
@@ -0,0 +1,54 @@
+#ifndef POLYSTATION_C_API_H
+#define POLYSTATION_C_API_H
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// C embedding API over core::Machine. Functions returning int give 0 on
+// success and -1 on failure, polystation_get_last_error then describes the
+// failure on the calling thread.
+
+typedef struct PolyStation PolyStation;
+
+typedef struct PolyStationConfig {
+  const char* bios_path;
+  int accurate;
+  // 0 off, 1 on, 2 verify against the BIOS.
+  int hle_mode;
+  int idle_skip;
+  // Optional, may be NULL.
+  const char* exe_path;
+  const char* name;
+  const char* log_path;
+} PolyStationConfig;
+
+PolyStation* polystation_create(const PolyStationConfig* config);
+void polystation_destroy(PolyStation* machine);
+
+int polystation_reset(PolyStation* machine);
+int polystation_run_frame(PolyStation* machine);
+int polystation_run_cycles(PolyStation* machine, uint64_t cycles);
+uint64_t polystation_get_cycle_count(const PolyStation* machine);
+
+size_t polystation_get_state_size(const PolyStation* machine);
+// Returns the number of bytes written, 0 on failure.
+size_t polystation_save_state(const PolyStation* machine, void* buffer,
+                              size_t size);
+int polystation_load_state(PolyStation* machine, const void* buffer,
+                           size_t size);
+
+// Fills `clones` with `count` new machines forked from `machine`, sharing
+// its RAM copy-on-write. Each clone must be destroyed on its own.
+int polystation_fork(const PolyStation* machine, PolyStation** clones,
+                     size_t count);
+
+const char* polystation_get_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // POLYSTATION_C_API_H
@@ -0,0 +1,97 @@
+#include "core.h"
+
+#include <format>
+#include <utility>
+
+core::Machine::Machine(Config config)
+    : config_(std::move(config)),
+      logger_(logger::Logger::Create(config_.name, config_.log_level,
+                                     config_.log_path)) {
+  const logger::ScopedLogger scoped_logger(logger_);
+  if (!config_.bios_image) {
+    config_.bios_image = bios::Image::Open(config_.bios_path);
+  }
+  cpu_ = std::make_unique<cpu::CPU>(config_.bios_image);
+  cpu_->SetAccuracy(config_.accuracy);
+  cpu_->SetHleMode(config_.hle_mode);
+  cpu_->SetIdleSkipping(config_.idle_skipping);
+  cpu_->SetFusion(config_.fusion);
+  cpu_->SetBackend(config_.backend);
+  cpu_->SetMdecPool(config_.mdec_pool);
+  if (!config_.executable && config_.exe_path.has_value()) {
+    config_.executable =
+        std::make_shared<const exe::Executable>(config_.exe_path.value());
+  }
+  if (config_.executable) {
+    cpu_->Sideload(config_.executable);
+  }
+}
+
+void core::Machine::Reset() {
+  const logger::ScopedLogger scoped_logger(logger_);
+  cpu_->Reset();
+}
+
+void core::Machine::RunFrame() {
+  const logger::ScopedLogger scoped_logger(logger_);
+  cpu_->RunFrame();
+}
+
+void core::Machine::RunFor(const uint64_t cycles) {
+  const logger::ScopedLogger scoped_logger(logger_);
+  cpu_->RunFor(cycles);
+}
+
+size_t core::Machine::GetStateSize(
+    const savestate::Compression compression) const {
+  return cpu_->GetStateSize(compression);
+}
+
+size_t core::Machine::SaveState(
+    const std::span<std::byte> buffer,
+    const savestate::Compression compression) const {
+  const logger::ScopedLogger scoped_logger(logger_);
+  return cpu_->SaveState(buffer, compression);
+}
+
+void core::Machine::LoadState(const std::span<const std::byte> buffer) {
+  const logger::ScopedLogger scoped_logger(logger_);
+  cpu_->LoadState(buffer);
+}
+
+std::vector<core::Machine> core::Machine::Fork(const size_t count) const {
+  constexpr auto kCompression = savestate::Compression::kNone;
+  constexpr auto kContent = savestate::Content::kWithoutMemory;
+
+  std::vector<std::byte> state(cpu_->GetStateSize(kCompression, kContent));
+  state.resize(cpu_->SaveState(state, kCompression, kContent));
+  const ram::Snapshot snapshot(cpu_->GetRam());
+
+  std::vector<Machine> clones;
+  clones.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    // Clones share the EXE and BIOS, but each logs to a file of its own.
+    Config config = config_;
+    config.name = std::format("{}.{}", config_.name, i);
+    if (config_.log_path.has_value()) {
+      config.log_path = std::format("{}.{}", config_.log_path.value(), i);
+    }
+
+    Machine& clone = clones.emplace_back(std::move(config));
+    const logger::ScopedLogger scoped_logger(clone.logger_);
+    clone.cpu_->GetRam().MapSnapshot(snapshot);
+    clone.cpu_->LoadState(state);
+  }
+
+  return clones;
+}
+
+const core::Config& core::Machine::GetConfig() const { return config_; }
+
+std::shared_ptr<spdlog::logger> core::Machine::GetLogger() const {
+  return logger_;
+}
+
+cpu::CPU& core::Machine::GetCpu() { return *cpu_; }
+
+const cpu::CPU& core::Machine::GetCpu() const { return *cpu_; }
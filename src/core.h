@@ -0,0 +1,71 @@
+#ifndef POLYSTATION_CORE_H
+#define POLYSTATION_CORE_H
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "logger.h"
+#include "worker_pool.h"
+
+namespace core {
+struct Config {
+  std::string bios_path;
+  // Shared with other machines when set, bios_path is then ignored.
+  std::shared_ptr<const bios::Image> bios_image = nullptr;
+  // PS-X EXE started in place of the BIOS shell.
+  std::optional<std::string> exe_path = std::nullopt;
+  // Shared with other machines when set, exe_path is then ignored.
+  std::shared_ptr<const exe::Executable> executable = nullptr;
+  cpu::Accuracy accuracy = cpu::Accuracy::kFast;
+  hle::Mode hle_mode = hle::Mode::kOff;
+  bool idle_skipping = false;
+  bool fusion = true;
+  cpu::Backend backend = cpu::Backend::kInterpreter;
+  // Decodes large MDEC batches, machines running side by side should share
+  // one. Without a pool the MDEC decodes on the machine's own thread.
+  std::shared_ptr<worker_pool::WorkerPool> mdec_pool = nullptr;
+  // Prefixes every log line, so interleaved machines can be told apart.
+  std::string name = "polystation";
+  spdlog::level::level_enum log_level = spdlog::level::info;
+  std::optional<std::string> log_path = std::nullopt;
+} __attribute__((aligned(128)));
+
+// One self-contained emulated console. Machines share nothing but the
+// read-only BIOS image and the MDEC pool, any number of them can run side by
+// side on different threads.
+class Machine {
+ public:
+  explicit Machine(Config config);
+
+  void Reset();
+  void RunFrame();
+  void RunFor(uint64_t cycles);
+
+  [[nodiscard]] size_t GetStateSize(savestate::Compression compression) const;
+  size_t SaveState(std::span<std::byte> buffer,
+                   savestate::Compression compression) const;
+  void LoadState(std::span<const std::byte> buffer);
+
+  // Creates `count` independent copies of this machine. RAM is shared
+  // copy-on-write with a snapshot taken now, so forking costs one RAM copy
+  // no matter how many clones are made, and each clone only pays for the
+  // pages it later writes. Clone i is named <name>.i and logs to
+  // <log_path>.i.
+  [[nodiscard]] std::vector<Machine> Fork(size_t count) const;
+
+  [[nodiscard]] const Config& GetConfig() const;
+  [[nodiscard]] std::shared_ptr<spdlog::logger> GetLogger() const;
+  [[nodiscard]] cpu::CPU& GetCpu();
+  [[nodiscard]] const cpu::CPU& GetCpu() const;
+
+ private:
+  Config config_;
+  std::shared_ptr<spdlog::logger> logger_;
+  std::unique_ptr<cpu::CPU> cpu_;
+};
+}  // namespace core
+
+#endif  // POLYSTATION_CORE_H
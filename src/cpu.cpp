@@ -3,9 +3,119 @@
 #include <format>
 #include <gsl/gsl>
 #include <iostream>
+#include <utility>
 
 #include "logger.h"
 
+namespace {
+// Approximate cost of an uncached word fetch, the BIOS sits on an 8-bit bus.
+constexpr uint64_t kRamFetchCycles = 4;
+constexpr uint64_t kBiosFetchCycles = 22;
+
+// bus::Stats index of the RAM accesses translated blocks make directly.
+constexpr auto kRamRegion = static_cast<size_t>(bus::MemoryRegion::kRam);
+
+constexpr uint32_t kStateTag = savestate::MakeTag("CPU ");
+constexpr uint32_t kStateVersion = 3;
+
+constexpr uint32_t kReturnValue = 2;
+constexpr uint32_t kFirstArgument = 4;
+constexpr uint32_t kBiosFunction = 9;
+constexpr uint32_t kGlobalPointer = 28;
+constexpr uint32_t kStackPointer = 29;
+constexpr uint32_t kFramePointer = 30;
+
+constexpr uint32_t kInterruptStackMask = 0x3FU;
+constexpr uint32_t kBootExceptionVectors = 1U << 22U;
+constexpr uint32_t kCauseExceptionCodeMask = 0x7CU;
+constexpr uint32_t kCauseBranchDelay = 1U << 31U;
+
+// A verified BIOS routine that runs longer than this is assumed stuck.
+constexpr uint64_t kMaxVerifySteps = 10'000'000;
+
+uint64_t GetFetchCycles(const uint32_t address) {
+  return bus::kBiosMemoryRange.InRange(bus::MaskRegion(address))
+             ? kBiosFetchCycles
+             : kRamFetchCycles;
+}
+
+// LWL/LWR merge the aligned word around `address` into `current`.
+uint32_t MergeLeft(const uint32_t current, const uint32_t word,
+                   const uint32_t address) {
+  const uint32_t shift = (address & 0x3U) * 8;
+  const uint32_t kept = 0x00FFFFFFU >> shift;
+  return (current & kept) | (word << (24 - shift));
+}
+
+uint32_t MergeRight(const uint32_t current, const uint32_t word,
+                    const uint32_t address) {
+  const uint32_t shift = (address & 0x3U) * 8;
+  const uint32_t kept = 0xFFFFFF00U << (24 - shift);
+  return (current & kept) | (word >> shift);
+}
+
+// SWL/SWR merge `value` into the aligned word around `address`.
+uint32_t StoreMergeLeft(const uint32_t word, const uint32_t value,
+                        const uint32_t address) {
+  const uint32_t shift = (address & 0x3U) * 8;
+  const uint32_t kept = 0xFFFFFF00U << shift;
+  return (word & kept) | (value >> (24 - shift));
+}
+
+uint32_t StoreMergeRight(const uint32_t word, const uint32_t value,
+                         const uint32_t address) {
+  const uint32_t shift = (address & 0x3U) * 8;
+  const uint32_t kept = 0x00FFFFFFU >> (24 - shift);
+  return (word & kept) | (value << shift);
+}
+
+uint32_t Extend(const ir::Access access, const uint32_t value) {
+  switch (access) {
+    case ir::Access::kByte:
+      return static_cast<uint32_t>(static_cast<int8_t>(value));
+    case ir::Access::kHalf:
+      return static_cast<uint32_t>(static_cast<int16_t>(value));
+    default:
+      return value;
+  }
+}
+
+// Block accesses known to hit RAM skip the bus, and its counters.
+uint32_t LoadRam(const ram::Ram& ram, const ir::Access access,
+                 const uint32_t address) {
+  const uint32_t offset = bus::MaskRegion(address);
+  switch (access) {
+    case ir::Access::kByte:
+    case ir::Access::kByteUnsigned:
+      return ram.Load8(offset);
+    case ir::Access::kHalf:
+    case ir::Access::kHalfUnsigned:
+      return ram.Load16(offset);
+    case ir::Access::kWord:
+      return ram.Load32(offset);
+  }
+  return 0;
+}
+
+void StoreRam(ram::Ram& ram, const ir::Access access, const uint32_t address,
+              const uint32_t value) {
+  const uint32_t offset = bus::MaskRegion(address);
+  switch (access) {
+    case ir::Access::kByte:
+    case ir::Access::kByteUnsigned:
+      ram.Store8(offset, static_cast<uint8_t>(value & 0xFF));
+      break;
+    case ir::Access::kHalf:
+    case ir::Access::kHalfUnsigned:
+      ram.Store16(offset, static_cast<uint16_t>(value & 0xFFFF));
+      break;
+    case ir::Access::kWord:
+      ram.Store32(offset, value);
+      break;
+  }
+}
+}  // namespace
+
 uint32_t cpu::COP0::GetStatusRegister() const { return status_register_; }
 
 void cpu::COP0::SetStatusRegister(const uint32_t value) {
@@ -17,8 +127,9 @@ bool cpu::COP0::IsCacheIsolated() const {
 }
 
 cpu::COP0::HandlerAddress cpu::COP0::GetHandlerAddress() const {
-  return (status_register_ >> 22U) != 0U ? COP0::HandlerAddress::kKSEG1
-                                         : COP0::HandlerAddress::kKSEG0;
+  return (status_register_ & kBootExceptionVectors) != 0U
+             ? COP0::HandlerAddress::kKSEG1
+             : COP0::HandlerAddress::kKSEG0;
 }
 
 cpu::Mode cpu::COP0::GetMode() const {
@@ -35,17 +146,184 @@ uint32_t cpu::COP0::GetEpcRegister() const { return epc_register_; }
 
 void cpu::COP0::SetEpcRegister(const uint32_t value) { epc_register_ = value; }
 
+uint32_t cpu::COP0::GetBadVaddrRegister() const { return bad_vaddr_register_; }
+
+void cpu::COP0::SetBadVaddrRegister(const uint32_t value) {
+  bad_vaddr_register_ = value;
+}
+
 void cpu::CPU::Reset() {
   program_counter_ = bios::kBiosBase;
   next_program_counter_ = bios::kBiosBase + kInstructionLength;
   read_registers_.fill(0);
+  write_registers_ = read_registers_;
+  load_delay_slots_ = LoadDelaySlots();
   step_count_ = 0;
+  cycle_count_ = 0;
+  icache_.Reset();
+  idle_loop_.Reset();
+  sideload_pending_ = executable_ != nullptr;
+  branch_ = false;
+  stopped_at_breakpoint_ = false;
+
+  if (profiler_.IsRunning()) {
+    profiler_.Start(program_counter_, cycle_count_);
+  }
+}
+
+template <cpu::Accuracy kAccuracy>
+uint32_t cpu::CPU::FetchInstruction(const uint32_t address) {
+  if constexpr (kAccuracy == Accuracy::kAccurate) {
+    constexpr uint32_t kCodeCacheEnable = 1U << 11U;
+
+    if ((bus_.GetCacheControl() & kCodeCacheEnable) == 0U ||
+        !icache::InstructionCache::IsCacheable(address)) {
+      cycle_count_ += GetFetchCycles(address);
+      return bus_.Load32(address);
+    }
+
+    if (const std::optional<uint32_t> cached = icache_.Lookup(address)) {
+      return cached.value();
+    }
+
+    // A miss refills the line from the missed word to its end, the extra
+    // words arrive in a burst.
+    icache_.GetStats().misses++;
+    cycle_count_ += GetFetchCycles(address);
+    const uint32_t line_end = (address | (icache::kLineSize - 1)) + 1;
+    for (uint32_t fill = address; fill != line_end; fill += 4) {
+      icache_.Fill(fill, bus_.Load32(fill));
+      cycle_count_++;
+    }
+    return icache_.Lookup(address).value();
+  } else {
+    return bus_.Load32(address);
+  }
+}
+
+template <cpu::Accuracy kAccuracy>
+void cpu::CPU::Run(const uint64_t target_cycle) {
+  // Breakpoints only change between runs.
+  const bool check_breakpoints = !breakpoints_.IsEmpty();
+  bool resuming = std::exchange(stopped_at_breakpoint_, false);
+  const bool check_watchpoints = !watchpoints_.IsEmpty();
+  if (check_watchpoints) {
+    watchpoints_.Arm();
+  }
+  // Fused steps and blocks skip the checks below for all but their first
+  // instruction, and would fetch and access memory within one step.
+  const bool unchecked = kAccuracy == Accuracy::kFast && !check_breakpoints &&
+                         !check_watchpoints && !instrumented_;
+  const bool fuse = unchecked && fusion_;
+  const bool use_blocks =
+      unchecked && backend_ == Backend::kCachedInterpreter;
+  fusion_guarded_ =
+      idle_loop_.IsEnabled() || hle_.GetMode() != hle::Mode::kOff;
+
+  while (cycle_count_ < target_cycle) {
+    if (check_breakpoints && !std::exchange(resuming, false) &&
+        breakpoints_.Check(program_counter_, read_registers_)) [[unlikely]] {
+      stopped_at_breakpoint_ = true;
+      return;
+    }
+
+    if (!use_blocks || !ExecuteBlock(target_cycle)) {
+      Step<kAccuracy>(fuse ? target_cycle - cycle_count_ : 0);
+    }
+
+    if (check_watchpoints && watchpoints_.HasFaults()) [[unlikely]] {
+      CollectWatchpoints();
+    }
+
+    if (idle_loop_.IsIdle() && cycle_count_ < target_cycle) [[unlikely]] {
+      idle_loop_.Skip(target_cycle - cycle_count_);
+      cycle_count_ = target_cycle;
+    }
+  }
 }
 
 void cpu::CPU::Cycle() {
-  const auto instruction = Instruction(Load32(program_counter_));
+  stopped_at_breakpoint_ = false;
+  const bool check_watchpoints = !watchpoints_.IsEmpty();
+  if (check_watchpoints) {
+    watchpoints_.Arm();
+  }
+
+  if (accuracy_ == Accuracy::kAccurate) {
+    Step<Accuracy::kAccurate>();
+  } else {
+    Step<Accuracy::kFast>();
+  }
+
+  if (check_watchpoints && watchpoints_.HasFaults()) {
+    CollectWatchpoints();
+  }
+}
+
+void cpu::CPU::RunFrame() { RunFor(kCyclesPerFrame); }
+
+void cpu::CPU::RunFor(const uint64_t cycles) {
+  const uint64_t target_cycle = cycle_count_ + cycles;
+
+  if (accuracy_ == Accuracy::kAccurate) {
+    Run<Accuracy::kAccurate>(target_cycle);
+  } else {
+    Run<Accuracy::kFast>(target_cycle);
+  }
+}
+
+void cpu::CPU::SetAccuracy(const Accuracy accuracy) {
+  if (accuracy != accuracy_) {
+    icache_.Reset();
+  }
+  accuracy_ = accuracy;
+}
+
+cpu::Accuracy cpu::CPU::GetAccuracy() const { return accuracy_; }
+
+uint64_t cpu::CPU::GetCycleCount() const { return cycle_count_; }
+
+template <cpu::Accuracy kAccuracy>
+void cpu::CPU::Step(const uint64_t fusion_budget) {
+  if (sideload_pending_ && program_counter_ == exe::kShellEntry) [[unlikely]] {
+    LoadExecutable();
+  }
+
+  if (program_counter_ == idle_loop_.GetHead()) [[unlikely]] {
+    idle_loop_.OnLoopHead(
+        idle_loop::LoopState{.registers = read_registers_,
+                             .pending_load_index = load_delay_slots_.index,
+                             .pending_load_value = load_delay_slots_.value});
+  }
+
+  if (hle_.GetMode() != hle::Mode::kOff && !verifying_bios_call_) [[unlikely]] {
+    if (const std::optional<uint32_t> table = hle::GetTable(program_counter_);
+        table.has_value() && HandleBiosCall<kAccuracy>(table.value())) {
+      return;
+    }
+  }
 
   current_program_counter_ = program_counter_;
+  delay_slot_ = branch_;
+  branch_ = false;
+
+  Instruction instruction;
+  std::optional<ExceptionType> fetch_error;
+  if (program_counter_ % kInstructionLength != 0) [[unlikely]] {
+    cop0_.SetBadVaddrRegister(program_counter_);
+    fetch_error = ExceptionType::kLoadAddressError;
+  } else {
+    instruction = Instruction(FetchInstruction<kAccuracy>(program_counter_));
+    if (bus_.TakeBusError()) [[unlikely]] {
+      fetch_error = ExceptionType::kBusErrorInstruction;
+    }
+  }
+  current_instruction_ = instruction.GetRawData();
+  // Fetching from a read-watched page faults too, only the data accesses
+  // that follow are watched.
+  if (watchpoints_.HasFaults()) [[unlikely]] {
+    watchpoints_.Discard();
+  }
 
   program_counter_ = next_program_counter_;
   next_program_counter_ += kInstructionLength;
@@ -54,82 +332,438 @@ void cpu::CPU::Cycle() {
   SetRegister(index, value);
   load_delay_slots_ = LoadDelaySlots();
 
-  switch (instruction.GetPrimaryOpcode()) {
-    case Instruction::PrimaryOpcode::kSPECIAL:
-      OpSPECIAL(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kBcondZ:
-      OpBcondZ(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kJ:
-      OpJ(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kJAL:
-      OpJAL(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kBEQ:
-      OpBEQ(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kBNE:
-      OpBNE(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kBLEZ:
-      OpBLEZ(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kBGTZ:
-      OpBGTZ(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kADDI:
-      OpADDI(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kADDIU:
-      OpADDIU(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kSLTI:
-      OpSLTI(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kSLTIU:
-      OpSLTIU(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kANDI:
-      OpANDI(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kORI:
-      OpORI(instruction);
-      break;
-    case Instruction::PrimaryOpcode::kLUI:
-      OpLUI(instruction);
+  uint8_t cycles = 1;
+  if (fetch_error.has_value()) [[unlikely]] {
+    Exception(fetch_error.value());
+  } else if (fusion_budget > 1 && !delay_slot_ &&
+             fusion::IsHead(instruction.GetRawData()) &&
+             ExecuteFused(instruction, fusion_budget)) {
+    read_registers_ = write_registers_;
+    return;
+  } else {
+    cycles = Execute(instruction);
+  }
+
+  step_count_++;
+  cycle_count_ += cycles;
+
+  if (instrumented_) [[unlikely]] {
+    Instrument(instruction);
+  }
+
+  read_registers_ = write_registers_;
+}
+
+constinit const std::array<cpu::CPU::Handler, isa::kDecodeTableSize>
+    cpu::CPU::kDispatchTable = [] {
+      // Ordered like isa::Operation.
+      constexpr auto kHandlers = std::to_array<Handler>({
+        &CPU::OpIllegal, &CPU::OpSLL, &CPU::OpSRL, &CPU::OpSRA, &CPU::OpSLLV,
+        &CPU::OpSRLV, &CPU::OpSRAV, &CPU::OpJR, &CPU::OpJALR, &CPU::OpSYSCALL,
+        &CPU::OpBREAK, &CPU::OpMFHI, &CPU::OpMTHI, &CPU::OpMFLO, &CPU::OpMTLO,
+        &CPU::OpMULT, &CPU::OpMULTU, &CPU::OpDIV, &CPU::OpDIVU, &CPU::OpADD,
+        &CPU::OpADDU, &CPU::OpSUB, &CPU::OpSUBU, &CPU::OpAND, &CPU::OpOR,
+        &CPU::OpXOR, &CPU::OpNOR, &CPU::OpSLT, &CPU::OpSLTU, &CPU::OpBLTZAL,
+        &CPU::OpBGEZAL, &CPU::OpBLTZ, &CPU::OpBGEZ, &CPU::OpJ, &CPU::OpJAL,
+        &CPU::OpBEQ, &CPU::OpBNE, &CPU::OpBLEZ, &CPU::OpBGTZ, &CPU::OpADDI,
+        &CPU::OpADDIU, &CPU::OpSLTI, &CPU::OpSLTIU, &CPU::OpANDI, &CPU::OpORI,
+        &CPU::OpXORI, &CPU::OpLUI, &CPU::OpMFC0, &CPU::OpMTC0, &CPU::OpRFE,
+        &CPU::OpMFC2, &CPU::OpCFC2, &CPU::OpMTC2, &CPU::OpCTC2, &CPU::OpGTE,
+        &CPU::OpLB, &CPU::OpLH, &CPU::OpLWL, &CPU::OpLW, &CPU::OpLBU,
+        &CPU::OpLHU, &CPU::OpLWR, &CPU::OpSB, &CPU::OpSH, &CPU::OpSWL,
+        &CPU::OpSW, &CPU::OpSWR, &CPU::OpLWC2, &CPU::OpSWC2
+      });
+      static_assert(kHandlers.size() == isa::kOperationCount);
+
+      std::array<Handler, isa::kDecodeTableSize> table{};
+      for (size_t i = 0; i < table.size(); i++) {
+        const isa::Operation operation = gsl::at(isa::kDecodeTable, i);
+        gsl::at(table, i) =
+            gsl::at(kHandlers, static_cast<size_t>(operation));
+      }
+      return table;
+    }();
+
+uint8_t cpu::CPU::Execute(const Instruction& instruction) {
+  const size_t index = isa::GetDecodeIndex(instruction.GetRawData());
+  const isa::Spec& spec = isa::GetSpec(gsl::at(isa::kDecodeTable, index));
+
+  // Cleared again by Exception, so a faulting instruction never opens a
+  // delay slot.
+  branch_ = (spec.flags & isa::kBranch) != 0U;
+  if constexpr (histogram::kEnabled) {
+    histogram_.Record(index);
+  }
+  (this->*gsl::at(kDispatchTable, index))(instruction);
+
+  return spec.cycles;
+}
+
+bool cpu::CPU::ExecuteFused(const Instruction& first,
+                            const uint64_t fusion_budget) {
+  if (!CanFuseAt(program_counter_)) {
+    return false;
+  }
+  // The follower is fetched once here instead of by the next step.
+  const Instruction second(bus_.Load32(program_counter_));
+  if (bus_.TakeBusError()) [[unlikely]] {
+    return false;
+  }
+
+  switch (fusion::Match(first.GetRawData(), second.GetRawData())) {
+    case fusion::Kind::kPair:
+      ExecutePair(first, second);
       break;
-    case Instruction::PrimaryOpcode::kCOP0:
-      OpCOP0(instruction);
+    case fusion::Kind::kLoadConstant:
+      FuseLoadConstant(first, second);
       break;
-    case Instruction::PrimaryOpcode::kLB:
-      OpLB(instruction);
+    case fusion::Kind::kUpperMemory:
+      FuseUpperMemory(first, second);
       break;
-    case Instruction::PrimaryOpcode::kLW:
-      OpLW(instruction);
+    case fusion::Kind::kCompareBranch:
+      FuseCompareBranch(first, second);
       break;
-    case Instruction::PrimaryOpcode::kLBU:
-      OpLBU(instruction);
+    case fusion::Kind::kNopRun:
+      FuseNopRun(first, fusion_budget);
       break;
-    case Instruction::PrimaryOpcode::kSB:
-      OpSB(instruction);
+  }
+  return true;
+}
+
+bool cpu::CPU::CanFuseAt(const uint32_t address) const {
+  if (sideload_pending_ && address == exe::kShellEntry) {
+    return false;
+  }
+  if (!fusion_guarded_) {
+    return true;
+  }
+  // Run skips an idle loop right after the step that finds it.
+  if (idle_loop_.IsIdle() || address == idle_loop_.GetHead()) {
+    return false;
+  }
+  return hle_.GetMode() == hle::Mode::kOff ||
+         !hle::GetTable(address).has_value();
+}
+
+void cpu::CPU::AdvanceFused() {
+  current_program_counter_ = program_counter_;
+  program_counter_ = next_program_counter_;
+  next_program_counter_ += kInstructionLength;
+}
+
+void cpu::CPU::Retire(const Instruction& instruction) {
+  if constexpr (histogram::kEnabled) {
+    histogram_.Record(isa::GetDecodeIndex(instruction.GetRawData()));
+  }
+  step_count_++;
+  cycle_count_++;
+}
+
+void cpu::CPU::ExecutePair(const Instruction& first,
+                           const Instruction& second) {
+  cycle_count_ += Execute(first);
+  step_count_++;
+  read_registers_ = write_registers_;
+
+  AdvanceFused();
+  cycle_count_ += Execute(second);
+  step_count_++;
+}
+
+void cpu::CPU::FuseLoadConstant(const Instruction& first,
+                                const Instruction& second) {
+  const uint32_t upper = uint32_t{first.GetImmediate16()} << 16U;
+  const uint32_t value =
+      isa::Decode(second.GetRawData()) == isa::Operation::kORI
+          ? upper | second.GetImmediate16()
+          : upper + second.GetImmediate16SignExtend();
+
+  Retire(first);
+  AdvanceFused();
+  Retire(second);
+  SetRegister(first.GetT(), value);
+}
+
+void cpu::CPU::FuseUpperMemory(const Instruction& first,
+                               const Instruction& second) {
+  SetRegister(first.GetT(), uint32_t{first.GetImmediate16()} << 16U);
+  Retire(first);
+  read_registers_ = write_registers_;
+
+  // May fault, which has to look like any other access at this PC.
+  AdvanceFused();
+  cycle_count_ += Execute(second);
+  step_count_++;
+}
+
+void cpu::CPU::FuseCompareBranch(const Instruction& first,
+                                 const Instruction& second) {
+  const uint32_t register_s = GetRegister(first.GetS());
+  bool less = false;
+  switch (isa::Decode(first.GetRawData())) {
+    case isa::Operation::kSLT:
+      less = static_cast<int32_t>(register_s) <
+             static_cast<int32_t>(GetRegister(first.GetT()));
       break;
-    case Instruction::PrimaryOpcode::kSH:
-      OpSH(instruction);
+    case isa::Operation::kSLTU:
+      less = register_s < GetRegister(first.GetT());
       break;
-    case Instruction::PrimaryOpcode::kSW:
-      OpSW(instruction);
+    case isa::Operation::kSLTI:
+      less = static_cast<int32_t>(register_s) <
+             static_cast<int32_t>(first.GetImmediate16SignExtend());
       break;
     default:
-      throw std::runtime_error(
-          std::format("unhandled primary opcode {:02X}",
-                      static_cast<uint8_t>(instruction.GetPrimaryOpcode())));
+      less = register_s < first.GetImmediate16SignExtend();
+      break;
   }
+  SetRegister(fusion::GetComparisonDestination(first.GetRawData()),
+              less ? 1 : 0);
+  Retire(first);
+
+  AdvanceFused();
+  Retire(second);
+  branch_ = true;
+  // The branch compares the result with R0.
+  if (less == (isa::Decode(second.GetRawData()) == isa::Operation::kBNE)) {
+    Branch(second.GetImmediate16SignExtend());
+  }
+}
 
+void cpu::CPU::FuseNopRun(const Instruction& first,
+                          const uint64_t fusion_budget) {
+  const uint64_t limit = std::min(fusion_budget, fusion::kMaxNopRun);
+
+  Retire(first);
+  uint64_t retired = 1;
+  do {
+    AdvanceFused();
+    Retire(first);
+    retired++;
+  } while (retired < limit && CanFuseAt(program_counter_) &&
+           bus_.Load32(program_counter_) == 0 && !bus_.TakeBusError());
+}
+
+bool cpu::CPU::ExecuteBlock(const uint64_t target_cycle) {
+  // Blocks start with every register in place.
+  if (load_delay_slots_.index != 0 || branch_ ||
+      program_counter_ % kInstructionLength != 0 ||
+      cop0_.IsCacheIsolated() || !CanFuseAt(program_counter_)) {
+    return false;
+  }
+
+  const ir::Block& block = blocks_.Get(program_counter_, bus_);
+  const uint64_t length = block.code.size();
+  if (length == 0 || target_cycle - cycle_count_ < length) {
+    return false;
+  }
+  // The idle loop detector has to see its head reached.
+  if (fusion_guarded_ &&
+      idle_loop_.GetHead() - program_counter_ < length * kInstructionLength) {
+    return false;
+  }
+
+  blocks_.GetStats().executed++;
+  RunBlock(block);
+  return true;
+}
+
+void cpu::CPU::RunBlock(const ir::Block& block) {
+  // Registers live in write_registers_ only, read_registers_ catches up
+  // when the block ends or hands an instruction to the interpreter.
+  exception_raised_ = false;
+  // A load into R0 may still be in flight, it lands as nothing.
+  load_delay_slots_ = LoadDelaySlots();
+  bool branch = false;
+  bool store_ends_block = false;
+
+  for (size_t i = 0; i < block.ops.size(); i++) {
+    const ir::Op& op = gsl::at(block.ops, i);
+    uint32_t& result = gsl::at(block_values_, i);
+    switch (op.opcode) {
+      case ir::Opcode::kInstruction:
+        if (store_ends_block) {
+          program_counter_ = op.immediate;
+          next_program_counter_ = program_counter_ + kInstructionLength;
+          branch_ = false;
+          read_registers_ = write_registers_;
+          return;
+        }
+        current_program_counter_ = op.immediate;
+        delay_slot_ = std::exchange(branch, false);
+        if constexpr (histogram::kEnabled) {
+          histogram_.Record(
+              isa::GetDecodeIndex(gsl::at(block.code, op.index)));
+        }
+        step_count_++;
+        cycle_count_++;
+        break;
+      case ir::Opcode::kConstant:
+        result = op.immediate;
+        break;
+      case ir::Opcode::kGetRegister:
+        result = gsl::at(write_registers_, op.index);
+        break;
+      case ir::Opcode::kSetRegister:
+        gsl::at(write_registers_, op.index) = gsl::at(block_values_, op.a);
+        break;
+      case ir::Opcode::kAdd:
+      case ir::Opcode::kSub:
+      case ir::Opcode::kAnd:
+      case ir::Opcode::kOr:
+      case ir::Opcode::kXor:
+      case ir::Opcode::kNor:
+      case ir::Opcode::kShiftLeft:
+      case ir::Opcode::kShiftRight:
+      case ir::Opcode::kShiftRightArithmetic:
+      case ir::Opcode::kLess:
+      case ir::Opcode::kLessUnsigned:
+        result = ir::Evaluate(op.opcode, gsl::at(block_values_, op.a),
+                              gsl::at(block_values_, op.b));
+        break;
+      case ir::Opcode::kAddChecked:
+      case ir::Opcode::kSubChecked:
+        if (const std::optional<uint32_t> sum = ir::EvaluateChecked(
+                op.opcode, gsl::at(block_values_, op.a),
+                gsl::at(block_values_, op.b))) {
+          result = sum.value();
+        } else {
+          Exception(ExceptionType::kOverflow);
+        }
+        break;
+      case ir::Opcode::kLoad: {
+        const uint32_t address = gsl::at(block_values_, op.a);
+        uint32_t value = 0;
+        if (op.address == ir::Address::kRam) {
+          value = LoadRam(bus_.GetRam(), op.access, address);
+          gsl::at(bus_.GetStats().loads, kRamRegion)++;
+        } else if (op.access == ir::Access::kWord) {
+          value = Load32(address).value_or(0);
+        } else if (op.access == ir::Access::kHalf ||
+                   op.access == ir::Access::kHalfUnsigned) {
+          value = Load16(address).value_or(0);
+        } else {
+          value = Load8(address).value_or(0);
+        }
+        result = Extend(op.access, value);
+        break;
+      }
+      case ir::Opcode::kLoadLeft:
+      case ir::Opcode::kLoadRight: {
+        const uint32_t address = gsl::at(block_values_, op.a);
+        const uint32_t word = Load32(address & ~0x3U).value_or(0);
+        const uint32_t current = gsl::at(block_values_, op.b);
+        result = op.opcode == ir::Opcode::kLoadLeft
+                     ? MergeLeft(current, word, address)
+                     : MergeRight(current, word, address);
+        break;
+      }
+      case ir::Opcode::kStore: {
+        const uint32_t address = gsl::at(block_values_, op.a);
+        const uint32_t value = gsl::at(block_values_, op.b);
+        if (op.address == ir::Address::kRam) {
+          StoreRam(bus_.GetRam(), op.access, address, value);
+          gsl::at(bus_.GetStats().stores, kRamRegion)++;
+          break;
+        }
+        if (op.access == ir::Access::kWord) {
+          Store32(address, value);
+        } else if (op.access == ir::Access::kHalf ||
+                   op.access == ir::Access::kHalfUnsigned) {
+          Store16(address, static_cast<uint16_t>(value & 0xFFFF));
+        } else {
+          Store8(address, static_cast<uint8_t>(value & 0xFF));
+        }
+        store_ends_block = ir::IsObservable(op) && EndsBlock(block, address);
+        break;
+      }
+      case ir::Opcode::kStoreLeft:
+      case ir::Opcode::kStoreRight: {
+        const uint32_t address = gsl::at(block_values_, op.a);
+        const uint32_t aligned = address & ~0x3U;
+        const uint32_t value = gsl::at(block_values_, op.b);
+        if (const std::optional<uint32_t> word = Load32(aligned)) {
+          Store32(aligned,
+                  op.opcode == ir::Opcode::kStoreLeft
+                      ? StoreMergeLeft(word.value(), value, address)
+                      : StoreMergeRight(word.value(), value, address));
+        }
+        store_ends_block = ir::IsObservable(op) && EndsBlock(block, aligned);
+        break;
+      }
+      case ir::Opcode::kBranch:
+        branch = true;
+        if (ir::Holds(op.condition, gsl::at(block_values_, op.a),
+                      op.b == ir::kNoValue ? 0
+                                           : gsl::at(block_values_, op.b))) {
+          result = op.immediate;
+          next_program_counter_ = result;
+          if (idle_loop_.IsEnabled()) {
+            CheckIdleLoop();
+          }
+        } else {
+          result = current_program_counter_ + 2 * kInstructionLength;
+        }
+        break;
+      case ir::Opcode::kJump:
+        branch = true;
+        result = op.immediate;
+        next_program_counter_ = result;
+        if (idle_loop_.IsEnabled()) {
+          CheckIdleLoop();
+        }
+        break;
+      case ir::Opcode::kJumpRegister:
+        branch = true;
+        result = gsl::at(block_values_, op.a);
+        break;
+      case ir::Opcode::kInterpret: {
+        read_registers_ = write_registers_;
+        const Instruction instruction(op.immediate);
+        (this->*gsl::at(kDispatchTable,
+                        isa::GetDecodeIndex(op.immediate)))(instruction);
+        break;
+      }
+    }
+
+    // Exception already moved the PC to the handler.
+    if (exception_raised_) [[unlikely]] {
+      read_registers_ = write_registers_;
+      return;
+    }
+  }
+
+  const auto end = static_cast<uint32_t>(
+      block.start + block.code.size() * kInstructionLength);
+  if (block.next == ir::kNoValue) {
+    program_counter_ = end;
+    next_program_counter_ = end + kInstructionLength;
+  } else if (block.delay_slot_pending) {
+    program_counter_ = end;
+    next_program_counter_ = gsl::at(block_values_, block.next);
+  } else {
+    program_counter_ = gsl::at(block_values_, block.next);
+    next_program_counter_ = program_counter_ + kInstructionLength;
+  }
+  branch_ = block.delay_slot_pending;
+  if (block.pending_value != ir::kNoValue) {
+    load_delay_slots_ =
+        LoadDelaySlots(block.pending_register,
+                       gsl::at(block_values_, block.pending_value));
+  }
   read_registers_ = write_registers_;
+}
 
-  step_count_++;
+bool cpu::CPU::EndsBlock(const ir::Block& block, const uint32_t address) {
+  if (bus::GetScratchpadOffset(address).has_value()) {
+    return false;
+  }
+  const uint32_t masked = bus::MaskRegion(address);
+  const uint32_t code_begin = bus::MaskRegion(block.start);
+  const auto code_end = static_cast<uint32_t>(
+      code_begin + block.code.size() * kInstructionLength);
+  // Anywhere else a store may start a DMA transfer.
+  return !bus::kRamMemoryRange.InRange(masked) ||
+         (masked + kInstructionLength > code_begin && masked < code_end);
 }
 
 uint32_t cpu::CPU::GetRegister(const uint32_t index) const {
@@ -158,30 +792,489 @@ uint32_t cpu::CPU::GetHI() const { return hi_; }
 
 uint32_t cpu::CPU::GetLO() const { return lo_; }
 
-uint32_t cpu::CPU::Load32(const uint32_t address) const {
-  return bus_.Load32(address);
+uint32_t cpu::CPU::Peek32(const uint32_t address) const {
+  return bus_.Peek32(address);
+}
+
+void cpu::CPU::Sideload(std::shared_ptr<const exe::Executable> executable) {
+  executable_ = std::move(executable);
+  sideload_pending_ = executable_ != nullptr;
+}
+
+void cpu::CPU::LoadExecutable() {
+  sideload_pending_ = false;
+
+  const exe::Header& header = executable_->GetHeader();
+  ram::Ram& ram = bus_.GetRam();
+  ram.WriteBytes(bus::MaskRegion(header.text_address), executable_->GetText());
+  ram.ZeroBytes(bus::MaskRegion(header.bss_address), header.bss_size);
+  icache_.Reset();
+
+  program_counter_ = header.initial_pc;
+  next_program_counter_ = program_counter_ + kInstructionLength;
+  load_delay_slots_ = LoadDelaySlots();
+
+  SetRegister(kGlobalPointer, header.initial_gp);
+  if (header.stack_address != 0) {
+    const uint32_t stack_top = header.stack_address + header.stack_size;
+    SetRegister(kStackPointer, stack_top);
+    SetRegister(kFramePointer, stack_top);
+  }
+  read_registers_ = write_registers_;
+
+  LOG_INFO_CPU("Sideloaded EXE, entry point 0x{:08X}", header.initial_pc);
+}
+
+void cpu::CPU::SetHleMode(const hle::Mode mode) { hle_.SetMode(mode); }
+
+hle::Mode cpu::CPU::GetHleMode() const { return hle_.GetMode(); }
+
+const hle::Stats& cpu::CPU::GetHleStats() const { return hle_.GetStats(); }
+
+void cpu::CPU::SetIdleSkipping(const bool enabled) {
+  idle_loop_.SetEnabled(enabled);
+}
+
+bool cpu::CPU::IsIdleSkipping() const { return idle_loop_.IsEnabled(); }
+
+void cpu::CPU::SetFusion(const bool enabled) { fusion_ = enabled; }
+
+bool cpu::CPU::IsFusing() const { return fusion_; }
+
+void cpu::CPU::SetBackend(const Backend backend) { backend_ = backend; }
+
+cpu::Backend cpu::CPU::GetBackend() const { return backend_; }
+
+block_cache::Cache& cpu::CPU::GetBlockCache() { return blocks_; }
+
+const block_cache::Cache& cpu::CPU::GetBlockCache() const { return blocks_; }
+
+const idle_loop::Stats& cpu::CPU::GetIdleLoopStats() const {
+  return idle_loop_.GetStats();
+}
+
+const bus::Stats& cpu::CPU::GetBusStats() const { return bus_.GetStats(); }
+
+const icache::Stats& cpu::CPU::GetInstructionCacheStats() const {
+  return icache_.GetStats();
+}
+
+void cpu::CPU::SetMdecPool(std::shared_ptr<worker_pool::WorkerPool> pool) {
+  bus_.SetMdecPool(std::move(pool));
+}
+
+breakpoint::Set& cpu::CPU::GetBreakpoints() { return breakpoints_; }
+
+const breakpoint::Set& cpu::CPU::GetBreakpoints() const {
+  return breakpoints_;
+}
+
+bool cpu::CPU::IsStoppedAtBreakpoint() const { return stopped_at_breakpoint_; }
+
+watchpoint::Set& cpu::CPU::GetWatchpoints() { return watchpoints_; }
+
+const watchpoint::Set& cpu::CPU::GetWatchpoints() const {
+  return watchpoints_;
+}
+
+void cpu::CPU::StartTrace(const std::filesystem::path& path) {
+  trace_ = std::make_unique<trace::Writer>(path);
+  UpdateInstrumentation();
+}
+
+void cpu::CPU::StopTrace() {
+  trace_.reset();
+  UpdateInstrumentation();
+}
+
+bool cpu::CPU::IsTracing() const { return trace_ != nullptr; }
+
+void cpu::CPU::StartProfiling() {
+  profiler_.Start(program_counter_, cycle_count_);
+  UpdateInstrumentation();
+}
+
+void cpu::CPU::StopProfiling() {
+  profiler_.Stop();
+  UpdateInstrumentation();
+}
+
+profiler::Profiler& cpu::CPU::GetProfiler() { return profiler_; }
+
+const profiler::Profiler& cpu::CPU::GetProfiler() const { return profiler_; }
+
+histogram::OpcodeHistogram& cpu::CPU::GetOpcodeHistogram() {
+  return histogram_;
 }
 
-uint8_t cpu::CPU::Load8(const uint32_t address) const {
-  return bus_.Load8(address);
+const histogram::OpcodeHistogram& cpu::CPU::GetOpcodeHistogram() const {
+  return histogram_;
+}
+
+void cpu::CPU::UpdateInstrumentation() {
+  const bool instrumented = trace_ != nullptr || profiler_.IsRunning();
+  if (instrumented && !instrumented_) {
+    // Raised while nobody was looking.
+    exception_raised_ = false;
+  }
+  instrumented_ = instrumented;
+}
+
+void cpu::CPU::Instrument(const Instruction& instruction) {
+  const bool exception = std::exchange(exception_raised_, false);
+
+  if (trace_ != nullptr) {
+    TraceInstruction(instruction, exception);
+  }
+
+  if (profiler_.IsRunning()) {
+    profiler_.OnInstruction(
+        profiler::Step{.pc = current_program_counter_,
+                       .instruction = instruction.GetRawData(),
+                       .next_pc = program_counter_,
+                       .target = next_program_counter_,
+                       .cycle = cycle_count_,
+                       .bios_function = GetRegister(kBiosFunction),
+                       .epc = cop0_.GetEpcRegister(),
+                       .exception = exception});
+  }
+}
+
+void cpu::CPU::TraceInstruction(const Instruction& instruction,
+                                const bool exception) {
+  const uint32_t word = instruction.GetRawData();
+  const isa::Spec& spec = isa::GetSpec(isa::Decode(word));
+
+  trace::Record record{.pc = current_program_counter_,
+                       .instruction = word,
+                       .cycle = static_cast<uint32_t>(cycle_count_)};
+
+  if (exception) {
+    record.flags = trace::kException;
+    trace_->Append(record);
+    return;
+  }
+
+  if ((spec.flags & (isa::kLoad | isa::kStore)) != 0U) {
+    record.address = GetRegister(instruction.GetS()) +
+                     instruction.GetImmediate16SignExtend();
+  }
+  if ((spec.flags & isa::kStore) != 0U) {
+    record.flags |= trace::kStore;
+    record.value = GetRegister(instruction.GetT());
+  }
+  if ((spec.flags & isa::kLoad) != 0U) {
+    record.flags |= trace::kLoad;
+  }
+
+  // Loads and coprocessor reads land through the delay slot.
+  if (load_delay_slots_.index != 0) {
+    record.flags |= trace::kRegisterWrite;
+    record.register_index = static_cast<uint8_t>(load_delay_slots_.index);
+    record.value = load_delay_slots_.value;
+  } else if (const std::optional<uint8_t> destination =
+                 isa::GetDestination(word);
+             destination.has_value() && (spec.flags & isa::kLoad) == 0U) {
+    record.flags |= trace::kRegisterWrite;
+    record.register_index = destination.value();
+    record.value = gsl::at(write_registers_, destination.value());
+  }
+
+  trace_->Append(record);
+}
+
+void cpu::CPU::CollectWatchpoints() {
+  watchpoints_.Collect(current_program_counter_, current_instruction_,
+                       data_address_);
+}
+
+template <cpu::Accuracy kAccuracy>
+bool cpu::CPU::HandleBiosCall(const uint32_t table) {
+  const uint32_t function = GetRegister(kBiosFunction);
+  if (!hle::IsImplemented(table, function)) {
+    return false;
+  }
+
+  // A load still in flight lands before the call starts.
+  const auto [index, value] = load_delay_slots_;
+  SetRegister(index, value);
+  load_delay_slots_ = LoadDelaySlots();
+  read_registers_ = write_registers_;
+
+  const hle::Call call{.table = table,
+                       .function = function,
+                       .arguments = {GetRegister(kFirstArgument),
+                                     GetRegister(kFirstArgument + 1),
+                                     GetRegister(kFirstArgument + 2),
+                                     GetRegister(kFirstArgument + 3)},
+                       .stack_pointer = GetRegister(kStackPointer)};
+
+  if (hle_.GetMode() == hle::Mode::kVerify) {
+    VerifyBiosCall<kAccuracy>(call);
+  } else {
+    ReturnFromBiosCall(hle_.Execute(call, bus_));
+  }
+  // HLE routines never raise guest exceptions, drop any bus error they hit.
+  static_cast<void>(bus_.TakeBusError());
+  return true;
+}
+
+template <cpu::Accuracy kAccuracy>
+void cpu::CPU::VerifyBiosCall(const hle::Call& call) {
+  constexpr auto kCompression = savestate::Compression::kNone;
+
+  std::vector<std::byte> state(GetStateSize(kCompression));
+  state.resize(SaveState(state, kCompression));
+
+  const hle::Result native = hle_.Execute(call, bus_);
+  std::vector<uint8_t> native_memory(native.written_size);
+  for (uint32_t i = 0; i < native.written_size; i++) {
+    gsl::at(native_memory, i) = bus_.Load8(native.written_address + i);
+  }
+  static_cast<void>(bus_.TakeBusError());
+
+  // Rewind and let the BIOS run the same call, with HLE out of the way.
+  LoadState(state);
+  const uint32_t return_address = GetRegister(kReturnAddress);
+  verifying_bios_call_ = true;
+  const auto clear_verifying = gsl::finally([this] {
+    verifying_bios_call_ = false;
+  });
+
+  for (uint64_t steps = 0; program_counter_ != return_address; steps++) {
+    if (steps == kMaxVerifySteps) {
+      LOG_ERROR_HLE("{:02X}({:02X}) did not return", call.table,
+                    call.function);
+      hle_.GetStats().mismatches++;
+      return;
+    }
+    Step<kAccuracy>();
+  }
+  hle_.GetStats().verified++;
+
+  const uint32_t value = GetRegister(kReturnValue);
+  if (native.value.has_value() && native.value.value() != value) {
+    LOG_ERROR_HLE("{:02X}({:02X}) returned {:08X}, the BIOS returned {:08X}",
+                  call.table, call.function, native.value.value(), value);
+    hle_.GetStats().mismatches++;
+    return;
+  }
+
+  for (uint32_t i = 0; i < native.written_size; i++) {
+    const uint32_t address = native.written_address + i;
+    if (const uint8_t byte = bus_.Load8(address);
+        byte != gsl::at(native_memory, i)) {
+      LOG_ERROR_HLE(
+          "{:02X}({:02X}) wrote {:02X} at {:08X}, the BIOS wrote {:02X}",
+          call.table, call.function, gsl::at(native_memory, i), address, byte);
+      hle_.GetStats().mismatches++;
+      return;
+    }
+  }
+}
+
+void cpu::CPU::ReturnFromBiosCall(const hle::Result& result) {
+  if (result.value.has_value()) {
+    SetRegister(kReturnValue, result.value.value());
+    read_registers_ = write_registers_;
+  }
+
+  program_counter_ = GetRegister(kReturnAddress);
+  next_program_counter_ = program_counter_ + kInstructionLength;
+  cycle_count_ += result.cycles;
+  step_count_++;
+
+  if (profiler_.IsRunning()) {
+    profiler_.Return(program_counter_);
+  }
+}
+
+size_t cpu::CPU::GetStateSize(const savestate::Compression compression,
+                              const savestate::Content content) const {
+  savestate::Writer writer(compression, content);
+  Save(writer);
+  return writer.Finish();
+}
+
+size_t cpu::CPU::SaveState(const std::span<std::byte> buffer,
+                           const savestate::Compression compression,
+                           const savestate::Content content) const {
+  savestate::Writer writer(buffer, compression, content);
+  Save(writer);
+  return writer.Finish();
+}
+
+void cpu::CPU::LoadState(const std::span<const std::byte> buffer) {
+  savestate::Reader reader(buffer);
+
+  // The whole state is read into copies and only committed once all of it
+  // has been read, so a truncated or corrupt state leaves the machine as it
+  // was. The bus goes last and commits itself only on success.
+  auto next_program_counter = next_program_counter_;
+  auto program_counter = program_counter_;
+  auto current_program_counter = current_program_counter_;
+  auto read_registers = read_registers_;
+  auto write_registers = write_registers_;
+  auto load_delay_slots = load_delay_slots_;
+  auto cop0 = cop0_;
+  auto hi = hi_;
+  auto lo = lo_;
+  auto step_count = step_count_;
+  auto cycle_count = cycle_count_;
+  bool sideload_pending = false;
+  bool branch = false;
+
+  const uint32_t version = reader.BeginSection(kStateTag, kStateVersion);
+  reader.Read(next_program_counter);
+  reader.Read(program_counter);
+  reader.Read(current_program_counter);
+  reader.Read(read_registers);
+  reader.Read(write_registers);
+  reader.Read(load_delay_slots);
+  reader.Read(cop0);
+  reader.Read(hi);
+  reader.Read(lo);
+  reader.Read(step_count);
+  reader.Read(cycle_count);
+  if (version >= 2) {
+    reader.Read(sideload_pending);
+  }
+  if (version >= 3) {
+    reader.Read(branch);
+  }
+  reader.EndSection();
+
+  gte::Gte gte = gte_;
+  gte.Load(reader);
+  icache::InstructionCache icache = icache_;
+  icache.Load(reader);
+  bus_.Load(reader);
+
+  next_program_counter_ = next_program_counter;
+  program_counter_ = program_counter;
+  current_program_counter_ = current_program_counter;
+  read_registers_ = read_registers;
+  write_registers_ = write_registers;
+  load_delay_slots_ = load_delay_slots;
+  cop0_ = cop0;
+  hi_ = hi;
+  lo_ = lo;
+  step_count_ = step_count;
+  cycle_count_ = cycle_count;
+  sideload_pending_ = sideload_pending && executable_ != nullptr;
+  branch_ = branch;
+  gte_ = gte;
+  icache_ = icache;
+
+  idle_loop_.Reset();
+  stopped_at_breakpoint_ = false;
+
+  if (profiler_.IsRunning()) {
+    profiler_.Start(program_counter_, cycle_count_);
+  }
+}
+
+ram::Ram& cpu::CPU::GetRam() { return bus_.GetRam(); }
+
+const ram::Ram& cpu::CPU::GetRam() const { return bus_.GetRam(); }
+
+void cpu::CPU::Save(savestate::Writer& writer) const {
+  writer.BeginSection(kStateTag, kStateVersion);
+  writer.Write(next_program_counter_);
+  writer.Write(program_counter_);
+  writer.Write(current_program_counter_);
+  writer.Write(read_registers_);
+  writer.Write(write_registers_);
+  writer.Write(load_delay_slots_);
+  writer.Write(cop0_);
+  writer.Write(hi_);
+  writer.Write(lo_);
+  writer.Write(step_count_);
+  writer.Write(cycle_count_);
+  writer.Write(sideload_pending_);
+  writer.Write(branch_);
+  writer.EndSection();
+
+  gte_.Save(writer);
+  icache_.Save(writer);
+  bus_.Save(writer);
+}
+
+std::optional<uint32_t> cpu::CPU::Load32(const uint32_t address) {
+  if (address % 4 != 0) [[unlikely]] {
+    AddressError(ExceptionType::kLoadAddressError, address);
+    return std::nullopt;
+  }
+
+  data_address_ = address;
+  const uint32_t value = bus_.Load32(address);
+  if (bus_.TakeBusError()) [[unlikely]] {
+    Exception(ExceptionType::kBusErrorData);
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<uint16_t> cpu::CPU::Load16(const uint32_t address) {
+  if (address % 2 != 0) [[unlikely]] {
+    AddressError(ExceptionType::kLoadAddressError, address);
+    return std::nullopt;
+  }
+
+  data_address_ = address;
+  const uint16_t value = bus_.Load16(address);
+  if (bus_.TakeBusError()) [[unlikely]] {
+    Exception(ExceptionType::kBusErrorData);
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<uint8_t> cpu::CPU::Load8(const uint32_t address) {
+  data_address_ = address;
+  const uint8_t value = bus_.Load8(address);
+  if (bus_.TakeBusError()) [[unlikely]] {
+    Exception(ExceptionType::kBusErrorData);
+    return std::nullopt;
+  }
+  return value;
 }
 
 void cpu::CPU::Store32(const uint32_t address, const uint32_t value) {
+  if (address % 4 != 0) [[unlikely]] {
+    AddressError(ExceptionType::kStoreAddressError, address);
+    return;
+  }
+
   if (cop0_.IsCacheIsolated()) {
-    LOG_INFO_CPU("Ignoring store while cache is isolated");
+    // With the cache isolated the BIOS flushes it by storing to every line.
+    icache_.Invalidate(address);
     return;
   }
 
+  data_address_ = address;
   bus_.Store32(address, value);
+  if (bus_.TakeBusError()) [[unlikely]] {
+    Exception(ExceptionType::kBusErrorData);
+  }
 }
 
 void cpu::CPU::Store16(const uint32_t address, const uint16_t value) {
+  if (address % 2 != 0) [[unlikely]] {
+    AddressError(ExceptionType::kStoreAddressError, address);
+    return;
+  }
+
   if (cop0_.IsCacheIsolated()) {
     LOG_INFO_CPU("Ignoring store while cache is isolated");
     return;
   }
 
+  data_address_ = address;
   bus_.Store16(address, value);
+  if (bus_.TakeBusError()) [[unlikely]] {
+    Exception(ExceptionType::kBusErrorData);
+  }
 }
 
 void cpu::CPU::Store8(const uint32_t address, const uint8_t value) {
@@ -190,7 +1283,11 @@ void cpu::CPU::Store8(const uint32_t address, const uint8_t value) {
     return;
   }
 
+  data_address_ = address;
   bus_.Store8(address, value);
+  if (bus_.TakeBusError()) [[unlikely]] {
+    Exception(ExceptionType::kBusErrorData);
+  }
 }
 
 void cpu::CPU::Branch(uint32_t offset) {
@@ -198,82 +1295,68 @@ void cpu::CPU::Branch(uint32_t offset) {
 
   next_program_counter_ += offset;
   next_program_counter_ -= 4;
-}
 
-void cpu::CPU::Exception(ExceptionType cause) {
-  const uint32_t handler = cop0_.GetHandlerAddress();
+  if (idle_loop_.IsEnabled()) {
+    CheckIdleLoop();
+  }
+}
 
-  const Mode mode = cop0_.GetMode();
-  cop0_.SetStatusRegister(cop0_.GetStatusRegister() & 0x3U);
-  cop0_.SetStatusRegister(cop0_.GetStatusRegister() |
-                          ((static_cast<uint32_t>(mode) << 2) & 0x3f));
+void cpu::CPU::CheckIdleLoop() {
+  const uint32_t tail = current_program_counter_;
+  const uint32_t head = next_program_counter_;
+  constexpr uint32_t kMaxDistance =
+      (idle_loop::kMaxLoopInstructions - 2) * kInstructionLength;
+  if (head > tail || tail - head > kMaxDistance) {
+    return;
+  }
 
-  cop0_.SetCauseRegister(static_cast<uint32_t>(cause) << 2);
+  if (!idle_loop_.IsCandidate(head, tail)) {
+    std::array<uint32_t, idle_loop::kMaxLoopInstructions> body{};
+    // The body runs through the back-edge's delay slot.
+    const size_t count = ((tail - head) / kInstructionLength) + 2;
+    for (size_t i = 0; i < count; i++) {
+      gsl::at(body, i) =
+          bus_.Peek32(head + static_cast<uint32_t>(i) * kInstructionLength);
+    }
+    idle_loop_.SetCandidate(head, tail, std::span(body).first(count));
+  }
+  idle_loop_.OnBackEdge();
+}
 
-  cop0_.SetEpcRegister(current_program_counter_);
+void cpu::CPU::Exception(const ExceptionType cause) {
+  const uint32_t handler = cop0_.GetHandlerAddress();
+  exception_raised_ = true;
+
+  // Push the mode/interrupt enable pairs, the handler starts in kernel mode
+  // with interrupts disabled.
+  const uint32_t status = cop0_.GetStatusRegister();
+  cop0_.SetStatusRegister((status & ~kInterruptStackMask) |
+                          ((status << 2U) & kInterruptStackMask));
+
+  constexpr uint32_t kCauseMask = kCauseExceptionCodeMask | kCauseBranchDelay;
+  uint32_t cause_register = (cop0_.GetCauseRegister() & ~kCauseMask) |
+                            (static_cast<uint32_t>(cause) << 2U);
+  uint32_t epc = current_program_counter_;
+  if (delay_slot_) {
+    // Returning to the branch runs it and its delay slot again.
+    cause_register |= kCauseBranchDelay;
+    epc -= kInstructionLength;
+  }
+  cop0_.SetCauseRegister(cause_register);
+  cop0_.SetEpcRegister(epc);
 
   program_counter_ = handler;
   next_program_counter_ = program_counter_ + kInstructionLength;
+  branch_ = false;
 }
 
-void cpu::CPU::OpSPECIAL(const Instruction& instruction) {
-  switch (instruction.GetSecondaryOpcode()) {
-    case Instruction::SecondaryOpcode::kSLL:
-      OpSLL(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kSRL:
-      OpSRL(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kSRA:
-      OpSRA(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kJR:
-      OpJR(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kJALR:
-      OpJALR(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kSYSCALL:
-      OpSYSCALL(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kMFHI:
-      OpMFHI(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kMFLO:
-      OpMFLO(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kDIV:
-      OpDIV(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kDIVU:
-      OpDIVU(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kADD:
-      OpADD(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kADDU:
-      OpADDU(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kSUBU:
-      OpSUBU(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kAND:
-      OpAND(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kOR:
-      OpOR(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kSLT:
-      OpSLT(instruction);
-      break;
-    case Instruction::SecondaryOpcode::kSLTU:
-      OpSLTU(instruction);
-      break;
-    default:
-      throw std::runtime_error(
-          std::format("unhandled secondary opcode {:02X}",
-                      static_cast<uint8_t>(instruction.GetSecondaryOpcode())));
-  }
+void cpu::CPU::AddressError(const ExceptionType cause, const uint32_t address) {
+  cop0_.SetBadVaddrRegister(address);
+  Exception(cause);
+}
+
+void cpu::CPU::OpIllegal([[maybe_unused]] const Instruction& instruction) {
+  Exception(ExceptionType::kReservedInstruction);
 }
 
 void cpu::CPU::OpSLL(const Instruction& instruction) {
@@ -300,6 +1383,30 @@ void cpu::CPU::OpSRA(const Instruction& instruction) {
   SetRegister(instruction.GetD(), static_cast<uint32_t>(result));
 }
 
+void cpu::CPU::OpSLLV(const Instruction& instruction) {
+  const uint32_t register_t = GetRegister(instruction.GetT());
+  const uint32_t shift = GetRegister(instruction.GetS()) & 0x1FU;
+
+  const uint32_t result = register_t << shift;
+  SetRegister(instruction.GetD(), result);
+}
+
+void cpu::CPU::OpSRLV(const Instruction& instruction) {
+  const uint32_t register_t = GetRegister(instruction.GetT());
+  const uint32_t shift = GetRegister(instruction.GetS()) & 0x1FU;
+
+  const uint32_t result = register_t >> shift;
+  SetRegister(instruction.GetD(), result);
+}
+
+void cpu::CPU::OpSRAV(const Instruction& instruction) {
+  const auto register_t = static_cast<int32_t>(GetRegister(instruction.GetT()));
+  const uint32_t shift = GetRegister(instruction.GetS()) & 0x1FU;
+
+  const int32_t result = register_t >> shift;
+  SetRegister(instruction.GetD(), static_cast<uint32_t>(result));
+}
+
 void cpu::CPU::OpJR(const Instruction& instruction) {
   const uint32_t register_s = GetRegister(instruction.GetS());
 
@@ -317,14 +1424,45 @@ void cpu::CPU::OpSYSCALL([[maybe_unused]] const Instruction& instruction) {
   Exception(ExceptionType::kSysCall);
 }
 
+void cpu::CPU::OpBREAK([[maybe_unused]] const Instruction& instruction) {
+  Exception(ExceptionType::kBreak);
+}
+
 void cpu::CPU::OpMFHI(const Instruction& instruction) {
   SetRegister(instruction.GetD(), hi_);
 }
 
+void cpu::CPU::OpMTHI(const Instruction& instruction) {
+  hi_ = GetRegister(instruction.GetS());
+}
+
 void cpu::CPU::OpMFLO(const Instruction& instruction) {
   SetRegister(instruction.GetD(), lo_);
 }
 
+void cpu::CPU::OpMTLO(const Instruction& instruction) {
+  lo_ = GetRegister(instruction.GetS());
+}
+
+void cpu::CPU::OpMULT(const Instruction& instruction) {
+  const auto register_s = static_cast<int32_t>(GetRegister(instruction.GetS()));
+  const auto register_t = static_cast<int32_t>(GetRegister(instruction.GetT()));
+
+  const auto result = static_cast<uint64_t>(static_cast<int64_t>(register_s) *
+                                            static_cast<int64_t>(register_t));
+  hi_ = static_cast<uint32_t>(result >> 32U);
+  lo_ = static_cast<uint32_t>(result);
+}
+
+void cpu::CPU::OpMULTU(const Instruction& instruction) {
+  const uint64_t register_s = GetRegister(instruction.GetS());
+  const uint64_t register_t = GetRegister(instruction.GetT());
+
+  const uint64_t result = register_s * register_t;
+  hi_ = static_cast<uint32_t>(result >> 32U);
+  lo_ = static_cast<uint32_t>(result);
+}
+
 void cpu::CPU::OpDIV(const Instruction& instruction) {
   const auto register_s = static_cast<int32_t>(GetRegister(instruction.GetS()));
   const auto register_t = static_cast<int32_t>(GetRegister(instruction.GetT()));
@@ -366,13 +1504,15 @@ void cpu::CPU::OpADD(const Instruction& instruction) {
   const uint32_t register_s = GetRegister(instruction.GetS());
   const uint32_t register_t = GetRegister(instruction.GetT());
 
-  int32_t result = 0;
-  if (CheckedSum<int32_t>(static_cast<int32_t>(register_s),
-                          static_cast<int32_t>(register_t), &result)) {
-    throw std::runtime_error("overflow in ADD");
+  // Shared with the blocks, so both raise Ov on exactly the same sums.
+  const std::optional<uint32_t> result =
+      ir::EvaluateChecked(ir::Opcode::kAddChecked, register_s, register_t);
+  if (!result.has_value()) {
+    Exception(ExceptionType::kOverflow);
+    return;
   }
 
-  SetRegister(instruction.GetD(), static_cast<uint32_t>(result));
+  SetRegister(instruction.GetD(), result.value());
 }
 
 void cpu::CPU::OpADDU(const Instruction& instruction) {
@@ -383,6 +1523,20 @@ void cpu::CPU::OpADDU(const Instruction& instruction) {
   SetRegister(instruction.GetD(), result);
 }
 
+void cpu::CPU::OpSUB(const Instruction& instruction) {
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t register_t = GetRegister(instruction.GetT());
+
+  const std::optional<uint32_t> result =
+      ir::EvaluateChecked(ir::Opcode::kSubChecked, register_s, register_t);
+  if (!result.has_value()) {
+    Exception(ExceptionType::kOverflow);
+    return;
+  }
+
+  SetRegister(instruction.GetD(), result.value());
+}
+
 void cpu::CPU::OpSUBU(const Instruction& instruction) {
   const uint32_t register_s = GetRegister(instruction.GetS());
   const uint32_t register_t = GetRegister(instruction.GetT());
@@ -407,6 +1561,22 @@ void cpu::CPU::OpOR(const Instruction& instruction) {
   SetRegister(instruction.GetD(), result);
 }
 
+void cpu::CPU::OpXOR(const Instruction& instruction) {
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t register_t = GetRegister(instruction.GetT());
+
+  const uint32_t result = register_s ^ register_t;
+  SetRegister(instruction.GetD(), result);
+}
+
+void cpu::CPU::OpNOR(const Instruction& instruction) {
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t register_t = GetRegister(instruction.GetT());
+
+  const uint32_t result = ~(register_s | register_t);
+  SetRegister(instruction.GetD(), result);
+}
+
 void cpu::CPU::OpSLT(const Instruction& instruction) {
   const auto register_s = static_cast<int32_t>(GetRegister(instruction.GetS()));
   const auto register_t = static_cast<int32_t>(GetRegister(instruction.GetT()));
@@ -421,19 +1591,17 @@ void cpu::CPU::OpSLTU(const Instruction& instruction) {
   SetRegister(instruction.GetD(), register_s < register_t ? 1 : 0);
 }
 
-void cpu::CPU::OpBcondZ(const Instruction& instruction) {
-  switch (instruction.GetConditionOpcode()) {
-    case Instruction::ConditionOpcode::kBLTZ:
-      OpBLTZ(instruction);
-      break;
-    case Instruction::ConditionOpcode::kBGEZ:
-      OpBGEZ(instruction);
-      break;
-    default:
-      throw std::runtime_error(
-          std::format("unhandled condition opcode {:02X}",
-                      static_cast<uint8_t>(instruction.GetConditionOpcode())));
-  }
+void cpu::CPU::OpBLTZAL(const Instruction& instruction) {
+  // The return address is written whether or not the branch is taken.
+  SetRegister(kReturnAddress, GetNextPC());
+
+  OpBLTZ(instruction);
+}
+
+void cpu::CPU::OpBGEZAL(const Instruction& instruction) {
+  SetRegister(kReturnAddress, GetNextPC());
+
+  OpBGEZ(instruction);
 }
 
 void cpu::CPU::OpBLTZ(const Instruction& instruction) {
@@ -459,6 +1627,10 @@ void cpu::CPU::OpJ(const Instruction& instruction) {
 
   next_program_counter_ =
       (next_program_counter_ & 0xF0000000) | (immediate << 2U);
+
+  if (idle_loop_.IsEnabled()) {
+    CheckIdleLoop();
+  }
 }
 
 void cpu::CPU::OpJAL(const Instruction& instruction) {
@@ -506,16 +1678,17 @@ void cpu::CPU::OpBGTZ(const Instruction& instruction) {
 }
 
 void cpu::CPU::OpADDI(const Instruction& instruction) {
-  const auto register_s = static_cast<int32_t>(GetRegister(instruction.GetS()));
-  const auto immediate =
-      static_cast<int32_t>(instruction.GetImmediate16SignExtend());
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t immediate = instruction.GetImmediate16SignExtend();
 
-  int32_t sum = 0;
-  if (CheckedSum<int32_t>(register_s, immediate, &sum)) {
-    throw std::runtime_error("overflow in ADDI");
+  const std::optional<uint32_t> sum =
+      ir::EvaluateChecked(ir::Opcode::kAddChecked, register_s, immediate);
+  if (!sum.has_value()) {
+    Exception(ExceptionType::kOverflow);
+    return;
   }
 
-  SetRegister(instruction.GetT(), static_cast<uint32_t>(sum));
+  SetRegister(instruction.GetT(), sum.value());
 }
 
 void cpu::CPU::OpADDIU(const Instruction& instruction) {
@@ -557,41 +1730,50 @@ void cpu::CPU::OpORI(const Instruction& instruction) {
   SetRegister(instruction.GetT(), result);
 }
 
-void cpu::CPU::OpLUI(const Instruction& instruction) {
+void cpu::CPU::OpXORI(const Instruction& instruction) {
+  const uint32_t register_s = GetRegister(instruction.GetS());
   const uint16_t immediate = instruction.GetImmediate16();
 
-  const uint32_t result = immediate << 16U;
+  const uint32_t result = register_s ^ immediate;
   SetRegister(instruction.GetT(), result);
 }
 
-void cpu::CPU::OpCOP0(const Instruction& instruction) {
-  switch (const bool flag = instruction.GetCoprocessorFlag();
-          instruction.GetCoprocessorOpcode(flag)) {
-    case Instruction::CoprocessorOpcode::kMFC:
-      OpMFC0(instruction);
-      break;
-    case Instruction::CoprocessorOpcode::kMTC:
-      OpMTC0(instruction);
-      break;
-    default:
-      throw std::runtime_error(std::format(
-          "unhandled coprocessor opcode {:02X}",
-          static_cast<uint8_t>(instruction.GetCoprocessorOpcode(flag))));
-  }
+void cpu::CPU::OpLUI(const Instruction& instruction) {
+  const uint16_t immediate = instruction.GetImmediate16();
+
+  const uint32_t result = immediate << 16U;
+  SetRegister(instruction.GetT(), result);
 }
 
 void cpu::CPU::OpMFC0(const Instruction& instruction) {
+  uint32_t value = 0;
   switch (instruction.GetD()) {
     case COP0::Registers::kStatusRegister:
-      SetRegister(instruction.GetT(), cop0_.GetStatusRegister());
+      value = cop0_.GetStatusRegister();
       break;
     case COP0::Registers::kCAUSE:
+      value = cop0_.GetCauseRegister();
+      break;
     case COP0::Registers::kEPC:
+      value = cop0_.GetEpcRegister();
+      break;
+    case COP0::Registers::kBadVaddr:
+      value = cop0_.GetBadVaddrRegister();
+      break;
+    case COP0::Registers::kBPC:
+    case COP0::Registers::kBDA:
+    case COP0::Registers::kTAR:
+    case COP0::Registers::kDCIC:
+    case COP0::Registers::kBDAM:
+    case COP0::Registers::kBPCM:
       LOG_INFO_CPU("Unhandled read from cop0r{}", instruction.GetD());
+      break;
     default:
-      throw std::runtime_error(
-          std::format("unhandled cop0 register {}", instruction.GetD()));
+      Exception(ExceptionType::kReservedInstruction);
+      return;
   }
+
+  SetRegister(instruction.GetT(), value);
 }
 
 void cpu::CPU::OpMTC0(const Instruction& instruction) {
@@ -608,14 +1790,44 @@ void cpu::CPU::OpMTC0(const Instruction& instruction) {
     case COP0::Registers::kBDAM:
     case COP0::Registers::kBPCM:
     case COP0::Registers::kCAUSE:
-      LOG_INFO_CPU("Ignoring write to debug COP0 register");
+    case COP0::Registers::kBadVaddr:
+    case COP0::Registers::kEPC:
+      LOG_INFO_CPU("Ignoring write to cop0r{}", instruction.GetD());
       break;
     default:
-      throw std::runtime_error(
-          std::format("unhandled cop0 register {}", instruction.GetD()));
+      Exception(ExceptionType::kReservedInstruction);
+      break;
   }
 }
 
+void cpu::CPU::OpRFE([[maybe_unused]] const Instruction& instruction) {
+  // Pop the mode/interrupt enable stack, the oldest pair stays put.
+  const uint32_t status = cop0_.GetStatusRegister();
+  cop0_.SetStatusRegister((status & ~0xFU) | ((status >> 2U) & 0xFU));
+}
+
+void cpu::CPU::OpMFC2(const Instruction& instruction) {
+  load_delay_slots_ =
+      LoadDelaySlots(instruction.GetT(), gte_.GetData(instruction.GetD()));
+}
+
+void cpu::CPU::OpCFC2(const Instruction& instruction) {
+  load_delay_slots_ =
+      LoadDelaySlots(instruction.GetT(), gte_.GetControl(instruction.GetD()));
+}
+
+void cpu::CPU::OpMTC2(const Instruction& instruction) {
+  gte_.SetData(instruction.GetD(), GetRegister(instruction.GetT()));
+}
+
+void cpu::CPU::OpCTC2(const Instruction& instruction) {
+  gte_.SetControl(instruction.GetD(), GetRegister(instruction.GetT()));
+}
+
+void cpu::CPU::OpGTE(const Instruction& instruction) {
+  gte_.Execute(instruction.GetRawData() & 0x1FFFFFFU);
+}
+
 void cpu::CPU::OpLB(const Instruction& instruction) {
   if (cop0_.IsCacheIsolated()) {
     LOG_INFO_CPU("Ignoring load while cache is isolated");
@@ -626,10 +1838,57 @@ void cpu::CPU::OpLB(const Instruction& instruction) {
   const uint32_t immediate = instruction.GetImmediate16SignExtend();
 
   const uint32_t address = register_s + immediate;
-  const auto value = static_cast<int8_t>(bus_.Load8(address));
+  const std::optional<uint8_t> value = Load8(address);
+  if (!value.has_value()) [[unlikely]] {
+    return;
+  }
 
-  load_delay_slots_ =
-      LoadDelaySlots(instruction.GetT(), static_cast<uint32_t>(value));
+  load_delay_slots_ = LoadDelaySlots(
+      instruction.GetT(),
+      static_cast<uint32_t>(static_cast<int8_t>(value.value())));
+}
+
+void cpu::CPU::OpLH(const Instruction& instruction) {
+  if (cop0_.IsCacheIsolated()) {
+    LOG_INFO_CPU("Ignoring load while cache is isolated");
+    return;
+  }
+
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t immediate = instruction.GetImmediate16SignExtend();
+
+  const uint32_t address = register_s + immediate;
+  const std::optional<uint16_t> value = Load16(address);
+  if (!value.has_value()) [[unlikely]] {
+    return;
+  }
+
+  load_delay_slots_ = LoadDelaySlots(
+      instruction.GetT(),
+      static_cast<uint32_t>(static_cast<int16_t>(value.value())));
+}
+
+void cpu::CPU::OpLWL(const Instruction& instruction) {
+  if (cop0_.IsCacheIsolated()) {
+    LOG_INFO_CPU("Ignoring load while cache is isolated");
+    return;
+  }
+
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t immediate = instruction.GetImmediate16SignExtend();
+
+  const uint32_t address = register_s + immediate;
+  const std::optional<uint32_t> word = Load32(address & ~0x3U);
+  if (!word.has_value()) [[unlikely]] {
+    return;
+  }
+
+  // LWL/LWR merge into a load still in flight to the same register, so
+  // the pair works back to back.
+  const uint32_t current = gsl::at(write_registers_, instruction.GetT());
+
+  load_delay_slots_ = LoadDelaySlots(
+      instruction.GetT(), MergeLeft(current, word.value(), address));
 }
 
 void cpu::CPU::OpLW(const Instruction& instruction) {
@@ -642,9 +1901,12 @@ void cpu::CPU::OpLW(const Instruction& instruction) {
   const uint32_t immediate = instruction.GetImmediate16SignExtend();
 
   const uint32_t address = register_s + immediate;
-  const uint32_t value = bus_.Load32(address);
+  const std::optional<uint32_t> value = Load32(address);
+  if (!value.has_value()) [[unlikely]] {
+    return;
+  }
 
-  load_delay_slots_ = LoadDelaySlots(instruction.GetT(), value);
+  load_delay_slots_ = LoadDelaySlots(instruction.GetT(), value.value());
 }
 
 void cpu::CPU::OpLBU(const Instruction& instruction) {
@@ -657,10 +1919,53 @@ void cpu::CPU::OpLBU(const Instruction& instruction) {
   const uint32_t immediate = instruction.GetImmediate16SignExtend();
 
   const uint32_t address = register_s + immediate;
-  const uint8_t value = bus_.Load8(address);
+  const std::optional<uint8_t> value = Load8(address);
+  if (!value.has_value()) [[unlikely]] {
+    return;
+  }
+
+  load_delay_slots_ =
+      LoadDelaySlots(instruction.GetT(), static_cast<uint32_t>(value.value()));
+}
+
+void cpu::CPU::OpLHU(const Instruction& instruction) {
+  if (cop0_.IsCacheIsolated()) {
+    LOG_INFO_CPU("Ignoring load while cache is isolated");
+    return;
+  }
+
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t immediate = instruction.GetImmediate16SignExtend();
+
+  const uint32_t address = register_s + immediate;
+  const std::optional<uint16_t> value = Load16(address);
+  if (!value.has_value()) [[unlikely]] {
+    return;
+  }
 
   load_delay_slots_ =
-      LoadDelaySlots(instruction.GetT(), static_cast<uint32_t>(value));
+      LoadDelaySlots(instruction.GetT(), static_cast<uint32_t>(value.value()));
+}
+
+void cpu::CPU::OpLWR(const Instruction& instruction) {
+  if (cop0_.IsCacheIsolated()) {
+    LOG_INFO_CPU("Ignoring load while cache is isolated");
+    return;
+  }
+
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t immediate = instruction.GetImmediate16SignExtend();
+
+  const uint32_t address = register_s + immediate;
+  const std::optional<uint32_t> word = Load32(address & ~0x3U);
+  if (!word.has_value()) [[unlikely]] {
+    return;
+  }
+
+  const uint32_t current = gsl::at(write_registers_, instruction.GetT());
+
+  load_delay_slots_ = LoadDelaySlots(
+      instruction.GetT(), MergeRight(current, word.value(), address));
 }
 
 void cpu::CPU::OpSB(const Instruction& instruction) {
@@ -681,6 +1986,21 @@ void cpu::CPU::OpSH(const Instruction& instruction) {
   Store16(address, static_cast<uint16_t>(register_t & 0xFFFF));
 }
 
+void cpu::CPU::OpSWL(const Instruction& instruction) {
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t register_t = GetRegister(instruction.GetT());
+  const uint32_t immediate = instruction.GetImmediate16SignExtend();
+
+  const uint32_t address = register_s + immediate;
+  const uint32_t aligned = address & ~0x3U;
+  const std::optional<uint32_t> word = Load32(aligned);
+  if (!word.has_value()) [[unlikely]] {
+    return;
+  }
+
+  Store32(aligned, StoreMergeLeft(word.value(), register_t, address));
+}
+
 void cpu::CPU::OpSW(const Instruction& instruction) {
   const uint32_t register_s = GetRegister(instruction.GetS());
   const uint32_t register_t = GetRegister(instruction.GetT());
@@ -690,30 +2010,42 @@ void cpu::CPU::OpSW(const Instruction& instruction) {
   Store32(address, register_t);
 }
 
-cpu::Instruction::PrimaryOpcode cpu::Instruction::GetPrimaryOpcode() const {
-  return static_cast<PrimaryOpcode>(data_ >> 26U & 0x3FU);
-}
+void cpu::CPU::OpSWR(const Instruction& instruction) {
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t register_t = GetRegister(instruction.GetT());
+  const uint32_t immediate = instruction.GetImmediate16SignExtend();
 
-cpu::Instruction::SecondaryOpcode cpu::Instruction::GetSecondaryOpcode() const {
-  return static_cast<SecondaryOpcode>(data_ & 0x3FU);
-}
-cpu::Instruction::CoprocessorOpcode cpu::Instruction::GetCoprocessorOpcode(
-    const bool flag) const {
-  if (flag) {
-    return static_cast<CoprocessorOpcode>(data_ & 0x3FU);
+  const uint32_t address = register_s + immediate;
+  const uint32_t aligned = address & ~0x3U;
+  const std::optional<uint32_t> word = Load32(aligned);
+  if (!word.has_value()) [[unlikely]] {
+    return;
   }
 
-  return static_cast<CoprocessorOpcode>(data_ >> 21U & 0x1FU);
+  Store32(aligned, StoreMergeRight(word.value(), register_t, address));
 }
 
-cpu::Instruction::ConditionOpcode cpu::Instruction::GetConditionOpcode() const {
-  return static_cast<ConditionOpcode>(data_ >> 16U & 0x1FU);
+void cpu::CPU::OpLWC2(const Instruction& instruction) {
+  if (cop0_.IsCacheIsolated()) {
+    LOG_INFO_CPU("Ignoring load while cache is isolated");
+    return;
+  }
+
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t immediate = instruction.GetImmediate16SignExtend();
+
+  const uint32_t address = register_s + immediate;
+  if (const std::optional<uint32_t> value = Load32(address)) {
+    gte_.SetData(instruction.GetT(), value.value());
+  }
 }
 
-uint8_t cpu::Instruction::GetCoprocessor() const { return data_ >> 26U & 0x3U; }
+void cpu::CPU::OpSWC2(const Instruction& instruction) {
+  const uint32_t register_s = GetRegister(instruction.GetS());
+  const uint32_t immediate = instruction.GetImmediate16SignExtend();
 
-bool cpu::Instruction::GetCoprocessorFlag() const {
-  return (data_ >> 25U & 0x1U) == 1;
+  const uint32_t address = register_s + immediate;
+  Store32(address, gte_.GetData(instruction.GetT()));
 }
 
 uint8_t cpu::Instruction::GetS() const { return data_ >> 21U & 0x1FU; }
@@ -738,172 +2070,7 @@ uint32_t cpu::Instruction::GetImmediate26() const { return data_ & 0x3FFFFFFU; }
 
 std::ostream& cpu::operator<<(std::ostream& outs,
                               const Instruction& instruction) {
-  switch (instruction.GetPrimaryOpcode()) {
-    case Instruction::PrimaryOpcode::kSPECIAL:
-      switch (instruction.GetSecondaryOpcode()) {
-        case Instruction::SecondaryOpcode::kSLL:
-          return outs << std::format("sll R{}, R{}, {:04X}", instruction.GetD(),
-                                     instruction.GetT(),
-                                     instruction.GetImmediate16());
-        case Instruction::SecondaryOpcode::kSRL:
-          return outs << std::format("srl R{}, R{}, {:04X}", instruction.GetD(),
-                                     instruction.GetT(),
-                                     instruction.GetImmediate16());
-        case Instruction::SecondaryOpcode::kSRA:
-          return outs << std::format("sra R{}, R{}, {:04X}", instruction.GetD(),
-                                     instruction.GetT(),
-                                     instruction.GetImmediate16());
-        case Instruction::SecondaryOpcode::kJR:
-          return outs << std::format("jr R{}", instruction.GetS());
-        case Instruction::SecondaryOpcode::kJALR:
-          return outs << std::format("jalr R{}, R{}", instruction.GetD(),
-                                     instruction.GetS());
-        case Instruction::SecondaryOpcode::kSYSCALL:
-          return outs << std::format("syscall {:08X}",
-                                     instruction.GetImmediate20());
-        case Instruction::SecondaryOpcode::kMFHI:
-          return outs << std::format("mfhi R{}", instruction.GetD());
-        case Instruction::SecondaryOpcode::kMFLO:
-          return outs << std::format("mflo R{}", instruction.GetD());
-        case Instruction::SecondaryOpcode::kADD:
-          return outs << std::format("add R{}, R{}, R{}", instruction.GetD(),
-                                     instruction.GetS(), instruction.GetT());
-        case Instruction::SecondaryOpcode::kDIV:
-          return outs << std::format("div R{}, R{}", instruction.GetS(),
-                                     instruction.GetT());
-        case Instruction::SecondaryOpcode::kDIVU:
-          return outs << std::format("divu R{}, R{}", instruction.GetS(),
-                                     instruction.GetT());
-        case Instruction::SecondaryOpcode::kADDU:
-          return outs << std::format("addu R{}, R{}, R{}", instruction.GetD(),
-                                     instruction.GetS(), instruction.GetT());
-        case Instruction::SecondaryOpcode::kSUBU:
-          return outs << std::format("subu R{}, R{}, R{}", instruction.GetD(),
-                                     instruction.GetS(), instruction.GetT());
-        case Instruction::SecondaryOpcode::kAND:
-          return outs << std::format("and R{}, R{}, R{}", instruction.GetD(),
-                                     instruction.GetS(), instruction.GetT());
-        case Instruction::SecondaryOpcode::kOR:
-          return outs << std::format("or R{}, R{}, R{}", instruction.GetD(),
-                                     instruction.GetS(), instruction.GetT());
-        case Instruction::SecondaryOpcode::kSLT:
-          return outs << std::format("slt R{}, R{}, R{}", instruction.GetD(),
-                                     instruction.GetS(), instruction.GetT());
-        case Instruction::SecondaryOpcode::kSLTU:
-          return outs << std::format("sltu R{}, R{}, R{}", instruction.GetD(),
-                                     instruction.GetS(), instruction.GetT());
-        default:
-          return outs << std::format("0x{:08X}", instruction.GetRawData());
-      }
-    case Instruction::PrimaryOpcode::kBcondZ:
-      switch (instruction.GetConditionOpcode()) {
-        case Instruction::ConditionOpcode::kBLTZ:
-          return outs << std::format("bltz R{}, {}", instruction.GetS(),
-                                     instruction.GetImmediate16SignExtend());
-        case Instruction::ConditionOpcode::kBGEZ:
-          return outs << std::format("bgez R{}, {}", instruction.GetS(),
-                                     instruction.GetImmediate16SignExtend());
-        default:
-          return outs << std::format("0x{:08X}", instruction.GetRawData());
-      }
-    case Instruction::PrimaryOpcode::kJ:
-      return outs << std::format("j {:07X}", instruction.GetImmediate26());
-    case Instruction::PrimaryOpcode::kJAL:
-      return outs << std::format("jal {:07X}", instruction.GetImmediate26());
-    case Instruction::PrimaryOpcode::kBEQ:
-      return outs << std::format(
-                 "beq R{}, R{}, {}", instruction.GetS(), instruction.GetT(),
-                 static_cast<int32_t>(instruction.GetImmediate16SignExtend()));
-    case Instruction::PrimaryOpcode::kBNE:
-      return outs << std::format(
-                 "bne R{}, R{}, {}", instruction.GetS(), instruction.GetT(),
-                 static_cast<int32_t>(instruction.GetImmediate16SignExtend()));
-    case Instruction::PrimaryOpcode::kBLEZ:
-      return outs << std::format(
-                 "blez R{}, {}", instruction.GetS(),
-                 static_cast<int32_t>(instruction.GetImmediate16SignExtend()));
-    case Instruction::PrimaryOpcode::kBGTZ:
-      return outs << std::format(
-                 "bgtz R{}, {}", instruction.GetS(),
-                 static_cast<int32_t>(instruction.GetImmediate16SignExtend()));
-    case Instruction::PrimaryOpcode::kADDI:
-      return outs << std::format(
-                 "addi R{}, R{}, {}", instruction.GetT(), instruction.GetS(),
-                 static_cast<int32_t>(instruction.GetImmediate16SignExtend()));
-    case Instruction::PrimaryOpcode::kADDIU:
-      return outs << std::format("addiu R{}, R{}, {:04X}", instruction.GetT(),
-                                 instruction.GetS(),
-                                 instruction.GetImmediate16());
-    case Instruction::PrimaryOpcode::kSLTI:
-      return outs << std::format(
-                 "slti R{}, R{}, {}", instruction.GetT(), instruction.GetS(),
-                 static_cast<int32_t>(instruction.GetImmediate16SignExtend()));
-    case Instruction::PrimaryOpcode::kSLTIU:
-      return outs << std::format("sltiu R{}, R{}, {}", instruction.GetT(),
-                                 instruction.GetS(),
-                                 instruction.GetImmediate16SignExtend());
-    case Instruction::PrimaryOpcode::kANDI:
-      return outs << std::format("andi R{}, R{}, {:04X}", instruction.GetT(),
-                                 instruction.GetS(),
-                                 instruction.GetImmediate16());
-    case Instruction::PrimaryOpcode::kORI:
-      return outs << std::format("ori R{}, R{}, {:04X}", instruction.GetT(),
-                                 instruction.GetS(),
-                                 instruction.GetImmediate16());
-    case Instruction::PrimaryOpcode::kLUI:
-      return outs << std::format("lui R{}, {:04X}", instruction.GetT(),
-                                 instruction.GetImmediate16());
-    case Instruction::PrimaryOpcode::kCOP0:
-      switch (const bool flag = instruction.GetCoprocessorFlag();
-              instruction.GetCoprocessorOpcode(flag)) {
-        case Instruction::CoprocessorOpcode::kMFC:
-          return outs << std::format(
-                     "mfc{} R{}, cop{}dat{}", instruction.GetCoprocessor(),
-                     instruction.GetT(), instruction.GetCoprocessor(),
-                     instruction.GetD());
-        case Instruction::CoprocessorOpcode::kMTC:
-          return outs << std::format(
-                     "mtc{} R{}, cop{}dat{}", instruction.GetCoprocessor(),
-                     instruction.GetT(), instruction.GetCoprocessor(),
-                     instruction.GetD());
-        default:
-          return outs << std::format("0x{:08X}", instruction.GetRawData());
-      }
-    case Instruction::PrimaryOpcode::kLB:
-      return outs << std::format("lb R{}, {:04X}(R{})", instruction.GetT(),
-                                 instruction.GetImmediate16SignExtend(),
-                                 instruction.GetS());
-    case Instruction::PrimaryOpcode::kLW:
-      return outs << std::format("lw R{}, {:04X}(R{})", instruction.GetT(),
-                                 instruction.GetImmediate16SignExtend(),
-                                 instruction.GetS());
-    case Instruction::PrimaryOpcode::kLBU:
-      return outs << std::format("lbu R{}, {:04X}(R{})", instruction.GetT(),
-                                 instruction.GetImmediate16SignExtend(),
-                                 instruction.GetS());
-    case Instruction::PrimaryOpcode::kSB:
-      return outs << std::format("sb R{}, {:04X}(R{})", instruction.GetT(),
-                                 instruction.GetImmediate16SignExtend(),
-                                 instruction.GetS());
-    case Instruction::PrimaryOpcode::kSH:
-      return outs << std::format("sh R{}, {:04X}(R{})", instruction.GetT(),
-                                 instruction.GetImmediate16SignExtend(),
-                                 instruction.GetS());
-    case Instruction::PrimaryOpcode::kSW:
-      return outs << std::format("sw R{}, {:04X}(R{})", instruction.GetT(),
-                                 instruction.GetImmediate16SignExtend(),
-                                 instruction.GetS());
-    default:
-      return outs << std::format("0x{:08X}", instruction.GetRawData());
-  }
-}
-
-template <typename T>
-bool cpu::CheckedSum(T value_a, T value_b, T* result) {
-  *result = value_a + value_b;
-
-  return (value_b > 0 && value_a > std::numeric_limits<T>::max() - value_b) ||
-         (value_b < 0 && value_a < std::numeric_limits<T>::min() - value_b);
+  return outs << isa::Disassemble(instruction.GetRawData());
 }
 
 std::string cpu::Instruction::ToString() const {
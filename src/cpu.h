@@ -1,17 +1,46 @@
 #ifndef POLYSTATION_CPU_H_
 #define POLYSTATION_CPU_H_
 #include <array>
+#include <memory>
+#include <optional>
 
 #include "bios.h"
+#include "block_cache.h"
+#include "breakpoint.h"
 #include "bus.h"
+#include "exe.h"
+#include "fusion.h"
+#include "gte.h"
+#include "histogram.h"
+#include "hle.h"
+#include "icache.h"
+#include "idle_loop.h"
+#include "isa.h"
+#include "profiler.h"
+#include "savestate.h"
+#include "trace.h"
+#include "watchpoint.h"
+#include "worker_pool.h"
 
 namespace cpu {
 constexpr uint32_t kNumberOfRegisters = 32;
 constexpr uint32_t kInstructionLength = 4;
 constexpr uint32_t kReturnAddress = 31;
+constexpr uint32_t kCpuClock = 33868800;
+constexpr uint32_t kFrameRate = 60;
+constexpr uint64_t kCyclesPerFrame = kCpuClock / kFrameRate;
 
 enum class Mode : bool { kKernel = false, kUser = true };
 
+// kAccurate models instruction fetch timing through the I-cache, kFast
+// counts one cycle per instruction and compiles the model out.
+enum class Accuracy : bool { kFast = false, kAccurate = true };
+
+// kInterpreter fetches and decodes every instruction it runs. kFast runs of
+// kCachedInterpreter translate basic blocks to ir::Block once and run their
+// optimized ops instead.
+enum class Backend : uint8_t { kInterpreter, kCachedInterpreter };
+
 class Instruction {
  public:
   Instruction() : data_(0) {}
@@ -19,62 +48,7 @@ class Instruction {
 
   [[nodiscard]] std::string ToString() const;
 
-  enum class PrimaryOpcode : uint8_t {
-    kSPECIAL = 0x00,
-    kBcondZ = 0x01,
-    kJ = 0x02,
-    kJAL = 0x03,
-    kBEQ = 0x04,
-    kBNE = 0x05,
-    kBLEZ = 0x06,
-    kBGTZ = 0x07,
-    kADDI = 0x08,
-    kADDIU = 0x09,
-    kSLTI = 0x0A,
-    kSLTIU = 0x0B,
-    kANDI = 0x0C,
-    kORI = 0x0D,
-    kLUI = 0x0F,
-    kCOP0 = 0x10,
-    kLB = 0x20,
-    kLW = 0x23,
-    kLBU = 0x24,
-    kSB = 0x28,
-    kSH = 0x29,
-    kSW = 0x2B
-  };
-
-  enum class SecondaryOpcode : uint8_t {
-    kSLL = 0x00,
-    kSRL = 0x02,
-    kSRA = 0x03,
-    kJR = 0x08,
-    kJALR = 0x09,
-    kSYSCALL = 0x0C,
-    kMFHI = 0x10,
-    kMFLO = 0x12,
-    kDIV = 0x1A,
-    kDIVU = 0x1B,
-    kADD = 0x20,
-    kADDU = 0x21,
-    kSUBU = 0x23,
-    kAND = 0x24,
-    kOR = 0x25,
-    kSLT = 0x2A,
-    kSLTU = 0x2B
-  };
-
-  enum class CoprocessorOpcode : uint8_t { kMFC = 0x00, kMTC = 0x04 };
-
-  enum class ConditionOpcode : uint8_t { kBLTZ = 0x00, kBGEZ = 0x01 };
-
   [[nodiscard]] uint32_t GetRawData() const { return data_; }
-  [[nodiscard]] PrimaryOpcode GetPrimaryOpcode() const;
-  [[nodiscard]] SecondaryOpcode GetSecondaryOpcode() const;
-  [[nodiscard]] CoprocessorOpcode GetCoprocessorOpcode(bool flag) const;
-  [[nodiscard]] ConditionOpcode GetConditionOpcode() const;
-  [[nodiscard]] uint8_t GetCoprocessor() const;
-  [[nodiscard]] bool GetCoprocessorFlag() const;
   [[nodiscard]] uint8_t GetS() const;
   [[nodiscard]] uint8_t GetT() const;
   [[nodiscard]] uint8_t GetD() const;
@@ -93,6 +67,7 @@ struct COP0 {
   uint32_t status_register_ = 0;
   uint32_t cause_register_ = 0;
   uint32_t epc_register_ = 0;
+  uint32_t bad_vaddr_register_ = 0;
 
  public:
   enum Registers : uint8_t {
@@ -100,6 +75,7 @@ struct COP0 {
     kBDA = 0x5,
     kTAR = 0x6,
     kDCIC = 0x7,
+    kBadVaddr = 0x8,
     kBDAM = 0x9,
     kBPCM = 0xB,
     kStatusRegister = 0xC,
@@ -120,6 +96,9 @@ struct COP0 {
 
   [[nodiscard]] uint32_t GetEpcRegister() const;
   void SetEpcRegister(uint32_t value);
+
+  [[nodiscard]] uint32_t GetBadVaddrRegister() const;
+  void SetBadVaddrRegister(uint32_t value);
 } __attribute__((aligned(8)));
 
 struct LoadDelaySlots {
@@ -128,15 +107,33 @@ struct LoadDelaySlots {
 } __attribute__((aligned(8)));
 
 enum class ExceptionType : uint8_t {
+  kInterrupt = 0x00,
+  kLoadAddressError = 0x04,
+  kStoreAddressError = 0x05,
+  kBusErrorInstruction = 0x06,
+  kBusErrorData = 0x07,
   kSysCall = 0x08,
+  kBreak = 0x09,
+  kReservedInstruction = 0x0A,
+  kCoprocessorUnusable = 0x0B,
+  kOverflow = 0x0C,
 };
 
 class CPU {
  public:
   explicit CPU(const std::string& path) : bus_(path) { read_registers_[0] = 0; }
+  explicit CPU(std::shared_ptr<const bios::Image> bios)
+      : bus_(std::move(bios)) {
+    read_registers_[0] = 0;
+  }
 
   void Reset();
   void Cycle();
+  void RunFrame();
+  void RunFor(uint64_t cycles);
+  void SetAccuracy(Accuracy accuracy);
+  [[nodiscard]] Accuracy GetAccuracy() const;
+  [[nodiscard]] uint64_t GetCycleCount() const;
   [[nodiscard]] uint32_t GetRegister(uint32_t index) const;
   void SetRegister(uint32_t index, uint32_t value);
   [[nodiscard]] unsigned long long GetStepCount() const;
@@ -146,49 +143,229 @@ class CPU {
   [[nodiscard]] uint32_t GetHI() const;
   [[nodiscard]] uint32_t GetLO() const;
 
-  [[nodiscard]] uint32_t Load32(uint32_t address) const;
+  [[nodiscard]] uint32_t Peek32(uint32_t address) const;
+
+  // Runs `executable` instead of the BIOS shell, skipping the intro while
+  // keeping the kernel set up. Armed again by every Reset.
+  void Sideload(std::shared_ptr<const exe::Executable> executable);
+
+  void SetHleMode(hle::Mode mode);
+  [[nodiscard]] hle::Mode GetHleMode() const;
+  [[nodiscard]] const hle::Stats& GetHleStats() const;
+
+  // Fast-forwards through polling loops that cannot exit before the end of
+  // the current RunFor/RunFrame slice.
+  void SetIdleSkipping(bool enabled);
+  [[nodiscard]] bool IsIdleSkipping() const;
+  [[nodiscard]] const idle_loop::Stats& GetIdleLoopStats() const;
+
+  // Host-side counters, see metrics::Collect.
+  [[nodiscard]] const bus::Stats& GetBusStats() const;
+  [[nodiscard]] const icache::Stats& GetInstructionCacheStats() const;
+
+  // Threads for decoding large MDEC batches, see mdec::Mdec::SetWorkerPool.
+  void SetMdecPool(std::shared_ptr<worker_pool::WorkerPool> pool);
+
+  // Runs common instruction pairs and nop runs as one step in kFast runs
+  // without breakpoints, watchpoints, tracing or profiling. On by default,
+  // the results are the same either way.
+  void SetFusion(bool enabled);
+  [[nodiscard]] bool IsFusing() const;
+
+  // Blocks only run in kFast runs without breakpoints, watchpoints, tracing
+  // or profiling, everything else still goes through the interpreter. The
+  // results are the same with either backend.
+  void SetBackend(Backend backend);
+  [[nodiscard]] Backend GetBackend() const;
+  [[nodiscard]] block_cache::Cache& GetBlockCache();
+  [[nodiscard]] const block_cache::Cache& GetBlockCache() const;
+
+  // RunFor and RunFrame return early when they reach a breakpoint, the
+  // next run resumes past it. Cycle steps without checking.
+  [[nodiscard]] breakpoint::Set& GetBreakpoints();
+  [[nodiscard]] const breakpoint::Set& GetBreakpoints() const;
+  [[nodiscard]] bool IsStoppedAtBreakpoint() const;
+
+  // Hits are logged and recorded, execution carries on.
+  [[nodiscard]] watchpoint::Set& GetWatchpoints();
+  [[nodiscard]] const watchpoint::Set& GetWatchpoints() const;
+
+  // Records every executed instruction to `path` until StopTrace.
+  void StartTrace(const std::filesystem::path& path);
+  void StopTrace();
+  [[nodiscard]] bool IsTracing() const;
+
+  // Samples the PC and the guest call stack until StopProfiling, the
+  // interval and symbols are set on the profiler.
+  void StartProfiling();
+  void StopProfiling();
+  [[nodiscard]] profiler::Profiler& GetProfiler();
+  [[nodiscard]] const profiler::Profiler& GetProfiler() const;
+
+  // Only counts when built with histogram::kEnabled.
+  [[nodiscard]] histogram::OpcodeHistogram& GetOpcodeHistogram();
+  [[nodiscard]] const histogram::OpcodeHistogram& GetOpcodeHistogram() const;
+
+  // Upper bound of SaveState's output, so callers can allocate once.
+  [[nodiscard]] size_t GetStateSize(
+      savestate::Compression compression,
+      savestate::Content content = savestate::Content::kFull) const;
+  // Returns the number of bytes written into `buffer`.
+  size_t SaveState(
+      std::span<std::byte> buffer, savestate::Compression compression,
+      savestate::Content content = savestate::Content::kFull) const;
+  // Throws on a truncated or corrupt state, leaving the machine unchanged.
+  void LoadState(std::span<const std::byte> buffer);
+
+  [[nodiscard]] ram::Ram& GetRam();
+  [[nodiscard]] const ram::Ram& GetRam() const;
 
  private:
   uint32_t next_program_counter_ = bios::kBiosBase + kInstructionLength;
   uint32_t program_counter_ = bios::kBiosBase;
-  uint32_t current_program_counter_;
+  uint32_t current_program_counter_ = bios::kBiosBase;
+  // The word at current_program_counter_ and the address of its last load
+  // or store, for watchpoint reports.
+  uint32_t current_instruction_ = 0;
+  uint32_t data_address_ = 0;
   std::array<uint32_t, kNumberOfRegisters> read_registers_{};
   std::array<uint32_t, kNumberOfRegisters> write_registers_ = read_registers_;
   LoadDelaySlots load_delay_slots_{};
   bus::Bus bus_;
   COP0 cop0_;
+  gte::Gte gte_;
   uint32_t hi_ = 0;
   uint32_t lo_ = 0;
   unsigned long long step_count_ = 0;
+  uint64_t cycle_count_ = 0;
+  Accuracy accuracy_ = Accuracy::kFast;
+  icache::InstructionCache icache_;
+  std::shared_ptr<const exe::Executable> executable_;
+  bool sideload_pending_ = false;
+  hle::Hle hle_;
+  bool verifying_bios_call_ = false;
+  idle_loop::Detector idle_loop_;
+  breakpoint::Set breakpoints_;
+  bool stopped_at_breakpoint_ = false;
+  watchpoint::Set watchpoints_{bus_.GetRam()};
+  std::unique_ptr<trace::Writer> trace_;
+  profiler::Profiler profiler_;
+  histogram::OpcodeHistogram histogram_;
+  // Tracing or profiling, the only per-instruction check either costs.
+  bool instrumented_ = false;
+  // Set by Exception, consumed by the trace and the profiler.
+  bool exception_raised_ = false;
+  // Set by every branch and jump, the next instruction runs in its delay
+  // slot.
+  bool branch_ = false;
+  bool delay_slot_ = false;
+  bool fusion_ = true;
+  // Set for a run when idle loop skipping or HLE may take over at any
+  // instruction, CanFuseAt then has to ask them.
+  bool fusion_guarded_ = false;
+  Backend backend_ = Backend::kInterpreter;
+  block_cache::Cache blocks_;
+  // Results of the running block's ops, indexed by ir::Value.
+  std::array<uint32_t, ir::kMaxOps> block_values_{};
 
-  [[nodiscard]] uint8_t Load8(uint32_t address) const;
+  void Save(savestate::Writer& writer) const;
+
+  // Up to `fusion_budget` instructions may be fused into this step.
+  template <Accuracy kAccuracy>
+  void Step(uint64_t fusion_budget = 0);
+  template <Accuracy kAccuracy>
+  void Run(uint64_t target_cycle);
+  template <Accuracy kAccuracy>
+  [[nodiscard]] uint32_t FetchInstruction(uint32_t address);
+  void LoadExecutable();
+  template <Accuracy kAccuracy>
+  [[nodiscard]] bool HandleBiosCall(uint32_t table);
+  template <Accuracy kAccuracy>
+  void VerifyBiosCall(const hle::Call& call);
+  void ReturnFromBiosCall(const hle::Result& result);
+
+  using Handler = void (CPU::*)(const Instruction& instruction);
+  // Indexed by isa::GetDecodeIndex, generated from isa::kSpecs.
+  static const std::array<Handler, isa::kDecodeTableSize> kDispatchTable;
+
+  // Returns the instruction's issue cycles.
+  [[nodiscard]] uint8_t Execute(const Instruction& instruction);
+
+  // Runs the head `first` and what follows it as one step, returns false
+  // with the machine untouched when the follower has to be stepped alone.
+  [[nodiscard]] bool ExecuteFused(const Instruction& first,
+                                  uint64_t fusion_budget);
+  // Whether Step would let the instruction at `address` run unchecked.
+  [[nodiscard]] bool CanFuseAt(uint32_t address) const;
+  // Moves on to the next instruction of a fused step.
+  void AdvanceFused();
+  // Counts an instruction a fused step ran without Execute.
+  void Retire(const Instruction& instruction);
+  void ExecutePair(const Instruction& first, const Instruction& second);
+  void FuseLoadConstant(const Instruction& first, const Instruction& second);
+  void FuseUpperMemory(const Instruction& first, const Instruction& second);
+  void FuseCompareBranch(const Instruction& first, const Instruction& second);
+  void FuseNopRun(const Instruction& first, uint64_t fusion_budget);
+
+  // Runs the block at the PC, returns false with the machine untouched
+  // when it has to be stepped instead.
+  [[nodiscard]] bool ExecuteBlock(uint64_t target_cycle);
+  void RunBlock(const ir::Block& block);
+  // Whether a store to `address` that was not known to hit RAM or the
+  // scratchpad may have changed code or devices `block` depends on.
+  [[nodiscard]] static bool EndsBlock(const ir::Block& block,
+                                      uint32_t address);
+
+  // Loads and stores raise address and bus errors themselves, a load
+  // returns nothing when it faulted.
+  [[nodiscard]] std::optional<uint32_t> Load32(uint32_t address);
+  [[nodiscard]] std::optional<uint16_t> Load16(uint32_t address);
+  [[nodiscard]] std::optional<uint8_t> Load8(uint32_t address);
 
   void Store32(uint32_t address, uint32_t value);
   void Store16(uint32_t address, uint16_t value);
   void Store8(uint32_t address, uint8_t value);
 
   void Branch(uint32_t offset);
+  void CheckIdleLoop();
+  void CollectWatchpoints();
+  void UpdateInstrumentation();
+  void Instrument(const Instruction& instruction);
+  void TraceInstruction(const Instruction& instruction, bool exception);
   void Exception(ExceptionType cause);
+  void AddressError(ExceptionType cause, uint32_t address);
 
-  void OpSPECIAL(const Instruction& instruction);
+  void OpIllegal(const Instruction& instruction);
   void OpSLL(const Instruction& instruction);
   void OpSRL(const Instruction& instruction);
   void OpSRA(const Instruction& instruction);
+  void OpSLLV(const Instruction& instruction);
+  void OpSRLV(const Instruction& instruction);
+  void OpSRAV(const Instruction& instruction);
   void OpJR(const Instruction& instruction);
   void OpJALR(const Instruction& instruction);
   void OpSYSCALL(const Instruction& instruction);
+  void OpBREAK(const Instruction& instruction);
   void OpMFHI(const Instruction& instruction);
+  void OpMTHI(const Instruction& instruction);
   void OpMFLO(const Instruction& instruction);
+  void OpMTLO(const Instruction& instruction);
+  void OpMULT(const Instruction& instruction);
+  void OpMULTU(const Instruction& instruction);
   void OpDIV(const Instruction& instruction);
   void OpDIVU(const Instruction& instruction);
   void OpADD(const Instruction& instruction);
   void OpADDU(const Instruction& instruction);
+  void OpSUB(const Instruction& instruction);
   void OpSUBU(const Instruction& instruction);
   void OpAND(const Instruction& instruction);
   void OpOR(const Instruction& instruction);
+  void OpXOR(const Instruction& instruction);
+  void OpNOR(const Instruction& instruction);
   void OpSLT(const Instruction& instruction);
   void OpSLTU(const Instruction& instruction);
-  void OpBcondZ(const Instruction& instruction);
+  void OpBLTZAL(const Instruction& instruction);
+  void OpBGEZAL(const Instruction& instruction);
   void OpBLTZ(const Instruction& instruction);
   void OpBGEZ(const Instruction& instruction);
   void OpJ(const Instruction& instruction);
@@ -203,22 +380,33 @@ class CPU {
   void OpSLTIU(const Instruction& instruction);
   void OpANDI(const Instruction& instruction);
   void OpORI(const Instruction& instruction);
+  void OpXORI(const Instruction& instruction);
   void OpLUI(const Instruction& instruction);
-  void OpCOP0(const Instruction& instruction);
   void OpMFC0(const Instruction& instruction);
   void OpMTC0(const Instruction& instruction);
+  void OpRFE(const Instruction& instruction);
+  void OpMFC2(const Instruction& instruction);
+  void OpCFC2(const Instruction& instruction);
+  void OpMTC2(const Instruction& instruction);
+  void OpCTC2(const Instruction& instruction);
+  void OpGTE(const Instruction& instruction);
   void OpLB(const Instruction& instruction);
+  void OpLH(const Instruction& instruction);
+  void OpLWL(const Instruction& instruction);
   void OpLW(const Instruction& instruction);
   void OpLBU(const Instruction& instruction);
+  void OpLHU(const Instruction& instruction);
+  void OpLWR(const Instruction& instruction);
   void OpSB(const Instruction& instruction);
   void OpSH(const Instruction& instruction);
+  void OpSWL(const Instruction& instruction);
   void OpSW(const Instruction& instruction);
+  void OpSWR(const Instruction& instruction);
+  void OpLWC2(const Instruction& instruction);
+  void OpSWC2(const Instruction& instruction);
 };
 
 std::ostream& operator<<(std::ostream& outs, const Instruction& instruction);
-
-template <typename T>
-bool CheckedSum(T value_a, T value_b, T* result);
 }  // namespace cpu
 
 #endif  // POLYSTATION_CPU_H_
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "dma.h"
+
+#include <gsl/util>
+
+namespace {
+constexpr uint32_t kStateTag = savestate::MakeTag("DMA ");
+constexpr uint32_t kStateVersion = 1;
+
+constexpr uint32_t kControlRegister = 0x70;
+constexpr uint32_t kInterruptRegister = 0x74;
+
+constexpr uint32_t kChannelStart = 1U << 24U;
+constexpr uint32_t kChannelTrigger = 1U << 28U;
+
+uint32_t GetInterruptMasterFlag(const uint32_t interrupt) {
+  const bool force = (interrupt & (1U << 15U)) != 0U;
+  const bool master_enable = (interrupt & (1U << 23U)) != 0U;
+  const uint32_t enabled = (interrupt >> 16U) & 0x7FU;
+  const uint32_t flags = (interrupt >> 24U) & 0x7FU;
+
+  return force || (master_enable && (enabled & flags) != 0U) ? 1U << 31U : 0U;
+}
+}  // namespace
+
+dma::Direction dma::Channel::GetDirection() const {
+  return static_cast<Direction>(channel_control & 0x1U);
+}
+
+bool dma::Channel::IsStepBackward() const {
+  return (channel_control & 0x2U) != 0U;
+}
+
+dma::SyncMode dma::Channel::GetSyncMode() const {
+  return static_cast<SyncMode>((channel_control >> 9U) & 0x3U);
+}
+
+bool dma::Channel::IsActive() const {
+  if ((channel_control & kChannelStart) == 0U) {
+    return false;
+  }
+  if (GetSyncMode() == SyncMode::kManual) {
+    return (channel_control & kChannelTrigger) != 0U;
+  }
+  return true;
+}
+
+uint32_t dma::Channel::GetTransferSize() const {
+  const uint32_t block_size = block_control & 0xFFFFU;
+  const uint32_t block_count = block_control >> 16U;
+
+  switch (GetSyncMode()) {
+    case SyncMode::kManual:
+      return block_size == 0 ? 0x10000 : block_size;
+    case SyncMode::kRequest:
+      return block_size * block_count;
+    default:
+      return 0;
+  }
+}
+
+uint32_t dma::Dma::Load32(const uint32_t offset) const {
+  switch (offset) {
+    case kControlRegister:
+      return control_;
+    case kInterruptRegister:
+      return interrupt_;
+    default:
+      break;
+  }
+
+  const Channel& channel = gsl::at(channels_, (offset >> 4U) & 0x7U);
+  switch (offset & 0xFU) {
+    case 0x0:
+      return channel.base_address;
+    case 0x4:
+      return channel.block_control;
+    case 0x8:
+      return channel.channel_control;
+    default:
+      return 0;
+  }
+}
+
+std::optional<dma::Port> dma::Dma::Store32(const uint32_t offset,
+                                           const uint32_t value) {
+  switch (offset) {
+    case kControlRegister:
+      control_ = value;
+      return std::nullopt;
+    case kInterruptRegister: {
+      // Flags (bits 24-30) are acknowledged by writing 1
+      const uint32_t flags = (interrupt_ & ~value) & 0x7F000000U;
+      interrupt_ = (value & 0x00FF803FU) | flags;
+      interrupt_ |= GetInterruptMasterFlag(interrupt_);
+      return std::nullopt;
+    }
+    default:
+      break;
+  }
+
+  const uint32_t index = (offset >> 4U) & 0x7U;
+  if (index >= kChannelCount) {
+    return std::nullopt;
+  }
+
+  Channel& channel = gsl::at(channels_, index);
+  switch (offset & 0xFU) {
+    case 0x0:
+      channel.base_address = value & 0xFFFFFFU;
+      break;
+    case 0x4:
+      channel.block_control = value;
+      break;
+    case 0x8:
+      channel.channel_control = value;
+      break;
+    default:
+      break;
+  }
+
+  const auto port = static_cast<Port>(index);
+  if (channel.IsActive() && IsPortEnabled(port)) {
+    return port;
+  }
+  return std::nullopt;
+}
+
+const dma::Channel& dma::Dma::GetChannel(const Port port) const {
+  return gsl::at(channels_, static_cast<uint32_t>(port));
+}
+
+bool dma::Dma::IsStarted(const Port port) const {
+  return GetChannel(port).IsActive() && IsPortEnabled(port);
+}
+
+void dma::Dma::Complete(const Port port) {
+  const auto index = static_cast<uint32_t>(port);
+  gsl::at(channels_, index).channel_control &=
+      ~(kChannelStart | kChannelTrigger);
+
+  if ((interrupt_ & (1U << (16U + index))) != 0U) {
+    interrupt_ |= 1U << (24U + index);
+  }
+  interrupt_ = (interrupt_ & ~(1U << 31U)) | GetInterruptMasterFlag(interrupt_);
+}
+
+bool dma::Dma::IsPortEnabled(const Port port) const {
+  return (control_ & (0x8U << (static_cast<uint32_t>(port) * 4U))) != 0U;
+}
+
+void dma::Dma::Save(savestate::Writer& writer) const {
+  // Field by field, the padding after each channel is not state.
+  writer.BeginSection(kStateTag, kStateVersion);
+  for (const Channel& channel : channels_) {
+    writer.Write(channel.base_address);
+    writer.Write(channel.block_control);
+    writer.Write(channel.channel_control);
+  }
+  writer.Write(control_);
+  writer.Write(interrupt_);
+  writer.EndSection();
+}
+
+void dma::Dma::Load(savestate::Reader& reader) {
+  reader.BeginSection(kStateTag, kStateVersion);
+  for (Channel& channel : channels_) {
+    reader.Read(channel.base_address);
+    reader.Read(channel.block_control);
+    reader.Read(channel.channel_control);
+  }
+  reader.Read(control_);
+  reader.Read(interrupt_);
+  reader.EndSection();
+}
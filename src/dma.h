@@ -0,0 +1,63 @@
+#ifndef POLYSTATION_DMA_H
+#define POLYSTATION_DMA_H
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "savestate.h"
+
+namespace dma {
+constexpr uint32_t kChannelCount = 7;
+
+enum class Port : uint8_t {
+  kMdecIn = 0,
+  kMdecOut = 1,
+  kGpu = 2,
+  kCdRom = 3,
+  kSpu = 4,
+  kPio = 5,
+  kOrderingTable = 6
+};
+
+enum class Direction : uint8_t { kToRam = 0, kFromRam = 1 };
+
+enum class SyncMode : uint8_t { kManual = 0, kRequest = 1, kLinkedList = 2 };
+
+struct Channel {
+  uint32_t base_address = 0;
+  uint32_t block_control = 0;
+  uint32_t channel_control = 0;
+
+  [[nodiscard]] Direction GetDirection() const;
+  [[nodiscard]] bool IsStepBackward() const;
+  [[nodiscard]] SyncMode GetSyncMode() const;
+  [[nodiscard]] bool IsActive() const;
+  // Number of words to move, only meaningful for the manual and request
+  // sync modes.
+  [[nodiscard]] uint32_t GetTransferSize() const;
+} __attribute__((aligned(16)));
+
+class Dma {
+ public:
+  [[nodiscard]] uint32_t Load32(uint32_t offset) const;
+  // Returns the port whose transfer was started by this write, if any.
+  std::optional<Port> Store32(uint32_t offset, uint32_t value);
+
+  [[nodiscard]] const Channel& GetChannel(Port port) const;
+  // Whether the port's transfer has been started and not yet completed.
+  [[nodiscard]] bool IsStarted(Port port) const;
+  void Complete(Port port);
+
+  void Save(savestate::Writer& writer) const;
+  void Load(savestate::Reader& reader);
+
+ private:
+  std::array<Channel, kChannelCount> channels_{};
+  uint32_t control_ = 0x07654321;
+  uint32_t interrupt_ = 0;
+
+  [[nodiscard]] bool IsPortEnabled(Port port) const;
+};
+}  // namespace dma
+
+#endif  // POLYSTATION_DMA_H
@@ -0,0 +1,94 @@
+#include "exe.h"
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+#include "bus.h"
+#include "ram.h"
+
+namespace {
+constexpr std::string_view kMagic = "PS-X EXE";
+
+constexpr size_t kPcOffset = 0x10;
+constexpr size_t kGpOffset = 0x14;
+constexpr size_t kTextAddressOffset = 0x18;
+constexpr size_t kTextSizeOffset = 0x1C;
+constexpr size_t kBssAddressOffset = 0x28;
+constexpr size_t kBssSizeOffset = 0x2C;
+constexpr size_t kStackAddressOffset = 0x30;
+constexpr size_t kStackSizeOffset = 0x34;
+
+uint32_t ReadWord(const std::span<const std::byte> data, const size_t offset) {
+  uint32_t value = 0;
+  std::memcpy(&value, data.subspan(offset, sizeof(value)).data(),
+              sizeof(value));
+  return value;
+}
+
+// Whether `size` bytes at `address` land in RAM without wrapping around.
+bool FitsInRam(const uint32_t address, const uint32_t size) {
+  if (size == 0) {
+    return true;
+  }
+  const uint32_t offset = bus::MaskRegion(address);
+  return offset < ram::kRamSize && size <= ram::kRamSize - offset;
+}
+}  // namespace
+
+exe::Executable::Executable(const std::string& path) {
+  std::ifstream input(path, std::ios::binary | std::ios::ate);
+  if (!input) {
+    throw std::runtime_error(std::format("failed to open EXE {}", path));
+  }
+
+  const auto file_size = static_cast<size_t>(input.tellg());
+  if (file_size < kHeaderSize) {
+    throw std::runtime_error(
+        std::format("{} is too small for a PS-X EXE", path));
+  }
+
+  std::vector<std::byte> header(kHeaderSize);
+  input.seekg(0);
+  input.read(reinterpret_cast<char*>(header.data()), kHeaderSize);
+  if (std::memcmp(header.data(), kMagic.data(), kMagic.size()) != 0) {
+    throw std::runtime_error(std::format("{} is not a PS-X EXE", path));
+  }
+
+  header_ = Header{
+      .initial_pc = ReadWord(header, kPcOffset),
+      .initial_gp = ReadWord(header, kGpOffset),
+      .text_address = ReadWord(header, kTextAddressOffset),
+      .text_size = ReadWord(header, kTextSizeOffset),
+      .bss_address = ReadWord(header, kBssAddressOffset),
+      .bss_size = ReadWord(header, kBssSizeOffset),
+      .stack_address = ReadWord(header, kStackAddressOffset),
+      .stack_size = ReadWord(header, kStackSizeOffset)};
+
+  if (!FitsInRam(header_.text_address, header_.text_size)) {
+    throw std::runtime_error(
+        std::format("{} has {} bytes of text at 0x{:08X}, outside RAM", path,
+                    header_.text_size, header_.text_address));
+  }
+  if (!FitsInRam(header_.bss_address, header_.bss_size)) {
+    throw std::runtime_error(
+        std::format("{} has {} bytes of BSS at 0x{:08X}, outside RAM", path,
+                    header_.bss_size, header_.bss_address));
+  }
+  if (header_.text_size > file_size - kHeaderSize) {
+    throw std::runtime_error(std::format("{} is truncated", path));
+  }
+
+  text_.resize(header_.text_size);
+  input.read(reinterpret_cast<char*>(text_.data()),
+             static_cast<std::streamsize>(text_.size()));
+  if (!input) {
+    throw std::runtime_error(std::format("failed to read EXE {}", path));
+  }
+}
+
+const exe::Header& exe::Executable::GetHeader() const { return header_; }
+
+std::span<const std::byte> exe::Executable::GetText() const { return text_; }
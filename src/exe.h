@@ -0,0 +1,39 @@
+#ifndef POLYSTATION_EXE_H
+#define POLYSTATION_EXE_H
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace exe {
+// The BIOS jumps here once the kernel is up, to run the shell that plays
+// the intro and boots the disc.
+constexpr uint32_t kShellEntry = 0x80030000;
+constexpr uint32_t kHeaderSize = 0x800;
+
+struct Header {
+  uint32_t initial_pc = 0;
+  uint32_t initial_gp = 0;
+  uint32_t text_address = 0;
+  uint32_t text_size = 0;
+  uint32_t bss_address = 0;
+  uint32_t bss_size = 0;
+  uint32_t stack_address = 0;
+  uint32_t stack_size = 0;
+} __attribute__((aligned(32)));
+
+// A PS-X EXE file, ready to be copied into RAM.
+class Executable {
+ public:
+  explicit Executable(const std::string& path);
+
+  [[nodiscard]] const Header& GetHeader() const;
+  [[nodiscard]] std::span<const std::byte> GetText() const;
+
+ private:
+  Header header_;
+  std::vector<std::byte> text_;
+};
+}  // namespace exe
+
+#endif  // POLYSTATION_EXE_H
@@ -0,0 +1,127 @@
+#ifndef POLYSTATION_FUSION_H
+#define POLYSTATION_FUSION_H
+#include <algorithm>
+#include <cstdint>
+
+#include "isa.h"
+
+// Superinstructions: short sequences the interpreter recognises when it
+// decodes their first instruction and runs as one step.
+namespace fusion {
+// Nops retired by one fused step at most.
+constexpr uint64_t kMaxNopRun = 8;
+
+enum class Kind : uint8_t {
+  kPair,           // any other follower, both still run as one step
+  kLoadConstant,   // lui rt, hi; ori/addiu rt, rt, lo
+  kUpperMemory,    // lui rt, hi; load or store based on rt
+  kCompareBranch,  // slt/sltu/slti/sltiu rd; beq/bne rd, zero
+  kNopRun,         // nop; nop; ...
+};
+
+// Fused steps are bounded by a cycle budget counted in instructions, and
+// retire their instructions at one cycle each.
+static_assert(std::ranges::all_of(
+                  isa::kSpecs, [](const isa::Spec& spec) {
+                    return spec.cycles == 1;
+                  }),
+              "fusion assumes single cycle instructions");
+
+constexpr uint32_t GetS(const uint32_t word) { return (word >> 21U) & 0x1FU; }
+
+constexpr uint32_t GetT(const uint32_t word) { return (word >> 16U) & 0x1FU; }
+
+constexpr uint32_t GetD(const uint32_t word) { return (word >> 11U) & 0x1FU; }
+
+// The register a comparison writes, 0 when `word` is none.
+constexpr uint32_t GetComparisonDestination(const uint32_t word) {
+  switch (isa::Decode(word)) {
+    case isa::Operation::kSLT:
+    case isa::Operation::kSLTU:
+      return GetD(word);
+    case isa::Operation::kSLTI:
+    case isa::Operation::kSLTIU:
+      return GetT(word);
+    default:
+      return 0;
+  }
+}
+
+constexpr bool Matches(const uint32_t word, const isa::Operation operation) {
+  const isa::Spec& spec = isa::GetSpec(operation);
+  return (word & spec.mask) == spec.match;
+}
+
+// Filter run on every instruction before anything else is fetched, so it
+// tests the opcode fields instead of decoding.
+constexpr bool IsHead(const uint32_t word) {
+  if (word == 0) {
+    return true;
+  }
+  if (Matches(word, isa::Operation::kLUI) ||
+      Matches(word, isa::Operation::kSLTI) ||
+      Matches(word, isa::Operation::kSLTIU)) {
+    return GetT(word) != 0;
+  }
+  if (Matches(word, isa::Operation::kSLT) ||
+      Matches(word, isa::Operation::kSLTU)) {
+    return GetD(word) != 0;
+  }
+  return false;
+}
+
+constexpr bool IsMemoryAccess(const isa::Operation operation) {
+  switch (operation) {
+    case isa::Operation::kLB:
+    case isa::Operation::kLH:
+    case isa::Operation::kLWL:
+    case isa::Operation::kLW:
+    case isa::Operation::kLBU:
+    case isa::Operation::kLHU:
+    case isa::Operation::kLWR:
+    case isa::Operation::kSB:
+    case isa::Operation::kSH:
+    case isa::Operation::kSWL:
+    case isa::Operation::kSW:
+    case isa::Operation::kSWR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// What the head `first` followed by `second` fuses into. A head never
+// branches, touches memory or faults, so nothing a step checks can change
+// between the two and running both back to back is the same as two steps.
+constexpr Kind Match(const uint32_t first, const uint32_t second) {
+  if (first == 0) {
+    return second == 0 ? Kind::kNopRun : Kind::kPair;
+  }
+
+  const isa::Operation operation = isa::Decode(second);
+  if (isa::Decode(first) == isa::Operation::kLUI) {
+    const uint32_t target = GetT(first);
+    if (GetS(second) != target) {
+      return Kind::kPair;
+    }
+    if ((operation == isa::Operation::kORI ||
+         operation == isa::Operation::kADDIU) &&
+        GetT(second) == target) {
+      return Kind::kLoadConstant;
+    }
+    return IsMemoryAccess(operation) ? Kind::kUpperMemory : Kind::kPair;
+  }
+
+  const uint32_t destination = GetComparisonDestination(first);
+  if (operation != isa::Operation::kBEQ && operation != isa::Operation::kBNE) {
+    return Kind::kPair;
+  }
+  const uint32_t s = GetS(second);
+  const uint32_t t = GetT(second);
+  return (s == destination && t == 0) || (s == 0 && t == destination)
+             ? Kind::kCompareBranch
+             : Kind::kPair;
+}
+}  // namespace fusion
+
+#endif  // POLYSTATION_FUSION_H
@@ -0,0 +1,1166 @@
+#include "gte.h"
+
+#include <algorithm>
+#include <bit>
+#include <gsl/util>
+
+#include "logger.h"
+
+namespace {
+constexpr uint32_t kStateTag = savestate::MakeTag("GTE ");
+constexpr uint32_t kStateVersion = 1;
+
+constexpr int64_t kMacMax = (1LL << 43) - 1;
+constexpr int64_t kMacMin = -(1LL << 43);
+constexpr int64_t kMac0Max = (1LL << 31) - 1;
+constexpr int64_t kMac0Min = -(1LL << 31);
+
+constexpr std::array<uint32_t, 3> kFlagMacPositive{1U << 30U, 1U << 29U,
+                                                   1U << 28U};
+constexpr std::array<uint32_t, 3> kFlagMacNegative{1U << 27U, 1U << 26U,
+                                                   1U << 25U};
+constexpr std::array<uint32_t, 3> kFlagIrSaturated{1U << 24U, 1U << 23U,
+                                                   1U << 22U};
+constexpr std::array<uint32_t, 3> kFlagColorSaturated{1U << 21U, 1U << 20U,
+                                                      1U << 19U};
+constexpr uint32_t kFlagScreenZSaturated = 1U << 18U;
+constexpr uint32_t kFlagDivideOverflow = 1U << 17U;
+constexpr uint32_t kFlagMac0Positive = 1U << 16U;
+constexpr uint32_t kFlagMac0Negative = 1U << 15U;
+constexpr uint32_t kFlagScreenXSaturated = 1U << 14U;
+constexpr uint32_t kFlagScreenYSaturated = 1U << 13U;
+constexpr uint32_t kFlagIr0Saturated = 1U << 12U;
+constexpr uint32_t kFlagErrorMask = 0x7F87E000U;
+constexpr uint32_t kFlagError = 1U << 31U;
+
+// Reciprocal seed table used by the hardware's Newton-Raphson division.
+constexpr std::array<uint8_t, 0x101> kUnrTable = [] {
+  std::array<uint8_t, 0x101> table{};
+  for (int32_t i = 0; i < 0x101; i++) {
+    const int32_t value = (((0x40000 / (i + 0x100)) + 1) / 2) - 0x101;
+    table.at(static_cast<size_t>(i)) =
+        static_cast<uint8_t>(std::max(0, value));
+  }
+  return table;
+}();
+
+int64_t SignExtend44(const int64_t value) {
+  return static_cast<int64_t>(static_cast<uint64_t>(value) << 20U) >> 20;
+}
+
+gte::Lanes Broadcast(const int64_t value) {
+  gte::Lanes lanes{};
+  lanes.fill(value);
+  return lanes;
+}
+
+int16_t& MatrixElement(gte::Matrix& matrix, const uint32_t index) {
+  return gsl::at(gsl::at(matrix, index / 3), index % 3);
+}
+
+int16_t MatrixElement(const gte::Matrix& matrix, const uint32_t index) {
+  return gsl::at(gsl::at(matrix, index / 3), index % 3);
+}
+
+uint32_t GetMatrixRegister(const gte::Matrix& matrix, const uint32_t index) {
+  if (index == 4) {
+    return static_cast<uint32_t>(
+        static_cast<int32_t>(MatrixElement(matrix, 8)));
+  }
+
+  return static_cast<uint16_t>(MatrixElement(matrix, index * 2)) |
+         static_cast<uint32_t>(
+             static_cast<uint16_t>(MatrixElement(matrix, (index * 2) + 1)))
+             << 16U;
+}
+
+void SetMatrixRegister(gte::Matrix& matrix, const uint32_t index,
+                       const uint32_t value) {
+  MatrixElement(matrix, index * 2) = static_cast<int16_t>(value);
+  if (index != 4) {
+    MatrixElement(matrix, (index * 2) + 1) = static_cast<int16_t>(value >> 16U);
+  }
+}
+
+uint32_t PackColor(const gte::Color& color) {
+  return color[0] | color[1] << 8U | color[2] << 16U |
+         static_cast<uint32_t>(color[3]) << 24U;
+}
+
+gte::Color UnpackColor(const uint32_t value) {
+  return {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8U),
+          static_cast<uint8_t>(value >> 16U),
+          static_cast<uint8_t>(value >> 24U)};
+}
+
+uint32_t SignExtend16(const int16_t value) {
+  return static_cast<uint32_t>(static_cast<int32_t>(value));
+}
+}  // namespace
+
+std::string_view gte::GetOpcodeName(const uint32_t command) {
+  switch (static_cast<Opcode>(command & 0x3FU)) {
+    case Opcode::kRTPS:
+      return "rtps";
+    case Opcode::kNCLIP:
+      return "nclip";
+    case Opcode::kOP:
+      return "op";
+    case Opcode::kDPCS:
+      return "dpcs";
+    case Opcode::kINTPL:
+      return "intpl";
+    case Opcode::kMVMVA:
+      return "mvmva";
+    case Opcode::kNCDS:
+      return "ncds";
+    case Opcode::kCDP:
+      return "cdp";
+    case Opcode::kNCDT:
+      return "ncdt";
+    case Opcode::kNCCS:
+      return "nccs";
+    case Opcode::kCC:
+      return "cc";
+    case Opcode::kNCS:
+      return "ncs";
+    case Opcode::kNCT:
+      return "nct";
+    case Opcode::kSQR:
+      return "sqr";
+    case Opcode::kDCPL:
+      return "dcpl";
+    case Opcode::kDPCT:
+      return "dpct";
+    case Opcode::kAVSZ3:
+      return "avsz3";
+    case Opcode::kAVSZ4:
+      return "avsz4";
+    case Opcode::kRTPT:
+      return "rtpt";
+    case Opcode::kGPF:
+      return "gpf";
+    case Opcode::kGPL:
+      return "gpl";
+    case Opcode::kNCCT:
+      return "ncct";
+    default:
+      return "cop2";
+  }
+}
+
+void gte::Gte::Save(savestate::Writer& writer) const {
+  // Registers one by one, the per-command lanes and the padding between
+  // members would make states depend on the build.
+  writer.BeginSection(kStateTag, kStateVersion);
+  writer.Write(vertices_);
+  writer.Write(rgbc_);
+  writer.Write(otz_);
+  writer.Write(ir_);
+  writer.Write(sxy_fifo_);
+  writer.Write(sz_fifo_);
+  writer.Write(rgb_fifo_);
+  writer.Write(res1_);
+  writer.Write(mac_);
+  writer.Write(lzcs_);
+  writer.Write(lzcr_);
+  writer.Write(rotation_);
+  writer.Write(translation_);
+  writer.Write(light_);
+  writer.Write(background_color_);
+  writer.Write(light_color_);
+  writer.Write(far_color_);
+  writer.Write(screen_offset_x_);
+  writer.Write(screen_offset_y_);
+  writer.Write(projection_distance_);
+  writer.Write(depth_cue_a_);
+  writer.Write(depth_cue_b_);
+  writer.Write(z_scale_3_);
+  writer.Write(z_scale_4_);
+  writer.Write(flag_);
+  writer.EndSection();
+}
+
+void gte::Gte::Load(savestate::Reader& reader) {
+  reader.BeginSection(kStateTag, kStateVersion);
+  reader.Read(vertices_);
+  reader.Read(rgbc_);
+  reader.Read(otz_);
+  reader.Read(ir_);
+  reader.Read(sxy_fifo_);
+  reader.Read(sz_fifo_);
+  reader.Read(rgb_fifo_);
+  reader.Read(res1_);
+  reader.Read(mac_);
+  reader.Read(lzcs_);
+  reader.Read(lzcr_);
+  reader.Read(rotation_);
+  reader.Read(translation_);
+  reader.Read(light_);
+  reader.Read(background_color_);
+  reader.Read(light_color_);
+  reader.Read(far_color_);
+  reader.Read(screen_offset_x_);
+  reader.Read(screen_offset_y_);
+  reader.Read(projection_distance_);
+  reader.Read(depth_cue_a_);
+  reader.Read(depth_cue_b_);
+  reader.Read(z_scale_3_);
+  reader.Read(z_scale_4_);
+  reader.Read(flag_);
+  reader.EndSection();
+}
+
+uint32_t gte::Gte::GetData(const uint32_t index) const {
+  switch (index) {
+    case 0:
+    case 2:
+    case 4: {
+      const Vertex& vertex = gsl::at(vertices_, index / 2);
+      return static_cast<uint16_t>(vertex[0]) |
+             static_cast<uint32_t>(static_cast<uint16_t>(vertex[1])) << 16U;
+    }
+    case 1:
+    case 3:
+    case 5:
+      return SignExtend16(gsl::at(vertices_, index / 2)[2]);
+    case 6:
+      return PackColor(rgbc_);
+    case 7:
+      return otz_;
+    case 8:
+    case 9:
+    case 10:
+    case 11:
+      return SignExtend16(gsl::at(ir_, index - 8));
+    case 12:
+    case 13:
+    case 14:
+    case 15: {
+      const auto& xy = gsl::at(sxy_fifo_, std::min<uint32_t>(index - 12, 2));
+      return static_cast<uint16_t>(xy[0]) |
+             static_cast<uint32_t>(static_cast<uint16_t>(xy[1])) << 16U;
+    }
+    case 16:
+    case 17:
+    case 18:
+    case 19:
+      return gsl::at(sz_fifo_, index - 16);
+    case 20:
+    case 21:
+    case 22:
+      return PackColor(gsl::at(rgb_fifo_, index - 20));
+    case 23:
+      return res1_;
+    case 24:
+    case 25:
+    case 26:
+    case 27:
+      return static_cast<uint32_t>(gsl::at(mac_, index - 24));
+    case 28:
+    case 29: {
+      uint32_t color = 0;
+      for (uint32_t i = 0; i < 3; i++) {
+        const int32_t value = std::clamp(gsl::at(ir_, i + 1) >> 7, 0, 0x1F);
+        color |= static_cast<uint32_t>(value) << (i * 5);
+      }
+      return color;
+    }
+    case 30:
+      return lzcs_;
+    case 31:
+      return lzcr_;
+    default:
+      return 0;
+  }
+}
+
+void gte::Gte::SetData(const uint32_t index, const uint32_t value) {
+  switch (index) {
+    case 0:
+    case 2:
+    case 4: {
+      Vertex& vertex = gsl::at(vertices_, index / 2);
+      vertex[0] = static_cast<int16_t>(value);
+      vertex[1] = static_cast<int16_t>(value >> 16U);
+      break;
+    }
+    case 1:
+    case 3:
+    case 5:
+      gsl::at(vertices_, index / 2)[2] = static_cast<int16_t>(value);
+      break;
+    case 6:
+      rgbc_ = UnpackColor(value);
+      break;
+    case 7:
+      otz_ = static_cast<uint16_t>(value);
+      break;
+    case 8:
+    case 9:
+    case 10:
+    case 11:
+      gsl::at(ir_, index - 8) = static_cast<int16_t>(value);
+      break;
+    case 12:
+    case 13:
+    case 14: {
+      auto& xy = gsl::at(sxy_fifo_, index - 12);
+      xy[0] = static_cast<int16_t>(value);
+      xy[1] = static_cast<int16_t>(value >> 16U);
+      break;
+    }
+    case 15:
+      sxy_fifo_[0] = sxy_fifo_[1];
+      sxy_fifo_[1] = sxy_fifo_[2];
+      sxy_fifo_[2] = {static_cast<int16_t>(value),
+                      static_cast<int16_t>(value >> 16U)};
+      break;
+    case 16:
+    case 17:
+    case 18:
+    case 19:
+      gsl::at(sz_fifo_, index - 16) = static_cast<uint16_t>(value);
+      break;
+    case 20:
+    case 21:
+    case 22:
+      gsl::at(rgb_fifo_, index - 20) = UnpackColor(value);
+      break;
+    case 23:
+      res1_ = value;
+      break;
+    case 24:
+    case 25:
+    case 26:
+    case 27:
+      gsl::at(mac_, index - 24) = static_cast<int32_t>(value);
+      break;
+    case 28:
+      for (uint32_t i = 0; i < 3; i++) {
+        gsl::at(ir_, i + 1) =
+            static_cast<int16_t>(((value >> (i * 5)) & 0x1FU) * 0x80);
+      }
+      break;
+    case 30:
+      lzcs_ = value;
+      lzcr_ = std::countl_zero((value >> 31U) != 0U ? ~value : value);
+      break;
+    default:
+      break;
+  }
+}
+
+uint32_t gte::Gte::GetControl(const uint32_t index) const {
+  switch (index) {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+      return GetMatrixRegister(rotation_, index);
+    case 5:
+    case 6:
+    case 7:
+      return static_cast<uint32_t>(gsl::at(translation_, index - 5));
+    case 8:
+    case 9:
+    case 10:
+    case 11:
+    case 12:
+      return GetMatrixRegister(light_, index - 8);
+    case 13:
+    case 14:
+    case 15:
+      return static_cast<uint32_t>(gsl::at(background_color_, index - 13));
+    case 16:
+    case 17:
+    case 18:
+    case 19:
+    case 20:
+      return GetMatrixRegister(light_color_, index - 16);
+    case 21:
+    case 22:
+    case 23:
+      return static_cast<uint32_t>(gsl::at(far_color_, index - 21));
+    case 24:
+      return static_cast<uint32_t>(screen_offset_x_);
+    case 25:
+      return static_cast<uint32_t>(screen_offset_y_);
+    case 26:
+      // H is unsigned, but reads back sign-extended on real hardware.
+      return SignExtend16(static_cast<int16_t>(projection_distance_));
+    case 27:
+      return SignExtend16(depth_cue_a_);
+    case 28:
+      return static_cast<uint32_t>(depth_cue_b_);
+    case 29:
+      return SignExtend16(z_scale_3_);
+    case 30:
+      return SignExtend16(z_scale_4_);
+    case 31:
+      return flag_;
+    default:
+      return 0;
+  }
+}
+
+void gte::Gte::SetControl(const uint32_t index, const uint32_t value) {
+  switch (index) {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+      SetMatrixRegister(rotation_, index, value);
+      break;
+    case 5:
+    case 6:
+    case 7:
+      gsl::at(translation_, index - 5) = static_cast<int32_t>(value);
+      break;
+    case 8:
+    case 9:
+    case 10:
+    case 11:
+    case 12:
+      SetMatrixRegister(light_, index - 8, value);
+      break;
+    case 13:
+    case 14:
+    case 15:
+      gsl::at(background_color_, index - 13) = static_cast<int32_t>(value);
+      break;
+    case 16:
+    case 17:
+    case 18:
+    case 19:
+    case 20:
+      SetMatrixRegister(light_color_, index - 16, value);
+      break;
+    case 21:
+    case 22:
+    case 23:
+      gsl::at(far_color_, index - 21) = static_cast<int32_t>(value);
+      break;
+    case 24:
+      screen_offset_x_ = static_cast<int32_t>(value);
+      break;
+    case 25:
+      screen_offset_y_ = static_cast<int32_t>(value);
+      break;
+    case 26:
+      projection_distance_ = static_cast<uint16_t>(value);
+      break;
+    case 27:
+      depth_cue_a_ = static_cast<int16_t>(value);
+      break;
+    case 28:
+      depth_cue_b_ = static_cast<int32_t>(value);
+      break;
+    case 29:
+      z_scale_3_ = static_cast<int16_t>(value);
+      break;
+    case 30:
+      z_scale_4_ = static_cast<int16_t>(value);
+      break;
+    case 31:
+      flag_ = value & 0x7FFFF000U;
+      if ((flag_ & kFlagErrorMask) != 0U) {
+        flag_ |= kFlagError;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void gte::Gte::Execute(const uint32_t command) {
+  const uint8_t shift = (command & (1U << 19U)) != 0U ? 12 : 0;
+  const bool lm = (command & (1U << 10U)) != 0U;
+
+  flag_ = 0;
+  lane_count_ = 1;
+
+  switch (static_cast<Opcode>(command & 0x3FU)) {
+    case Opcode::kRTPS:
+      OpRTP(1, shift, lm);
+      break;
+    case Opcode::kNCLIP:
+      OpNCLIP();
+      break;
+    case Opcode::kOP:
+      OpOP(shift, lm);
+      break;
+    case Opcode::kDPCS:
+      OpDPC(1, {rgbc_}, shift, lm);
+      break;
+    case Opcode::kINTPL:
+      OpINTPL(shift, lm);
+      break;
+    case Opcode::kMVMVA:
+      OpMVMVA(command, shift, lm);
+      break;
+    case Opcode::kNCDS:
+      OpNCD(1, shift, lm);
+      break;
+    case Opcode::kCDP:
+      OpCDP(shift, lm);
+      break;
+    case Opcode::kNCDT:
+      OpNCD(3, shift, lm);
+      break;
+    case Opcode::kNCCS:
+      OpNCC(1, shift, lm);
+      break;
+    case Opcode::kCC:
+      OpCC(shift, lm);
+      break;
+    case Opcode::kNCS:
+      OpNC(1, shift, lm);
+      break;
+    case Opcode::kNCT:
+      OpNC(3, shift, lm);
+      break;
+    case Opcode::kSQR:
+      OpSQR(shift, lm);
+      break;
+    case Opcode::kDCPL:
+      OpDCPL(shift, lm);
+      break;
+    case Opcode::kDPCT:
+      OpDPC(3, rgb_fifo_, shift, lm);
+      break;
+    case Opcode::kAVSZ3:
+      OpAVSZ3();
+      break;
+    case Opcode::kAVSZ4:
+      OpAVSZ4();
+      break;
+    case Opcode::kRTPT:
+      OpRTP(3, shift, lm);
+      break;
+    case Opcode::kGPF:
+      OpGPF(shift, lm);
+      break;
+    case Opcode::kGPL:
+      OpGPL(shift, lm);
+      break;
+    case Opcode::kNCCT:
+      OpNCC(3, shift, lm);
+      break;
+    default:
+      LOG_INFO_GTE("Unhandled command {:02X}", command & 0x3FU);
+      break;
+  }
+
+  if ((flag_ & kFlagErrorMask) != 0U) {
+    flag_ |= kFlagError;
+  }
+}
+
+void gte::Gte::LoadLanes() {
+  for (uint32_t component = 0; component < 3; component++) {
+    gsl::at(mac_lanes_, component) = Broadcast(gsl::at(mac_, component + 1));
+    gsl::at(ir_lanes_, component) = Broadcast(gsl::at(ir_, component + 1));
+  }
+}
+
+void gte::Gte::StoreLanes() {
+  const size_t lane = lane_count_ - 1;
+  for (uint32_t component = 0; component < 3; component++) {
+    gsl::at(mac_, component + 1) =
+        static_cast<int32_t>(gsl::at(gsl::at(mac_lanes_, component), lane));
+    gsl::at(ir_, component + 1) =
+        static_cast<int16_t>(gsl::at(gsl::at(ir_lanes_, component), lane));
+  }
+}
+
+gte::LaneVector gte::Gte::GetVertexLanes(const size_t count) const {
+  LaneVector lanes{};
+  for (size_t lane = 0; lane < count; lane++) {
+    for (uint32_t component = 0; component < 3; component++) {
+      gsl::at(gsl::at(lanes, component), lane) =
+          gsl::at(gsl::at(vertices_, lane), component);
+    }
+  }
+  return lanes;
+}
+
+void gte::Gte::CheckMacOverflow(const uint32_t component, const Lanes& value) {
+  bool positive = false;
+  bool negative = false;
+  for (size_t lane = 0; lane < lane_count_; lane++) {
+    positive = positive || gsl::at(value, lane) > kMacMax;
+    negative = negative || gsl::at(value, lane) < kMacMin;
+  }
+
+  if (positive) {
+    flag_ |= gsl::at(kFlagMacPositive, component);
+  }
+  if (negative) {
+    flag_ |= gsl::at(kFlagMacNegative, component);
+  }
+}
+
+gte::Lanes gte::Gte::SignExtendMac(const uint32_t component, Lanes value) {
+  CheckMacOverflow(component, value);
+  for (int64_t& lane : value) {
+    lane = SignExtend44(lane);
+  }
+  return value;
+}
+
+void gte::Gte::SetMac(const uint32_t component, const Lanes& value,
+                      const uint8_t shift) {
+  CheckMacOverflow(component, value);
+
+  Lanes& mac = gsl::at(mac_lanes_, component);
+  for (size_t lane = 0; lane < kLanes; lane++) {
+    gsl::at(mac, lane) = static_cast<int32_t>(gsl::at(value, lane) >> shift);
+  }
+}
+
+void gte::Gte::SetIr(const uint32_t component, const Lanes& value,
+                     const bool lm) {
+  const int64_t minimum = lm ? 0 : -0x8000;
+  constexpr int64_t kMaximum = 0x7FFF;
+
+  bool saturated = false;
+  Lanes& ir = gsl::at(ir_lanes_, component);
+  for (size_t lane = 0; lane < kLanes; lane++) {
+    gsl::at(ir, lane) = std::clamp(gsl::at(value, lane), minimum, kMaximum);
+  }
+  for (size_t lane = 0; lane < lane_count_; lane++) {
+    saturated = saturated || gsl::at(ir, lane) != gsl::at(value, lane);
+  }
+
+  if (saturated) {
+    flag_ |= gsl::at(kFlagIrSaturated, component);
+  }
+}
+
+void gte::Gte::SetMacAndIr(const uint32_t component, const Lanes& value,
+                           const uint8_t shift, const bool lm) {
+  SetMac(component, value, shift);
+  SetIr(component, gsl::at(mac_lanes_, component), lm);
+}
+
+void gte::Gte::CheckMac0Overflow(const int64_t value) {
+  if (value > kMac0Max) {
+    flag_ |= kFlagMac0Positive;
+  } else if (value < kMac0Min) {
+    flag_ |= kFlagMac0Negative;
+  }
+}
+
+void gte::Gte::SetMac0(const int64_t value) {
+  CheckMac0Overflow(value);
+  mac_[0] = static_cast<int32_t>(value);
+}
+
+void gte::Gte::SetIr0(const int32_t value) {
+  if (value < 0 || value > 0x1000) {
+    flag_ |= kFlagIr0Saturated;
+  }
+  ir_[0] = static_cast<int16_t>(std::clamp(value, 0, 0x1000));
+}
+
+gte::LaneVector gte::Gte::MultiplyAccumulate(const Matrix& matrix,
+                                             const Vector& translation,
+                                             const LaneVector& vector) {
+  LaneVector result{};
+
+  for (uint32_t row = 0; row < 3; row++) {
+    const auto& coefficients = gsl::at(matrix, row);
+    Lanes sum{};
+
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(sum, lane) = (int64_t{gsl::at(translation, row)} * 0x1000) +
+                           (int64_t{coefficients[0]} * vector[0][lane]);
+    }
+    sum = SignExtendMac(row, sum);
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(sum, lane) += int64_t{coefficients[1]} * vector[1][lane];
+    }
+    sum = SignExtendMac(row, sum);
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(sum, lane) += int64_t{coefficients[2]} * vector[2][lane];
+    }
+
+    gsl::at(result, row) = sum;
+  }
+
+  return result;
+}
+
+// The vector is taken by value since it is often IR, which the rows below
+// overwrite.
+void gte::Gte::MultiplyMatrixVector(const Matrix& matrix,
+                                    const Vector& translation,
+                                    const LaneVector vector,
+                                    const uint8_t shift, const bool lm) {
+  const LaneVector sums = MultiplyAccumulate(matrix, translation, vector);
+  for (uint32_t row = 0; row < 3; row++) {
+    SetMacAndIr(row, gsl::at(sums, row), shift, lm);
+  }
+}
+
+void gte::Gte::MultiplyMatrixVectorFarColor(const Matrix& matrix,
+                                            const Vector& translation,
+                                            const LaneVector vector,
+                                            const uint8_t shift,
+                                            const bool lm) {
+  // Hardware bug: the far color term and first column only reach the flags,
+  // the result keeps just the last two columns.
+  for (uint32_t row = 0; row < 3; row++) {
+    const auto& coefficients = gsl::at(matrix, row);
+    Lanes discarded{};
+    Lanes sum{};
+
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(discarded, lane) =
+          (int64_t{gsl::at(translation, row)} * 0x1000) +
+          (int64_t{coefficients[0]} * vector[0][lane]);
+    }
+    discarded = SignExtendMac(row, discarded);
+    for (int64_t& lane : discarded) {
+      lane >>= shift;
+    }
+    SetIr(row, discarded, false);
+
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(sum, lane) = int64_t{coefficients[1]} * vector[1][lane];
+    }
+    sum = SignExtendMac(row, sum);
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(sum, lane) += int64_t{coefficients[2]} * vector[2][lane];
+    }
+    SetMacAndIr(row, sum, shift, lm);
+  }
+}
+
+void gte::Gte::InterpolateColor(const LaneVector& input, const uint8_t shift,
+                                const bool lm) {
+  // MAC = MAC + (FC - MAC) * IR0
+  for (uint32_t component = 0; component < 3; component++) {
+    Lanes difference{};
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(difference, lane) =
+          (int64_t{gsl::at(far_color_, component)} * 0x1000) -
+          input[component][lane];
+    }
+    SetMacAndIr(component, difference, shift, false);
+  }
+
+  for (uint32_t component = 0; component < 3; component++) {
+    Lanes result{};
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(result, lane) = (ir_lanes_[component][lane] * ir_[0]) +
+                              input[component][lane];
+    }
+    SetMacAndIr(component, result, shift, lm);
+  }
+}
+
+void gte::Gte::PushColorFromMac(const size_t lane) {
+  Color color{};
+  for (uint32_t component = 0; component < 3; component++) {
+    const int64_t value = gsl::at(gsl::at(mac_lanes_, component), lane) >> 4;
+    if (value < 0 || value > 0xFF) {
+      flag_ |= gsl::at(kFlagColorSaturated, component);
+    }
+    gsl::at(color, component) =
+        static_cast<uint8_t>(std::clamp<int64_t>(value, 0, 0xFF));
+  }
+  color[3] = rgbc_[3];
+
+  rgb_fifo_[0] = rgb_fifo_[1];
+  rgb_fifo_[1] = rgb_fifo_[2];
+  rgb_fifo_[2] = color;
+}
+
+void gte::Gte::PushScreenXY(int32_t x, int32_t y) {
+  if (x < -0x400 || x > 0x3FF) {
+    flag_ |= kFlagScreenXSaturated;
+    x = std::clamp(x, -0x400, 0x3FF);
+  }
+  if (y < -0x400 || y > 0x3FF) {
+    flag_ |= kFlagScreenYSaturated;
+    y = std::clamp(y, -0x400, 0x3FF);
+  }
+
+  sxy_fifo_[0] = sxy_fifo_[1];
+  sxy_fifo_[1] = sxy_fifo_[2];
+  sxy_fifo_[2] = {static_cast<int16_t>(x), static_cast<int16_t>(y)};
+}
+
+void gte::Gte::PushScreenZ(int32_t z) {
+  if (z < 0 || z > 0xFFFF) {
+    flag_ |= kFlagScreenZSaturated;
+    z = std::clamp(z, 0, 0xFFFF);
+  }
+
+  sz_fifo_[0] = sz_fifo_[1];
+  sz_fifo_[1] = sz_fifo_[2];
+  sz_fifo_[2] = sz_fifo_[3];
+  sz_fifo_[3] = static_cast<uint16_t>(z);
+}
+
+void gte::Gte::SetOrderingTableZ(int32_t z) {
+  if (z < 0 || z > 0xFFFF) {
+    flag_ |= kFlagScreenZSaturated;
+    z = std::clamp(z, 0, 0xFFFF);
+  }
+  otz_ = static_cast<uint16_t>(z);
+}
+
+uint32_t gte::Gte::Divide(uint32_t numerator, uint32_t denominator) {
+  if (denominator * 2 <= numerator) {
+    flag_ |= kFlagDivideOverflow;
+    return 0x1FFFF;
+  }
+
+  const int shift = std::countl_zero(static_cast<uint16_t>(denominator));
+  numerator <<= static_cast<uint32_t>(shift);
+  denominator <<= static_cast<uint32_t>(shift);
+
+  const uint32_t divisor = denominator | 0x8000U;
+  const auto seed = static_cast<int32_t>(
+      0x101 + gsl::at(kUnrTable, ((divisor & 0x7FFFU) + 0x40) >> 7U));
+  const int32_t error = ((static_cast<int32_t>(divisor) * -seed) + 0x80) >> 8;
+  const auto reciprocal =
+      static_cast<uint32_t>(((seed * (0x20000 + error)) + 0x80) >> 8);
+  const auto result = static_cast<uint32_t>(
+      ((uint64_t{numerator} * reciprocal) + 0x8000) >> 16U);
+
+  return std::min<uint32_t>(0x1FFFF, result);
+}
+
+void gte::Gte::OpRTP(const size_t count, const uint8_t shift, const bool lm) {
+  lane_count_ = count;
+
+  const LaneVector sums =
+      MultiplyAccumulate(rotation_, translation_, GetVertexLanes(count));
+  SetMacAndIr(0, sums[0], shift, lm);
+  SetMacAndIr(1, sums[1], shift, lm);
+  SetMac(2, sums[2], shift);
+
+  // IR3 is saturated from MAC3, but its flag always looks at MAC3 >> 12.
+  for (size_t lane = 0; lane < count; lane++) {
+    const int64_t value = gsl::at(sums[2], lane) >> 12;
+    if (value < -0x8000 || value > 0x7FFF) {
+      flag_ |= kFlagIrSaturated[2];
+    }
+  }
+  for (size_t lane = 0; lane < kLanes; lane++) {
+    gsl::at(ir_lanes_[2], lane) =
+        std::clamp<int64_t>(gsl::at(mac_lanes_[2], lane), lm ? 0 : -0x8000,
+                            0x7FFF);
+  }
+
+  for (size_t lane = 0; lane < count; lane++) {
+    PushScreenZ(static_cast<int32_t>(gsl::at(sums[2], lane) >> 12));
+
+    const int64_t quotient = Divide(projection_distance_, sz_fifo_[3]);
+    const int64_t screen_x =
+        (quotient * gsl::at(ir_lanes_[0], lane)) + screen_offset_x_;
+    const int64_t screen_y =
+        (quotient * gsl::at(ir_lanes_[1], lane)) + screen_offset_y_;
+    CheckMac0Overflow(screen_x);
+    CheckMac0Overflow(screen_y);
+    PushScreenXY(static_cast<int32_t>(screen_x >> 16),
+                 static_cast<int32_t>(screen_y >> 16));
+
+    if (lane == count - 1) {
+      const int64_t depth = (quotient * depth_cue_a_) + depth_cue_b_;
+      SetMac0(depth);
+      SetIr0(static_cast<int32_t>(depth >> 12));
+    }
+  }
+
+  StoreLanes();
+}
+
+void gte::Gte::OpNCLIP() {
+  const auto& [sx0, sy0] = sxy_fifo_[0];
+  const auto& [sx1, sy1] = sxy_fifo_[1];
+  const auto& [sx2, sy2] = sxy_fifo_[2];
+
+  SetMac0((int64_t{sx0} * sy1) + (int64_t{sx1} * sy2) + (int64_t{sx2} * sy0) -
+          (int64_t{sx0} * sy2) - (int64_t{sx1} * sy0) - (int64_t{sx2} * sy1));
+}
+
+void gte::Gte::OpOP(const uint8_t shift, const bool lm) {
+  LoadLanes();
+
+  const int64_t d1 = rotation_[0][0];
+  const int64_t d2 = rotation_[1][1];
+  const int64_t d3 = rotation_[2][2];
+  const int64_t ir1 = ir_[1];
+  const int64_t ir2 = ir_[2];
+  const int64_t ir3 = ir_[3];
+
+  SetMacAndIr(0, Broadcast((ir3 * d2) - (ir2 * d3)), shift, lm);
+  SetMacAndIr(1, Broadcast((ir1 * d3) - (ir3 * d1)), shift, lm);
+  SetMacAndIr(2, Broadcast((ir2 * d1) - (ir1 * d2)), shift, lm);
+
+  StoreLanes();
+}
+
+void gte::Gte::OpDPC(const size_t count, const std::array<Color, 3>& colors,
+                     const uint8_t shift, const bool lm) {
+  LoadLanes();
+  lane_count_ = count;
+
+  LaneVector input{};
+  for (size_t lane = 0; lane < count; lane++) {
+    for (uint32_t component = 0; component < 3; component++) {
+      gsl::at(gsl::at(input, component), lane) =
+          int64_t{gsl::at(gsl::at(colors, lane), component)} << 16U;
+    }
+  }
+
+  InterpolateColor(input, shift, lm);
+  for (size_t lane = 0; lane < count; lane++) {
+    PushColorFromMac(lane);
+  }
+
+  StoreLanes();
+}
+
+void gte::Gte::OpINTPL(const uint8_t shift, const bool lm) {
+  LoadLanes();
+
+  LaneVector input{};
+  for (uint32_t component = 0; component < 3; component++) {
+    gsl::at(input, component) =
+        Broadcast(int64_t{gsl::at(ir_, component + 1)} * 0x1000);
+  }
+
+  InterpolateColor(input, shift, lm);
+  PushColorFromMac(0);
+
+  StoreLanes();
+}
+
+void gte::Gte::OpMVMVA(const uint32_t command, const uint8_t shift,
+                       const bool lm) {
+  LoadLanes();
+
+  const uint32_t matrix_select = (command >> 17U) & 0x3U;
+  const uint32_t vector_select = (command >> 15U) & 0x3U;
+  const uint32_t translation_select = (command >> 13U) & 0x3U;
+
+  LaneVector vector{};
+  for (uint32_t component = 0; component < 3; component++) {
+    gsl::at(vector, component) =
+        vector_select == 3
+            ? Broadcast(gsl::at(ir_, component + 1))
+            : Broadcast(gsl::at(gsl::at(vertices_, vector_select), component));
+  }
+
+  Matrix matrix{};
+  switch (matrix_select) {
+    case 0:
+      matrix = rotation_;
+      break;
+    case 1:
+      matrix = light_;
+      break;
+    case 2:
+      matrix = light_color_;
+      break;
+    default: {
+      // Reserved, reads back a garbage matrix built from other registers.
+      const auto red = static_cast<int16_t>(rgbc_[0] << 4U);
+      matrix = {{{static_cast<int16_t>(-red), red, ir_[0]},
+                 {rotation_[0][2], rotation_[0][2], rotation_[0][2]},
+                 {rotation_[1][1], rotation_[1][1], rotation_[1][1]}}};
+      break;
+    }
+  }
+
+  switch (translation_select) {
+    case 0:
+      MultiplyMatrixVector(matrix, translation_, vector, shift, lm);
+      break;
+    case 1:
+      MultiplyMatrixVector(matrix, background_color_, vector, shift, lm);
+      break;
+    case 2:
+      MultiplyMatrixVectorFarColor(matrix, far_color_, vector, shift, lm);
+      break;
+    default:
+      MultiplyMatrixVector(matrix, {}, vector, shift, lm);
+      break;
+  }
+
+  StoreLanes();
+}
+
+void gte::Gte::OpNCD(const size_t count, const uint8_t shift, const bool lm) {
+  LoadLanes();
+  lane_count_ = count;
+
+  MultiplyMatrixVector(light_, {}, GetVertexLanes(count), shift, lm);
+  MultiplyMatrixVector(light_color_, background_color_, ir_lanes_, shift, lm);
+
+  LaneVector input{};
+  for (uint32_t component = 0; component < 3; component++) {
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(gsl::at(input, component), lane) =
+          (int64_t{gsl::at(rgbc_, component)} * ir_lanes_[component][lane])
+          << 4U;
+    }
+  }
+
+  InterpolateColor(input, shift, lm);
+  for (size_t lane = 0; lane < count; lane++) {
+    PushColorFromMac(lane);
+  }
+
+  StoreLanes();
+}
+
+void gte::Gte::OpCDP(const uint8_t shift, const bool lm) {
+  LoadLanes();
+
+  MultiplyMatrixVector(light_color_, background_color_, ir_lanes_, shift, lm);
+
+  LaneVector input{};
+  for (uint32_t component = 0; component < 3; component++) {
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(gsl::at(input, component), lane) =
+          (int64_t{gsl::at(rgbc_, component)} * ir_lanes_[component][lane])
+          << 4U;
+    }
+  }
+
+  InterpolateColor(input, shift, lm);
+  PushColorFromMac(0);
+
+  StoreLanes();
+}
+
+void gte::Gte::OpNCC(const size_t count, const uint8_t shift, const bool lm) {
+  LoadLanes();
+  lane_count_ = count;
+
+  MultiplyMatrixVector(light_, {}, GetVertexLanes(count), shift, lm);
+  ColorTail(count, shift, lm);
+}
+
+void gte::Gte::OpCC(const uint8_t shift, const bool lm) {
+  LoadLanes();
+  ColorTail(1, shift, lm);
+}
+
+void gte::Gte::ColorTail(const size_t count, const uint8_t shift,
+                         const bool lm) {
+  MultiplyMatrixVector(light_color_, background_color_, ir_lanes_, shift, lm);
+
+  for (uint32_t component = 0; component < 3; component++) {
+    Lanes product{};
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      gsl::at(product, lane) = (int64_t{gsl::at(rgbc_, component)} << 4U) *
+                               ir_lanes_[component][lane];
+    }
+    SetMac(component, product, 0);
+  }
+  for (uint32_t component = 0; component < 3; component++) {
+    SetMacAndIr(component, gsl::at(mac_lanes_, component), shift, lm);
+  }
+
+  for (size_t lane = 0; lane < count; lane++) {
+    PushColorFromMac(lane);
+  }
+
+  StoreLanes();
+}
+
+void gte::Gte::OpNC(const size_t count, const uint8_t shift, const bool lm) {
+  LoadLanes();
+  lane_count_ = count;
+
+  MultiplyMatrixVector(light_, {}, GetVertexLanes(count), shift, lm);
+  MultiplyMatrixVector(light_color_, background_color_, ir_lanes_, shift, lm);
+
+  for (size_t lane = 0; lane < count; lane++) {
+    PushColorFromMac(lane);
+  }
+
+  StoreLanes();
+}
+
+void gte::Gte::OpSQR(const uint8_t shift, const bool lm) {
+  LoadLanes();
+
+  for (uint32_t component = 0; component < 3; component++) {
+    const int64_t ir = gsl::at(ir_, component + 1);
+    SetMacAndIr(component, Broadcast(ir * ir), shift, lm);
+  }
+
+  StoreLanes();
+}
+
+void gte::Gte::OpDCPL(const uint8_t shift, const bool lm) {
+  LoadLanes();
+
+  LaneVector input{};
+  for (uint32_t component = 0; component < 3; component++) {
+    gsl::at(input, component) = Broadcast(
+        (int64_t{gsl::at(rgbc_, component)} * gsl::at(ir_, component + 1))
+        << 4U);
+  }
+
+  InterpolateColor(input, shift, lm);
+  PushColorFromMac(0);
+
+  StoreLanes();
+}
+
+void gte::Gte::OpAVSZ3() {
+  const int64_t sum = int64_t{sz_fifo_[1]} + sz_fifo_[2] + sz_fifo_[3];
+  const int64_t result = z_scale_3_ * sum;
+
+  SetMac0(result);
+  SetOrderingTableZ(static_cast<int32_t>(result >> 12));
+}
+
+void gte::Gte::OpAVSZ4() {
+  const int64_t sum =
+      int64_t{sz_fifo_[0]} + sz_fifo_[1] + sz_fifo_[2] + sz_fifo_[3];
+  const int64_t result = z_scale_4_ * sum;
+
+  SetMac0(result);
+  SetOrderingTableZ(static_cast<int32_t>(result >> 12));
+}
+
+void gte::Gte::OpGPF(const uint8_t shift, const bool lm) {
+  LoadLanes();
+
+  for (uint32_t component = 0; component < 3; component++) {
+    const int64_t ir = gsl::at(ir_, component + 1);
+    SetMacAndIr(component, Broadcast(ir * ir_[0]), shift, lm);
+  }
+  PushColorFromMac(0);
+
+  StoreLanes();
+}
+
+void gte::Gte::OpGPL(const uint8_t shift, const bool lm) {
+  LoadLanes();
+
+  for (uint32_t component = 0; component < 3; component++) {
+    const Lanes accumulator = SignExtendMac(
+        component,
+        Broadcast(int64_t{gsl::at(mac_, component + 1)} * (1LL << shift)));
+    const int64_t ir = gsl::at(ir_, component + 1);
+    SetMacAndIr(component, Broadcast((ir * ir_[0]) + accumulator[0]), shift,
+                lm);
+  }
+  PushColorFromMac(0);
+
+  StoreLanes();
+}
@@ -0,0 +1,149 @@
+#ifndef POLYSTATION_GTE_H
+#define POLYSTATION_GTE_H
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "savestate.h"
+
+namespace gte {
+constexpr uint32_t kNumberOfRegisters = 32;
+
+// Commands operate on up to three vertices at once (RTPT, NCDT, ...). Every
+// intermediate value is kept in one lane per vertex so the fixed-point
+// pipeline runs on all of them together; the fourth lane is padding.
+constexpr size_t kLanes = 4;
+
+using Lanes = std::array<int64_t, kLanes>;
+using LaneVector = std::array<Lanes, 3>;
+using Matrix = std::array<std::array<int16_t, 3>, 3>;
+using Vector = std::array<int32_t, 3>;
+using Vertex = std::array<int16_t, 3>;
+using Color = std::array<uint8_t, 4>;
+
+enum class Opcode : uint8_t {
+  kRTPS = 0x01,
+  kNCLIP = 0x06,
+  kOP = 0x0C,
+  kDPCS = 0x10,
+  kINTPL = 0x11,
+  kMVMVA = 0x12,
+  kNCDS = 0x13,
+  kCDP = 0x14,
+  kNCDT = 0x16,
+  kNCCS = 0x1B,
+  kCC = 0x1C,
+  kNCS = 0x1E,
+  kNCT = 0x20,
+  kSQR = 0x28,
+  kDCPL = 0x29,
+  kDPCT = 0x2A,
+  kAVSZ3 = 0x2D,
+  kAVSZ4 = 0x2E,
+  kRTPT = 0x30,
+  kGPF = 0x3D,
+  kGPL = 0x3E,
+  kNCCT = 0x3F
+};
+
+[[nodiscard]] std::string_view GetOpcodeName(uint32_t command);
+
+class Gte {
+ public:
+  [[nodiscard]] uint32_t GetData(uint32_t index) const;
+  void SetData(uint32_t index, uint32_t value);
+  [[nodiscard]] uint32_t GetControl(uint32_t index) const;
+  void SetControl(uint32_t index, uint32_t value);
+
+  void Execute(uint32_t command);
+
+  void Save(savestate::Writer& writer) const;
+  void Load(savestate::Reader& reader);
+
+ private:
+  // Data registers
+  std::array<Vertex, 3> vertices_{};
+  Color rgbc_{};
+  uint16_t otz_ = 0;
+  std::array<int16_t, 4> ir_{};
+  std::array<std::array<int16_t, 2>, 3> sxy_fifo_{};
+  std::array<uint16_t, 4> sz_fifo_{};
+  std::array<Color, 3> rgb_fifo_{};
+  uint32_t res1_ = 0;
+  std::array<int32_t, 4> mac_{};
+  uint32_t lzcs_ = 0;
+  uint32_t lzcr_ = 32;
+
+  // Control registers
+  Matrix rotation_{};
+  Vector translation_{};
+  Matrix light_{};
+  Vector background_color_{};
+  Matrix light_color_{};
+  Vector far_color_{};
+  int32_t screen_offset_x_ = 0;
+  int32_t screen_offset_y_ = 0;
+  uint16_t projection_distance_ = 0;
+  int16_t depth_cue_a_ = 0;
+  int32_t depth_cue_b_ = 0;
+  int16_t z_scale_3_ = 0;
+  int16_t z_scale_4_ = 0;
+  uint32_t flag_ = 0;
+
+  // Per-command working state
+  size_t lane_count_ = 1;
+  LaneVector mac_lanes_{};
+  LaneVector ir_lanes_{};
+
+  void LoadLanes();
+  void StoreLanes();
+  [[nodiscard]] LaneVector GetVertexLanes(size_t count) const;
+
+  void CheckMacOverflow(uint32_t component, const Lanes& value);
+  [[nodiscard]] Lanes SignExtendMac(uint32_t component, Lanes value);
+  void SetMac(uint32_t component, const Lanes& value, uint8_t shift);
+  void SetIr(uint32_t component, const Lanes& value, bool lm);
+  void SetMacAndIr(uint32_t component, const Lanes& value, uint8_t shift,
+                   bool lm);
+  void SetMac0(int64_t value);
+  void SetIr0(int32_t value);
+  void CheckMac0Overflow(int64_t value);
+
+  [[nodiscard]] LaneVector MultiplyAccumulate(const Matrix& matrix,
+                                              const Vector& translation,
+                                              const LaneVector& vector);
+  void MultiplyMatrixVector(const Matrix& matrix, const Vector& translation,
+                            LaneVector vector, uint8_t shift, bool lm);
+  void MultiplyMatrixVectorFarColor(const Matrix& matrix,
+                                    const Vector& translation,
+                                    LaneVector vector, uint8_t shift, bool lm);
+  void InterpolateColor(const LaneVector& input, uint8_t shift, bool lm);
+  void PushColorFromMac(size_t lane);
+  void PushScreenXY(int32_t x, int32_t y);
+  void PushScreenZ(int32_t z);
+  void SetOrderingTableZ(int32_t z);
+  [[nodiscard]] uint32_t Divide(uint32_t numerator, uint32_t denominator);
+
+  void OpRTP(size_t count, uint8_t shift, bool lm);
+  void OpNCLIP();
+  void OpOP(uint8_t shift, bool lm);
+  void OpDPC(size_t count, const std::array<Color, 3>& colors, uint8_t shift,
+             bool lm);
+  void OpINTPL(uint8_t shift, bool lm);
+  void OpMVMVA(uint32_t command, uint8_t shift, bool lm);
+  void OpNCD(size_t count, uint8_t shift, bool lm);
+  void OpCDP(uint8_t shift, bool lm);
+  void OpNCC(size_t count, uint8_t shift, bool lm);
+  void OpCC(uint8_t shift, bool lm);
+  void OpNC(size_t count, uint8_t shift, bool lm);
+  void OpSQR(uint8_t shift, bool lm);
+  void OpDCPL(uint8_t shift, bool lm);
+  void OpAVSZ3();
+  void OpAVSZ4();
+  void OpGPF(uint8_t shift, bool lm);
+  void OpGPL(uint8_t shift, bool lm);
+  void ColorTail(size_t count, uint8_t shift, bool lm);
+};
+}  // namespace gte
+
+#endif  // POLYSTATION_GTE_H
@@ -0,0 +1,181 @@
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "batch.h"
+#include "logger.h"
+#include "worker_pool.h"
+
+namespace {
+struct Options {
+  batch::Job job;
+  std::optional<std::string> batch_path;
+  size_t threads = worker_pool::WorkerPool::DefaultThreadCount() + 1;
+} __attribute__((aligned(128)));
+
+std::optional<Options> ParseOptions(const std::span<char*> args) {
+  if (args.size() < 2) {
+    return std::nullopt;
+  }
+
+  Options options;
+  size_t i = 1;
+  if (const std::string_view first = args[1]; first == "--batch") {
+    if (args.size() < 3) {
+      return std::nullopt;
+    }
+    options.batch_path = args[2];
+    i = 3;
+  } else {
+    options.job.name = args[1];
+    options.job.bios_path = args[1];
+    i = 2;
+  }
+
+  for (; i < args.size(); i++) {
+    const std::string_view arg = args[i];
+    const bool has_value = i + 1 < args.size();
+
+    if (arg == "--accurate") {
+      options.job.accuracy = cpu::Accuracy::kAccurate;
+    } else if (arg == "--idle-skip") {
+      options.job.idle_skipping = true;
+    } else if (arg == "--no-fusion") {
+      options.job.fusion = false;
+    } else if (arg == "--cached-interpreter") {
+      options.job.backend = cpu::Backend::kCachedInterpreter;
+    } else if (arg == "--hle") {
+      options.job.hle_mode = hle::Mode::kOn;
+    } else if (arg == "--hle-verify") {
+      options.job.hle_mode = hle::Mode::kVerify;
+    } else if (arg == "--hash") {
+      options.job.hash = true;
+    } else if (arg == "--quiet") {
+      logger::Logger::get()->set_level(spdlog::level::warn);
+    } else if (arg == "--threads" && has_value) {
+      options.threads = std::stoull(args[++i]);
+    } else if (arg == "--exe" && has_value) {
+      options.job.exe_path = args[++i];
+    } else if (arg == "--cycles" && has_value) {
+      options.job.cycles = std::stoull(args[++i]);
+    } else if (arg == "--frames" && has_value) {
+      options.job.cycles = std::stoull(args[++i]) * cpu::kCyclesPerFrame;
+    } else if (arg == "--seconds" && has_value) {
+      options.job.cycles = std::stoull(args[++i]) * cpu::kCpuClock;
+    } else if (arg == "--block-cache" && has_value) {
+      options.job.block_cache_path = args[++i];
+    } else if (arg == "--dump-ram" && has_value) {
+      options.job.dump_ram_path = args[++i];
+    } else if (arg == "--save-state" && has_value) {
+      options.job.save_state_path = args[++i];
+    } else if (arg == "--trace" && has_value) {
+      options.job.trace_path = args[++i];
+    } else if (arg == "--profile" && has_value) {
+      options.job.profile_path = args[++i];
+    } else if (arg == "--profile-interval" && has_value) {
+      options.job.profile_interval = std::stoull(args[++i]);
+    } else if (arg == "--symbols" && has_value) {
+      options.job.symbols_path = args[++i];
+    } else if (arg == "--metrics" && has_value) {
+      options.job.metrics_path = args[++i];
+    } else if (arg == "--opcodes" && has_value) {
+      options.job.opcodes_path = args[++i];
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  return options;
+}
+
+int RunBatch(const Options& options) {
+  std::ifstream input(options.batch_path.value());
+  if (!input) {
+    throw std::runtime_error(
+        std::format("failed to open job list {}", options.batch_path.value()));
+  }
+
+  const std::vector<batch::Job> jobs = batch::ParseJobs(input);
+  const batch::Summary summary =
+      batch::RunJobs(jobs, options.threads, std::cout);
+
+  LOG_INFO_CORE("{} jobs, {} failed, {:.3f}s, {:.0f} instructions per second",
+                summary.jobs, summary.failures, summary.host_seconds,
+                static_cast<double>(summary.instructions) /
+                    summary.host_seconds);
+  return summary.failures == 0 ? 0 : 1;
+}
+
+int RunSingle(const Options& options) {
+  const batch::Result result =
+      batch::RunJob(options.job, bios::Image::Open(options.job.bios_path),
+                    std::make_shared<worker_pool::WorkerPool>());
+  if (result.error.has_value()) {
+    throw std::runtime_error(result.error.value());
+  }
+
+  std::cout << std::format("cycles: {}\n", result.cycles);
+  std::cout << std::format("instructions: {}\n", result.instructions);
+  std::cout << std::format("host seconds: {:.3f}\n", result.host_seconds);
+  std::cout << std::format(
+      "instructions per second: {:.0f}\n",
+      static_cast<double>(result.instructions) / result.host_seconds);
+  if (result.hle.has_value()) {
+    std::cout << std::format("hle calls: {}, verified: {}, mismatches: {}\n",
+                             result.hle->calls, result.hle->verified,
+                             result.hle->mismatches);
+  }
+  if (result.idle_loop.has_value()) {
+    std::cout << std::format("idle loops skipped: {}, cycles skipped: {}\n",
+                             result.idle_loop->loops_skipped,
+                             result.idle_loop->cycles_skipped);
+  }
+  if (result.ram_hash.has_value()) {
+    std::cout << std::format("ram hash: {:016X}\n", result.ram_hash.value());
+  }
+  if (result.state_hash.has_value()) {
+    std::cout << std::format("state hash: {:016X}\n",
+                             result.state_hash.value());
+  }
+  return 0;
+}
+}  // namespace
+
+int main(const int argc, char** argv) {
+  logger::Logger::init();
+
+  const std::span args(argv, argc);
+  int status = 0;
+
+  try {
+    const std::optional<Options> options = ParseOptions(args);
+    if (!options.has_value()) {
+      LOG_FATAL_CORE(
+          "Usage: {0} <bios_path> [--exe <path>] "
+          "[--cycles N | --frames N | --seconds N] "
+          "[--accurate] [--hle | --hle-verify] [--idle-skip] [--no-fusion] "
+          "[--cached-interpreter [--block-cache <path>]] [--hash] "
+          "[--dump-ram <path>] [--save-state <path>] [--trace <path>] "
+          "[--profile <path> [--profile-interval N] [--symbols <path>]] "
+          "[--metrics <path>] [--opcodes <path>] [--quiet]\n"
+          "       {0} --batch <job_list> [--threads N] [--quiet]",
+          args[0]);
+      return -1;
+    }
+
+    status = options->batch_path.has_value() ? RunBatch(options.value())
+                                             : RunSingle(options.value());
+  } catch (const std::exception& e) {
+    LOG_FATAL_CORE("{}", e.what());
+    return -1;
+  }
+
+  logger::Logger::shutdown();
+
+  return status;
+}
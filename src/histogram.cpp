@@ -0,0 +1,113 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <gsl/gsl>
+#include <stdexcept>
+
+namespace {
+constexpr size_t kPairRows = isa::kDecodeTableSize + 1;
+
+double GetPercent(const uint64_t count, const uint64_t total) {
+  return total == 0 ? 0.0
+                    : 100.0 * static_cast<double>(count) /
+                          static_cast<double>(total);
+}
+
+std::vector<histogram::PairCount> CollectPairs(
+    const std::vector<uint64_t>& pairs) {
+  std::vector<histogram::PairCount> counts;
+  // The last row holds the first instruction, which has no predecessor.
+  for (size_t first = 0; first < isa::kDecodeTableSize; first++) {
+    for (size_t second = 0; second < isa::kDecodeTableSize; second++) {
+      if (const uint64_t count =
+              gsl::at(pairs, first * isa::kDecodeTableSize + second);
+          count != 0) {
+        counts.push_back(histogram::PairCount{
+            .first = first, .second = second, .count = count});
+      }
+    }
+  }
+  return counts;
+}
+}  // namespace
+
+histogram::OpcodeHistogram::OpcodeHistogram() {
+  if constexpr (kEnabled) {
+    pairs_.resize(kPairRows * isa::kDecodeTableSize);
+  }
+}
+
+void histogram::OpcodeHistogram::Record(const size_t index) {
+  gsl::at(counts_, index)++;
+  gsl::at(pairs_, previous_ * isa::kDecodeTableSize + index)++;
+  previous_ = index;
+  total_++;
+}
+
+void histogram::OpcodeHistogram::Clear() {
+  counts_.fill(0);
+  std::ranges::fill(pairs_, 0);
+  previous_ = isa::kDecodeTableSize;
+  total_ = 0;
+}
+
+uint64_t histogram::OpcodeHistogram::GetTotal() const { return total_; }
+
+std::vector<histogram::OpcodeCount> histogram::OpcodeHistogram::GetOpcodes()
+    const {
+  std::vector<OpcodeCount> opcodes;
+  for (size_t index = 0; index < counts_.size(); index++) {
+    if (const uint64_t count = gsl::at(counts_, index); count != 0) {
+      opcodes.push_back(OpcodeCount{.index = index, .count = count});
+    }
+  }
+  std::ranges::sort(opcodes, std::ranges::greater(), &OpcodeCount::count);
+  return opcodes;
+}
+
+std::vector<histogram::PairCount> histogram::OpcodeHistogram::GetPairs(
+    const size_t count) const {
+  if (pairs_.empty()) {
+    return {};
+  }
+
+  std::vector<PairCount> pairs = CollectPairs(pairs_);
+  const auto middle = pairs.begin() + static_cast<std::ptrdiff_t>(
+                                          std::min(count, pairs.size()));
+  std::ranges::partial_sort(pairs, middle, std::ranges::greater(),
+                            &PairCount::count);
+  pairs.erase(middle, pairs.end());
+  return pairs;
+}
+
+void histogram::OpcodeHistogram::WriteCsv(
+    const std::filesystem::path& path) const {
+  std::ofstream output(path, std::ios::trunc);
+  output << "kind,first,second,count,percent\n";
+
+  for (const OpcodeCount& opcode : GetOpcodes()) {
+    output << std::format("opcode,{},,{},{:.4f}\n",
+                          isa::GetDecodeName(opcode.index), opcode.count,
+                          GetPercent(opcode.count, total_));
+  }
+
+  if (!pairs_.empty()) {
+    std::vector<PairCount> pairs = CollectPairs(pairs_);
+    std::ranges::sort(pairs, std::ranges::greater(), &PairCount::count);
+    // Percent of all pairs, one fewer than instructions.
+    const uint64_t pair_total = total_ == 0 ? 0 : total_ - 1;
+    for (const PairCount& pair : pairs) {
+      output << std::format("pair,{},{},{},{:.4f}\n",
+                            isa::GetDecodeName(pair.first),
+                            isa::GetDecodeName(pair.second), pair.count,
+                            GetPercent(pair.count, pair_total));
+    }
+  }
+
+  if (!output) {
+    throw std::runtime_error(
+        std::format("failed to write histogram {}", path.string()));
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef POLYSTATION_HISTOGRAM_H
+#define POLYSTATION_HISTOGRAM_H
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "isa.h"
+
+namespace histogram {
+// Set with the POLYSTATION_OPCODE_HISTOGRAM CMake option. Counting costs a
+// few memory increments per instruction, so it is compiled out otherwise.
+#ifdef POLYSTATION_OPCODE_HISTOGRAM
+constexpr bool kEnabled = true;
+#else
+constexpr bool kEnabled = false;
+#endif
+
+struct OpcodeCount {
+  // isa::GetDecodeIndex of the instruction.
+  size_t index = 0;
+  uint64_t count = 0;
+} __attribute__((aligned(16)));
+
+struct PairCount {
+  size_t first = 0;
+  size_t second = 0;
+  uint64_t count = 0;
+} __attribute__((aligned(32)));
+
+// Executions per decode index, i.e. per primary opcode and per sub-opcode
+// of the grouped ones, and per pair of consecutively executed instructions.
+// The pairs show which sequences are worth fusing.
+class OpcodeHistogram {
+ public:
+  OpcodeHistogram();
+
+  void Record(size_t index);
+  void Clear();
+
+  [[nodiscard]] uint64_t GetTotal() const;
+  // Sorted by count, most first, without the opcodes never executed.
+  [[nodiscard]] std::vector<OpcodeCount> GetOpcodes() const;
+  [[nodiscard]] std::vector<PairCount> GetPairs(size_t count) const;
+
+  // kind,first,second,count,percent rows, the opcodes first and then every
+  // pair seen.
+  void WriteCsv(const std::filesystem::path& path) const;
+
+ private:
+  std::array<uint64_t, isa::kDecodeTableSize> counts_{};
+  // Row per previous index plus one for the first instruction, which has
+  // none, so Record never branches.
+  std::vector<uint64_t> pairs_;
+  size_t previous_ = isa::kDecodeTableSize;
+  uint64_t total_ = 0;
+};
+}  // namespace histogram
+
+#endif  // POLYSTATION_HISTOGRAM_H
@@ -0,0 +1,381 @@
+#include "hle.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <stdexcept>
+
+#include "logger.h"
+
+namespace {
+constexpr uint32_t kStrcmp = 0x17;
+constexpr uint32_t kStrcpy = 0x19;
+constexpr uint32_t kStrlen = 0x1B;
+constexpr uint32_t kMemcpy = 0x2A;
+constexpr uint32_t kMemset = 0x2B;
+constexpr uint32_t kPutCharA = 0x3C;
+constexpr uint32_t kPutsA = 0x3E;
+constexpr uint32_t kPrintf = 0x3F;
+constexpr uint32_t kPutCharB = 0x3D;
+constexpr uint32_t kPutsB = 0x3F;
+
+// The BIOS loops run from ROM, a few instructions per byte.
+constexpr uint64_t kCallCycles = 20;
+constexpr uint64_t kCyclesPerByte = 8;
+
+// Guards against unterminated strings walking all of memory.
+constexpr uint32_t kMaxStringLength = 0x10000;
+
+// One printf conversion's flags, width and precision. The guest's format
+// string is untrusted, so conversions are formatted by hand and nothing in
+// it can make formatting fail.
+struct Conversion {
+  bool left_align = false;
+  bool zero_pad = false;
+  bool alternate = false;
+  // '+', ' ' or nothing for positive numbers.
+  char sign = '\0';
+  size_t width = 0;
+  std::optional<size_t> precision = std::nullopt;
+} __attribute__((aligned(32)));
+
+std::string Pad(const Conversion& conversion, std::string text) {
+  if (text.size() >= conversion.width) {
+    return text;
+  }
+  const std::string padding(conversion.width - text.size(), ' ');
+  return conversion.left_align ? text + padding : padding + text;
+}
+
+// `prefix` is the sign or 0x, kept in front of zero padding.
+std::string FormatNumber(const Conversion& conversion,
+                         const std::string& prefix, std::string digits) {
+  if (conversion.precision.has_value()) {
+    if (conversion.precision.value() == 0 && digits == "0") {
+      digits.clear();
+    }
+    if (digits.size() < conversion.precision.value()) {
+      digits.insert(0, conversion.precision.value() - digits.size(), '0');
+    }
+  } else if (conversion.zero_pad && !conversion.left_align &&
+             prefix.size() + digits.size() < conversion.width) {
+    digits.insert(0, conversion.width - prefix.size() - digits.size(), '0');
+  }
+  return Pad(conversion, prefix + digits);
+}
+
+uint64_t GetCycles(const uint32_t bytes) {
+  return kCallCycles + kCyclesPerByte * bytes;
+}
+
+std::string ReadString(bus::Bus& bus, const uint32_t address) {
+  std::string text;
+  for (uint32_t i = 0; i < kMaxStringLength; i++) {
+    const auto character = static_cast<char>(bus.Load8(address + i));
+    if (character == '\0') {
+      break;
+    }
+    text += character;
+  }
+  return text;
+}
+}  // namespace
+
+std::optional<uint32_t> hle::GetTable(const uint32_t address) {
+  switch (bus::MaskRegion(address)) {
+    case kTableA:
+      return kTableA;
+    case kTableB:
+      return kTableB;
+    case kTableC:
+      return kTableC;
+    default:
+      return std::nullopt;
+  }
+}
+
+bool hle::IsImplemented(const uint32_t table, const uint32_t function) {
+  if (table == kTableA) {
+    switch (function) {
+      case kStrcmp:
+      case kStrcpy:
+      case kStrlen:
+      case kMemcpy:
+      case kMemset:
+      case kPutCharA:
+      case kPutsA:
+      case kPrintf:
+        return true;
+      default:
+        return false;
+    }
+  }
+  if (table == kTableB) {
+    return function == kPutCharB || function == kPutsB;
+  }
+  return false;
+}
+
+void hle::Hle::SetMode(const Mode mode) { mode_ = mode; }
+
+hle::Mode hle::Hle::GetMode() const { return mode_; }
+
+const hle::Stats& hle::Hle::GetStats() const { return stats_; }
+
+hle::Stats& hle::Hle::GetStats() { return stats_; }
+
+hle::Result hle::Hle::Execute(const Call& call, bus::Bus& bus) {
+  stats_.calls++;
+
+  if (call.table == kTableB) {
+    if (call.function == kPutCharB) {
+      PutChar(static_cast<char>(call.arguments[0]));
+      return Result{.cycles = kCallCycles};
+    }
+    return Puts(call, bus);
+  }
+
+  switch (call.function) {
+    case kStrcmp:
+      return Strcmp(call, bus);
+    case kStrcpy:
+      return Strcpy(call, bus);
+    case kStrlen:
+      return Strlen(call, bus);
+    case kMemcpy:
+      return Memcpy(call, bus);
+    case kMemset:
+      return Memset(call, bus);
+    case kPutCharA:
+      PutChar(static_cast<char>(call.arguments[0]));
+      return Result{.cycles = kCallCycles};
+    case kPutsA:
+      return Puts(call, bus);
+    case kPrintf:
+      return Printf(call, bus);
+    default:
+      throw std::runtime_error(
+          std::format("HLE call {:02X}({:02X}) is not implemented", call.table,
+                      call.function));
+  }
+}
+
+void hle::Hle::PutChar(const char character) {
+  if (character == '\n') {
+    LOG_INFO_TTY("{}", tty_line_);
+    tty_line_.clear();
+  } else {
+    tty_line_ += character;
+  }
+}
+
+hle::Result hle::Hle::Memcpy(const Call& call, bus::Bus& bus) {
+  const auto [destination, source, length, unused] = call.arguments;
+  if (destination == 0) {
+    return Result{.value = 0, .cycles = kCallCycles};
+  }
+  if (static_cast<int32_t>(length) <= 0) {
+    return Result{.value = destination, .cycles = kCallCycles};
+  }
+
+  for (uint32_t i = 0; i < length; i++) {
+    bus.Store8(destination + i, bus.Load8(source + i));
+  }
+  return Result{.value = destination,
+                .written_address = destination,
+                .written_size = length,
+                .cycles = GetCycles(length)};
+}
+
+hle::Result hle::Hle::Memset(const Call& call, bus::Bus& bus) {
+  const auto [destination, fill, length, unused] = call.arguments;
+  if (destination == 0 || static_cast<int32_t>(length) <= 0) {
+    return Result{.value = 0, .cycles = kCallCycles};
+  }
+
+  for (uint32_t i = 0; i < length; i++) {
+    bus.Store8(destination + i, static_cast<uint8_t>(fill));
+  }
+  return Result{.value = destination,
+                .written_address = destination,
+                .written_size = length,
+                .cycles = GetCycles(length)};
+}
+
+hle::Result hle::Hle::Strlen(const Call& call, bus::Bus& bus) {
+  const uint32_t source = call.arguments[0];
+  if (source == 0) {
+    return Result{.value = 0, .cycles = kCallCycles};
+  }
+
+  const auto length = static_cast<uint32_t>(ReadString(bus, source).size());
+  return Result{.value = length, .cycles = GetCycles(length)};
+}
+
+hle::Result hle::Hle::Strcmp(const Call& call, bus::Bus& bus) {
+  const auto [first, second, unused_0, unused_1] = call.arguments;
+  if (first == 0 || second == 0) {
+    const int32_t value = first == second ? 0 : (first == 0 ? -1 : 1);
+    return Result{.value = static_cast<uint32_t>(value),
+                  .cycles = kCallCycles};
+  }
+
+  for (uint32_t i = 0; i < kMaxStringLength; i++) {
+    const uint8_t left = bus.Load8(first + i);
+    const uint8_t right = bus.Load8(second + i);
+    if (left != right || left == 0) {
+      return Result{.value = static_cast<uint32_t>(left - right),
+                    .cycles = GetCycles(i)};
+    }
+  }
+  return Result{.value = 0, .cycles = GetCycles(kMaxStringLength)};
+}
+
+hle::Result hle::Hle::Strcpy(const Call& call, bus::Bus& bus) {
+  const auto [destination, source, unused_0, unused_1] = call.arguments;
+  if (destination == 0 || source == 0) {
+    return Result{.value = 0, .cycles = kCallCycles};
+  }
+
+  const std::string text = ReadString(bus, source);
+  const auto size = static_cast<uint32_t>(text.size() + 1);
+  for (uint32_t i = 0; i < size; i++) {
+    bus.Store8(destination + i, i < text.size()
+                                    ? static_cast<uint8_t>(text[i])
+                                    : 0);
+  }
+  return Result{.value = destination,
+                .written_address = destination,
+                .written_size = size,
+                .cycles = GetCycles(size)};
+}
+
+hle::Result hle::Hle::Puts(const Call& call, bus::Bus& bus) {
+  const uint32_t source = call.arguments[0];
+  const std::string text =
+      source == 0 ? std::string("<NULL>") : ReadString(bus, source);
+  for (const char character : text) {
+    PutChar(character);
+  }
+  PutChar('\n');
+  return Result{.cycles = GetCycles(static_cast<uint32_t>(text.size()))};
+}
+
+hle::Result hle::Hle::Printf(const Call& call, bus::Bus& bus) {
+  const std::string format = ReadString(bus, call.arguments[0]);
+
+  // Variadic arguments follow the format in a1-a3, then on the stack past
+  // the 16 bytes the caller reserves for the register arguments.
+  uint32_t next_argument = 1;
+  const auto pop_argument = [&]() -> uint32_t {
+    const uint32_t index = next_argument++;
+    if (index < call.arguments.size()) {
+      return call.arguments.at(index);
+    }
+    return bus.Load32(call.stack_pointer + index * 4);
+  };
+  const auto parse_number = [&](size_t& i) {
+    if (i < format.size() && format[i] == '*') {
+      i++;
+      return std::min<size_t>(pop_argument(), kMaxStringLength);
+    }
+    size_t number = 0;
+    for (; i < format.size() && format[i] >= '0' && format[i] <= '9'; i++) {
+      number = std::min<size_t>(
+          number * 10 + static_cast<size_t>(format[i] - '0'),
+          kMaxStringLength);
+    }
+    return number;
+  };
+
+  std::string output;
+  for (size_t i = 0; i < format.size(); i++) {
+    if (format[i] != '%') {
+      output += format[i];
+      continue;
+    }
+
+    Conversion conversion;
+    for (i++; i < format.size(); i++) {
+      if (format[i] == '-') {
+        conversion.left_align = true;
+      } else if (format[i] == '0') {
+        conversion.zero_pad = true;
+      } else if (format[i] == '#') {
+        conversion.alternate = true;
+      } else if (format[i] == '+' || format[i] == ' ') {
+        conversion.sign = conversion.sign == '+' ? '+' : format[i];
+      } else {
+        break;
+      }
+    }
+    conversion.width = parse_number(i);
+    if (i < format.size() && format[i] == '.') {
+      i++;
+      conversion.precision = parse_number(i);
+    }
+    // Every integer is 32 bits wide, length modifiers change nothing.
+    while (i < format.size() &&
+           (format[i] == 'l' || format[i] == 'h' || format[i] == 'z')) {
+      i++;
+    }
+    if (i >= format.size()) {
+      break;
+    }
+
+    switch (const char type = format[i]) {
+      case 'd':
+      case 'i': {
+        const auto value = static_cast<int32_t>(pop_argument());
+        const char sign = value < 0 ? '-' : conversion.sign;
+        output += FormatNumber(
+            conversion, sign == '\0' ? "" : std::string(1, sign),
+            std::to_string(std::abs(static_cast<int64_t>(value))));
+        break;
+      }
+      case 'u':
+        output += FormatNumber(conversion, "", std::to_string(pop_argument()));
+        break;
+      case 'x':
+      case 'X': {
+        const uint32_t value = pop_argument();
+        const bool upper = type == 'X';
+        const std::string prefix = upper ? "0X" : "0x";
+        output += FormatNumber(
+            conversion, conversion.alternate && value != 0 ? prefix : "",
+            upper ? std::format("{:X}", value) : std::format("{:x}", value));
+        break;
+      }
+      case 'o': {
+        std::string digits = std::format("{:o}", pop_argument());
+        if (conversion.alternate && digits.front() != '0') {
+          digits.insert(digits.begin(), '0');
+        }
+        output += FormatNumber(conversion, "", digits);
+        break;
+      }
+      case 'p':
+        output += std::format("{:08x}", pop_argument());
+        break;
+      case 'c':
+        output += Pad(conversion,
+                      std::string(1, static_cast<char>(pop_argument())));
+        break;
+      case 's': {
+        std::string text = ReadString(bus, pop_argument());
+        if (conversion.precision.has_value()) {
+          text.resize(std::min(text.size(), conversion.precision.value()));
+        }
+        output += Pad(conversion, text);
+        break;
+      }
+      default:
+        output += type;
+    }
+  }
+
+  for (const char character : output) {
+    PutChar(character);
+  }
+  return Result{.cycles = GetCycles(static_cast<uint32_t>(output.size()))};
+}
@@ -0,0 +1,78 @@
+#ifndef POLYSTATION_HLE_H
+#define POLYSTATION_HLE_H
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "bus.h"
+
+namespace hle {
+// Kernel calls jump to one of these vectors with the function number in t1.
+constexpr uint32_t kTableA = 0xA0;
+constexpr uint32_t kTableB = 0xB0;
+constexpr uint32_t kTableC = 0xC0;
+
+enum class Mode : uint8_t {
+  kOff,
+  kOn,
+  // Runs every call natively, then again through the BIOS, and reports any
+  // difference in the return value or the memory written.
+  kVerify
+};
+
+// Returns the table (kTableA/B/C) when `address` is one of the vectors.
+[[nodiscard]] std::optional<uint32_t> GetTable(uint32_t address);
+[[nodiscard]] bool IsImplemented(uint32_t table, uint32_t function);
+
+struct Call {
+  uint32_t table = 0;
+  uint32_t function = 0;
+  std::array<uint32_t, 4> arguments{};
+  uint32_t stack_pointer = 0;
+} __attribute__((aligned(32)));
+
+struct Result {
+  // Unset for calls whose return value is undefined, v0 is then left alone.
+  std::optional<uint32_t> value = std::nullopt;
+  // Guest memory written by the call, compared in verify mode.
+  uint32_t written_address = 0;
+  uint32_t written_size = 0;
+  // Rough cost of the BIOS routine, so timing stays in the right ballpark.
+  uint64_t cycles = 0;
+} __attribute__((aligned(32)));
+
+struct Stats {
+  unsigned long long calls = 0;
+  unsigned long long verified = 0;
+  unsigned long long mismatches = 0;
+} __attribute__((aligned(32)));
+
+class Hle {
+ public:
+  void SetMode(Mode mode);
+  [[nodiscard]] Mode GetMode() const;
+  [[nodiscard]] const Stats& GetStats() const;
+  Stats& GetStats();
+
+  // Runs an implemented call against `bus`, see IsImplemented.
+  Result Execute(const Call& call, bus::Bus& bus);
+
+ private:
+  Mode mode_ = Mode::kOff;
+  Stats stats_;
+  std::string tty_line_;
+
+  void PutChar(char character);
+
+  static Result Memcpy(const Call& call, bus::Bus& bus);
+  static Result Memset(const Call& call, bus::Bus& bus);
+  static Result Strlen(const Call& call, bus::Bus& bus);
+  static Result Strcmp(const Call& call, bus::Bus& bus);
+  static Result Strcpy(const Call& call, bus::Bus& bus);
+  Result Puts(const Call& call, bus::Bus& bus);
+  Result Printf(const Call& call, bus::Bus& bus);
+};
+}  // namespace hle
+
+#endif  // POLYSTATION_HLE_H
@@ -0,0 +1,81 @@
+#include "icache.h"
+
+#include <gsl/util>
+
+namespace {
+constexpr uint32_t kStateTag = savestate::MakeTag("ICAC");
+constexpr uint32_t kStateVersion = 1;
+
+uint32_t GetTag(const uint32_t address) { return address & 0x7FFFF000U; }
+
+uint32_t GetLineIndex(const uint32_t address) {
+  return (address >> 4U) % icache::kLineCount;
+}
+
+uint32_t GetWordIndex(const uint32_t address) {
+  return (address >> 2U) % icache::kWordsPerLine;
+}
+}  // namespace
+
+std::optional<uint32_t> icache::InstructionCache::Lookup(
+    const uint32_t address) const {
+  const Line& line = gsl::at(lines_, GetLineIndex(address));
+  const uint32_t word = GetWordIndex(address);
+
+  if (line.tag != GetTag(address) || (line.valid & (1U << word)) == 0U) {
+    return std::nullopt;
+  }
+  return gsl::at(line.words, word);
+}
+
+void icache::InstructionCache::Fill(const uint32_t address,
+                                    const uint32_t value) {
+  Line& line = gsl::at(lines_, GetLineIndex(address));
+  const uint32_t word = GetWordIndex(address);
+
+  if (line.tag != GetTag(address)) {
+    line.tag = GetTag(address);
+    line.valid = 0;
+  }
+  line.valid |= 1U << word;
+  gsl::at(line.words, word) = value;
+}
+
+void icache::InstructionCache::Invalidate(const uint32_t address) {
+  gsl::at(lines_, GetLineIndex(address)).valid = 0;
+  stats_.invalidations++;
+}
+
+void icache::InstructionCache::Reset() { lines_.fill(Line()); }
+
+const icache::Stats& icache::InstructionCache::GetStats() const {
+  return stats_;
+}
+
+icache::Stats& icache::InstructionCache::GetStats() { return stats_; }
+
+bool icache::InstructionCache::IsCacheable(const uint32_t address) {
+  // KUSEG and KSEG0 are cached, KSEG1 and KSEG2 are not.
+  return address < 0xA0000000U;
+}
+
+void icache::InstructionCache::Save(savestate::Writer& writer) const {
+  // Field by field, the padding inside a line is not state.
+  writer.BeginSection(kStateTag, kStateVersion);
+  for (const Line& line : lines_) {
+    writer.Write(line.tag);
+    writer.Write(line.valid);
+    writer.Write(line.words);
+  }
+  writer.EndSection();
+}
+
+void icache::InstructionCache::Load(savestate::Reader& reader) {
+  reader.BeginSection(kStateTag, kStateVersion);
+  for (Line& line : lines_) {
+    reader.Read(line.tag);
+    reader.Read(line.valid);
+    reader.Read(line.words);
+  }
+  reader.EndSection();
+}
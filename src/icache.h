@@ -0,0 +1,50 @@
+#ifndef POLYSTATION_ICACHE_H
+#define POLYSTATION_ICACHE_H
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "savestate.h"
+
+namespace icache {
+constexpr uint32_t kLineCount = 256;
+constexpr uint32_t kWordsPerLine = 4;
+constexpr uint32_t kLineSize = kWordsPerLine * 4;
+
+struct Line {
+  uint32_t tag = 0;
+  // One valid bit per word, lines are filled from the missed word onwards.
+  uint8_t valid = 0;
+  std::array<uint32_t, kWordsPerLine> words{};
+} __attribute__((aligned(32)));
+
+struct Stats {
+  // Lookups that went to memory, counted by the CPU as it refills.
+  unsigned long long misses = 0;
+  unsigned long long invalidations = 0;
+} __attribute__((aligned(16)));
+
+// Direct-mapped 4KB instruction cache of the R3000A.
+class InstructionCache {
+ public:
+  [[nodiscard]] std::optional<uint32_t> Lookup(uint32_t address) const;
+  void Fill(uint32_t address, uint32_t value);
+  void Invalidate(uint32_t address);
+  // Clears the lines, the stats are host-side and carry on.
+  void Reset();
+
+  [[nodiscard]] const Stats& GetStats() const;
+  Stats& GetStats();
+
+  void Save(savestate::Writer& writer) const;
+  void Load(savestate::Reader& reader);
+
+  [[nodiscard]] static bool IsCacheable(uint32_t address);
+
+ private:
+  std::array<Line, kLineCount> lines_{};
+  Stats stats_;
+};
+}  // namespace icache
+
+#endif  // POLYSTATION_ICACHE_H
@@ -0,0 +1,121 @@
+#include "idle_loop.h"
+
+#include "isa.h"
+
+namespace {
+// Anything that can write memory, trap, write HI/LO or talk to a
+// coprocessor makes a loop observable from outside the CPU.
+constexpr uint8_t kImpureFlags =
+    isa::kStore | isa::kTrap | isa::kHiLo | isa::kCoprocessor;
+}  // namespace
+
+void idle_loop::Detector::SetEnabled(const bool enabled) {
+  enabled_ = enabled;
+  Reset();
+}
+
+bool idle_loop::Detector::IsEnabled() const { return enabled_; }
+
+void idle_loop::Detector::Reset() {
+  head_ = kNoLoop;
+  tail_ = kNoLoop;
+  pure_ = false;
+  back_edge_taken_ = false;
+  has_state_ = false;
+  idle_ = false;
+}
+
+bool idle_loop::Detector::IsCandidate(const uint32_t head,
+                                      const uint32_t tail) const {
+  return head == head_ && tail == tail_;
+}
+
+void idle_loop::Detector::SetCandidate(const uint32_t head,
+                                       const uint32_t tail,
+                                       const std::span<const uint32_t> body) {
+  Reset();
+  head_ = head;
+  tail_ = tail;
+  pure_ = IsPure(body);
+}
+
+void idle_loop::Detector::OnBackEdge() { back_edge_taken_ = pure_; }
+
+uint32_t idle_loop::Detector::GetHead() const {
+  return pure_ ? head_ : kNoLoop;
+}
+
+void idle_loop::Detector::OnLoopHead(const LoopState& state) {
+  // Reaching the head any other way than the back-edge starts over.
+  if (!back_edge_taken_) {
+    has_state_ = false;
+    return;
+  }
+  back_edge_taken_ = false;
+
+  if (has_state_ && state == state_) {
+    idle_ = true;
+    return;
+  }
+  state_ = state;
+  has_state_ = true;
+}
+
+bool idle_loop::Detector::IsIdle() const { return idle_; }
+
+void idle_loop::Detector::Skip(const uint64_t cycles) {
+  idle_ = false;
+  stats_.loops_skipped++;
+  stats_.cycles_skipped += cycles;
+}
+
+const idle_loop::Stats& idle_loop::Detector::GetStats() const {
+  return stats_;
+}
+
+bool idle_loop::Detector::IsPure(const std::span<const uint32_t> body) const {
+  if (body.size() > kMaxLoopInstructions) {
+    return false;
+  }
+
+  for (size_t i = 0; i < body.size(); i++) {
+    const uint32_t word = body[i];
+    const isa::Spec& spec = isa::GetSpec(isa::Decode(word));
+    const uint32_t address = head_ + static_cast<uint32_t>(i) * 4;
+
+    if (spec.operation == isa::Operation::kIllegal) {
+      return false;
+    }
+
+    if ((spec.flags & isa::kBranch) == 0U) {
+      if ((spec.flags & kImpureFlags) != 0U) {
+        return false;
+      }
+      continue;
+    }
+
+    if ((spec.flags & isa::kLink) != 0U) {
+      return false;
+    }
+
+    if (spec.format == isa::Format::kBranch ||
+        spec.format == isa::Format::kBranchZero) {
+      // Branches may only stay inside the body.
+      const auto offset = static_cast<uint32_t>(
+          static_cast<int32_t>(static_cast<int16_t>(word & 0xFFFFU)) * 4);
+      const uint32_t target = address + 4 + offset;
+      if (target < head_ || target > tail_) {
+        return false;
+      }
+    } else if (spec.format == isa::Format::kJump) {
+      const uint32_t target =
+          ((address + 4) & 0xF0000000U) | ((word & 0x3FFFFFFU) << 2U);
+      if (target != head_) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,68 @@
+#ifndef POLYSTATION_IDLE_LOOP_H
+#define POLYSTATION_IDLE_LOOP_H
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace idle_loop {
+// Longest loop body considered, counting the back-edge's delay slot.
+constexpr uint32_t kMaxLoopInstructions = 16;
+constexpr uint32_t kNoLoop = 1;
+
+// Everything a side-effect free loop body can depend on besides memory.
+struct LoopState {
+  std::array<uint32_t, 32> registers{};
+  uint32_t pending_load_index = 0;
+  uint32_t pending_load_value = 0;
+
+  bool operator==(const LoopState& other) const = default;
+} __attribute__((aligned(128)));
+
+struct Stats {
+  unsigned long long loops_skipped = 0;
+  uint64_t cycles_skipped = 0;
+} __attribute__((aligned(16)));
+
+// Spots polling loops that can never exit on their own. A loop qualifies
+// when its body only loads, computes and branches within itself, and it
+// reaches its head twice in a row with the same registers. Nothing writes
+// memory behind the CPU's back, so from there on every iteration is the
+// same and the time until the next event can be skipped outright.
+class Detector {
+ public:
+  void SetEnabled(bool enabled);
+  [[nodiscard]] bool IsEnabled() const;
+  void Reset();
+
+  [[nodiscard]] bool IsCandidate(uint32_t head, uint32_t tail) const;
+  // `body` holds the instructions from `head` to the delay slot of the
+  // backward branch at `tail`.
+  void SetCandidate(uint32_t head, uint32_t tail,
+                    std::span<const uint32_t> body);
+  void OnBackEdge();
+
+  // kNoLoop unless a side-effect free loop is being watched.
+  [[nodiscard]] uint32_t GetHead() const;
+  void OnLoopHead(const LoopState& state);
+
+  [[nodiscard]] bool IsIdle() const;
+  void Skip(uint64_t cycles);
+
+  [[nodiscard]] const Stats& GetStats() const;
+
+ private:
+  bool enabled_ = false;
+  uint32_t head_ = kNoLoop;
+  uint32_t tail_ = kNoLoop;
+  bool pure_ = false;
+  bool back_edge_taken_ = false;
+  bool has_state_ = false;
+  bool idle_ = false;
+  LoopState state_;
+  Stats stats_;
+
+  [[nodiscard]] bool IsPure(std::span<const uint32_t> body) const;
+};
+}  // namespace idle_loop
+
+#endif  // POLYSTATION_IDLE_LOOP_H
@@ -0,0 +1,787 @@
+#include "ir.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <gsl/gsl>
+#include <utility>
+
+#include "bus.h"
+#include "isa.h"
+
+namespace {
+constexpr uint32_t kInstructionLength = 4;
+constexpr uint32_t kRegisterCount = 32;
+constexpr uint8_t kReturnAddress = 31;
+
+constexpr auto kOpcodeNames = std::to_array<std::string_view>({
+    "instruction", "const", "get",   "set",   "add",    "sub",
+    "and",         "or",    "xor",   "nor",   "sll",    "srl",
+    "sra",         "slt",   "sltu",  "addc",  "subc",   "load",
+    "loadl",       "loadr", "store", "storel", "storer", "branch",
+    "jump",        "jumpr", "interpret",
+});
+static_assert(kOpcodeNames.size() ==
+              static_cast<size_t>(ir::Opcode::kInterpret) + 1);
+
+constexpr auto kAccessNames =
+    std::to_array<std::string_view>({"b", "bu", "h", "hu", "w"});
+constexpr auto kConditionNames = std::to_array<std::string_view>(
+    {"eq", "ne", "lez", "gtz", "ltz", "gez"});
+constexpr auto kAddressNames = std::to_array<std::string_view>(
+    {"", " ram", " scratchpad", " bios", " io"});
+
+constexpr uint8_t GetS(const uint32_t word) { return (word >> 21U) & 0x1FU; }
+
+constexpr uint8_t GetT(const uint32_t word) { return (word >> 16U) & 0x1FU; }
+
+constexpr uint8_t GetD(const uint32_t word) { return (word >> 11U) & 0x1FU; }
+
+constexpr bool IsArithmetic(const ir::Opcode opcode) {
+  return opcode >= ir::Opcode::kAdd && opcode <= ir::Opcode::kLessUnsigned;
+}
+
+constexpr bool IsChecked(const ir::Opcode opcode) {
+  return opcode == ir::Opcode::kAddChecked ||
+         opcode == ir::Opcode::kSubChecked;
+}
+
+constexpr bool IsLoad(const ir::Opcode opcode) {
+  return opcode >= ir::Opcode::kLoad && opcode <= ir::Opcode::kLoadRight;
+}
+
+constexpr bool IsStore(const ir::Opcode opcode) {
+  return opcode >= ir::Opcode::kStore && opcode <= ir::Opcode::kStoreRight;
+}
+
+// Left to the interpreter through kInterpret, none of them can fault.
+constexpr bool IsInterpreted(const isa::Operation operation) {
+  switch (operation) {
+    case isa::Operation::kMFHI:
+    case isa::Operation::kMTHI:
+    case isa::Operation::kMFLO:
+    case isa::Operation::kMTLO:
+    case isa::Operation::kMULT:
+    case isa::Operation::kMULTU:
+    case isa::Operation::kDIV:
+    case isa::Operation::kDIVU:
+    case isa::Operation::kMTC2:
+    case isa::Operation::kCTC2:
+    case isa::Operation::kGTE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// The rest touch COP0 state, trap, or go through the load delay slot from
+// a coprocessor, and end the block before them.
+constexpr bool IsTranslatable(const isa::Operation operation) {
+  switch (operation) {
+    case isa::Operation::kIllegal:
+    case isa::Operation::kSYSCALL:
+    case isa::Operation::kBREAK:
+    case isa::Operation::kMFC0:
+    case isa::Operation::kMTC0:
+    case isa::Operation::kRFE:
+    case isa::Operation::kMFC2:
+    case isa::Operation::kCFC2:
+    case isa::Operation::kLWC2:
+    case isa::Operation::kSWC2:
+      return false;
+    default:
+      return true;
+  }
+}
+
+constexpr ir::Opcode GetArithmetic(const isa::Operation operation) {
+  switch (operation) {
+    case isa::Operation::kSLL:
+    case isa::Operation::kSLLV:
+      return ir::Opcode::kShiftLeft;
+    case isa::Operation::kSRL:
+    case isa::Operation::kSRLV:
+      return ir::Opcode::kShiftRight;
+    case isa::Operation::kSRA:
+    case isa::Operation::kSRAV:
+      return ir::Opcode::kShiftRightArithmetic;
+    case isa::Operation::kADD:
+    case isa::Operation::kADDI:
+      return ir::Opcode::kAddChecked;
+    case isa::Operation::kSUB:
+      return ir::Opcode::kSubChecked;
+    case isa::Operation::kSUBU:
+      return ir::Opcode::kSub;
+    case isa::Operation::kAND:
+    case isa::Operation::kANDI:
+      return ir::Opcode::kAnd;
+    case isa::Operation::kOR:
+    case isa::Operation::kORI:
+      return ir::Opcode::kOr;
+    case isa::Operation::kXOR:
+    case isa::Operation::kXORI:
+      return ir::Opcode::kXor;
+    case isa::Operation::kNOR:
+      return ir::Opcode::kNor;
+    case isa::Operation::kSLT:
+    case isa::Operation::kSLTI:
+      return ir::Opcode::kLess;
+    case isa::Operation::kSLTU:
+    case isa::Operation::kSLTIU:
+      return ir::Opcode::kLessUnsigned;
+    default:
+      return ir::Opcode::kAdd;
+  }
+}
+
+constexpr ir::Access GetAccess(const isa::Operation operation) {
+  switch (operation) {
+    case isa::Operation::kLB:
+    case isa::Operation::kSB:
+      return ir::Access::kByte;
+    case isa::Operation::kLBU:
+      return ir::Access::kByteUnsigned;
+    case isa::Operation::kLH:
+    case isa::Operation::kSH:
+      return ir::Access::kHalf;
+    case isa::Operation::kLHU:
+      return ir::Access::kHalfUnsigned;
+    default:
+      return ir::Access::kWord;
+  }
+}
+
+constexpr uint32_t GetAccessSize(const ir::Access access) {
+  switch (access) {
+    case ir::Access::kByte:
+    case ir::Access::kByteUnsigned:
+      return 1;
+    case ir::Access::kHalf:
+    case ir::Access::kHalfUnsigned:
+      return 2;
+    case ir::Access::kWord:
+      return 4;
+  }
+  return 4;
+}
+
+ir::Address GetRegion(const uint32_t address) {
+  if (bus::GetScratchpadOffset(address).has_value()) {
+    return ir::Address::kScratchpad;
+  }
+  const std::optional<bus::MemoryRegion> region =
+      bus::GetMemoryRegionByAddress(bus::MaskRegion(address));
+  if (!region.has_value()) {
+    return ir::Address::kUnknown;
+  }
+  switch (region.value()) {
+    case bus::MemoryRegion::kRam:
+      return ir::Address::kRam;
+    case bus::MemoryRegion::kBios:
+      return ir::Address::kBios;
+    default:
+      return ir::Address::kIo;
+  }
+}
+
+std::optional<uint32_t> GetConstant(const ir::Block& block,
+                                    const ir::Value value) {
+  if (value == ir::kNoValue) {
+    return std::nullopt;
+  }
+  const ir::Op& op = gsl::at(block.ops, value);
+  if (op.opcode != ir::Opcode::kConstant) {
+    return std::nullopt;
+  }
+  return op.immediate;
+}
+
+// The operand an arithmetic op passes through unchanged, if any.
+std::optional<ir::Value> GetIdentity(const ir::Op& op,
+                                     const std::optional<uint32_t> a,
+                                     const std::optional<uint32_t> b) {
+  const bool a_zero = a.has_value() && a.value() == 0;
+  const bool b_zero = b.has_value() && b.value() == 0;
+  switch (op.opcode) {
+    case ir::Opcode::kAdd:
+    case ir::Opcode::kOr:
+    case ir::Opcode::kXor:
+    case ir::Opcode::kAddChecked:
+      if (a_zero) {
+        return op.b;
+      }
+      [[fallthrough]];
+    case ir::Opcode::kSub:
+    case ir::Opcode::kShiftLeft:
+    case ir::Opcode::kShiftRight:
+    case ir::Opcode::kShiftRightArithmetic:
+    case ir::Opcode::kSubChecked:
+      if (b_zero) {
+        return op.a;
+      }
+      return std::nullopt;
+    default:
+      return std::nullopt;
+  }
+}
+
+// Loads from memory without side effects can go when unused.
+bool HasSideEffects(const ir::Op& op) {
+  switch (op.opcode) {
+    case ir::Opcode::kInstruction:
+    case ir::Opcode::kAddChecked:
+    case ir::Opcode::kSubChecked:
+    case ir::Opcode::kStore:
+    case ir::Opcode::kStoreLeft:
+    case ir::Opcode::kStoreRight:
+    case ir::Opcode::kBranch:
+    case ir::Opcode::kJump:
+    case ir::Opcode::kJumpRegister:
+    case ir::Opcode::kInterpret:
+      return true;
+    case ir::Opcode::kLoad:
+    case ir::Opcode::kLoadLeft:
+    case ir::Opcode::kLoadRight:
+      return op.address == ir::Address::kUnknown ||
+             op.address == ir::Address::kIo;
+    default:
+      return false;
+  }
+}
+
+ir::Value Remap(const std::span<const ir::Value> values,
+                const ir::Value value) {
+  return value == ir::kNoValue ? value : gsl::at(values, value);
+}
+
+class Builder {
+ public:
+  explicit Builder(const uint32_t start) {
+    block_.start = start;
+    registers_.fill(ir::kNoValue);
+  }
+
+  // Returns false with the block untouched when `word` has to be left to
+  // the interpreter.
+  [[nodiscard]] bool Add(uint32_t word);
+  // Past the delay slot of a branch.
+  [[nodiscard]] bool IsComplete() const { return complete_; }
+  [[nodiscard]] ir::Block Finish();
+
+ private:
+  ir::Block block_;
+  // The value each register holds for the next instruction to read,
+  // kNoValue until it is first read or written.
+  std::array<ir::Value, kRegisterCount> registers_{};
+  // The load in flight, it lands once the next instruction read its
+  // operands.
+  uint8_t pending_register_ = 0;
+  ir::Value pending_value_ = ir::kNoValue;
+  bool delay_slot_ = false;
+  bool complete_ = false;
+
+  ir::Value Emit(const ir::Op& op);
+  ir::Value Constant(uint32_t value);
+  ir::Value Compute(ir::Opcode opcode, ir::Value a, ir::Value b);
+  ir::Value Read(uint8_t index);
+  void Write(uint8_t index, ir::Value value);
+  void Land();
+  void Defer(uint8_t index, ir::Value value);
+  void AddArithmetic(isa::Operation operation, uint32_t word);
+  void AddMemory(isa::Operation operation, uint32_t word);
+  void AddBranch(isa::Operation operation, uint32_t word, uint32_t pc);
+  void AddInterpreted(isa::Operation operation, uint32_t word);
+};
+
+bool Builder::Add(const uint32_t word) {
+  const isa::Operation operation = isa::Decode(word);
+  const bool branch = (isa::GetSpec(operation).flags & isa::kBranch) != 0U;
+  if (!IsTranslatable(operation) || (branch && delay_slot_)) {
+    return false;
+  }
+
+  const auto index = static_cast<uint8_t>(block_.code.size());
+  const uint32_t pc = block_.start + index * kInstructionLength;
+  Emit(ir::Op{.opcode = ir::Opcode::kInstruction,
+              .index = index,
+              .immediate = pc});
+  block_.code.push_back(word);
+
+  if (branch) {
+    AddBranch(operation, word, pc);
+  } else if (IsInterpreted(operation)) {
+    AddInterpreted(operation, word);
+  } else if ((isa::GetSpec(operation).flags & (isa::kLoad | isa::kStore)) !=
+             0U) {
+    AddMemory(operation, word);
+  } else {
+    AddArithmetic(operation, word);
+  }
+
+  complete_ = delay_slot_;
+  delay_slot_ = branch;
+  return true;
+}
+
+ir::Block Builder::Finish() {
+  block_.delay_slot_pending = delay_slot_;
+  block_.pending_register = pending_register_;
+  block_.pending_value = pending_value_;
+  return std::move(block_);
+}
+
+ir::Value Builder::Emit(const ir::Op& op) {
+  block_.ops.push_back(op);
+  return static_cast<ir::Value>(block_.ops.size() - 1);
+}
+
+ir::Value Builder::Constant(const uint32_t value) {
+  return Emit(ir::Op{.opcode = ir::Opcode::kConstant, .immediate = value});
+}
+
+ir::Value Builder::Compute(const ir::Opcode opcode, const ir::Value a,
+                           const ir::Value b) {
+  return Emit(ir::Op{.opcode = opcode, .a = a, .b = b});
+}
+
+ir::Value Builder::Read(const uint8_t index) {
+  ir::Value& value = gsl::at(registers_, index);
+  if (value == ir::kNoValue) {
+    value = index == 0 ? Constant(0)
+                       : Emit(ir::Op{.opcode = ir::Opcode::kGetRegister,
+                                     .index = index});
+  }
+  return value;
+}
+
+void Builder::Write(const uint8_t index, const ir::Value value) {
+  if (index == 0) {
+    return;
+  }
+  Emit(ir::Op{
+      .opcode = ir::Opcode::kSetRegister, .index = index, .a = value});
+  gsl::at(registers_, index) = value;
+}
+
+void Builder::Land() {
+  Write(std::exchange(pending_register_, 0),
+        std::exchange(pending_value_, ir::kNoValue));
+}
+
+void Builder::Defer(const uint8_t index, const ir::Value value) {
+  pending_register_ = index;
+  pending_value_ = value;
+}
+
+void Builder::AddArithmetic(const isa::Operation operation,
+                            const uint32_t word) {
+  const uint8_t s = GetS(word);
+  const uint8_t t = GetT(word);
+  const uint8_t d = GetD(word);
+  const uint32_t immediate = word & 0xFFFFU;
+  const auto signed_immediate =
+      static_cast<uint32_t>(static_cast<int16_t>(immediate));
+
+  switch (operation) {
+    case isa::Operation::kSLL:
+    case isa::Operation::kSRL:
+    case isa::Operation::kSRA: {
+      const ir::Value value = Read(t);
+      Land();
+      Write(d, Compute(GetArithmetic(operation), value,
+                       Constant((word >> 6U) & 0x1FU)));
+      break;
+    }
+    case isa::Operation::kSLLV:
+    case isa::Operation::kSRLV:
+    case isa::Operation::kSRAV: {
+      const ir::Value value = Read(t);
+      const ir::Value amount = Read(s);
+      Land();
+      Write(d, Compute(GetArithmetic(operation), value, amount));
+      break;
+    }
+    case isa::Operation::kADDI:
+    case isa::Operation::kADDIU:
+    case isa::Operation::kSLTI:
+    case isa::Operation::kSLTIU: {
+      const ir::Value value = Read(s);
+      Land();
+      Write(t, Compute(GetArithmetic(operation), value,
+                       Constant(signed_immediate)));
+      break;
+    }
+    case isa::Operation::kANDI:
+    case isa::Operation::kORI:
+    case isa::Operation::kXORI: {
+      const ir::Value value = Read(s);
+      Land();
+      Write(t,
+            Compute(GetArithmetic(operation), value, Constant(immediate)));
+      break;
+    }
+    case isa::Operation::kLUI:
+      Land();
+      Write(t, Constant(immediate << 16U));
+      break;
+    default: {
+      const ir::Value a = Read(s);
+      const ir::Value b = Read(t);
+      Land();
+      Write(d, Compute(GetArithmetic(operation), a, b));
+      break;
+    }
+  }
+}
+
+void Builder::AddMemory(const isa::Operation operation, const uint32_t word) {
+  const uint8_t t = GetT(word);
+  const ir::Value base = Read(GetS(word));
+  const bool store = (isa::GetSpec(operation).flags & isa::kStore) != 0U;
+  const ir::Value value = store ? Read(t) : ir::kNoValue;
+  Land();
+
+  const auto offset = static_cast<uint32_t>(static_cast<int16_t>(word));
+  ir::Op op{.access = GetAccess(operation),
+            .a = Compute(ir::Opcode::kAdd, base, Constant(offset)),
+            .b = value};
+  switch (operation) {
+    case isa::Operation::kLWL:
+    case isa::Operation::kLWR:
+      // Merges into the register as the landed load left it.
+      op.opcode = operation == isa::Operation::kLWL ? ir::Opcode::kLoadLeft
+                                                    : ir::Opcode::kLoadRight;
+      op.b = Read(t);
+      Defer(t, Emit(op));
+      break;
+    case isa::Operation::kSWL:
+      op.opcode = ir::Opcode::kStoreLeft;
+      Emit(op);
+      break;
+    case isa::Operation::kSWR:
+      op.opcode = ir::Opcode::kStoreRight;
+      Emit(op);
+      break;
+    default:
+      op.opcode = store ? ir::Opcode::kStore : ir::Opcode::kLoad;
+      if (store) {
+        Emit(op);
+      } else {
+        Defer(t, Emit(op));
+      }
+      break;
+  }
+}
+
+void Builder::AddBranch(const isa::Operation operation, const uint32_t word,
+                        const uint32_t pc) {
+  // Relative to the delay slot, like the interpreter sees it.
+  const uint32_t link = pc + 2 * kInstructionLength;
+  const uint32_t target =
+      pc + kInstructionLength +
+      (static_cast<uint32_t>(static_cast<int16_t>(word)) << 2U);
+  const uint8_t s = GetS(word);
+
+  ir::Op op{.opcode = ir::Opcode::kBranch, .immediate = target};
+  switch (operation) {
+    case isa::Operation::kJ:
+    case isa::Operation::kJAL:
+      Land();
+      op.opcode = ir::Opcode::kJump;
+      op.immediate = (link & 0xF0000000U) | ((word & 0x3FFFFFFU) << 2U);
+      if (operation == isa::Operation::kJAL) {
+        Write(kReturnAddress, Constant(link));
+      }
+      break;
+    case isa::Operation::kJR:
+    case isa::Operation::kJALR:
+      op.opcode = ir::Opcode::kJumpRegister;
+      op.a = Read(s);
+      Land();
+      if (operation == isa::Operation::kJALR) {
+        Write(GetD(word), Constant(link));
+      }
+      break;
+    case isa::Operation::kBEQ:
+    case isa::Operation::kBNE:
+      op.condition = operation == isa::Operation::kBEQ
+                         ? ir::Condition::kEqual
+                         : ir::Condition::kNotEqual;
+      op.a = Read(s);
+      op.b = Read(GetT(word));
+      Land();
+      break;
+    case isa::Operation::kBLEZ:
+      op.condition = ir::Condition::kLessOrEqualZero;
+      op.a = Read(s);
+      Land();
+      break;
+    case isa::Operation::kBGTZ:
+      op.condition = ir::Condition::kGreaterThanZero;
+      op.a = Read(s);
+      Land();
+      break;
+    default:
+      // BLTZ, BGEZ and the linking BLTZAL and BGEZAL, which write the
+      // return address whether or not they branch.
+      op.condition = operation == isa::Operation::kBLTZ ||
+                             operation == isa::Operation::kBLTZAL
+                         ? ir::Condition::kLessThanZero
+                         : ir::Condition::kGreaterOrEqualZero;
+      op.a = Read(s);
+      Land();
+      if (operation == isa::Operation::kBLTZAL ||
+          operation == isa::Operation::kBGEZAL) {
+        Write(kReturnAddress, Constant(link));
+      }
+      break;
+  }
+  block_.next = Emit(op);
+}
+
+void Builder::AddInterpreted(const isa::Operation operation,
+                             const uint32_t word) {
+  Emit(ir::Op{.opcode = ir::Opcode::kInterpret,
+              .index = static_cast<uint8_t>(block_.code.size() - 1),
+              .immediate = word});
+
+  // The interpreter reads registers before the load in flight lands, and
+  // writes them after.
+  if (operation == isa::Operation::kMFHI ||
+      operation == isa::Operation::kMFLO) {
+    const uint8_t d = GetD(word);
+    gsl::at(registers_, d) = ir::kNoValue;
+    if (pending_register_ == d) {
+      pending_register_ = 0;
+      pending_value_ = ir::kNoValue;
+    }
+  }
+  Land();
+}
+}  // namespace
+
+ir::Block ir::Translate(const uint32_t start,
+                        const std::span<const uint32_t> code) {
+  Builder builder(start);
+  for (const uint32_t word :
+       code.first(std::min(code.size(), kMaxInstructions))) {
+    if (builder.IsComplete() || !builder.Add(word)) {
+      break;
+    }
+  }
+  return builder.Finish();
+}
+
+void ir::FoldConstants(Block& block) {
+  std::vector<Value> forward(block.ops.size());
+  for (size_t i = 0; i < block.ops.size(); i++) {
+    gsl::at(forward, i) = static_cast<Value>(i);
+    Op& op = gsl::at(block.ops, i);
+    op.a = Remap(forward, op.a);
+    op.b = Remap(forward, op.b);
+
+    const std::optional<uint32_t> a = GetConstant(block, op.a);
+    const std::optional<uint32_t> b = GetConstant(block, op.b);
+    if (!IsArithmetic(op.opcode) && !IsChecked(op.opcode)) {
+      continue;
+    }
+
+    if (a.has_value() && b.has_value()) {
+      // An overflowing ADD stays to raise its exception.
+      const std::optional<uint32_t> result =
+          IsChecked(op.opcode)
+              ? EvaluateChecked(op.opcode, a.value(), b.value())
+              : Evaluate(op.opcode, a.value(), b.value());
+      if (result.has_value()) {
+        op = Op{.opcode = Opcode::kConstant, .immediate = result.value()};
+      }
+    } else if (const std::optional<Value> same = GetIdentity(op, a, b)) {
+      gsl::at(forward, i) = same.value();
+    } else if (op.opcode == Opcode::kAnd &&
+               (a.value_or(1) == 0 || b.value_or(1) == 0)) {
+      op = Op{.opcode = Opcode::kConstant, .immediate = 0};
+    }
+  }
+
+  block.next = Remap(forward, block.next);
+  block.pending_value = Remap(forward, block.pending_value);
+}
+
+ir::Address ir::ClassifyAddress(const Block& block, const Op& op) {
+  if (!IsLoad(op.opcode) && !IsStore(op.opcode)) {
+    return Address::kUnknown;
+  }
+  const std::optional<uint32_t> constant = GetConstant(block, op.a);
+  if (!constant.has_value()) {
+    return Address::kUnknown;
+  }
+
+  // LWL/LWR/SWL/SWR access the aligned word around their address.
+  const bool partial =
+      op.opcode != Opcode::kLoad && op.opcode != Opcode::kStore;
+  const uint32_t address =
+      partial ? constant.value() & ~0x3U : constant.value();
+  if (address % GetAccessSize(op.access) != 0) {
+    return Address::kUnknown;
+  }
+
+  const Address region = GetRegion(address);
+  const uint32_t masked = bus::MaskRegion(address);
+  const uint32_t code_begin = bus::MaskRegion(block.start);
+  const auto code_end = static_cast<uint32_t>(
+      code_begin + block.code.size() * kInstructionLength);
+  if (IsStore(op.opcode) && region == Address::kRam &&
+      masked + kInstructionLength > code_begin && masked < code_end) {
+    return Address::kUnknown;
+  }
+  return region;
+}
+
+void ir::ClassifyAddresses(Block& block) {
+  for (Op& op : block.ops) {
+    op.address = ClassifyAddress(block, op);
+  }
+}
+
+bool ir::IsObservable(const Op& op) {
+  switch (op.opcode) {
+    case Opcode::kAddChecked:
+    case Opcode::kSubChecked:
+    case Opcode::kInterpret:
+      return true;
+    case Opcode::kLoad:
+    case Opcode::kLoadLeft:
+    case Opcode::kLoadRight:
+      return op.address == Address::kUnknown;
+    case Opcode::kStore:
+    case Opcode::kStoreLeft:
+    case Opcode::kStoreRight:
+      return op.address != Address::kRam &&
+             op.address != Address::kScratchpad;
+    default:
+      return false;
+  }
+}
+
+void ir::EliminateDeadCode(Block& block) {
+  const size_t size = block.ops.size();
+  std::vector<bool> live(size);
+
+  // Backwards, a register write is dead when the register is written
+  // again before anything observes it. The block's end observes all.
+  std::array<bool, kRegisterCount> overwritten{};
+  for (size_t i = size; i-- > 0;) {
+    const Op& op = gsl::at(block.ops, i);
+    if (IsObservable(op)) {
+      overwritten.fill(false);
+    } else if (op.opcode == Opcode::kSetRegister) {
+      gsl::at(live, i) = !gsl::at(overwritten, op.index);
+      gsl::at(overwritten, op.index) = true;
+    }
+  }
+
+  // Operands come before their users, so one more backward pass finds
+  // every value still needed.
+  for (size_t i = size; i-- > 0;) {
+    const Op& op = gsl::at(block.ops, i);
+    if (HasSideEffects(op) || i == block.next || i == block.pending_value) {
+      gsl::at(live, i) = true;
+    }
+    if (gsl::at(live, i)) {
+      if (op.a != kNoValue) {
+        gsl::at(live, op.a) = true;
+      }
+      if (op.b != kNoValue) {
+        gsl::at(live, op.b) = true;
+      }
+    }
+  }
+
+  std::vector<Value> renumber(size, kNoValue);
+  std::vector<Op> ops;
+  ops.reserve(size);
+  for (size_t i = 0; i < size; i++) {
+    if (!gsl::at(live, i)) {
+      continue;
+    }
+    gsl::at(renumber, i) = static_cast<Value>(ops.size());
+    Op op = gsl::at(block.ops, i);
+    op.a = Remap(renumber, op.a);
+    op.b = Remap(renumber, op.b);
+    ops.push_back(op);
+  }
+  block.ops = std::move(ops);
+  block.next = Remap(renumber, block.next);
+  block.pending_value = Remap(renumber, block.pending_value);
+}
+
+void ir::Optimize(Block& block) {
+  FoldConstants(block);
+  ClassifyAddresses(block);
+  EliminateDeadCode(block);
+}
+
+std::string ir::ToString(const Block& block) {
+  std::string text = std::format("block {:08X}\n", block.start);
+  for (size_t i = 0; i < block.ops.size(); i++) {
+    const Op& op = gsl::at(block.ops, i);
+    const std::string_view name =
+        gsl::at(kOpcodeNames, static_cast<size_t>(op.opcode));
+    switch (op.opcode) {
+      case Opcode::kInstruction:
+      case Opcode::kInterpret:
+        text += std::format(
+            "{:>4}  {} {:08X} {}\n", "", name,
+            block.start + op.index * kInstructionLength,
+            isa::Disassemble(gsl::at(block.code, op.index)));
+        break;
+      case Opcode::kConstant:
+        text += std::format("{:>4}= {} 0x{:X}\n", i, name, op.immediate);
+        break;
+      case Opcode::kGetRegister:
+        text += std::format("{:>4}= {} r{}\n", i, name, op.index);
+        break;
+      case Opcode::kSetRegister:
+        text += std::format("{:>4}  {} r{}, {}\n", "", name, op.index, op.a);
+        break;
+      case Opcode::kLoad:
+      case Opcode::kLoadLeft:
+      case Opcode::kLoadRight:
+      case Opcode::kStore:
+      case Opcode::kStoreLeft:
+      case Opcode::kStoreRight:
+        text += std::format(
+            "{:>4}= {}.{} [{}]{}", i, name,
+            gsl::at(kAccessNames, static_cast<size_t>(op.access)), op.a,
+            gsl::at(kAddressNames, static_cast<size_t>(op.address)));
+        text += op.b == kNoValue ? "\n" : std::format(", {}\n", op.b);
+        break;
+      case Opcode::kBranch:
+        text += std::format(
+            "{:>4}= {}.{} {}, {} -> {:08X}\n", i, name,
+            gsl::at(kConditionNames, static_cast<size_t>(op.condition)),
+            op.a, op.b == kNoValue ? "0" : std::format("{}", op.b),
+            op.immediate);
+        break;
+      case Opcode::kJump:
+        text += std::format("{:>4}= {} {:08X}\n", i, name, op.immediate);
+        break;
+      case Opcode::kJumpRegister:
+        text += std::format("{:>4}= {} {}\n", i, name, op.a);
+        break;
+      default:
+        text += std::format("{:>4}= {} {}, {}\n", i, name, op.a, op.b);
+        break;
+    }
+  }
+
+  if (block.next != kNoValue) {
+    text += std::format("next {}{}\n", block.next,
+                        block.delay_slot_pending ? ", delay slot pending" : "");
+  }
+  if (block.pending_value != kNoValue) {
+    text += std::format("pending r{} = {}\n", block.pending_register,
+                        block.pending_value);
+  }
+  return text;
+}
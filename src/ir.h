@@ -0,0 +1,224 @@
+#ifndef POLYSTATION_IR_H
+#define POLYSTATION_IR_H
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Basic blocks of guest code as a list of single-assignment ops, the input
+// of block-translating CPU backends. A block starts at any PC and runs to
+// the delay slot of its first branch, or up to the first instruction it
+// leaves to the interpreter.
+namespace ir {
+// Guest instructions in one block at most.
+constexpr size_t kMaxInstructions = 32;
+// Ops in one block at most, enough for the longest expansion of every
+// instruction.
+constexpr size_t kMaxOps = 16 * kMaxInstructions;
+
+// An op's result is named by the op's index in Block::ops.
+using Value = uint16_t;
+constexpr Value kNoValue = 0xFFFF;
+
+enum class Opcode : uint8_t {
+  // Starts guest instruction `index` of the block, at PC `immediate`.
+  kInstruction,
+  kConstant,
+  // Guest register `index`, as left by whatever ran before it was first
+  // needed: the block's caller or a kInterpret.
+  kGetRegister,
+  kSetRegister,
+  kAdd,
+  kSub,
+  kAnd,
+  kOr,
+  kXor,
+  kNor,
+  kShiftLeft,
+  kShiftRight,
+  kShiftRightArithmetic,
+  kLess,
+  kLessUnsigned,
+  // ADD, ADDI and SUB, raise an overflow exception.
+  kAddChecked,
+  kSubChecked,
+  // Memory ops take the address as `a`. Stores write `b`, LWL/LWR merge
+  // into `b`, the register's value once the previous load landed.
+  kLoad,
+  kLoadLeft,
+  kLoadRight,
+  kStore,
+  kStoreLeft,
+  kStoreRight,
+  // The PC after the delay slot: `immediate` when `condition` holds for
+  // `a` and `b`, the fall-through otherwise.
+  kBranch,
+  kJump,
+  // To `a`.
+  kJumpRegister,
+  // Runs instruction `index`, whose word is `immediate`, through the
+  // interpreter, for HI/LO and the GTE. Reads and writes guest registers
+  // directly.
+  kInterpret,
+};
+
+enum class Access : uint8_t {
+  kByte,
+  kByteUnsigned,
+  kHalf,
+  kHalfUnsigned,
+  kWord,
+};
+
+// kBranch compares `a` with `b`, or with zero.
+enum class Condition : uint8_t {
+  kEqual,
+  kNotEqual,
+  kLessOrEqualZero,
+  kGreaterThanZero,
+  kLessThanZero,
+  kGreaterOrEqualZero,
+};
+
+// Where a memory op goes, set by ClassifyAddresses. Anything but kUnknown
+// means the address is a constant, naturally aligned and in that region.
+enum class Address : uint8_t {
+  kUnknown,
+  kRam,
+  kScratchpad,
+  kBios,
+  kIo,
+};
+
+struct Op {
+  Opcode opcode = Opcode::kConstant;
+  // Register of kGetRegister/kSetRegister, instruction of kInstruction and
+  // kInterpret.
+  uint8_t index = 0;
+  Access access = Access::kWord;
+  Condition condition = Condition::kEqual;
+  Address address = Address::kUnknown;
+  Value a = kNoValue;
+  Value b = kNoValue;
+  uint32_t immediate = 0;
+} __attribute__((aligned(16)));
+
+struct Block {
+  uint32_t start = 0;
+  // The words the block was translated from, one per guest instruction. A
+  // block whose first instruction is left to the interpreter has none.
+  std::vector<uint32_t> code;
+  std::vector<Op> ops;
+  // The PC after the block, kNoValue for the fall-through past `code`.
+  Value next = kNoValue;
+  // Ends on a branch whose delay slot is left to the interpreter.
+  bool delay_slot_pending = false;
+  // The load the last instruction started, which lands one instruction
+  // after the block. Loads into R0 are kept too, like the interpreter's
+  // delay slot does.
+  uint8_t pending_register = 0;
+  Value pending_value = kNoValue;
+} __attribute__((aligned(128)));
+
+// kAdd through kLessUnsigned, shared by FoldConstants and the backends.
+// Shift amounts are masked like SLLV's.
+constexpr uint32_t Evaluate(const Opcode opcode, const uint32_t a,
+                            const uint32_t b) {
+  switch (opcode) {
+    case Opcode::kAdd:
+      return a + b;
+    case Opcode::kSub:
+      return a - b;
+    case Opcode::kAnd:
+      return a & b;
+    case Opcode::kOr:
+      return a | b;
+    case Opcode::kXor:
+      return a ^ b;
+    case Opcode::kNor:
+      return ~(a | b);
+    case Opcode::kShiftLeft:
+      return a << (b & 0x1FU);
+    case Opcode::kShiftRight:
+      return a >> (b & 0x1FU);
+    case Opcode::kShiftRightArithmetic:
+      return static_cast<uint32_t>(static_cast<int32_t>(a) >> (b & 0x1FU));
+    case Opcode::kLess:
+      return static_cast<int32_t>(a) < static_cast<int32_t>(b) ? 1 : 0;
+    case Opcode::kLessUnsigned:
+      return a < b ? 1 : 0;
+    default:
+      return 0;
+  }
+}
+
+// kAddChecked and kSubChecked, nothing when they overflow.
+constexpr std::optional<uint32_t> EvaluateChecked(const Opcode opcode,
+                                                  const uint32_t a,
+                                                  const uint32_t b) {
+  int32_t result = 0;
+  const bool overflow =
+      opcode == Opcode::kAddChecked
+          ? __builtin_add_overflow(static_cast<int32_t>(a),
+                                   static_cast<int32_t>(b), &result)
+          : __builtin_sub_overflow(static_cast<int32_t>(a),
+                                   static_cast<int32_t>(b), &result);
+  if (overflow) {
+    return std::nullopt;
+  }
+  return static_cast<uint32_t>(result);
+}
+
+constexpr bool Holds(const Condition condition, const uint32_t a,
+                     const uint32_t b) {
+  const auto value = static_cast<int32_t>(a);
+  switch (condition) {
+    case Condition::kEqual:
+      return a == b;
+    case Condition::kNotEqual:
+      return a != b;
+    case Condition::kLessOrEqualZero:
+      return value <= 0;
+    case Condition::kGreaterThanZero:
+      return value > 0;
+    case Condition::kLessThanZero:
+      return value < 0;
+    case Condition::kGreaterOrEqualZero:
+      return value >= 0;
+  }
+  return false;
+}
+
+// Translates guest code starting at `start`, `code` holds the words up to
+// where the block must end at the latest. Load delay slots are resolved
+// here: a loaded value is written one instruction late, after the next
+// instruction read its operands, so the ops need no delay slot state.
+[[nodiscard]] Block Translate(uint32_t start, std::span<const uint32_t> code);
+
+// Evaluates ops whose operands are constants, LUI/ORI and LUI/ADDIU pairs
+// become one constant, and forwards identities like x | 0.
+void FoldConstants(Block& block);
+// Tags memory ops with constant addresses with their region. Stores into
+// the block's own code stay kUnknown, a backend ends the block after them.
+void ClassifyAddresses(Block& block);
+// The region ClassifyAddresses tags `op` with, kUnknown for anything but a
+// memory op. Operands must refer to earlier ops.
+[[nodiscard]] Address ClassifyAddress(const Block& block, const Op& op);
+// Drops register writes overwritten before anything could observe them,
+// and ops whose results are unused. Exceptions and early exits observe
+// every register, so ClassifyAddresses first lets more writes go.
+void EliminateDeadCode(Block& block);
+
+// The passes above, in order.
+void Optimize(Block& block);
+
+// Whether the op can raise an exception or end the block early, which
+// needs every register written so far to be in place.
+[[nodiscard]] bool IsObservable(const Op& op);
+
+// One op per line, for debugging.
+[[nodiscard]] std::string ToString(const Block& block);
+}  // namespace ir
+
+#endif  // POLYSTATION_IR_H
@@ -0,0 +1,144 @@
+#include "isa.h"
+
+#include <format>
+
+#include "gte.h"
+
+std::string isa::Disassemble(const uint32_t word) {
+  const Spec& spec = GetSpec(Decode(word));
+  const std::string_view name = spec.mnemonic;
+
+  const uint32_t s = (word >> 21U) & 0x1FU;
+  const uint32_t t = (word >> 16U) & 0x1FU;
+  const uint32_t d = (word >> 11U) & 0x1FU;
+  const uint32_t shift = (word >> 6U) & 0x1FU;
+  const auto immediate = static_cast<uint16_t>(word & 0xFFFFU);
+  const auto offset = static_cast<int16_t>(immediate);
+
+  switch (spec.format) {
+    case Format::kWord:
+      break;
+    case Format::kNone:
+      return std::string(name);
+    case Format::kShift:
+      return std::format("{} R{}, R{}, {}", name, d, t, shift);
+    case Format::kShiftVariable:
+      return std::format("{} R{}, R{}, R{}", name, d, t, s);
+    case Format::kRegister:
+      return std::format("{} R{}, R{}, R{}", name, d, s, t);
+    case Format::kJumpRegister:
+    case Format::kMoveToHiLo:
+      return std::format("{} R{}", name, s);
+    case Format::kLinkRegister:
+      return std::format("{} R{}, R{}", name, d, s);
+    case Format::kMultiply:
+      return std::format("{} R{}, R{}", name, s, t);
+    case Format::kMoveFromHiLo:
+      return std::format("{} R{}", name, d);
+    case Format::kCode:
+      return std::format("{} {:05X}", name, (word >> 6U) & 0xFFFFFU);
+    case Format::kBranchZero:
+      return std::format("{} R{}, {}", name, s, offset);
+    case Format::kBranch:
+      return std::format("{} R{}, R{}, {}", name, s, t, offset);
+    case Format::kJump:
+      return std::format("{} {:07X}", name, word & 0x3FFFFFFU);
+    case Format::kImmediate:
+      return std::format("{} R{}, R{}, {}", name, t, s, offset);
+    case Format::kLogical:
+      return std::format("{} R{}, R{}, {:04X}", name, t, s, immediate);
+    case Format::kLoadUpper:
+      return std::format("{} R{}, {:04X}", name, t, immediate);
+    case Format::kMemory:
+      return std::format("{} R{}, {}(R{})", name, t, offset, s);
+    case Format::kCop0Move:
+      return std::format("{} R{}, cop0r{}", name, t, d);
+    case Format::kCop2Data:
+      return std::format("{} R{}, cop2dat{}", name, t, d);
+    case Format::kCop2Control:
+      return std::format("{} R{}, cop2cnt{}", name, t, d);
+    case Format::kCop2Memory:
+      return std::format("{} cop2dat{}, {}(R{})", name, t, offset, s);
+    case Format::kGteCommand:
+      return std::string(gte::GetOpcodeName(word));
+  }
+
+  return std::format("0x{:08X}", word);
+}
+
+std::string isa::GetDecodeName(const size_t index) {
+  const uint32_t word = GetDecodeWord(index);
+  const std::string_view mnemonic =
+      GetSpec(gsl::at(kDecodeTable, index)).mnemonic;
+  const uint32_t primary = word >> 26U;
+
+  if (index < kSpecialBase) {
+    return std::format("{} {:02X}", mnemonic, primary);
+  }
+  if (index < kBcondZBase) {
+    return std::format("{} {:02X}/{:02X}", mnemonic, primary, word & 0x3FU);
+  }
+  if (index < kCop0MoveBase) {
+    return std::format("{} {:02X}/{:02X}", mnemonic, primary,
+                       (word >> 16U) & 0x1FU);
+  }
+  if (index == kCop2Command) {
+    return std::format("{} {:02X}/cmd", mnemonic, primary);
+  }
+  if ((word & kCoprocessorFlag) != 0U) {
+    return std::format("{} {:02X}/fn{:02X}", mnemonic, primary, word & 0x3FU);
+  }
+  return std::format("{} {:02X}/rs{:02X}", mnemonic, primary,
+                     (word >> 21U) & 0x1FU);
+}
+
+std::optional<uint8_t> isa::GetDestination(const uint32_t word) {
+  constexpr uint8_t kReturnAddress = 31;
+
+  const Spec& spec = GetSpec(Decode(word));
+  const auto t = static_cast<uint8_t>((word >> 16U) & 0x1FU);
+  const auto d = static_cast<uint8_t>((word >> 11U) & 0x1FU);
+
+  std::optional<uint8_t> destination;
+  switch (spec.format) {
+    case Format::kShift:
+    case Format::kShiftVariable:
+    case Format::kRegister:
+    case Format::kLinkRegister:
+    case Format::kMoveFromHiLo:
+      destination = d;
+      break;
+    case Format::kImmediate:
+    case Format::kLogical:
+    case Format::kLoadUpper:
+      destination = t;
+      break;
+    case Format::kMemory:
+      if ((spec.flags & kLoad) != 0U) {
+        destination = t;
+      }
+      break;
+    case Format::kCop0Move:
+    case Format::kCop2Data:
+    case Format::kCop2Control:
+      if (spec.operation == Operation::kMFC0 ||
+          spec.operation == Operation::kMFC2 ||
+          spec.operation == Operation::kCFC2) {
+        destination = t;
+      }
+      break;
+    case Format::kBranchZero:
+    case Format::kJump:
+      if ((spec.flags & kLink) != 0U) {
+        destination = kReturnAddress;
+      }
+      break;
+    default:
+      break;
+  }
+
+  if (destination == 0) {
+    return std::nullopt;
+  }
+  return destination;
+}
@@ -0,0 +1,446 @@
+#ifndef POLYSTATION_ISA_H
+#define POLYSTATION_ISA_H
+#include <array>
+#include <cstdint>
+#include <gsl/gsl>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// The R3000A instruction set as data. The decoder, the interpreter's
+// dispatch table and the disassembler are all derived from kSpecs.
+namespace isa {
+enum class Operation : uint8_t {
+  kIllegal,
+  kSLL,
+  kSRL,
+  kSRA,
+  kSLLV,
+  kSRLV,
+  kSRAV,
+  kJR,
+  kJALR,
+  kSYSCALL,
+  kBREAK,
+  kMFHI,
+  kMTHI,
+  kMFLO,
+  kMTLO,
+  kMULT,
+  kMULTU,
+  kDIV,
+  kDIVU,
+  kADD,
+  kADDU,
+  kSUB,
+  kSUBU,
+  kAND,
+  kOR,
+  kXOR,
+  kNOR,
+  kSLT,
+  kSLTU,
+  kBLTZAL,
+  kBGEZAL,
+  kBLTZ,
+  kBGEZ,
+  kJ,
+  kJAL,
+  kBEQ,
+  kBNE,
+  kBLEZ,
+  kBGTZ,
+  kADDI,
+  kADDIU,
+  kSLTI,
+  kSLTIU,
+  kANDI,
+  kORI,
+  kXORI,
+  kLUI,
+  kMFC0,
+  kMTC0,
+  kRFE,
+  kMFC2,
+  kCFC2,
+  kMTC2,
+  kCTC2,
+  kGTE,
+  kLB,
+  kLH,
+  kLWL,
+  kLW,
+  kLBU,
+  kLHU,
+  kLWR,
+  kSB,
+  kSH,
+  kSWL,
+  kSW,
+  kSWR,
+  kLWC2,
+  kSWC2
+};
+
+constexpr size_t kOperationCount = static_cast<size_t>(Operation::kSWC2) + 1;
+
+// Operand layout, drives the disassembler.
+enum class Format : uint8_t {
+  kWord,           // .word 0x...
+  kNone,           // rfe
+  kShift,          // sll rd, rt, shift
+  kShiftVariable,  // sllv rd, rt, rs
+  kRegister,       // add rd, rs, rt
+  kJumpRegister,   // jr rs
+  kLinkRegister,   // jalr rd, rs
+  kMultiply,       // mult rs, rt
+  kMoveFromHiLo,   // mfhi rd
+  kMoveToHiLo,     // mthi rs
+  kCode,           // syscall code
+  kBranchZero,     // bltz rs, offset
+  kBranch,         // beq rs, rt, offset
+  kJump,           // j target
+  kImmediate,      // addi rt, rs, signed
+  kLogical,        // andi rt, rs, unsigned
+  kLoadUpper,      // lui rt, unsigned
+  kMemory,         // lw rt, offset(rs)
+  kCop0Move,       // mfc0 rt, cop0rN
+  kCop2Data,       // mfc2 rt, cop2datN
+  kCop2Control,    // cfc2 rt, cop2cntN
+  kCop2Memory,     // lwc2 cop2datN, offset(rs)
+  kGteCommand      // named by the GTE
+};
+
+enum Flags : uint8_t {
+  kBranch = 1U << 0U,       // Has a delay slot.
+  kLink = 1U << 1U,         // Writes a return address.
+  kLoad = 1U << 2U,         // Reads memory.
+  kStore = 1U << 3U,        // Writes memory.
+  kTrap = 1U << 4U,         // Raises exceptions beyond address/bus errors.
+  kHiLo = 1U << 5U,         // Writes HI/LO.
+  kCoprocessor = 1U << 6U,  // Touches COP0 or the GTE.
+};
+
+struct Spec {
+  std::string_view mnemonic;
+  // An instruction word matches when (word & mask) == match.
+  uint32_t mask;
+  uint32_t match;
+  Operation operation;
+  Format format;
+  // Issue cycles, the multiply/divide unit's latency is not modelled.
+  uint8_t cycles;
+  uint8_t flags;
+} __attribute__((aligned(32)));
+
+constexpr uint32_t kPrimaryMask = 0xFC000000;
+constexpr uint32_t kSpecialMask = kPrimaryMask | 0x3FU;
+constexpr uint32_t kBcondZMask = kPrimaryMask | (0x1FU << 16U);
+constexpr uint32_t kCoprocessorMoveMask = kPrimaryMask | (0x1FU << 21U);
+constexpr uint32_t kCoprocessorFlag = 1U << 25U;
+
+constexpr uint32_t kSpecialOpcode = 0x00;
+constexpr uint32_t kBcondZOpcode = 0x01;
+constexpr uint32_t kCop0Opcode = 0x10;
+constexpr uint32_t kCop2Opcode = 0x12;
+
+constexpr Spec MakePrimary(const Operation operation, const uint32_t opcode,
+                           const std::string_view mnemonic,
+                           const Format format, const uint8_t flags = 0) {
+  return Spec{.mnemonic = mnemonic,
+              .mask = kPrimaryMask,
+              .match = opcode << 26U,
+              .operation = operation,
+              .format = format,
+              .cycles = 1,
+              .flags = flags};
+}
+
+constexpr Spec MakeSpecial(const Operation operation, const uint32_t function,
+                           const std::string_view mnemonic,
+                           const Format format, const uint8_t flags = 0) {
+  return Spec{.mnemonic = mnemonic,
+              .mask = kSpecialMask,
+              .match = (kSpecialOpcode << 26U) | function,
+              .operation = operation,
+              .format = format,
+              .cycles = 1,
+              .flags = flags};
+}
+
+constexpr Spec MakeCoprocessorMove(const Operation operation,
+                                   const uint32_t opcode, const uint32_t move,
+                                   const std::string_view mnemonic,
+                                   const Format format, const uint8_t flags) {
+  return Spec{.mnemonic = mnemonic,
+              .mask = kCoprocessorMoveMask,
+              .match = (opcode << 26U) | (move << 21U),
+              .operation = operation,
+              .format = format,
+              .cycles = 1,
+              .flags = flags};
+}
+
+// Ordered like Operation. Earlier entries win when several match, which
+// lets the BcondZ link forms shadow the plain ones.
+constexpr std::array kSpecs = std::to_array<Spec>({
+    {.mnemonic = "illegal",
+     .mask = 0,
+     .match = 1,
+     .operation = Operation::kIllegal,
+     .format = Format::kWord,
+     .cycles = 1,
+     .flags = 0},
+    MakeSpecial(Operation::kSLL, 0x00, "sll", Format::kShift),
+    MakeSpecial(Operation::kSRL, 0x02, "srl", Format::kShift),
+    MakeSpecial(Operation::kSRA, 0x03, "sra", Format::kShift),
+    MakeSpecial(Operation::kSLLV, 0x04, "sllv", Format::kShiftVariable),
+    MakeSpecial(Operation::kSRLV, 0x06, "srlv", Format::kShiftVariable),
+    MakeSpecial(Operation::kSRAV, 0x07, "srav", Format::kShiftVariable),
+    MakeSpecial(Operation::kJR, 0x08, "jr", Format::kJumpRegister, kBranch),
+    MakeSpecial(Operation::kJALR, 0x09, "jalr", Format::kLinkRegister,
+                kBranch | kLink),
+    MakeSpecial(Operation::kSYSCALL, 0x0C, "syscall", Format::kCode, kTrap),
+    MakeSpecial(Operation::kBREAK, 0x0D, "break", Format::kCode, kTrap),
+    MakeSpecial(Operation::kMFHI, 0x10, "mfhi", Format::kMoveFromHiLo),
+    MakeSpecial(Operation::kMTHI, 0x11, "mthi", Format::kMoveToHiLo, kHiLo),
+    MakeSpecial(Operation::kMFLO, 0x12, "mflo", Format::kMoveFromHiLo),
+    MakeSpecial(Operation::kMTLO, 0x13, "mtlo", Format::kMoveToHiLo, kHiLo),
+    MakeSpecial(Operation::kMULT, 0x18, "mult", Format::kMultiply, kHiLo),
+    MakeSpecial(Operation::kMULTU, 0x19, "multu", Format::kMultiply, kHiLo),
+    MakeSpecial(Operation::kDIV, 0x1A, "div", Format::kMultiply, kHiLo),
+    MakeSpecial(Operation::kDIVU, 0x1B, "divu", Format::kMultiply, kHiLo),
+    MakeSpecial(Operation::kADD, 0x20, "add", Format::kRegister, kTrap),
+    MakeSpecial(Operation::kADDU, 0x21, "addu", Format::kRegister),
+    MakeSpecial(Operation::kSUB, 0x22, "sub", Format::kRegister, kTrap),
+    MakeSpecial(Operation::kSUBU, 0x23, "subu", Format::kRegister),
+    MakeSpecial(Operation::kAND, 0x24, "and", Format::kRegister),
+    MakeSpecial(Operation::kOR, 0x25, "or", Format::kRegister),
+    MakeSpecial(Operation::kXOR, 0x26, "xor", Format::kRegister),
+    MakeSpecial(Operation::kNOR, 0x27, "nor", Format::kRegister),
+    MakeSpecial(Operation::kSLT, 0x2A, "slt", Format::kRegister),
+    MakeSpecial(Operation::kSLTU, 0x2B, "sltu", Format::kRegister),
+    // The PS1 decodes BcondZ loosely: bit 16 of rt picks GEZ over LTZ and
+    // only rt values 0x10/0x11 link, every other rt is a plain branch.
+    {.mnemonic = "bltzal",
+     .mask = kBcondZMask,
+     .match = (kBcondZOpcode << 26U) | (0x10U << 16U),
+     .operation = Operation::kBLTZAL,
+     .format = Format::kBranchZero,
+     .cycles = 1,
+     .flags = kBranch | kLink},
+    {.mnemonic = "bgezal",
+     .mask = kBcondZMask,
+     .match = (kBcondZOpcode << 26U) | (0x11U << 16U),
+     .operation = Operation::kBGEZAL,
+     .format = Format::kBranchZero,
+     .cycles = 1,
+     .flags = kBranch | kLink},
+    {.mnemonic = "bltz",
+     .mask = kPrimaryMask | (1U << 16U),
+     .match = kBcondZOpcode << 26U,
+     .operation = Operation::kBLTZ,
+     .format = Format::kBranchZero,
+     .cycles = 1,
+     .flags = kBranch},
+    {.mnemonic = "bgez",
+     .mask = kPrimaryMask | (1U << 16U),
+     .match = (kBcondZOpcode << 26U) | (1U << 16U),
+     .operation = Operation::kBGEZ,
+     .format = Format::kBranchZero,
+     .cycles = 1,
+     .flags = kBranch},
+    MakePrimary(Operation::kJ, 0x02, "j", Format::kJump, kBranch),
+    MakePrimary(Operation::kJAL, 0x03, "jal", Format::kJump, kBranch | kLink),
+    MakePrimary(Operation::kBEQ, 0x04, "beq", Format::kBranch, kBranch),
+    MakePrimary(Operation::kBNE, 0x05, "bne", Format::kBranch, kBranch),
+    MakePrimary(Operation::kBLEZ, 0x06, "blez", Format::kBranchZero, kBranch),
+    MakePrimary(Operation::kBGTZ, 0x07, "bgtz", Format::kBranchZero, kBranch),
+    MakePrimary(Operation::kADDI, 0x08, "addi", Format::kImmediate, kTrap),
+    MakePrimary(Operation::kADDIU, 0x09, "addiu", Format::kImmediate),
+    MakePrimary(Operation::kSLTI, 0x0A, "slti", Format::kImmediate),
+    MakePrimary(Operation::kSLTIU, 0x0B, "sltiu", Format::kImmediate),
+    MakePrimary(Operation::kANDI, 0x0C, "andi", Format::kLogical),
+    MakePrimary(Operation::kORI, 0x0D, "ori", Format::kLogical),
+    MakePrimary(Operation::kXORI, 0x0E, "xori", Format::kLogical),
+    MakePrimary(Operation::kLUI, 0x0F, "lui", Format::kLoadUpper),
+    MakeCoprocessorMove(Operation::kMFC0, kCop0Opcode, 0x00, "mfc0",
+                        Format::kCop0Move, kCoprocessor),
+    MakeCoprocessorMove(Operation::kMTC0, kCop0Opcode, 0x04, "mtc0",
+                        Format::kCop0Move, kCoprocessor),
+    {.mnemonic = "rfe",
+     .mask = kPrimaryMask | kCoprocessorFlag | 0x3FU,
+     .match = (kCop0Opcode << 26U) | kCoprocessorFlag | 0x10U,
+     .operation = Operation::kRFE,
+     .format = Format::kNone,
+     .cycles = 1,
+     .flags = kCoprocessor},
+    MakeCoprocessorMove(Operation::kMFC2, kCop2Opcode, 0x00, "mfc2",
+                        Format::kCop2Data, kCoprocessor),
+    MakeCoprocessorMove(Operation::kCFC2, kCop2Opcode, 0x02, "cfc2",
+                        Format::kCop2Control, kCoprocessor),
+    MakeCoprocessorMove(Operation::kMTC2, kCop2Opcode, 0x04, "mtc2",
+                        Format::kCop2Data, kCoprocessor),
+    MakeCoprocessorMove(Operation::kCTC2, kCop2Opcode, 0x06, "ctc2",
+                        Format::kCop2Control, kCoprocessor),
+    {.mnemonic = "gte",
+     .mask = kPrimaryMask | kCoprocessorFlag,
+     .match = (kCop2Opcode << 26U) | kCoprocessorFlag,
+     .operation = Operation::kGTE,
+     .format = Format::kGteCommand,
+     .cycles = 1,
+     .flags = kCoprocessor},
+    MakePrimary(Operation::kLB, 0x20, "lb", Format::kMemory, kLoad),
+    MakePrimary(Operation::kLH, 0x21, "lh", Format::kMemory, kLoad),
+    MakePrimary(Operation::kLWL, 0x22, "lwl", Format::kMemory, kLoad),
+    MakePrimary(Operation::kLW, 0x23, "lw", Format::kMemory, kLoad),
+    MakePrimary(Operation::kLBU, 0x24, "lbu", Format::kMemory, kLoad),
+    MakePrimary(Operation::kLHU, 0x25, "lhu", Format::kMemory, kLoad),
+    MakePrimary(Operation::kLWR, 0x26, "lwr", Format::kMemory, kLoad),
+    MakePrimary(Operation::kSB, 0x28, "sb", Format::kMemory, kStore),
+    MakePrimary(Operation::kSH, 0x29, "sh", Format::kMemory, kStore),
+    MakePrimary(Operation::kSWL, 0x2A, "swl", Format::kMemory, kStore),
+    MakePrimary(Operation::kSW, 0x2B, "sw", Format::kMemory, kStore),
+    MakePrimary(Operation::kSWR, 0x2E, "swr", Format::kMemory, kStore),
+    MakePrimary(Operation::kLWC2, 0x32, "lwc2", Format::kCop2Memory,
+                kLoad | kCoprocessor),
+    MakePrimary(Operation::kSWC2, 0x3A, "swc2", Format::kCop2Memory,
+                kStore | kCoprocessor),
+});
+
+static_assert(kSpecs.size() == kOperationCount);
+
+constexpr bool IsOrdered() {
+  for (size_t i = 0; i < kSpecs.size(); i++) {
+    if (static_cast<size_t>(gsl::at(kSpecs, i).operation) != i) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(IsOrdered(), "kSpecs must be ordered like Operation");
+
+// Decoding is a single table lookup. The primary opcode indexes the table
+// directly, grouped opcodes continue into a block keyed by their
+// sub-opcode field.
+constexpr size_t kSpecialBase = 64;
+constexpr size_t kBcondZBase = kSpecialBase + 64;
+constexpr size_t kCop0MoveBase = kBcondZBase + 32;
+constexpr size_t kCop0FunctionBase = kCop0MoveBase + 16;
+constexpr size_t kCop2MoveBase = kCop0FunctionBase + 64;
+constexpr size_t kCop2Command = kCop2MoveBase + 16;
+constexpr size_t kDecodeTableSize = kCop2Command + 1;
+
+constexpr size_t GetDecodeIndex(const uint32_t word) {
+  switch (const uint32_t primary = word >> 26U) {
+    case kSpecialOpcode:
+      return kSpecialBase + (word & 0x3FU);
+    case kBcondZOpcode:
+      return kBcondZBase + ((word >> 16U) & 0x1FU);
+    case kCop0Opcode:
+      return (word & kCoprocessorFlag) != 0U
+                 ? kCop0FunctionBase + (word & 0x3FU)
+                 : kCop0MoveBase + ((word >> 21U) & 0xFU);
+    case kCop2Opcode:
+      return (word & kCoprocessorFlag) != 0U
+                 ? kCop2Command
+                 : kCop2MoveBase + ((word >> 21U) & 0xFU);
+    default:
+      return primary;
+  }
+}
+
+// The bits GetDecodeIndex looks at for `word`.
+constexpr uint32_t GetDecodeMask(const uint32_t word) {
+  switch (word >> 26U) {
+    case kSpecialOpcode:
+      return kSpecialMask;
+    case kBcondZOpcode:
+      return kBcondZMask;
+    case kCop0Opcode:
+      return (word & kCoprocessorFlag) != 0U ? kSpecialMask | kCoprocessorFlag
+                                             : kCoprocessorMoveMask;
+    case kCop2Opcode:
+      return (word & kCoprocessorFlag) != 0U ? kPrimaryMask | kCoprocessorFlag
+                                             : kCoprocessorMoveMask;
+    default:
+      return kPrimaryMask;
+  }
+}
+
+// Inverse of GetDecodeIndex, a word that lands on `index`.
+constexpr uint32_t GetDecodeWord(const size_t index) {
+  const auto offset = [index](const size_t base) {
+    return static_cast<uint32_t>(index - base);
+  };
+  if (index < kSpecialBase) {
+    return static_cast<uint32_t>(index) << 26U;
+  }
+  if (index < kBcondZBase) {
+    return (kSpecialOpcode << 26U) | offset(kSpecialBase);
+  }
+  if (index < kCop0MoveBase) {
+    return (kBcondZOpcode << 26U) | (offset(kBcondZBase) << 16U);
+  }
+  if (index < kCop0FunctionBase) {
+    return (kCop0Opcode << 26U) | (offset(kCop0MoveBase) << 21U);
+  }
+  if (index < kCop2MoveBase) {
+    return (kCop0Opcode << 26U) | kCoprocessorFlag |
+           offset(kCop0FunctionBase);
+  }
+  if (index < kCop2Command) {
+    return (kCop2Opcode << 26U) | (offset(kCop2MoveBase) << 21U);
+  }
+  return (kCop2Opcode << 26U) | kCoprocessorFlag;
+}
+
+// Reference decoder, first matching spec wins. Only used to build
+// kDecodeTable.
+constexpr Operation Match(const uint32_t word) {
+  for (const Spec& spec : kSpecs) {
+    if ((word & spec.mask) == spec.match) {
+      return spec.operation;
+    }
+  }
+  return Operation::kIllegal;
+}
+
+// Every spec must be decidable from the bits the table lookup sees.
+constexpr bool IsDecodable() {
+  for (const Spec& spec : kSpecs) {
+    if ((spec.mask & ~GetDecodeMask(spec.match)) != 0U) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(IsDecodable(), "a spec depends on bits the decoder ignores");
+
+constexpr std::array<Operation, kDecodeTableSize> kDecodeTable = [] {
+  std::array<Operation, kDecodeTableSize> table{};
+  for (size_t i = 0; i < table.size(); i++) {
+    gsl::at(table, i) = Match(GetDecodeWord(i));
+  }
+  return table;
+}();
+
+constexpr const Spec& GetSpec(const Operation operation) {
+  return gsl::at(kSpecs, static_cast<size_t>(operation));
+}
+
+constexpr Operation Decode(const uint32_t word) {
+  return gsl::at(kDecodeTable, GetDecodeIndex(word));
+}
+
+[[nodiscard]] std::string Disassemble(uint32_t word);
+
+// Mnemonic and opcode fields of a decode index, e.g. "addu 00/21" for a
+// SPECIAL function or "lui 0F" for a primary opcode.
+[[nodiscard]] std::string GetDecodeName(size_t index);
+
+// The general purpose register `word` writes, none for R0.
+[[nodiscard]] std::optional<uint8_t> GetDestination(uint32_t word);
+}  // namespace isa
+
+#endif  // POLYSTATION_ISA_H
@@ -1,8 +1,11 @@
 #include "logger.h"
 
+#include <vector>
+
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 std::shared_ptr<spdlog::logger> logger::Logger::logger_;
+thread_local std::shared_ptr<spdlog::logger> logger::Logger::current_;
 
 void logger::Logger::init() {
   const auto console_sink =
@@ -35,4 +38,36 @@ void logger::Logger::shutdown() {
     spdlog::shutdown();
     logger_.reset();
   }
-}
\ No newline at end of file
+}
+std::shared_ptr<spdlog::logger> logger::Logger::Create(
+    const std::string& name, const spdlog::level::level_enum level,
+    const std::optional<std::string>& file_path) {
+  std::vector<spdlog::sink_ptr> sinks;
+
+  const auto console_sink =
+      std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
+  console_sink->set_pattern("%^[%l] [%n] %v%$");
+  sinks.push_back(console_sink);
+
+  if (file_path.has_value()) {
+    const auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(
+        file_path.value(), true);
+    file_sink->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] [%n] %v");
+    sinks.push_back(file_sink);
+  }
+
+  auto logger =
+      std::make_shared<spdlog::logger>(name, sinks.begin(), sinks.end());
+  logger->set_level(level);
+  logger->flush_on(spdlog::level::warn);
+  return logger;
+}
+
+logger::ScopedLogger::ScopedLogger(std::shared_ptr<spdlog::logger> logger)
+    : previous_(std::move(Logger::current_)) {
+  Logger::current_ = std::move(logger);
+}
+
+logger::ScopedLogger::~ScopedLogger() {
+  Logger::current_ = std::move(previous_);
+}
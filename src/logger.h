@@ -8,6 +8,8 @@
 #include <spdlog/spdlog.h>
 
 #include <memory>
+#include <optional>
+#include <string>
 
 namespace logger {
 
@@ -15,19 +17,62 @@ class Logger {
  public:
   static void init();
   static void shutdown();
-  static std::shared_ptr<spdlog::logger> get() { return logger_; }
+  // The logger bound to the calling thread, falling back to the process one.
+  static std::shared_ptr<spdlog::logger> get() {
+    return current_ ? current_ : logger_;
+  }
+
+  // Builds an unregistered logger, so every embedded machine can log on its
+  // own without touching the process-wide spdlog registry.
+  static std::shared_ptr<spdlog::logger> Create(
+      const std::string& name, spdlog::level::level_enum level,
+      const std::optional<std::string>& file_path = std::nullopt);
 
  private:
+  friend class ScopedLogger;
+
   static std::shared_ptr<spdlog::logger> logger_;
+  static thread_local std::shared_ptr<spdlog::logger> current_;
+};
+
+// Routes the LOG_* macros on this thread to `logger` until destroyed.
+class ScopedLogger {
+ public:
+  explicit ScopedLogger(std::shared_ptr<spdlog::logger> logger);
+  ~ScopedLogger();
+
+  ScopedLogger(const ScopedLogger&) = delete;
+  ScopedLogger& operator=(const ScopedLogger&) = delete;
+  ScopedLogger(ScopedLogger&&) = delete;
+  ScopedLogger& operator=(ScopedLogger&&) = delete;
+
+ private:
+  std::shared_ptr<spdlog::logger> previous_;
 };
 
 // Convenience macros for your emulator components
 #define LOG_INFO_BUS(...) \
   SPDLOG_LOGGER_INFO(logger::Logger::get(), "[BUS] " __VA_ARGS__)
+#define LOG_WARN_BUS(...) \
+  SPDLOG_LOGGER_WARN(logger::Logger::get(), "[BUS] " __VA_ARGS__)
 
 #define LOG_INFO_CPU(...) \
   SPDLOG_LOGGER_INFO(logger::Logger::get(), "[CPU] " __VA_ARGS__)
 
+#define LOG_INFO_MDEC(...) \
+  SPDLOG_LOGGER_INFO(logger::Logger::get(), "[MDEC] " __VA_ARGS__)
+
+#define LOG_INFO_GTE(...) \
+  SPDLOG_LOGGER_INFO(logger::Logger::get(), "[GTE] " __VA_ARGS__)
+
+#define LOG_INFO_HLE(...) \
+  SPDLOG_LOGGER_INFO(logger::Logger::get(), "[HLE] " __VA_ARGS__)
+#define LOG_ERROR_HLE(...) \
+  SPDLOG_LOGGER_ERROR(logger::Logger::get(), "[HLE] " __VA_ARGS__)
+
+#define LOG_INFO_TTY(...) \
+  SPDLOG_LOGGER_INFO(logger::Logger::get(), "[TTY] " __VA_ARGS__)
+
 #define LOG_INFO_CORE(...) \
   SPDLOG_LOGGER_INFO(logger::Logger::get(), "[CORE] " __VA_ARGS__)
 #define LOG_ERROR_CORE(...) \
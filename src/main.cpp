@@ -1,4 +1,5 @@
 #include <iostream>
+#include <optional>
 #include <span>
 
 #include "app.h"
@@ -13,7 +14,7 @@ int main(const int argc, char** argv) {
 
   const std::span args(argv, argc);
   if (args.size() <= 1) {
-    LOG_FATAL_CORE("Usage: {} <bios_path>", args[0]);
+    LOG_FATAL_CORE("Usage: {} <bios_path> [exe_path]", args[0]);
     return -1;
   }
 
@@ -21,7 +22,11 @@ int main(const int argc, char** argv) {
 
   try {
     std::string const bios_path = args[1];
-    app::Application app{bios_path};
+    std::optional<std::string> exe_path;
+    if (args.size() > 2) {
+      exe_path = args[2];
+    }
+    app::Application app{bios_path, exe_path};
     app.Run();
   } catch (const std::exception& e) {
     LOG_FATAL_CORE("{}", e.what());
@@ -0,0 +1,588 @@
+#include "mdec.h"
+
+#include <algorithm>
+#include <gsl/util>
+
+#include "logger.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+constexpr uint32_t kStateTag = savestate::MakeTag("MDEC");
+constexpr uint32_t kStateVersion = 1;
+
+constexpr std::array<uint8_t, mdec::kBlockSize> kZigZag{
+    0,  1,  5,  6,  14, 15, 27, 28, 2,  4,  7,  13, 16, 26, 29, 42,
+    3,  8,  12, 17, 25, 30, 41, 43, 9,  11, 18, 24, 31, 40, 44, 53,
+    10, 19, 23, 32, 39, 45, 52, 54, 20, 22, 33, 38, 46, 51, 55, 60,
+    21, 34, 37, 47, 50, 56, 59, 61, 35, 36, 48, 49, 57, 58, 62, 63};
+
+constexpr std::array<uint8_t, mdec::kBlockSize> kZagZig = [] {
+  std::array<uint8_t, mdec::kBlockSize> table{};
+  for (uint32_t i = 0; i < mdec::kBlockSize; i++) {
+    table.at(kZigZag.at(i)) = static_cast<uint8_t>(i);
+  }
+  return table;
+}();
+
+constexpr uint16_t kPadding = 0xFE00;
+constexpr uint32_t kCurrentBlockIdle = 4;
+
+// YUV to RGB coefficients in 2.14 fixed point. Chroma is pre-shifted by 2 so
+// a 16x16 high multiply lands directly on the integer result, which keeps the
+// scalar and SIMD paths bit identical.
+constexpr int32_t kCrToR = 22970;   // 1.402
+constexpr int32_t kCbToG = -5631;   // -0.3437
+constexpr int32_t kCrToG = -11703;  // -0.7143
+constexpr int32_t kCbToB = 29032;   // 1.772
+
+int32_t SignExtend10(const uint16_t value) {
+  return static_cast<int32_t>(static_cast<uint32_t>(value & 0x3FFU) << 22U) >>
+         22;
+}
+
+int32_t Saturate8(const int32_t value) { return std::clamp(value, -128, 127); }
+
+#if defined(__SSE2__)
+__m128i RoundIdct(const __m128i sum) {
+  const __m128i biased = _mm_add_epi32(sum, _mm_set1_epi32(0xFFF));
+  // Division truncates toward zero, an arithmetic shift floors.
+  const __m128i correction =
+      _mm_and_si128(_mm_srai_epi32(biased, 31), _mm_set1_epi32(0x1FFF));
+  return _mm_srai_epi32(_mm_add_epi32(biased, correction), 13);
+}
+
+__m128i Saturate8(const __m128i value) {
+  const __m128i packed = _mm_packs_epi16(value, value);
+  return _mm_srai_epi16(_mm_unpacklo_epi8(packed, packed), 8);
+}
+#else
+int32_t MultiplyHigh(const int32_t value, const int32_t coefficient) {
+  return (value * coefficient) >> 16;
+}
+
+int16_t RoundIdct(const int32_t sum) {
+  return static_cast<int16_t>(
+      std::clamp((sum + 0xFFF) / 0x2000, -0x8000, 0x7FFF));
+}
+#endif
+
+void IdctPass(const int16_t* source, const int16_t* scale_table,
+              int16_t* destination) {
+#if defined(__SSE2__)
+  for (uint32_t y = 0; y < 8; y++) {
+    __m128i sum_low = _mm_setzero_si128();
+    __m128i sum_high = _mm_setzero_si128();
+
+    for (uint32_t z = 0; z < 8; z++) {
+      const __m128i coefficient = _mm_set1_epi16(source[y + (z * 8)]);
+      const __m128i scale = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(scale_table + (z * 8)));
+
+      const __m128i product_low = _mm_mullo_epi16(coefficient, scale);
+      const __m128i product_high = _mm_mulhi_epi16(coefficient, scale);
+      sum_low = _mm_add_epi32(sum_low,
+                              _mm_unpacklo_epi16(product_low, product_high));
+      sum_high = _mm_add_epi32(sum_high,
+                               _mm_unpackhi_epi16(product_low, product_high));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (y * 8)),
+                     _mm_packs_epi32(RoundIdct(sum_low), RoundIdct(sum_high)));
+  }
+#else
+  for (uint32_t y = 0; y < 8; y++) {
+    for (uint32_t x = 0; x < 8; x++) {
+      int32_t sum = 0;
+      for (uint32_t z = 0; z < 8; z++) {
+        sum += static_cast<int32_t>(source[y + (z * 8)]) *
+               static_cast<int32_t>(scale_table[x + (z * 8)]);
+      }
+      destination[x + (y * 8)] = RoundIdct(sum);
+    }
+  }
+#endif
+}
+
+// Converts one row of 8 luminance samples. `cr_row` and `cb_row` point at the
+// 4 chroma samples covering those pixels.
+void ConvertRow(const int16_t* y_row, const int16_t* cr_row,
+                const int16_t* cb_row, std::array<int8_t, 8>& red,
+                std::array<int8_t, 8>& green, std::array<int8_t, 8>& blue) {
+#if defined(__SSE2__)
+  const __m128i luma =
+      Saturate8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y_row)));
+  __m128i cr = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr_row));
+  __m128i cb = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb_row));
+  cr = _mm_slli_epi16(Saturate8(_mm_unpacklo_epi16(cr, cr)), 2);
+  cb = _mm_slli_epi16(Saturate8(_mm_unpacklo_epi16(cb, cb)), 2);
+
+  const __m128i r = _mm_mulhi_epi16(cr, _mm_set1_epi16(kCrToR));
+  const __m128i g = _mm_add_epi16(_mm_mulhi_epi16(cb, _mm_set1_epi16(kCbToG)),
+                                  _mm_mulhi_epi16(cr, _mm_set1_epi16(kCrToG)));
+  const __m128i b = _mm_mulhi_epi16(cb, _mm_set1_epi16(kCbToB));
+
+  const __m128i zero = _mm_setzero_si128();
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(red.data()),
+                   _mm_packs_epi16(_mm_add_epi16(luma, r), zero));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(green.data()),
+                   _mm_packs_epi16(_mm_add_epi16(luma, g), zero));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(blue.data()),
+                   _mm_packs_epi16(_mm_add_epi16(luma, b), zero));
+#else
+  for (uint32_t x = 0; x < 8; x++) {
+    const int32_t luma = Saturate8(y_row[x]);
+    const int32_t cr = Saturate8(cr_row[x / 2]) * 4;
+    const int32_t cb = Saturate8(cb_row[x / 2]) * 4;
+
+    const int32_t r = MultiplyHigh(cr, kCrToR);
+    const int32_t g = MultiplyHigh(cb, kCbToG) + MultiplyHigh(cr, kCrToG);
+    const int32_t b = MultiplyHigh(cb, kCbToB);
+
+    gsl::at(red, x) = static_cast<int8_t>(Saturate8(luma + r));
+    gsl::at(green, x) = static_cast<int8_t>(Saturate8(luma + g));
+    gsl::at(blue, x) = static_cast<int8_t>(Saturate8(luma + b));
+  }
+#endif
+}
+
+template <size_t N>
+void PackBytes(const std::array<uint8_t, N>& bytes,
+               const std::span<uint32_t> output) {
+  for (size_t word = 0; word < N / 4; word++) {
+    output[word] = static_cast<uint32_t>(bytes[(word * 4) + 0]) |
+                   static_cast<uint32_t>(bytes[(word * 4) + 1]) << 8U |
+                   static_cast<uint32_t>(bytes[(word * 4) + 2]) << 16U |
+                   static_cast<uint32_t>(bytes[(word * 4) + 3]) << 24U;
+  }
+}
+}  // namespace
+
+bool mdec::MacroblockFormat::IsColor() const {
+  return depth == OutputDepth::k24Bit || depth == OutputDepth::k15Bit;
+}
+
+uint32_t mdec::MacroblockFormat::GetWordsPerMacroblock() const {
+  switch (depth) {
+    case OutputDepth::k4Bit:
+      return kBlockSize / 8;
+    case OutputDepth::k8Bit:
+      return kBlockSize / 4;
+    case OutputDepth::k24Bit:
+      return (16 * 16 * 3) / 4;
+    case OutputDepth::k15Bit:
+      return (16 * 16 * 2) / 4;
+  }
+  return 0;
+}
+
+void mdec::Mdec::WriteCommand(const uint32_t value) {
+  if (remaining_words_ == 0) {
+    StartCommand(value);
+    return;
+  }
+
+  input_.push_back(value);
+  remaining_words_--;
+
+  if (remaining_words_ == 0) {
+    ExecuteCommand();
+  }
+}
+
+uint32_t mdec::Mdec::ReadData() {
+  if (output_position_ >= output_.size()) {
+    return 0;
+  }
+
+  return output_[output_position_++];
+}
+
+void mdec::Mdec::WriteControl(const uint32_t value) {
+  if ((value & 0x80000000U) != 0U) {
+    Reset();
+  }
+
+  data_in_enabled_ = (value & 0x40000000U) != 0U;
+  data_out_enabled_ = (value & 0x20000000U) != 0U;
+}
+
+uint32_t mdec::Mdec::ReadStatus() const {
+  uint32_t status = 0;
+
+  if (output_position_ >= output_.size()) {
+    status |= 1U << 31U;
+  }
+  if (remaining_words_ != 0) {
+    status |= 1U << 29U;
+  }
+  if (IsDataInRequested()) {
+    status |= 1U << 28U;
+  }
+  if (IsDataOutRequested()) {
+    status |= 1U << 27U;
+  }
+
+  status |= ((command_word_ >> 25U) & 0xFU) << 23U;
+  status |= kCurrentBlockIdle << 16U;
+  status |= (remaining_words_ - 1) & 0xFFFFU;
+
+  return status;
+}
+
+bool mdec::Mdec::IsDataInRequested() const {
+  // A new command waits until the previous output has been read out.
+  return data_in_enabled_ &&
+         (remaining_words_ != 0 || output_position_ >= output_.size());
+}
+
+bool mdec::Mdec::IsDataOutRequested() const {
+  return data_out_enabled_ && output_position_ < output_.size();
+}
+
+void mdec::Mdec::SetWorkerPool(std::shared_ptr<worker_pool::WorkerPool> pool) {
+  pool_ = std::move(pool);
+}
+
+void mdec::Mdec::Save(savestate::Writer& writer) const {
+  writer.BeginSection(kStateTag, kStateVersion);
+  writer.Write(command_word_);
+  writer.Write(remaining_words_);
+  writer.Write(command_);
+  // Field by field, the format's padding byte is not state.
+  writer.Write(format_.depth);
+  writer.Write(format_.output_signed);
+  writer.Write(format_.set_bit15);
+  writer.Write(data_in_enabled_);
+  writer.Write(data_out_enabled_);
+  writer.Write(luminance_quant_table_);
+  writer.Write(color_quant_table_);
+  writer.Write(scale_table_);
+  writer.WriteVector(input_);
+  writer.WriteVector(output_);
+  writer.Write(static_cast<uint64_t>(output_position_));
+  writer.EndSection();
+}
+
+void mdec::Mdec::Load(savestate::Reader& reader) {
+  reader.BeginSection(kStateTag, kStateVersion);
+  reader.Read(command_word_);
+  reader.Read(remaining_words_);
+  reader.Read(command_);
+  reader.Read(format_.depth);
+  reader.Read(format_.output_signed);
+  reader.Read(format_.set_bit15);
+  reader.Read(data_in_enabled_);
+  reader.Read(data_out_enabled_);
+  reader.Read(luminance_quant_table_);
+  reader.Read(color_quant_table_);
+  reader.Read(scale_table_);
+  reader.ReadVector(input_);
+  reader.ReadVector(output_);
+  uint64_t output_position = 0;
+  reader.Read(output_position);
+  output_position_ = std::min<size_t>(output_position, output_.size());
+  reader.EndSection();
+}
+
+void mdec::Mdec::StartCommand(const uint32_t value) {
+  command_word_ = value;
+  format_.depth = static_cast<OutputDepth>((value >> 27U) & 0x3U);
+  format_.output_signed = (value & (1U << 26U)) != 0U;
+  format_.set_bit15 = (value & (1U << 25U)) != 0U;
+  input_.clear();
+
+  switch (value >> 29U) {
+    case static_cast<uint32_t>(Command::kDecodeMacroblock):
+      command_ = Command::kDecodeMacroblock;
+      remaining_words_ = value & 0xFFFFU;
+      break;
+    case static_cast<uint32_t>(Command::kSetQuantTable):
+      command_ = Command::kSetQuantTable;
+      remaining_words_ = (value & 0x1U) != 0U ? 32 : 16;
+      break;
+    case static_cast<uint32_t>(Command::kSetScaleTable):
+      command_ = Command::kSetScaleTable;
+      remaining_words_ = 32;
+      break;
+    default:
+      LOG_INFO_MDEC("Ignoring unknown command {:08X}", value);
+      remaining_words_ = 0;
+      return;
+  }
+
+  input_.reserve(remaining_words_);
+
+  if (remaining_words_ == 0) {
+    ExecuteCommand();
+  }
+}
+
+void mdec::Mdec::ExecuteCommand() {
+  switch (command_) {
+    case Command::kDecodeMacroblock:
+      DecodeMacroblocks();
+      break;
+    case Command::kSetQuantTable:
+      SetQuantTables();
+      break;
+    case Command::kSetScaleTable:
+      SetScaleTable();
+      break;
+  }
+}
+
+void mdec::Mdec::DecodeMacroblocks() {
+  std::vector<uint16_t> halfwords;
+  halfwords.reserve(input_.size() * 2);
+  for (const uint32_t word : input_) {
+    halfwords.push_back(static_cast<uint16_t>(word & 0xFFFFU));
+    halfwords.push_back(static_cast<uint16_t>(word >> 16U));
+  }
+  const std::span<const uint16_t> data(halfwords);
+
+  // Macroblocks are variable length, so find where each one starts before
+  // handing them out to the workers.
+  const uint32_t blocks_per_macroblock =
+      format_.IsColor() ? kColorBlocksPerMacroblock : 1;
+  std::vector<size_t> starts;
+  size_t position = 0;
+  while (position < data.size()) {
+    const size_t start = position;
+    for (uint32_t block = 0;
+         block < blocks_per_macroblock && position <= data.size(); block++) {
+      position = SkipBlock(data, position);
+    }
+    if (position > data.size()) {
+      break;
+    }
+    starts.push_back(start);
+  }
+
+  output_.erase(
+      output_.begin(),
+      output_.begin() + static_cast<std::ptrdiff_t>(output_position_));
+  output_position_ = 0;
+
+  const uint32_t words_per_macroblock = format_.GetWordsPerMacroblock();
+  const size_t base = output_.size();
+  output_.resize(base + (starts.size() * words_per_macroblock));
+
+  const auto decode = [&](const size_t index) {
+    const std::span<uint32_t> output = std::span(output_).subspan(
+        base + (index * words_per_macroblock), words_per_macroblock);
+    size_t block_position = starts[index];
+
+    if (format_.IsColor()) {
+      Block cr{};
+      Block cb{};
+      std::array<Block, 4> luminance{};
+
+      block_position =
+          DecodeBlock(data, block_position, color_quant_table_, cr);
+      InverseDct(scale_table_, cr);
+      block_position =
+          DecodeBlock(data, block_position, color_quant_table_, cb);
+      InverseDct(scale_table_, cb);
+      for (Block& block : luminance) {
+        block_position =
+            DecodeBlock(data, block_position, luminance_quant_table_, block);
+        InverseDct(scale_table_, block);
+      }
+
+      YuvToRgb(cr, cb, luminance, format_, output);
+    } else {
+      Block luminance{};
+      DecodeBlock(data, block_position, luminance_quant_table_, luminance);
+      InverseDct(scale_table_, luminance);
+
+      YToMono(luminance, format_, output);
+    }
+  };
+
+  if (!pool_ || starts.size() < kParallelDecodeThreshold) {
+    for (size_t i = 0; i < starts.size(); i++) {
+      decode(i);
+    }
+    return;
+  }
+
+  pool_->ParallelFor(starts.size(), decode);
+}
+
+void mdec::Mdec::SetQuantTables() {
+  for (uint32_t i = 0; i < kBlockSize; i++) {
+    gsl::at(luminance_quant_table_, i) =
+        static_cast<uint8_t>(gsl::at(input_, i / 4) >> ((i % 4) * 8));
+  }
+
+  if (input_.size() < 32) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < kBlockSize; i++) {
+    gsl::at(color_quant_table_, i) =
+        static_cast<uint8_t>(gsl::at(input_, 16 + (i / 4)) >> ((i % 4) * 8));
+  }
+}
+
+void mdec::Mdec::SetScaleTable() {
+  for (uint32_t i = 0; i < kBlockSize; i++) {
+    const auto value =
+        static_cast<int16_t>(gsl::at(input_, i / 2) >> ((i % 2) * 16));
+    gsl::at(scale_table_, i) = static_cast<int16_t>(value / 8);
+  }
+}
+
+void mdec::Mdec::Reset() {
+  command_word_ = 0;
+  remaining_words_ = 0;
+  input_.clear();
+  output_.clear();
+  output_position_ = 0;
+}
+
+size_t mdec::SkipBlock(const std::span<const uint16_t> data, size_t position) {
+  while (position < data.size() && data[position] == kPadding) {
+    position++;
+  }
+  if (position >= data.size()) {
+    return data.size() + 1;
+  }
+
+  position++;
+
+  uint32_t index = 0;
+  while (position < data.size()) {
+    index += ((data[position++] >> 10U) & 0x3FU) + 1;
+    if (index >= kBlockSize) {
+      return position;
+    }
+  }
+
+  return data.size() + 1;
+}
+
+size_t mdec::DecodeBlock(const std::span<const uint16_t> data, size_t position,
+                         const std::array<uint8_t, kBlockSize>& quant_table,
+                         Block& block) {
+  block.fill(0);
+
+  while (data[position] == kPadding) {
+    position++;
+  }
+
+  uint16_t code = data[position++];
+  const int32_t quant_scale = (code >> 10U) & 0x3F;
+  uint32_t index = 0;
+  int32_t value = SignExtend10(code) * quant_table[0];
+
+  while (true) {
+    if (quant_scale == 0) {
+      value = SignExtend10(code) * 2;
+    }
+    value = std::clamp(value, -0x400, 0x3FF);
+
+    if (quant_scale > 0) {
+      gsl::at(block, gsl::at(kZagZig, index)) = static_cast<int16_t>(value);
+    } else {
+      gsl::at(block, index) = static_cast<int16_t>(value);
+    }
+
+    code = data[position++];
+    index += ((code >> 10U) & 0x3FU) + 1;
+    if (index >= kBlockSize) {
+      return position;
+    }
+
+    value = ((SignExtend10(code) * gsl::at(quant_table, index) * quant_scale) +
+             4) /
+            8;
+  }
+}
+
+void mdec::InverseDct(const Block& scale_table, Block& block) {
+  Block temporary{};
+  IdctPass(block.data(), scale_table.data(), temporary.data());
+  IdctPass(temporary.data(), scale_table.data(), block.data());
+}
+
+void mdec::YuvToRgb(const Block& cr, const Block& cb,
+                    const std::array<Block, 4>& luminance,
+                    const MacroblockFormat& format,
+                    const std::span<uint32_t> output) {
+  const uint8_t sign_flip = format.output_signed ? 0x00 : 0x80;
+  std::array<uint8_t, 16 * 16 * 3> rgb24{};
+  std::array<uint8_t, 16 * 16 * 2> rgb15{};
+
+  for (uint32_t block = 0; block < 4; block++) {
+    const uint32_t block_x = (block % 2) * 8;
+    const uint32_t block_y = (block / 2) * 8;
+
+    for (uint32_t y = 0; y < 8; y++) {
+      const uint32_t chroma_offset = (((block_y + y) / 2) * 8) + (block_x / 2);
+
+      std::array<int8_t, 8> red{};
+      std::array<int8_t, 8> green{};
+      std::array<int8_t, 8> blue{};
+      ConvertRow(gsl::at(luminance, block).data() + (y * 8),
+                 cr.data() + chroma_offset, cb.data() + chroma_offset, red,
+                 green, blue);
+
+      for (uint32_t x = 0; x < 8; x++) {
+        const uint32_t pixel = (block_x + x) + ((block_y + y) * 16);
+        const auto r = static_cast<uint8_t>(gsl::at(red, x) ^ sign_flip);
+        const auto g = static_cast<uint8_t>(gsl::at(green, x) ^ sign_flip);
+        const auto b = static_cast<uint8_t>(gsl::at(blue, x) ^ sign_flip);
+
+        if (format.depth == OutputDepth::k24Bit) {
+          gsl::at(rgb24, (pixel * 3) + 0) = r;
+          gsl::at(rgb24, (pixel * 3) + 1) = g;
+          gsl::at(rgb24, (pixel * 3) + 2) = b;
+        } else {
+          const uint32_t color = (r >> 3U) | (g >> 3U) << 5U |
+                                 (b >> 3U) << 10U |
+                                 (format.set_bit15 ? 0x8000U : 0U);
+          gsl::at(rgb15, (pixel * 2) + 0) = static_cast<uint8_t>(color);
+          gsl::at(rgb15, (pixel * 2) + 1) = static_cast<uint8_t>(color >> 8U);
+        }
+      }
+    }
+  }
+
+  if (format.depth == OutputDepth::k24Bit) {
+    PackBytes(rgb24, output);
+  } else {
+    PackBytes(rgb15, output);
+  }
+}
+
+void mdec::YToMono(const Block& luminance, const MacroblockFormat& format,
+                   const std::span<uint32_t> output) {
+  const uint8_t sign_flip = format.output_signed ? 0x00 : 0x80;
+  std::array<uint8_t, kBlockSize> mono{};
+
+  for (uint32_t i = 0; i < kBlockSize; i++) {
+    // Clip to signed 9 bits, then saturate to signed 8 bits.
+    const int32_t value =
+        static_cast<int32_t>(static_cast<uint32_t>(gsl::at(luminance, i))
+                             << 23U) >>
+        23;
+    gsl::at(mono, i) = static_cast<uint8_t>(Saturate8(value) ^ sign_flip);
+  }
+
+  if (format.depth == OutputDepth::k8Bit) {
+    PackBytes(mono, output);
+    return;
+  }
+
+  std::array<uint8_t, kBlockSize / 2> packed{};
+  for (uint32_t i = 0; i < kBlockSize / 2; i++) {
+    gsl::at(packed, i) =
+        static_cast<uint8_t>((gsl::at(mono, (i * 2) + 0) >> 4U) |
+                             (gsl::at(mono, (i * 2) + 1) & 0xF0U));
+  }
+  PackBytes(packed, output);
+}
@@ -0,0 +1,110 @@
+#ifndef POLYSTATION_MDEC_H
+#define POLYSTATION_MDEC_H
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "savestate.h"
+#include "worker_pool.h"
+
+namespace mdec {
+constexpr uint32_t kBlockSize = 64;
+constexpr uint32_t kColorBlocksPerMacroblock = 6;
+
+// Batches smaller than this are decoded on the calling thread, waking the
+// workers costs more than a couple of macroblocks.
+constexpr size_t kParallelDecodeThreshold = 4;
+
+enum class OutputDepth : uint8_t {
+  k4Bit = 0,
+  k8Bit = 1,
+  k24Bit = 2,
+  k15Bit = 3
+};
+
+enum class Command : uint8_t {
+  kDecodeMacroblock = 1,
+  kSetQuantTable = 2,
+  kSetScaleTable = 3
+};
+
+using Block = std::array<int16_t, kBlockSize>;
+
+struct MacroblockFormat {
+  OutputDepth depth = OutputDepth::k4Bit;
+  bool output_signed = false;
+  bool set_bit15 = false;
+
+  [[nodiscard]] bool IsColor() const;
+  [[nodiscard]] uint32_t GetWordsPerMacroblock() const;
+} __attribute__((aligned(4)));
+
+class Mdec {
+ public:
+  // 0x1F801820
+  void WriteCommand(uint32_t value);
+  [[nodiscard]] uint32_t ReadData();
+  // 0x1F801824
+  void WriteControl(uint32_t value);
+  [[nodiscard]] uint32_t ReadStatus() const;
+
+  [[nodiscard]] bool IsDataInRequested() const;
+  [[nodiscard]] bool IsDataOutRequested() const;
+
+  // Large batches are split across `pool`, which machines sharing a host
+  // should share. Without one every batch decodes on the calling thread.
+  void SetWorkerPool(std::shared_ptr<worker_pool::WorkerPool> pool);
+
+  void Save(savestate::Writer& writer) const;
+  void Load(savestate::Reader& reader);
+
+ private:
+  uint32_t command_word_ = 0;
+  uint32_t remaining_words_ = 0;
+  Command command_ = Command::kDecodeMacroblock;
+  MacroblockFormat format_{};
+  bool data_in_enabled_ = false;
+  bool data_out_enabled_ = false;
+
+  std::array<uint8_t, kBlockSize> luminance_quant_table_{};
+  std::array<uint8_t, kBlockSize> color_quant_table_{};
+  // Stored already divided by 8, the way the IDCT consumes it.
+  Block scale_table_{};
+
+  std::vector<uint32_t> input_;
+  std::vector<uint32_t> output_;
+  size_t output_position_ = 0;
+
+  std::shared_ptr<worker_pool::WorkerPool> pool_;
+
+  void StartCommand(uint32_t value);
+  void ExecuteCommand();
+  void DecodeMacroblocks();
+  void SetQuantTables();
+  void SetScaleTable();
+  void Reset();
+};
+
+// Returns the halfword position right after the block starting at `position`,
+// or data.size() + 1 if the block is truncated.
+size_t SkipBlock(std::span<const uint16_t> data, size_t position);
+
+// Run-length decodes and dequantizes one 8x8 block into natural order and
+// returns the halfword position right after it.
+size_t DecodeBlock(std::span<const uint16_t> data, size_t position,
+                   const std::array<uint8_t, kBlockSize>& quant_table,
+                   Block& block);
+
+void InverseDct(const Block& scale_table, Block& block);
+
+void YuvToRgb(const Block& cr, const Block& cb,
+              const std::array<Block, 4>& luminance,
+              const MacroblockFormat& format, std::span<uint32_t> output);
+
+void YToMono(const Block& luminance, const MacroblockFormat& format,
+             std::span<uint32_t> output);
+}  // namespace mdec
+
+#endif  // POLYSTATION_MDEC_H
@@ -0,0 +1,261 @@
+#include "metrics.h"
+
+#include <format>
+#include <fstream>
+#include <gsl/gsl>
+#include <stdexcept>
+
+namespace {
+constexpr std::array<std::string_view, metrics::kSubsystemCount>
+    kSubsystemNames = {"cpu", "rewind", "ui", "present"};
+
+constexpr std::string_view kPrefix = "polystation_";
+
+class Collector {
+ public:
+  void Add(const std::string_view name, const std::string_view help,
+           const metrics::Type type, const double value) {
+    AddLabelled(name, help, type, "", "", value);
+  }
+
+  void AddLabelled(const std::string_view name, const std::string_view help,
+                   const metrics::Type type, const std::string_view label,
+                   const std::string_view label_value, const double value) {
+    samples_.push_back(metrics::Sample{.name = name,
+                                       .help = help,
+                                       .type = type,
+                                       .label = label,
+                                       .label_value = label_value,
+                                       .value = value});
+  }
+
+  [[nodiscard]] std::vector<metrics::Sample> Take() {
+    return std::move(samples_);
+  }
+
+ private:
+  std::vector<metrics::Sample> samples_;
+};
+
+void AddBusAccesses(
+    Collector& collector, const std::string_view name,
+    const std::string_view help,
+    const std::array<unsigned long long, bus::kMemoryRegionCount>& counts,
+    const unsigned long long scratchpad) {
+  constexpr auto kCounter = metrics::Type::kCounter;
+  for (size_t i = 0; i < bus::kMemoryRegionCount; i++) {
+    collector.AddLabelled(
+        name, help, kCounter, "region",
+        bus::GetMemoryRegionName(static_cast<bus::MemoryRegion>(i)),
+        static_cast<double>(gsl::at(counts, i)));
+  }
+  collector.AddLabelled(name, help, kCounter, "region", "scratchpad",
+                        static_cast<double>(scratchpad));
+}
+
+bool StartsGroup(const std::span<const metrics::Sample> samples,
+                 const size_t index) {
+  return index == 0 || gsl::at(samples, index - 1).name !=
+                           gsl::at(samples, index).name;
+}
+
+bool EndsGroup(const std::span<const metrics::Sample> samples,
+               const size_t index) {
+  return index + 1 == samples.size() ||
+         gsl::at(samples, index + 1).name != gsl::at(samples, index).name;
+}
+}  // namespace
+
+std::string_view metrics::GetSubsystemName(const Subsystem subsystem) {
+  return gsl::at(kSubsystemNames, static_cast<size_t>(subsystem));
+}
+
+void metrics::FrameTimer::Start(const Subsystem subsystem) {
+  EndLap();
+  running_ = subsystem;
+}
+
+void metrics::FrameTimer::EndFrame(const unsigned long long instructions) {
+  EndLap();
+  running_ = std::nullopt;
+
+  last_ = current_;
+  current_.fill(0.0);
+
+  // Loading a state or resetting moves the step count backwards.
+  const double cpu_milliseconds = GetMilliseconds(Subsystem::kCpu);
+  if (instructions >= instructions_ && cpu_milliseconds > 0.0) {
+    mips_ = static_cast<double>(instructions - instructions_) /
+            (cpu_milliseconds * 1000.0);
+  } else {
+    mips_ = 0.0;
+  }
+  instructions_ = instructions;
+}
+
+double metrics::FrameTimer::GetMilliseconds(const Subsystem subsystem) const {
+  return gsl::at(last_, static_cast<size_t>(subsystem));
+}
+
+double metrics::FrameTimer::GetTotalMilliseconds() const {
+  double total = 0.0;
+  for (const double milliseconds : last_) {
+    total += milliseconds;
+  }
+  return total;
+}
+
+double metrics::FrameTimer::GetMips() const { return mips_; }
+
+void metrics::FrameTimer::EndLap() {
+  const Clock::time_point now = Clock::now();
+  if (running_.has_value()) {
+    const std::chrono::duration<double, std::milli> elapsed = now - lap_start_;
+    gsl::at(current_, static_cast<size_t>(running_.value())) +=
+        elapsed.count();
+  }
+  lap_start_ = now;
+}
+
+std::vector<metrics::Sample> metrics::Collect(const cpu::CPU& cpu,
+                                              const FrameTimer* timer) {
+  constexpr auto kCounter = Type::kCounter;
+  constexpr auto kGauge = Type::kGauge;
+
+  Collector collector;
+  collector.Add("instructions_total", "Instructions executed.", kCounter,
+                static_cast<double>(cpu.GetStepCount()));
+  collector.Add("cycles_total", "Emulated CPU cycles.", kCounter,
+                static_cast<double>(cpu.GetCycleCount()));
+
+  const bus::Stats& bus = cpu.GetBusStats();
+  AddBusAccesses(collector, "bus_loads_total",
+                 "Bus loads by region, instruction fetches included.",
+                 bus.loads, bus.scratchpad_loads);
+  AddBusAccesses(collector, "bus_stores_total", "Bus stores by region.",
+                 bus.stores, bus.scratchpad_stores);
+  collector.Add("bus_unhandled_total",
+                "Accesses no device handles, served by the logging slow path.",
+                kCounter, static_cast<double>(bus.unhandled));
+  collector.Add("bus_errors_total", "Accesses to unmapped addresses.",
+                kCounter, static_cast<double>(bus.bus_errors));
+  collector.Add("dma_transfers_total", "DMA transfers run.", kCounter,
+                static_cast<double>(bus.dma_transfers));
+  collector.Add("dma_words_total", "Words moved by DMA.", kCounter,
+                static_cast<double>(bus.dma_words));
+
+  const icache::Stats& icache = cpu.GetInstructionCacheStats();
+  collector.Add("icache_misses_total",
+                "Instruction cache line refills, accurate mode only.",
+                kCounter, static_cast<double>(icache.misses));
+  collector.Add("icache_invalidations_total",
+                "Instruction cache lines invalidated.", kCounter,
+                static_cast<double>(icache.invalidations));
+
+  collector.Add("hle_calls_total", "Kernel calls run natively.", kCounter,
+                static_cast<double>(cpu.GetHleStats().calls));
+  const idle_loop::Stats& idle_loop = cpu.GetIdleLoopStats();
+  collector.Add("idle_loops_skipped_total", "Idle loops fast-forwarded.",
+                kCounter, static_cast<double>(idle_loop.loops_skipped));
+  collector.Add("idle_cycles_skipped_total", "Cycles skipped in idle loops.",
+                kCounter, static_cast<double>(idle_loop.cycles_skipped));
+
+  const block_cache::Stats& blocks = cpu.GetBlockCache().GetStats();
+  collector.Add("blocks_translated_total",
+                "Blocks translated by the cached interpreter.", kCounter,
+                static_cast<double>(blocks.translated));
+  collector.Add("blocks_loaded_total",
+                "Blocks taken from a block cache file instead.", kCounter,
+                static_cast<double>(blocks.loaded));
+  collector.Add("blocks_executed_total", "Translated blocks run.", kCounter,
+                static_cast<double>(blocks.executed));
+  collector.Add("block_invalidations_total",
+                "Blocks translated again after their code changed.",
+                kCounter, static_cast<double>(blocks.invalidated));
+
+  if (timer != nullptr) {
+    for (size_t i = 0; i < kSubsystemCount; i++) {
+      const auto subsystem = static_cast<Subsystem>(i);
+      collector.AddLabelled("frame_milliseconds",
+                            "Host time of the last frame by subsystem.",
+                            kGauge, "subsystem", GetSubsystemName(subsystem),
+                            timer->GetMilliseconds(subsystem));
+    }
+    collector.Add("mips", "Emulated MIPS over the last frame's CPU time.",
+                  kGauge, timer->GetMips());
+  }
+
+  return collector.Take();
+}
+
+std::string metrics::FormatPrometheus(const std::span<const Sample> samples) {
+  std::string text;
+  for (size_t i = 0; i < samples.size(); i++) {
+    const Sample& sample = gsl::at(samples, i);
+    if (StartsGroup(samples, i)) {
+      text += std::format("# HELP {}{} {}\n", kPrefix, sample.name,
+                          sample.help);
+      text += std::format("# TYPE {}{} {}\n", kPrefix, sample.name,
+                          sample.type == Type::kCounter ? "counter" : "gauge");
+    }
+
+    if (sample.label.empty()) {
+      text += std::format("{}{} {}\n", kPrefix, sample.name, sample.value);
+    } else {
+      text += std::format("{}{}{{{}=\"{}\"}} {}\n", kPrefix, sample.name,
+                          sample.label, sample.label_value, sample.value);
+    }
+  }
+  return text;
+}
+
+std::string metrics::FormatJson(const std::span<const Sample> samples) {
+  std::string json = "{";
+  for (size_t i = 0; i < samples.size(); i++) {
+    const Sample& sample = gsl::at(samples, i);
+    if (StartsGroup(samples, i)) {
+      json += std::format(R"({}"{}":)", i == 0 ? "" : ",", sample.name);
+      if (!sample.label.empty()) {
+        json += '{';
+      }
+    } else {
+      json += ',';
+    }
+
+    if (sample.label.empty()) {
+      json += std::format("{}", sample.value);
+    } else {
+      json += std::format(R"("{}":{})", sample.label_value, sample.value);
+      if (EndsGroup(samples, i)) {
+        json += '}';
+      }
+    }
+  }
+  json += "}\n";
+  return json;
+}
+
+void metrics::WriteFile(const std::filesystem::path& path,
+                        const std::span<const Sample> samples) {
+  const std::string text = path.extension() == ".json"
+                               ? FormatJson(samples)
+                               : FormatPrometheus(samples);
+
+  std::filesystem::path temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream output(temporary, std::ios::trunc);
+    output << text;
+    if (!output) {
+      throw std::runtime_error(
+          std::format("failed to write metrics {}", temporary.string()));
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    throw std::runtime_error(std::format("failed to write metrics {}: {}",
+                                         path.string(), error.message()));
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef POLYSTATION_METRICS_H
+#define POLYSTATION_METRICS_H
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cpu.h"
+
+namespace metrics {
+enum class Subsystem : uint8_t { kCpu, kRewind, kUi, kPresent };
+
+constexpr size_t kSubsystemCount = 4;
+
+// Lower case, usable as a metric label.
+[[nodiscard]] std::string_view GetSubsystemName(Subsystem subsystem);
+
+enum class Type : uint8_t { kCounter, kGauge };
+
+// One value of a metric, the samples of a labelled metric are adjacent.
+struct Sample {
+  std::string_view name;
+  std::string_view help;
+  Type type = Type::kCounter;
+  // Both empty for metrics without labels.
+  std::string_view label;
+  std::string_view label_value;
+  double value = 0.0;
+} __attribute__((aligned(128)));
+
+// Splits each frame's host time between subsystems, and measures emulated
+// MIPS against the time spent in Subsystem::kCpu.
+class FrameTimer {
+ public:
+  // Charges the time from now on to `subsystem`, until the next Start or
+  // EndFrame.
+  void Start(Subsystem subsystem);
+  // `instructions` is the CPU's step count at the end of the frame.
+  void EndFrame(unsigned long long instructions);
+
+  // Of the last finished frame.
+  [[nodiscard]] double GetMilliseconds(Subsystem subsystem) const;
+  [[nodiscard]] double GetTotalMilliseconds() const;
+  [[nodiscard]] double GetMips() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  std::optional<Subsystem> running_ = std::nullopt;
+  Clock::time_point lap_start_;
+  std::array<double, kSubsystemCount> current_{};
+  std::array<double, kSubsystemCount> last_{};
+  unsigned long long instructions_ = 0;
+  double mips_ = 0.0;
+
+  void EndLap();
+};
+
+// Snapshot of the machine's host-side counters, plus the frame timings when
+// `timer` is given. A machine only runs on one thread, so its counters are
+// plain per-machine fields and must be collected on that thread.
+[[nodiscard]] std::vector<Sample> Collect(const cpu::CPU& cpu,
+                                          const FrameTimer* timer = nullptr);
+
+// Text exposition format, names get a "polystation_" prefix.
+[[nodiscard]] std::string FormatPrometheus(std::span<const Sample> samples);
+// One object, labelled metrics become nested objects keyed by label value.
+[[nodiscard]] std::string FormatJson(std::span<const Sample> samples);
+
+// JSON for a .json path, Prometheus text otherwise. The dump goes to a
+// temporary file renamed over `path`, readers never see half of one.
+void WriteFile(const std::filesystem::path& path,
+               std::span<const Sample> samples);
+}  // namespace metrics
+
+#endif  // POLYSTATION_METRICS_H
@@ -0,0 +1,595 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <gsl/gsl>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+#include "hle.h"
+#include "isa.h"
+
+namespace {
+constexpr uint32_t kInstructionLength = 4;
+
+// Kernel calls are named by table and function number. Instructions are
+// word aligned, so the low bit tells them apart from code addresses.
+constexpr uint32_t kKernelCallTag = 1;
+
+constexpr uint32_t MakeKernelCall(const uint32_t table,
+                                  const uint32_t function) {
+  return (function & 0xFFU) << 16U | table << 8U | kKernelCallTag;
+}
+
+struct KernelFunction {
+  uint32_t table = 0;
+  uint32_t function = 0;
+  std::string_view name;
+} __attribute__((aligned(32)));
+
+// The commonly used part of the kernel tables, other calls are shown by
+// number.
+constexpr std::array kKernelFunctions = {
+    KernelFunction{0xA0, 0x00, "FileOpen"},
+    KernelFunction{0xA0, 0x01, "FileSeek"},
+    KernelFunction{0xA0, 0x02, "FileRead"},
+    KernelFunction{0xA0, 0x03, "FileWrite"},
+    KernelFunction{0xA0, 0x04, "FileClose"},
+    KernelFunction{0xA0, 0x06, "exit"},
+    KernelFunction{0xA0, 0x13, "setjmp"},
+    KernelFunction{0xA0, 0x14, "longjmp"},
+    KernelFunction{0xA0, 0x15, "strcat"},
+    KernelFunction{0xA0, 0x16, "strncat"},
+    KernelFunction{0xA0, 0x17, "strcmp"},
+    KernelFunction{0xA0, 0x18, "strncmp"},
+    KernelFunction{0xA0, 0x19, "strcpy"},
+    KernelFunction{0xA0, 0x1A, "strncpy"},
+    KernelFunction{0xA0, 0x1B, "strlen"},
+    KernelFunction{0xA0, 0x25, "toupper"},
+    KernelFunction{0xA0, 0x26, "tolower"},
+    KernelFunction{0xA0, 0x27, "bcopy"},
+    KernelFunction{0xA0, 0x28, "bzero"},
+    KernelFunction{0xA0, 0x29, "bcmp"},
+    KernelFunction{0xA0, 0x2A, "memcpy"},
+    KernelFunction{0xA0, 0x2B, "memset"},
+    KernelFunction{0xA0, 0x2C, "memmove"},
+    KernelFunction{0xA0, 0x2D, "memcmp"},
+    KernelFunction{0xA0, 0x2E, "memchr"},
+    KernelFunction{0xA0, 0x2F, "rand"},
+    KernelFunction{0xA0, 0x30, "srand"},
+    KernelFunction{0xA0, 0x31, "qsort"},
+    KernelFunction{0xA0, 0x33, "malloc"},
+    KernelFunction{0xA0, 0x34, "free"},
+    KernelFunction{0xA0, 0x37, "calloc"},
+    KernelFunction{0xA0, 0x38, "realloc"},
+    KernelFunction{0xA0, 0x39, "InitHeap"},
+    KernelFunction{0xA0, 0x3C, "putchar"},
+    KernelFunction{0xA0, 0x3E, "puts"},
+    KernelFunction{0xA0, 0x3F, "printf"},
+    KernelFunction{0xA0, 0x41, "LoadExeHeader"},
+    KernelFunction{0xA0, 0x42, "LoadExeFile"},
+    KernelFunction{0xA0, 0x43, "DoExecute"},
+    KernelFunction{0xA0, 0x44, "FlushCache"},
+    KernelFunction{0xA0, 0x49, "GPU_cw"},
+    KernelFunction{0xA0, 0x4D, "GetGPUStatus"},
+    KernelFunction{0xA0, 0x51, "LoadAndExecute"},
+    KernelFunction{0xA0, 0x72, "CdRemove"},
+    KernelFunction{0xA0, 0x96, "AddCDROMDevice"},
+    KernelFunction{0xA0, 0x97, "AddMemCardDevice"},
+    KernelFunction{0xA0, 0x9C, "SetConf"},
+    KernelFunction{0xA0, 0x9D, "GetConf"},
+    KernelFunction{0xA0, 0x9F, "SetMemSize"},
+    KernelFunction{0xA0, 0xA0, "WarmBoot"},
+    KernelFunction{0xA0, 0xA4, "CdGetLbn"},
+    KernelFunction{0xA0, 0xA5, "CdReadSector"},
+    KernelFunction{0xA0, 0xA6, "CdGetStatus"},
+    KernelFunction{0xB0, 0x00, "alloc_kernel_memory"},
+    KernelFunction{0xB0, 0x01, "free_kernel_memory"},
+    KernelFunction{0xB0, 0x02, "init_timer"},
+    KernelFunction{0xB0, 0x03, "get_timer"},
+    KernelFunction{0xB0, 0x04, "enable_timer_irq"},
+    KernelFunction{0xB0, 0x05, "disable_timer_irq"},
+    KernelFunction{0xB0, 0x06, "restart_timer"},
+    KernelFunction{0xB0, 0x07, "DeliverEvent"},
+    KernelFunction{0xB0, 0x08, "OpenEvent"},
+    KernelFunction{0xB0, 0x09, "CloseEvent"},
+    KernelFunction{0xB0, 0x0A, "WaitEvent"},
+    KernelFunction{0xB0, 0x0B, "TestEvent"},
+    KernelFunction{0xB0, 0x0C, "EnableEvent"},
+    KernelFunction{0xB0, 0x0D, "DisableEvent"},
+    KernelFunction{0xB0, 0x0E, "OpenThread"},
+    KernelFunction{0xB0, 0x0F, "CloseThread"},
+    KernelFunction{0xB0, 0x10, "ChangeThread"},
+    KernelFunction{0xB0, 0x12, "InitPad"},
+    KernelFunction{0xB0, 0x13, "StartPad"},
+    KernelFunction{0xB0, 0x14, "StopPad"},
+    KernelFunction{0xB0, 0x17, "ReturnFromException"},
+    KernelFunction{0xB0, 0x18, "SetDefaultExitFromException"},
+    KernelFunction{0xB0, 0x19, "SetCustomExitFromException"},
+    KernelFunction{0xB0, 0x20, "UnDeliverEvent"},
+    KernelFunction{0xB0, 0x32, "FileOpen"},
+    KernelFunction{0xB0, 0x33, "FileSeek"},
+    KernelFunction{0xB0, 0x34, "FileRead"},
+    KernelFunction{0xB0, 0x35, "FileWrite"},
+    KernelFunction{0xB0, 0x36, "FileClose"},
+    KernelFunction{0xB0, 0x38, "exit"},
+    KernelFunction{0xB0, 0x3D, "putchar"},
+    KernelFunction{0xB0, 0x3F, "puts"},
+    KernelFunction{0xB0, 0x42, "firstfile"},
+    KernelFunction{0xB0, 0x43, "nextfile"},
+    KernelFunction{0xB0, 0x44, "FileRename"},
+    KernelFunction{0xB0, 0x45, "FileDelete"},
+    KernelFunction{0xB0, 0x47, "AddDevice"},
+    KernelFunction{0xB0, 0x48, "RemoveDevice"},
+    KernelFunction{0xB0, 0x4A, "InitCard"},
+    KernelFunction{0xB0, 0x4B, "StartCard"},
+    KernelFunction{0xB0, 0x4C, "StopCard"},
+    KernelFunction{0xB0, 0x4E, "write_card_sector"},
+    KernelFunction{0xB0, 0x4F, "read_card_sector"},
+    KernelFunction{0xB0, 0x50, "allow_new_card"},
+    KernelFunction{0xB0, 0x54, "GetLastError"},
+    KernelFunction{0xB0, 0x56, "GetC0Table"},
+    KernelFunction{0xB0, 0x57, "GetB0Table"},
+    KernelFunction{0xB0, 0x5B, "ChangeClearPad"},
+    KernelFunction{0xC0, 0x00, "EnqueueTimerAndVblankIrqs"},
+    KernelFunction{0xC0, 0x01, "EnqueueSyscallHandler"},
+    KernelFunction{0xC0, 0x02, "SysEnqIntRP"},
+    KernelFunction{0xC0, 0x03, "SysDeqIntRP"},
+    KernelFunction{0xC0, 0x07, "InstallExceptionHandlers"},
+    KernelFunction{0xC0, 0x08, "SysInitMemory"},
+    KernelFunction{0xC0, 0x09, "SysInitKernelVariables"},
+    KernelFunction{0xC0, 0x0A, "ChangeClearRCnt"},
+    KernelFunction{0xC0, 0x0C, "InitDefInt"},
+    KernelFunction{0xC0, 0x0D, "SetIrqAutoAck"},
+    KernelFunction{0xC0, 0x12, "InstallDevices"},
+    KernelFunction{0xC0, 0x1C, "AdjustA0Table"},
+};
+
+constexpr std::array<char, 4> kElfMagic = {0x7F, 'E', 'L', 'F'};
+constexpr uint8_t kElfClass32 = 1;
+constexpr uint8_t kElfLittleEndian = 1;
+constexpr size_t kElfClassOffset = 4;
+constexpr size_t kElfDataOffset = 5;
+constexpr size_t kSectionTableOffset = 0x20;
+constexpr size_t kSectionEntrySizeOffset = 0x2E;
+constexpr size_t kSectionCountOffset = 0x30;
+constexpr size_t kSectionHeaderSize = 40;
+constexpr size_t kSymbolSize = 16;
+constexpr uint32_t kSymbolTableSection = 2;
+constexpr uint8_t kFunctionSymbol = 2;
+constexpr uint8_t kUntypedSymbol = 0;
+constexpr uint8_t kGlobalBinding = 1;
+
+template <typename T>
+T ReadElf(const std::vector<char>& data, const size_t offset) {
+  if (offset > data.size() || data.size() - offset < sizeof(T)) {
+    throw std::runtime_error("Truncated ELF file");
+  }
+  T value{};
+  std::memcpy(&value, &data.at(offset), sizeof(T));
+  return value;
+}
+
+std::optional<uint32_t> ParseHex(std::string_view text) {
+  if (text.starts_with("0x") || text.starts_with("0X")) {
+    text.remove_prefix(2);
+  }
+  if (text.empty() || text.size() > 8) {
+    return std::nullopt;
+  }
+  uint32_t value = 0;
+  const char* end = text.data() + text.size();
+  if (const auto [last, error] = std::from_chars(text.data(), end, value, 16);
+      error != std::errc{} || last != end) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+bool IsIdentifier(const std::string_view text) {
+  const auto is_start = [](const char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+  };
+  return !text.empty() && is_start(text.front()) &&
+         std::ranges::all_of(text, [&is_start](const char c) {
+           return is_start(c) || (c >= '0' && c <= '9') || c == '.' ||
+                  c == '$';
+         });
+}
+
+std::vector<std::string_view> Split(const std::string_view line) {
+  std::vector<std::string_view> tokens;
+  size_t position = 0;
+  while ((position = line.find_first_not_of(" \t\r", position)) !=
+         std::string_view::npos) {
+    const size_t end = std::min(line.find_first_of(" \t\r", position),
+                                line.size());
+    tokens.push_back(line.substr(position, end - position));
+    position = end;
+  }
+  return tokens;
+}
+
+// Names end up in collapsed stack lines, which split on ';' and ' '.
+std::string Sanitize(std::string name) {
+  std::ranges::replace(name, ';', '_');
+  std::ranges::replace(name, ' ', '_');
+  return name;
+}
+}  // namespace
+
+void profiler::Symbols::Load(const std::filesystem::path& path) {
+  std::ifstream input(path, std::ios::binary);
+  if (!input) {
+    throw std::runtime_error(
+        std::format("Failed to open symbols {}", path.string()));
+  }
+  const std::vector<char> data{std::istreambuf_iterator<char>(input),
+                               std::istreambuf_iterator<char>()};
+
+  if (data.size() >= kElfMagic.size() &&
+      std::equal(kElfMagic.begin(), kElfMagic.end(), data.begin())) {
+    LoadElf(data);
+  } else {
+    LoadMap(data);
+  }
+
+  std::ranges::stable_sort(symbols_, {}, &Symbol::address);
+  const auto duplicates = std::ranges::unique(symbols_, {}, &Symbol::address);
+  symbols_.erase(duplicates.begin(), duplicates.end());
+}
+
+void profiler::Symbols::Clear() { symbols_.clear(); }
+
+bool profiler::Symbols::IsEmpty() const { return symbols_.empty(); }
+
+size_t profiler::Symbols::GetCount() const { return symbols_.size(); }
+
+const profiler::Symbol* profiler::Symbols::Find(const uint32_t address) const {
+  const auto next = std::ranges::upper_bound(symbols_, address, {},
+                                             &Symbol::address);
+  if (next == symbols_.begin()) {
+    return nullptr;
+  }
+  const Symbol& symbol = *std::prev(next);
+  if (symbol.size != 0 && address - symbol.address >= symbol.size) {
+    return nullptr;
+  }
+  return &symbol;
+}
+
+void profiler::Symbols::LoadElf(const std::vector<char>& data) {
+  if (data.size() <= kElfDataOffset ||
+      data.at(kElfClassOffset) != kElfClass32 ||
+      data.at(kElfDataOffset) != kElfLittleEndian) {
+    throw std::runtime_error(
+        "Only 32-bit little endian ELF files are supported");
+  }
+
+  const auto section_table = ReadElf<uint32_t>(data, kSectionTableOffset);
+  const auto entry_size = ReadElf<uint16_t>(data, kSectionEntrySizeOffset);
+  const auto section_count = ReadElf<uint16_t>(data, kSectionCountOffset);
+  if (entry_size < kSectionHeaderSize) {
+    throw std::runtime_error("Invalid ELF section header size");
+  }
+
+  const auto get_section = [&](const uint32_t index) {
+    return section_table + static_cast<size_t>(index) * entry_size;
+  };
+
+  for (uint32_t i = 0; i < section_count; i++) {
+    const size_t section = get_section(i);
+    if (ReadElf<uint32_t>(data, section + 4) != kSymbolTableSection) {
+      continue;
+    }
+    const auto offset = ReadElf<uint32_t>(data, section + 16);
+    const auto size = ReadElf<uint32_t>(data, section + 20);
+    const auto link = ReadElf<uint32_t>(data, section + 24);
+    const auto strings = ReadElf<uint32_t>(data, get_section(link) + 16);
+
+    for (size_t symbol = offset; symbol + kSymbolSize <= offset + size;
+         symbol += kSymbolSize) {
+      const auto name = ReadElf<uint32_t>(data, symbol);
+      const auto value = ReadElf<uint32_t>(data, symbol + 4);
+      const auto length = ReadElf<uint32_t>(data, symbol + 8);
+      const auto info = ReadElf<uint8_t>(data, symbol + 12);
+      const auto section_index = ReadElf<uint16_t>(data, symbol + 14);
+
+      // Functions, and global labels from assembly.
+      const auto type = static_cast<uint8_t>(info & 0xFU);
+      const auto binding = static_cast<uint8_t>(info >> 4U);
+      if (name == 0 || section_index == 0 ||
+          (type != kFunctionSymbol &&
+           (type != kUntypedSymbol || binding != kGlobalBinding))) {
+        continue;
+      }
+
+      const size_t name_offset = strings + static_cast<size_t>(name);
+      if (name_offset >= data.size()) {
+        throw std::runtime_error("Invalid ELF symbol name");
+      }
+      const std::string_view text(&data.at(name_offset),
+                                  strnlen(&data.at(name_offset),
+                                          data.size() - name_offset));
+      symbols_.push_back(Symbol{.address = value,
+                                .size = length,
+                                .name = Sanitize(std::string(text))});
+    }
+  }
+}
+
+void profiler::Symbols::LoadMap(const std::vector<char>& data) {
+  const std::string_view text(data.data(), data.size());
+  size_t position = 0;
+  while (position < text.size()) {
+    const size_t end = std::min(text.find('\n', position), text.size());
+    const std::vector<std::string_view> tokens =
+        Split(text.substr(position, end - position));
+    position = end + 1;
+
+    // "<address> <name>" or "<address> <size> <name>".
+    if (tokens.size() < 2 || tokens.size() > 3 ||
+        !IsIdentifier(tokens.back())) {
+      continue;
+    }
+    const std::optional<uint32_t> address = ParseHex(tokens.front());
+    std::optional<uint32_t> size = 0;
+    if (tokens.size() == 3) {
+      size = ParseHex(tokens[1]);
+    }
+    if (!address.has_value() || !size.has_value()) {
+      continue;
+    }
+    symbols_.push_back(Symbol{.address = address.value(),
+                              .size = size.value(),
+                              .name = std::string(tokens.back())});
+  }
+}
+
+void profiler::Profiler::SetInterval(const uint64_t cycles) {
+  interval_ = std::max<uint64_t>(cycles, 1);
+}
+
+uint64_t profiler::Profiler::GetInterval() const { return interval_; }
+
+void profiler::Profiler::Start(const uint32_t pc, const uint64_t cycle) {
+  const Symbol* symbol = symbols_.Find(pc);
+  stack_.clear();
+  stack_.push_back(
+      Frame{.node = GetChild(0, symbol != nullptr ? symbol->address : pc)});
+  next_sample_ = cycle + interval_;
+  running_ = true;
+}
+
+void profiler::Profiler::Stop() { running_ = false; }
+
+bool profiler::Profiler::IsRunning() const { return running_; }
+
+void profiler::Profiler::Clear() {
+  std::vector<uint32_t> functions;
+  functions.reserve(stack_.size());
+  for (const Frame& frame : stack_) {
+    functions.push_back(gsl::at(nodes_, frame.node).function);
+  }
+
+  nodes_.assign(1, Node{});
+  children_.clear();
+  address_samples_.clear();
+  sample_count_ = 0;
+
+  // Keep following the calls we are in.
+  uint32_t parent = 0;
+  for (size_t i = 0; i < stack_.size(); i++) {
+    parent = GetChild(parent, gsl::at(functions, i));
+    gsl::at(stack_, i).node = parent;
+  }
+}
+
+void profiler::Profiler::OnInstruction(const Step& step) {
+  const isa::Spec& spec = isa::GetSpec(isa::Decode(step.instruction));
+
+  if (step.exception) {
+    Call(step.next_pc, step.epc, true);
+  } else if ((spec.flags & isa::kLink) != 0U) {
+    // BLTZAL and BGEZAL link even when they fall through.
+    if (step.target != step.next_pc + kInstructionLength) {
+      Call(step.target, step.pc + 2 * kInstructionLength, false);
+    }
+  } else if (spec.format == isa::Format::kJumpRegister) {
+    Return(step.target);
+  }
+
+  // A kernel call jumps from a stub to its vector, name the frame after
+  // the call instead of the stub.
+  if (const std::optional<uint32_t> table = hle::GetTable(step.pc);
+      table.has_value() && stack_.size() > 1) {
+    Frame& frame = stack_.back();
+    const uint32_t parent = gsl::at(nodes_, frame.node).parent;
+    frame.node = GetChild(parent, MakeKernelCall(table.value(),
+                                                 step.bios_function));
+  }
+
+  if (step.cycle >= next_sample_) [[unlikely]] {
+    Sample(step.pc, step.cycle);
+  }
+}
+
+void profiler::Profiler::Return(const uint32_t address) {
+  // The bottom frame is where profiling started and has nowhere to return.
+  for (size_t depth = stack_.size(); depth > 1; depth--) {
+    const Frame& frame = gsl::at(stack_, depth - 1);
+    if (frame.return_address == address ||
+        (frame.exception &&
+         frame.return_address + kInstructionLength == address)) {
+      stack_.resize(depth - 1);
+      return;
+    }
+  }
+}
+
+profiler::Symbols& profiler::Profiler::GetSymbols() { return symbols_; }
+
+const profiler::Symbols& profiler::Profiler::GetSymbols() const {
+  return symbols_;
+}
+
+uint64_t profiler::Profiler::GetSampleCount() const { return sample_count_; }
+
+size_t profiler::Profiler::GetDepth() const { return stack_.size(); }
+
+std::vector<profiler::FunctionSamples> profiler::Profiler::GetFunctions()
+    const {
+  // Children are always created after their parents.
+  std::vector<uint64_t> inclusive(nodes_.size());
+  for (size_t i = nodes_.size() - 1; i > 0; i--) {
+    const Node& node = gsl::at(nodes_, i);
+    gsl::at(inclusive, i) += node.samples;
+    gsl::at(inclusive, node.parent) += gsl::at(inclusive, i);
+  }
+
+  std::unordered_map<uint32_t, FunctionSamples> functions;
+  for (size_t i = 1; i < nodes_.size(); i++) {
+    const Node& node = gsl::at(nodes_, i);
+    FunctionSamples& samples = functions[node.function];
+    samples.function = node.function;
+    samples.self += node.samples;
+
+    // Count recursive calls once.
+    uint32_t ancestor = node.parent;
+    while (ancestor != 0 &&
+           gsl::at(nodes_, ancestor).function != node.function) {
+      ancestor = gsl::at(nodes_, ancestor).parent;
+    }
+    if (ancestor == 0) {
+      samples.total += gsl::at(inclusive, i);
+    }
+  }
+
+  std::vector<FunctionSamples> sorted;
+  sorted.reserve(functions.size());
+  for (const auto& [function, samples] : functions) {
+    if (samples.total != 0) {
+      sorted.push_back(samples);
+    }
+  }
+  std::ranges::sort(sorted, [](const auto& lhs, const auto& rhs) {
+    return lhs.self != rhs.self ? lhs.self > rhs.self : lhs.total > rhs.total;
+  });
+  return sorted;
+}
+
+std::vector<profiler::AddressSamples> profiler::Profiler::GetHotAddresses(
+    const size_t count) const {
+  std::vector<AddressSamples> addresses;
+  addresses.reserve(address_samples_.size());
+  for (const auto& [address, samples] : address_samples_) {
+    addresses.push_back(AddressSamples{.address = address, .samples = samples});
+  }
+
+  const size_t shown = std::min(count, addresses.size());
+  std::ranges::partial_sort(
+      addresses, addresses.begin() + static_cast<ptrdiff_t>(shown),
+      [](const auto& lhs, const auto& rhs) {
+        return lhs.samples > rhs.samples;
+      });
+  addresses.resize(shown);
+  return addresses;
+}
+
+std::string profiler::Profiler::Describe(const uint32_t address) const {
+  if ((address & kKernelCallTag) != 0) {
+    const uint32_t table = (address >> 8U) & 0xFFU;
+    const uint32_t function = address >> 16U;
+    const auto* known = std::ranges::find_if(
+        kKernelFunctions, [table, function](const KernelFunction& entry) {
+          return entry.table == table && entry.function == function;
+        });
+    if (known != kKernelFunctions.end()) {
+      return std::format("{:X}:{}", table, known->name);
+    }
+    return std::format("{:X}:{:02X}", table, function);
+  }
+
+  if (const Symbol* symbol = symbols_.Find(address); symbol != nullptr) {
+    if (symbol->address == address) {
+      return symbol->name;
+    }
+    return std::format("{}+0x{:X}", symbol->name, address - symbol->address);
+  }
+  return std::format("sub_{:08X}", address);
+}
+
+void profiler::Profiler::WriteCollapsed(
+    const std::filesystem::path& path) const {
+  std::ofstream output(path, std::ios::trunc);
+
+  std::vector<std::string> names(nodes_.size());
+  std::vector<uint32_t> path_nodes;
+  for (size_t i = 1; i < nodes_.size(); i++) {
+    gsl::at(names, i) = Describe(gsl::at(nodes_, i).function);
+  }
+
+  for (size_t i = 1; i < nodes_.size(); i++) {
+    if (gsl::at(nodes_, i).samples == 0) {
+      continue;
+    }
+    path_nodes.clear();
+    for (auto node = static_cast<uint32_t>(i); node != 0;
+         node = gsl::at(nodes_, node).parent) {
+      path_nodes.push_back(node);
+    }
+
+    std::string line;
+    for (auto node = path_nodes.rbegin(); node != path_nodes.rend(); ++node) {
+      if (!line.empty()) {
+        line += ';';
+      }
+      line += gsl::at(names, *node);
+    }
+    output << line << ' ' << gsl::at(nodes_, i).samples << '\n';
+  }
+
+  if (!output) {
+    throw std::runtime_error(
+        std::format("Failed to write profile {}", path.string()));
+  }
+}
+
+uint32_t profiler::Profiler::GetChild(const uint32_t parent,
+                                      const uint32_t function) {
+  const uint64_t key = static_cast<uint64_t>(parent) << 32U | function;
+  const auto [child, inserted] =
+      children_.try_emplace(key, static_cast<uint32_t>(nodes_.size()));
+  if (inserted) {
+    nodes_.push_back(Node{.parent = parent, .function = function});
+  }
+  return child->second;
+}
+
+void profiler::Profiler::Call(const uint32_t function,
+                              const uint32_t return_address,
+                              const bool exception) {
+  if (stack_.empty() || stack_.size() >= kMaxDepth) {
+    return;
+  }
+  stack_.push_back(Frame{.node = GetChild(stack_.back().node, function),
+                         .return_address = return_address,
+                         .exception = exception});
+}
+
+void profiler::Profiler::Sample(const uint32_t pc, const uint64_t cycle) {
+  // Long instructions and skipped idle loops can cover several periods.
+  const uint64_t samples = (cycle - next_sample_) / interval_ + 1;
+  next_sample_ += samples * interval_;
+  sample_count_ += samples;
+  address_samples_[pc] += samples;
+  if (!stack_.empty()) {
+    gsl::at(nodes_, stack_.back().node).samples += samples;
+  }
+}
@@ -0,0 +1,141 @@
+#ifndef POLYSTATION_PROFILER_H
+#define POLYSTATION_PROFILER_H
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace profiler {
+constexpr uint64_t kDefaultInterval = 1000;
+// Calls deeper than this are not tracked, threads that never return would
+// otherwise grow the stack forever.
+constexpr size_t kMaxDepth = 256;
+
+struct Symbol {
+  uint32_t address = 0;
+  // Zero when unknown, the symbol then runs up to the next one.
+  uint32_t size = 0;
+  std::string name;
+} __attribute__((aligned(64)));
+
+class Symbols {
+ public:
+  // Loads an ELF symbol table, or a text map of "<address> <name>" lines
+  // such as PSY-Q and GNU ld maps.
+  void Load(const std::filesystem::path& path);
+  void Clear();
+
+  [[nodiscard]] bool IsEmpty() const;
+  [[nodiscard]] size_t GetCount() const;
+  // Returns the symbol containing `address`, or nullptr.
+  [[nodiscard]] const Symbol* Find(uint32_t address) const;
+
+ private:
+  // Sorted by address.
+  std::vector<Symbol> symbols_;
+
+  void LoadElf(const std::vector<char>& data);
+  void LoadMap(const std::vector<char>& data);
+};
+
+// What the CPU hands over after every instruction while profiling.
+struct Step {
+  uint32_t pc = 0;
+  uint32_t instruction = 0;
+  // program_counter_ and next_program_counter_ after the instruction, a
+  // taken jump has put its target in `target`.
+  uint32_t next_pc = 0;
+  uint32_t target = 0;
+  uint64_t cycle = 0;
+  // t1, the function number of a kernel call.
+  uint32_t bios_function = 0;
+  uint32_t epc = 0;
+  bool exception = false;
+} __attribute__((aligned(64)));
+
+struct FunctionSamples {
+  uint32_t function = 0;
+  // Samples taken in the function itself, and with it anywhere on the
+  // stack.
+  uint64_t self = 0;
+  uint64_t total = 0;
+} __attribute__((aligned(32)));
+
+struct AddressSamples {
+  uint32_t address = 0;
+  uint64_t samples = 0;
+} __attribute__((aligned(16)));
+
+// Samples the PC every `interval` cycles and follows calls and returns in a
+// shadow call stack, so samples can be attributed to whole call paths.
+// Calls are jumps that link (JAL, JALR, BLTZAL, BGEZAL) and exceptions; a
+// jump to a return address on the stack returns to that frame. Kernel calls
+// through the A0/B0/C0 vectors replace the stub that jumped there.
+class Profiler {
+ public:
+  void SetInterval(uint64_t cycles);
+  [[nodiscard]] uint64_t GetInterval() const;
+
+  // Starts a new shadow stack at `pc`, keeping the samples taken so far.
+  void Start(uint32_t pc, uint64_t cycle);
+  void Stop();
+  [[nodiscard]] bool IsRunning() const;
+  void Clear();
+
+  void OnInstruction(const Step& step);
+  // Execution continues at `address` without a jump, e.g. after an HLE
+  // kernel call.
+  void Return(uint32_t address);
+
+  [[nodiscard]] Symbols& GetSymbols();
+  [[nodiscard]] const Symbols& GetSymbols() const;
+
+  [[nodiscard]] uint64_t GetSampleCount() const;
+  [[nodiscard]] size_t GetDepth() const;
+  // Sorted by self samples, most first.
+  [[nodiscard]] std::vector<FunctionSamples> GetFunctions() const;
+  [[nodiscard]] std::vector<AddressSamples> GetHotAddresses(
+      size_t count) const;
+  // Symbol and offset, kernel call name, or a generated name.
+  [[nodiscard]] std::string Describe(uint32_t address) const;
+
+  // One line per call path with its sample count, the collapsed stack
+  // format taken by flamegraph.pl and speedscope.
+  void WriteCollapsed(const std::filesystem::path& path) const;
+
+ private:
+  // One call path, children are found through children_.
+  struct Node {
+    uint32_t parent = 0;
+    uint32_t function = 0;
+    uint64_t samples = 0;
+  } __attribute__((aligned(16)));
+
+  struct Frame {
+    uint32_t node = 0;
+    uint32_t return_address = 0;
+    // Exception handlers may return past the faulting instruction.
+    bool exception = false;
+  } __attribute__((aligned(16)));
+
+  uint64_t interval_ = kDefaultInterval;
+  uint64_t next_sample_ = 0;
+  uint64_t sample_count_ = 0;
+  bool running_ = false;
+  Symbols symbols_;
+
+  // nodes_[0] is the root and has no function.
+  std::vector<Node> nodes_{Node{}};
+  // Keyed by parent node and function.
+  std::unordered_map<uint64_t, uint32_t> children_;
+  std::vector<Frame> stack_;
+  std::unordered_map<uint32_t, uint64_t> address_samples_;
+
+  [[nodiscard]] uint32_t GetChild(uint32_t parent, uint32_t function);
+  void Call(uint32_t function, uint32_t return_address, bool exception);
+  void Sample(uint32_t pc, uint64_t cycle);
+};
+}  // namespace profiler
+
+#endif  // POLYSTATION_PROFILER_H
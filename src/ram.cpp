@@ -1,7 +1,51 @@
 #include "ram.h"
 
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cstddef>
+#include <format>
 #include <gsl/util>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t kStateTag = savestate::MakeTag("RAM ");
+constexpr uint32_t kStateVersion = 1;
+
+std::span<std::byte, ram::kRamSize> MapAnonymous() {
+  void* data = mmap(nullptr, ram::kRamSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("failed to map RAM");
+  }
+  return std::span<std::byte, ram::kRamSize>(static_cast<std::byte*>(data),
+                                              ram::kRamSize);
+}
+}  // namespace
+
+ram::Snapshot::Snapshot(const Ram& ram)
+    : descriptor_(memfd_create("polystation-ram", MFD_CLOEXEC)) {
+  if (descriptor_ < 0) {
+    throw std::runtime_error("failed to create RAM snapshot");
+  }
+
+  const std::span<const std::byte, kRamSize> data = ram.GetData();
+  if (ftruncate(descriptor_, kRamSize) != 0 ||
+      pwrite(descriptor_, data.data(), data.size(), 0) !=
+          static_cast<ssize_t>(data.size())) {
+    close(descriptor_);
+    throw std::runtime_error("failed to write RAM snapshot");
+  }
+}
+
+ram::Snapshot::~Snapshot() { close(descriptor_); }
+
+int ram::Snapshot::GetDescriptor() const { return descriptor_; }
+
+ram::Ram::Ram() : data_(MapAnonymous()) {}
+
+ram::Ram::~Ram() { munmap(data_.data(), kRamSize); }
 
 uint32_t ram::Ram::Load32(const uint32_t offset) const {
   const auto byte_0 = std::to_integer<uint32_t>(data_[offset + 0]);
@@ -12,6 +56,13 @@ uint32_t ram::Ram::Load32(const uint32_t offset) const {
   return byte_0 | byte_1 << 8U | byte_2 << 16U | byte_3 << 24U;
 }
 
+uint16_t ram::Ram::Load16(const uint32_t offset) const {
+  const auto byte_0 = std::to_integer<uint32_t>(data_[offset + 0]);
+  const auto byte_1 = std::to_integer<uint32_t>(data_[offset + 1]);
+
+  return static_cast<uint16_t>(byte_0 | byte_1 << 8U);
+}
+
 uint8_t ram::Ram::Load8(const uint32_t offset) const {
   return std::to_integer<uint32_t>(data_[offset]);
 }
@@ -26,8 +77,115 @@ void ram::Ram::Store32(const uint32_t offset, const uint32_t value) {
   gsl::at(data_, offset + 1) = static_cast<std::byte>(byte_1);
   gsl::at(data_, offset + 2) = static_cast<std::byte>(byte_2);
   gsl::at(data_, offset + 3) = static_cast<std::byte>(byte_3);
+
+  MarkPageDirty(offset / kPageSize);
+}
+
+void ram::Ram::Store16(const uint32_t offset, const uint16_t value) {
+  const unsigned char byte_0 = value & 0xFF;
+  const unsigned char byte_1 = (value >> 8U) & 0xFF;
+
+  gsl::at(data_, offset + 0) = static_cast<std::byte>(byte_0);
+  gsl::at(data_, offset + 1) = static_cast<std::byte>(byte_1);
+
+  MarkPageDirty(offset / kPageSize);
 }
 
 void ram::Ram::Store8(const uint32_t offset, const uint8_t value) {
   gsl::at(data_, offset) = static_cast<std::byte>(value);
-}
\ No newline at end of file
+
+  MarkPageDirty(offset / kPageSize);
+}
+
+const ram::DirtyPages& ram::Ram::GetDirtyPages() const { return dirty_pages_; }
+
+void ram::Ram::ClearDirtyPages() { dirty_pages_.fill(0); }
+
+void ram::Ram::SetDirtyPages(const DirtyPages& dirty_pages) {
+  dirty_pages_ = dirty_pages;
+}
+
+void ram::Ram::MarkPageDirty(const uint32_t page) {
+  gsl::at(dirty_pages_, page / 64) |= uint64_t{1} << (page % 64);
+}
+
+std::span<const std::byte, ram::kPageSize> ram::Ram::GetPage(
+    const uint32_t page) const {
+  return data_.subspan(page * kPageSize).first<kPageSize>();
+}
+
+std::span<std::byte, ram::kPageSize> ram::Ram::GetPage(const uint32_t page) {
+  return data_.subspan(page * kPageSize).first<kPageSize>();
+}
+
+std::span<const std::byte, ram::kRamSize> ram::Ram::GetData() const {
+  return data_;
+}
+
+void ram::Ram::WriteBytes(const uint32_t offset,
+                          const std::span<const std::byte> data) {
+  if (data.empty()) {
+    return;
+  }
+  PrepareWrite(offset, data.size());
+  std::copy(data.begin(), data.end(), data_.subspan(offset).begin());
+}
+
+void ram::Ram::ZeroBytes(const uint32_t offset, const uint32_t size) {
+  if (size == 0) {
+    return;
+  }
+  PrepareWrite(offset, size);
+  std::fill_n(data_.subspan(offset).begin(), size, std::byte{0});
+}
+
+void ram::Ram::MapSnapshot(const Snapshot& snapshot) {
+  // MAP_FIXED swaps the pages in place, data_ stays valid.
+  if (mmap(data_.data(), kRamSize, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_FIXED, snapshot.GetDescriptor(),
+           0) == MAP_FAILED) {
+    throw std::runtime_error("failed to map RAM snapshot");
+  }
+  dirty_pages_.fill(~uint64_t{0});
+}
+
+void ram::Ram::Save(savestate::Writer& writer) const {
+  writer.BeginSection(kStateTag, kStateVersion);
+  if (writer.IncludesMemory()) {
+    writer.WriteBlob(data_);
+  }
+  writer.EndSection();
+}
+
+std::optional<std::span<const std::byte>> ram::Ram::PrepareLoad(
+    savestate::Reader& reader) const {
+  reader.BeginSection(kStateTag, kStateVersion);
+  std::optional<std::span<const std::byte>> contents;
+  if (reader.IncludesMemory()) {
+    contents = reader.ReadEncodedBlob(data_.size());
+  }
+  reader.EndSection();
+  return contents;
+}
+
+void ram::Ram::FinishLoad(
+    const savestate::Reader& reader,
+    const std::optional<std::span<const std::byte>> contents) {
+  if (!contents.has_value()) {
+    return;
+  }
+  reader.DecodeBlob(contents.value(), data_);
+  dirty_pages_.fill(~uint64_t{0});
+}
+
+void ram::Ram::PrepareWrite(const uint32_t offset, const size_t size) {
+  if (offset >= kRamSize || size > kRamSize - offset) {
+    throw std::out_of_range(std::format(
+        "RAM write of {} bytes at 0x{:08X} is out of range", size, offset));
+  }
+
+  for (uint32_t page = offset / kPageSize;
+       page <= (offset + size - 1) / kPageSize; page++) {
+    MarkPageDirty(page);
+  }
+}
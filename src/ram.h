@@ -2,18 +2,92 @@
 #define POLYSTATION_RAM_H
 #include <array>
 #include <cstdint>
+#include <optional>
+#include <span>
+
+#include "savestate.h"
 
 namespace ram {
+constexpr uint32_t kRamSize = 0x200000;
+constexpr uint32_t kPageSize = 0x1000;
+constexpr uint32_t kPageCount = kRamSize / kPageSize;
+
+// One bit per page written since the last ClearDirtyPages.
+using DirtyPages = std::array<uint64_t, kPageCount / 64>;
+
+class Ram;
+
+// Frozen copy of RAM in a memfd. Every machine cloned from it maps it
+// copy-on-write, so a clone only costs the pages it writes to.
+class Snapshot {
+ public:
+  explicit Snapshot(const Ram& ram);
+  ~Snapshot();
+
+  Snapshot(const Snapshot&) = delete;
+  Snapshot& operator=(const Snapshot&) = delete;
+  Snapshot(Snapshot&&) = delete;
+  Snapshot& operator=(Snapshot&&) = delete;
+
+  [[nodiscard]] int GetDescriptor() const;
+
+ private:
+  int descriptor_;
+};
+
+// RAM lives in its own mapping so it can be swapped for a snapshot mapping.
 class Ram {
  public:
+  Ram();
+  ~Ram();
+
+  Ram(const Ram&) = delete;
+  Ram& operator=(const Ram&) = delete;
+  Ram(Ram&&) = delete;
+  Ram& operator=(Ram&&) = delete;
+
   [[nodiscard]] uint32_t Load32(uint32_t offset) const;
+  [[nodiscard]] uint16_t Load16(uint32_t offset) const;
   [[nodiscard]] uint8_t Load8(uint32_t offset) const;
 
   void Store32(uint32_t offset, uint32_t value);
+  void Store16(uint32_t offset, uint16_t value);
   void Store8(uint32_t offset, uint8_t value);
 
+  [[nodiscard]] const DirtyPages& GetDirtyPages() const;
+  void ClearDirtyPages();
+  void SetDirtyPages(const DirtyPages& dirty_pages);
+  void MarkPageDirty(uint32_t page);
+
+  // Raw page access, writes through it are not tracked.
+  [[nodiscard]] std::span<const std::byte, kPageSize> GetPage(
+      uint32_t page) const;
+  [[nodiscard]] std::span<std::byte, kPageSize> GetPage(uint32_t page);
+  [[nodiscard]] std::span<const std::byte, kRamSize> GetData() const;
+  // Bulk copy, marks every page it touches dirty.
+  void WriteBytes(uint32_t offset, std::span<const std::byte> data);
+  // Zeroes `size` bytes in place, marks every page it touches dirty.
+  void ZeroBytes(uint32_t offset, uint32_t size);
+
+  // Replaces the contents with a private copy-on-write mapping of `snapshot`.
+  void MapSnapshot(const Snapshot& snapshot);
+
+  void Save(savestate::Writer& writer) const;
+  // Loading is split so a whole state can be read before memory changes.
+  // PrepareLoad reads and checks the section and returns the encoded
+  // contents, or nothing when the state leaves memory out. FinishLoad
+  // copies them in and cannot fail.
+  [[nodiscard]] std::optional<std::span<const std::byte>> PrepareLoad(
+      savestate::Reader& reader) const;
+  void FinishLoad(const savestate::Reader& reader,
+                  std::optional<std::span<const std::byte>> contents);
+
  private:
-  std::array<std::byte, 0x200000> data_{};
+  std::span<std::byte, kRamSize> data_;
+  DirtyPages dirty_pages_{};
+
+  // Throws unless the range lies within RAM, then marks its pages dirty.
+  void PrepareWrite(uint32_t offset, size_t size);
 };
 }  // namespace ram
 
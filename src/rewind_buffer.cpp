@@ -0,0 +1,160 @@
+#include "rewind_buffer.h"
+
+#include <bit>
+#include <cstring>
+#include <gsl/util>
+
+namespace {
+constexpr auto kCompression = savestate::Compression::kNone;
+constexpr auto kContent = savestate::Content::kWithoutMemory;
+}  // namespace
+
+rewind_buffer::RewindBuffer::RewindBuffer(const Config config)
+    : config_(config), scratch_page_(ram::kPageSize) {}
+
+void rewind_buffer::RewindBuffer::Update(cpu::CPU& cpu) {
+  if (cpu.GetCycleCount() >= next_capture_cycle_) {
+    Capture(cpu);
+  }
+}
+
+void rewind_buffer::RewindBuffer::Capture(cpu::CPU& cpu) {
+  ram::Ram& ram = cpu.GetRam();
+  Snapshot snapshot;
+
+  snapshot.state.resize(cpu.GetStateSize(kCompression, kContent));
+  snapshot.state.resize(cpu.SaveState(snapshot.state, kCompression, kContent));
+
+  if (shadow_ram_.empty()) {
+    shadow_ram_.resize(ram::kRamSize);
+    for (uint32_t page = 0; page < ram::kPageCount; page++) {
+      std::memcpy(&shadow_ram_[page * ram::kPageSize], ram.GetPage(page).data(),
+                  ram::kPageSize);
+    }
+  } else {
+    const ram::DirtyPages& dirty_pages = ram.GetDirtyPages();
+
+    for (uint32_t word = 0; word < dirty_pages.size(); word++) {
+      for (uint64_t bits = gsl::at(dirty_pages, word); bits != 0;
+           bits &= bits - 1) {
+        const uint32_t page = (word * 64) + std::countr_zero(bits);
+        const std::span<const std::byte, ram::kPageSize> current =
+            ram.GetPage(page);
+        std::byte* shadow = &shadow_ram_[page * ram::kPageSize];
+
+        if (std::memcmp(current.data(), shadow, ram::kPageSize) == 0) {
+          continue;
+        }
+
+        for (uint32_t i = 0; i < ram::kPageSize; i++) {
+          scratch_page_[i] = current[i] ^ shadow[i];
+        }
+        std::memcpy(shadow, current.data(), ram::kPageSize);
+
+        const auto offset = static_cast<uint32_t>(snapshot.deltas.size());
+        snapshot.deltas.resize(offset +
+                               savestate::GetCompressedBound(ram::kPageSize));
+        const auto size = static_cast<uint32_t>(savestate::CompressZeroRuns(
+            scratch_page_, std::span(snapshot.deltas).subspan(offset)));
+        snapshot.deltas.resize(offset + size);
+        snapshot.pages.push_back(
+            PageDelta{.page = page, .offset = offset, .size = size});
+      }
+    }
+  }
+
+  ram.ClearDirtyPages();
+  snapshot.deltas.shrink_to_fit();
+  snapshot.pages.shrink_to_fit();
+
+  memory_usage_ += snapshot.GetMemoryUsage();
+  snapshots_.push_back(std::move(snapshot));
+  next_capture_cycle_ =
+      cpu.GetCycleCount() + (config_.interval_frames * cpu::kCyclesPerFrame);
+
+  EnforceBudget();
+}
+
+bool rewind_buffer::RewindBuffer::StepBack(cpu::CPU& cpu) {
+  if (snapshots_.empty()) {
+    return false;
+  }
+
+  // Undo whatever was written since the newest snapshot.
+  ram::Ram& ram = cpu.GetRam();
+  const ram::DirtyPages& dirty_pages = ram.GetDirtyPages();
+  for (uint32_t word = 0; word < dirty_pages.size(); word++) {
+    for (uint64_t bits = gsl::at(dirty_pages, word); bits != 0;
+         bits &= bits - 1) {
+      const uint32_t page = (word * 64) + std::countr_zero(bits);
+      std::memcpy(ram.GetPage(page).data(), &shadow_ram_[page * ram::kPageSize],
+                  ram::kPageSize);
+    }
+  }
+  ram.ClearDirtyPages();
+
+  const Snapshot& snapshot = snapshots_.back();
+  cpu.LoadState(snapshot.state);
+
+  // The shadow steps back to the previous snapshot, leaving RAM dirty where
+  // the two differ.
+  ApplyDeltas(snapshot, ram);
+
+  memory_usage_ -= snapshot.GetMemoryUsage();
+  snapshots_.pop_back();
+  next_capture_cycle_ =
+      cpu.GetCycleCount() + (config_.interval_frames * cpu::kCyclesPerFrame);
+
+  return true;
+}
+
+void rewind_buffer::RewindBuffer::Clear() {
+  snapshots_.clear();
+  shadow_ram_.clear();
+  memory_usage_ = 0;
+  next_capture_cycle_ = 0;
+}
+
+void rewind_buffer::RewindBuffer::SetConfig(const Config& config) {
+  config_ = config;
+  EnforceBudget();
+}
+
+const rewind_buffer::Config& rewind_buffer::RewindBuffer::GetConfig() const {
+  return config_;
+}
+
+size_t rewind_buffer::RewindBuffer::GetSnapshotCount() const {
+  return snapshots_.size();
+}
+
+size_t rewind_buffer::RewindBuffer::GetMemoryUsage() const {
+  return memory_usage_ + shadow_ram_.size();
+}
+
+size_t rewind_buffer::RewindBuffer::Snapshot::GetMemoryUsage() const {
+  return state.capacity() + deltas.capacity() +
+         (pages.capacity() * sizeof(PageDelta));
+}
+
+void rewind_buffer::RewindBuffer::ApplyDeltas(const Snapshot& snapshot,
+                                              ram::Ram& ram) {
+  for (const PageDelta& delta : snapshot.pages) {
+    savestate::DecompressZeroRuns(
+        std::span(snapshot.deltas).subspan(delta.offset, delta.size),
+        scratch_page_);
+
+    std::byte* shadow = &shadow_ram_[delta.page * ram::kPageSize];
+    for (uint32_t i = 0; i < ram::kPageSize; i++) {
+      shadow[i] ^= scratch_page_[i];
+    }
+    ram.MarkPageDirty(delta.page);
+  }
+}
+
+void rewind_buffer::RewindBuffer::EnforceBudget() {
+  while (snapshots_.size() > 1 && GetMemoryUsage() > config_.memory_budget) {
+    memory_usage_ -= snapshots_.front().GetMemoryUsage();
+    snapshots_.pop_front();
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef POLYSTATION_REWIND_BUFFER_H
+#define POLYSTATION_REWIND_BUFFER_H
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "cpu.h"
+
+namespace rewind_buffer {
+struct Config {
+  size_t memory_budget = size_t{64} << 20U;
+  uint32_t interval_frames = 2;
+} __attribute__((aligned(16)));
+
+// Ring of snapshots. RAM is kept as XOR deltas of the pages dirtied between
+// consecutive snapshots, zero-run encoded, against a shadow copy of RAM at
+// the newest snapshot; everything else is a small memory-less savestate.
+class RewindBuffer {
+ public:
+  explicit RewindBuffer(Config config = {});
+
+  // Captures a snapshot once the interval has elapsed since the last one.
+  void Update(cpu::CPU& cpu);
+  void Capture(cpu::CPU& cpu);
+  // Returns to the newest snapshot and drops it, false when none is left.
+  bool StepBack(cpu::CPU& cpu);
+  void Clear();
+
+  void SetConfig(const Config& config);
+  [[nodiscard]] const Config& GetConfig() const;
+  [[nodiscard]] size_t GetSnapshotCount() const;
+  [[nodiscard]] size_t GetMemoryUsage() const;
+
+ private:
+  struct PageDelta {
+    uint32_t page = 0;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+  } __attribute__((aligned(16)));
+
+  struct Snapshot {
+    std::vector<std::byte> state;
+    std::vector<PageDelta> pages;
+    std::vector<std::byte> deltas;
+
+    [[nodiscard]] size_t GetMemoryUsage() const;
+  };
+
+  Config config_;
+  std::deque<Snapshot> snapshots_;
+  std::vector<std::byte> shadow_ram_;
+  std::vector<std::byte> scratch_page_;
+  size_t memory_usage_ = 0;
+  uint64_t next_capture_cycle_ = 0;
+
+  void ApplyDeltas(const Snapshot& snapshot, ram::Ram& ram);
+  void EnforceBudget();
+};
+}  // namespace rewind_buffer
+
+#endif  // POLYSTATION_REWIND_BUFFER_H
@@ -0,0 +1,107 @@
+#include "run_ahead.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <gsl/util>
+
+namespace {
+constexpr auto kCompression = savestate::Compression::kNone;
+constexpr auto kContent = savestate::Content::kWithoutMemory;
+
+using Clock = std::chrono::steady_clock;
+
+double GetMilliseconds(const Clock::time_point start,
+                       const Clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+}  // namespace
+
+double run_ahead::FrameTiming::GetTotal() const {
+  return emulate + save + run_ahead + restore;
+}
+
+run_ahead::RunAhead::RunAhead(const uint32_t frames)
+    : frames_(std::min(frames, kMaxFrames)) {}
+
+void run_ahead::RunAhead::RunFrame(cpu::CPU& cpu) {
+  const Clock::time_point start = Clock::now();
+  cpu.RunFrame();
+  const Clock::time_point emulated = Clock::now();
+
+  if (frames_ == 0) {
+    timing_ = FrameTiming{.emulate = GetMilliseconds(start, emulated)};
+    return;
+  }
+
+  Save(cpu);
+  const Clock::time_point saved = Clock::now();
+
+  try {
+    for (uint32_t frame = 0; frame < frames_; frame++) {
+      cpu.RunFrame();
+    }
+  } catch (...) {
+    // A speculative frame must never leak into the real timeline.
+    Restore(cpu);
+    throw;
+  }
+  const Clock::time_point ran_ahead = Clock::now();
+
+  Restore(cpu);
+  const Clock::time_point restored = Clock::now();
+
+  timing_ = FrameTiming{.emulate = GetMilliseconds(start, emulated),
+                        .save = GetMilliseconds(emulated, saved),
+                        .run_ahead = GetMilliseconds(saved, ran_ahead),
+                        .restore = GetMilliseconds(ran_ahead, restored)};
+}
+
+void run_ahead::RunAhead::SetFrames(const uint32_t frames) {
+  frames_ = std::min(frames, kMaxFrames);
+}
+
+uint32_t run_ahead::RunAhead::GetFrames() const { return frames_; }
+
+const run_ahead::FrameTiming& run_ahead::RunAhead::GetTiming() const {
+  return timing_;
+}
+
+void run_ahead::RunAhead::Save(cpu::CPU& cpu) {
+  if (const size_t size = cpu.GetStateSize(kCompression, kContent);
+      state_.size() < size) {
+    state_.resize(size);
+  }
+  static_cast<void>(cpu.SaveState(state_, kCompression, kContent));
+
+  // RAM is backed up whole, a plain copy is cheaper than a savestate blob,
+  // and only the pages the speculative frames dirty are copied back.
+  ram::Ram& ram = cpu.GetRam();
+  ram_backup_.resize(ram::kRamSize);
+  for (uint32_t page = 0; page < ram::kPageCount; page++) {
+    std::memcpy(&ram_backup_[page * ram::kPageSize], ram.GetPage(page).data(),
+                ram::kPageSize);
+  }
+
+  dirty_pages_ = ram.GetDirtyPages();
+  ram.ClearDirtyPages();
+}
+
+void run_ahead::RunAhead::Restore(cpu::CPU& cpu) {
+  ram::Ram& ram = cpu.GetRam();
+  const ram::DirtyPages& dirty_pages = ram.GetDirtyPages();
+
+  for (uint32_t word = 0; word < dirty_pages.size(); word++) {
+    for (uint64_t bits = gsl::at(dirty_pages, word); bits != 0;
+         bits &= bits - 1) {
+      const uint32_t page = (word * 64) + std::countr_zero(bits);
+      std::memcpy(ram.GetPage(page).data(), &ram_backup_[page * ram::kPageSize],
+                  ram::kPageSize);
+    }
+  }
+
+  // Other trackers, such as rewind, see RAM exactly as it was at the save.
+  ram.SetDirtyPages(dirty_pages_);
+  cpu.LoadState(state_);
+}
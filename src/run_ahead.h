@@ -0,0 +1,46 @@
+#ifndef POLYSTATION_RUN_AHEAD_H
+#define POLYSTATION_RUN_AHEAD_H
+#include <cstdint>
+#include <vector>
+
+#include "cpu.h"
+
+namespace run_ahead {
+constexpr uint32_t kMaxFrames = 4;
+
+// Host time spent in each phase of the last RunFrame, in milliseconds.
+struct FrameTiming {
+  double emulate = 0.0;
+  double save = 0.0;
+  double run_ahead = 0.0;
+  double restore = 0.0;
+
+  [[nodiscard]] double GetTotal() const;
+} __attribute__((aligned(32)));
+
+// Runs the real frame, snapshots it, then runs `frames` speculative frames
+// whose output is the one presented before rolling back to the snapshot.
+class RunAhead {
+ public:
+  explicit RunAhead(uint32_t frames = 1);
+
+  void RunFrame(cpu::CPU& cpu);
+
+  void SetFrames(uint32_t frames);
+  [[nodiscard]] uint32_t GetFrames() const;
+  [[nodiscard]] const FrameTiming& GetTiming() const;
+
+ private:
+  uint32_t frames_;
+  FrameTiming timing_;
+
+  std::vector<std::byte> state_;
+  std::vector<std::byte> ram_backup_;
+  ram::DirtyPages dirty_pages_{};
+
+  void Save(cpu::CPU& cpu);
+  void Restore(cpu::CPU& cpu);
+};
+}  // namespace run_ahead
+
+#endif  // POLYSTATION_RUN_AHEAD_H
@@ -0,0 +1,385 @@
+#include "savestate.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t kZeroRunFlag = 1U << 31U;
+constexpr size_t kWordSize = sizeof(uint64_t);
+// Shorter zero runs cost more as a token than as literal bytes.
+constexpr size_t kMinZeroRun = 2 * kWordSize;
+
+bool IsZeroWord(const std::byte* data) {
+  uint64_t word = 0;
+  std::memcpy(&word, data, kWordSize);
+  return word == 0;
+}
+
+// Throws unless `input` decodes to exactly `size` bytes.
+void CheckZeroRuns(const std::span<const std::byte> input, const size_t size) {
+  size_t in = 0;
+  size_t out = 0;
+
+  while (in + sizeof(uint32_t) <= input.size()) {
+    uint32_t token = 0;
+    std::memcpy(&token, &input[in], sizeof(token));
+    in += sizeof(token);
+
+    const size_t run = token & ~kZeroRunFlag;
+    if (out + run > size) {
+      throw std::runtime_error("savestate blob overflows its destination");
+    }
+    if ((token & kZeroRunFlag) == 0U) {
+      if (in + run > input.size()) {
+        throw std::runtime_error("savestate truncated");
+      }
+      in += run;
+    }
+    out += run;
+  }
+
+  if (out != size) {
+    throw std::runtime_error("savestate blob size mismatch");
+  }
+}
+}  // namespace
+
+savestate::Writer::Writer(const Compression compression,
+                          const Content content)
+    : compression_(compression), content_(content), measuring_(true) {}
+
+savestate::Writer::Writer(const std::span<std::byte> buffer,
+                          const Compression compression,
+                          const Content content)
+    : buffer_(buffer),
+      compression_(compression),
+      content_(content),
+      measuring_(false) {
+  if (buffer_.size() < sizeof(Header)) {
+    throw std::runtime_error("savestate buffer too small");
+  }
+}
+
+bool savestate::Writer::IncludesMemory() const {
+  return content_ == Content::kFull;
+}
+
+void savestate::Writer::BeginSection(const uint32_t tag,
+                                     const uint32_t version) {
+  section_start_ = position_;
+  Write(SectionHeader{.tag = tag, .version = version});
+}
+
+void savestate::Writer::EndSection() {
+  if (measuring_) {
+    return;
+  }
+
+  SectionHeader header{};
+  std::memcpy(&header, &buffer_[section_start_], sizeof(header));
+  header.size =
+      static_cast<uint32_t>(position_ - section_start_ - sizeof(header));
+  std::memcpy(&buffer_[section_start_], &header, sizeof(header));
+}
+
+void savestate::Writer::WriteBytes(const std::span<const std::byte> data) {
+  std::byte* destination = Reserve(data.size());
+  if (destination != nullptr && !data.empty()) {
+    std::memcpy(destination, data.data(), data.size());
+  }
+}
+
+void savestate::Writer::WriteBlob(const std::span<const std::byte> data) {
+  if (compression_ == Compression::kNone) {
+    WriteBytes(data);
+    return;
+  }
+
+  if (measuring_) {
+    position_ += sizeof(uint32_t) + GetCompressedBound(data.size());
+    return;
+  }
+
+  const size_t size_position = position_;
+  position_ += sizeof(uint32_t);
+  if (position_ > buffer_.size()) {
+    throw std::runtime_error("savestate buffer too small");
+  }
+
+  const auto size = static_cast<uint32_t>(
+      CompressZeroRuns(data, buffer_.subspan(position_)));
+  std::memcpy(&buffer_[size_position], &size, sizeof(size));
+  position_ += size;
+}
+
+size_t savestate::Writer::Finish() {
+  if (!measuring_) {
+    const Header header{.compression = static_cast<uint16_t>(compression_),
+                        .content = static_cast<uint16_t>(content_),
+                        .size = static_cast<uint32_t>(position_)};
+    std::memcpy(buffer_.data(), &header, sizeof(header));
+  }
+  return position_;
+}
+
+std::byte* savestate::Writer::Reserve(const size_t size) {
+  const size_t start = position_;
+  position_ += size;
+
+  if (measuring_) {
+    return nullptr;
+  }
+  if (position_ > buffer_.size()) {
+    throw std::runtime_error("savestate buffer too small");
+  }
+  return &buffer_[start];
+}
+
+savestate::Reader::Reader(const std::span<const std::byte> buffer)
+    : buffer_(buffer) {
+  Header header{};
+  if (buffer_.size() < sizeof(header)) {
+    throw std::runtime_error("savestate truncated");
+  }
+  std::memcpy(&header, buffer_.data(), sizeof(header));
+
+  if (header.magic != kMagic) {
+    throw std::runtime_error("not a PolyStation savestate");
+  }
+  if (header.version > kFormatVersion) {
+    throw std::runtime_error(
+        std::format("unsupported savestate version {}", header.version));
+  }
+  if (header.size > buffer_.size()) {
+    throw std::runtime_error("savestate truncated");
+  }
+  if (header.compression > static_cast<uint16_t>(Compression::kZeroRun)) {
+    throw std::runtime_error(std::format(
+        "unsupported savestate compression {}", header.compression));
+  }
+  if (header.content > static_cast<uint16_t>(Content::kWithoutMemory)) {
+    throw std::runtime_error(
+        std::format("unsupported savestate content {}", header.content));
+  }
+
+  buffer_ = buffer_.first(header.size);
+  compression_ = static_cast<Compression>(header.compression);
+  content_ = static_cast<Content>(header.content);
+}
+
+bool savestate::Reader::IncludesMemory() const {
+  return content_ == Content::kFull;
+}
+
+uint32_t savestate::Reader::BeginSection(const uint32_t tag,
+                                         const uint32_t max_version) {
+  section_end_ = 0;
+
+  SectionHeader header{};
+  Read(header);
+  if (header.tag != tag) {
+    throw std::runtime_error(
+        std::format("savestate section {:08X} missing, found {:08X}", tag,
+                    header.tag));
+  }
+  if (header.version > max_version) {
+    throw std::runtime_error(
+        std::format("savestate section {:08X} has unsupported version {}",
+                    tag, header.version));
+  }
+
+  section_end_ = position_ + header.size;
+  if (section_end_ > buffer_.size()) {
+    throw std::runtime_error("savestate truncated");
+  }
+  return header.version;
+}
+
+void savestate::Reader::EndSection() {
+  position_ = section_end_;
+  section_end_ = 0;
+}
+
+void savestate::Reader::ReadBytes(const std::span<std::byte> data) {
+  const std::byte* source = Consume(data.size());
+  if (!data.empty()) {
+    std::memcpy(data.data(), source, data.size());
+  }
+}
+
+void savestate::Reader::ReadBlob(const std::span<std::byte> data) {
+  DecodeBlob(ReadEncodedBlob(data.size()), data);
+}
+
+std::span<const std::byte> savestate::Reader::ReadEncodedBlob(
+    const size_t size) {
+  if (compression_ == Compression::kNone) {
+    return {Consume(size), size};
+  }
+
+  uint32_t encoded_size = 0;
+  Read(encoded_size);
+  const std::span blob(Consume(encoded_size), encoded_size);
+  CheckZeroRuns(blob, size);
+  return blob;
+}
+
+void savestate::Reader::DecodeBlob(const std::span<const std::byte> blob,
+                                   const std::span<std::byte> data) const {
+  if (compression_ != Compression::kNone) {
+    DecompressZeroRuns(blob, data);
+  } else if (!data.empty()) {
+    std::memcpy(data.data(), blob.data(), data.size());
+  }
+}
+
+const std::byte* savestate::Reader::Consume(const size_t size) {
+  const size_t limit = section_end_ != 0 ? section_end_ : buffer_.size();
+  if (position_ + size > limit) {
+    throw std::runtime_error("savestate truncated");
+  }
+
+  const std::byte* data = &buffer_[position_];
+  position_ += size;
+  return data;
+}
+
+size_t savestate::GetCompressedBound(const size_t size) {
+  // Worst case alternates one literal word with one minimal zero run.
+  return size + ((size / kMinZeroRun) + 1) * 2 * sizeof(uint32_t);
+}
+
+size_t savestate::CompressZeroRuns(const std::span<const std::byte> input,
+                                   const std::span<std::byte> output) {
+  size_t out = 0;
+  size_t literal_start = 0;
+
+  const auto emit = [&](const uint32_t token, const std::byte* data,
+                        const size_t size) {
+    if (out + sizeof(token) + size > output.size()) {
+      throw std::runtime_error("savestate buffer too small");
+    }
+    std::memcpy(&output[out], &token, sizeof(token));
+    out += sizeof(token);
+    if (data != nullptr) {
+      std::memcpy(&output[out], data, size);
+      out += size;
+    }
+  };
+
+  const auto emit_literal = [&](const size_t end) {
+    if (end > literal_start) {
+      const size_t size = end - literal_start;
+      emit(static_cast<uint32_t>(size), &input[literal_start], size);
+    }
+  };
+
+  size_t position = 0;
+  while (position + kWordSize <= input.size()) {
+    if (!IsZeroWord(&input[position])) {
+      position += kWordSize;
+      continue;
+    }
+
+    size_t run_end = position;
+    while (run_end + kWordSize <= input.size() && IsZeroWord(&input[run_end])) {
+      run_end += kWordSize;
+    }
+    if (run_end - position < kMinZeroRun) {
+      position = run_end;
+      continue;
+    }
+
+    emit_literal(position);
+    emit(kZeroRunFlag | static_cast<uint32_t>(run_end - position), nullptr, 0);
+    position = run_end;
+    literal_start = run_end;
+  }
+  emit_literal(input.size());
+
+  return out;
+}
+
+void savestate::DecompressZeroRuns(const std::span<const std::byte> input,
+                                   const std::span<std::byte> output) {
+  size_t in = 0;
+  size_t out = 0;
+
+  while (in + sizeof(uint32_t) <= input.size()) {
+    uint32_t token = 0;
+    std::memcpy(&token, &input[in], sizeof(token));
+    in += sizeof(token);
+
+    const size_t size = token & ~kZeroRunFlag;
+    if (out + size > output.size()) {
+      throw std::runtime_error("savestate blob overflows its destination");
+    }
+
+    if ((token & kZeroRunFlag) != 0U) {
+      std::memset(&output[out], 0, size);
+    } else {
+      if (in + size > input.size()) {
+        throw std::runtime_error("savestate truncated");
+      }
+      std::memcpy(&output[out], &input[in], size);
+      in += size;
+    }
+    out += size;
+  }
+
+  if (out != output.size()) {
+    throw std::runtime_error("savestate blob size mismatch");
+  }
+}
+
+void savestate::WriteFile(const std::filesystem::path& path,
+                          const std::span<const std::byte> data) {
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  output.write(reinterpret_cast<const char*>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+  if (!output) {
+    throw std::runtime_error(
+        std::format("failed to write savestate {}", path.string()));
+  }
+}
+
+savestate::MappedFile::MappedFile(const std::filesystem::path& path) {
+  const int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (descriptor < 0) {
+    throw std::runtime_error(
+        std::format("failed to open savestate {}", path.string()));
+  }
+
+  struct stat status {};
+  if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+    close(descriptor);
+    throw std::runtime_error(
+        std::format("failed to read savestate {}", path.string()));
+  }
+  size_ = static_cast<size_t>(status.st_size);
+
+  data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+               descriptor, 0);
+  close(descriptor);
+  if (data_ == MAP_FAILED) {
+    data_ = nullptr;
+    throw std::runtime_error(
+        std::format("failed to map savestate {}", path.string()));
+  }
+}
+
+savestate::MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+std::span<const std::byte> savestate::MappedFile::GetData() const {
+  return {static_cast<const std::byte*>(data_), size_};
+}
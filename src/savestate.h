@@ -0,0 +1,162 @@
+#ifndef POLYSTATION_SAVESTATE_H
+#define POLYSTATION_SAVESTATE_H
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace savestate {
+constexpr uint32_t MakeTag(const char (&name)[5]) {
+  return static_cast<uint32_t>(name[0]) |
+         static_cast<uint32_t>(name[1]) << 8U |
+         static_cast<uint32_t>(name[2]) << 16U |
+         static_cast<uint32_t>(name[3]) << 24U;
+}
+
+constexpr uint32_t kMagic = MakeTag("PSXS");
+constexpr uint32_t kFormatVersion = 1;
+
+enum class Compression : uint8_t { kNone = 0, kZeroRun = 1 };
+
+// kWithoutMemory leaves main RAM out, for callers that track it themselves.
+enum class Content : uint8_t { kFull = 0, kWithoutMemory = 1 };
+
+struct Header {
+  uint32_t magic = kMagic;
+  uint32_t version = kFormatVersion;
+  uint16_t compression = 0;
+  uint16_t content = 0;
+  uint32_t size = 0;
+} __attribute__((aligned(16)));
+
+struct SectionHeader {
+  uint32_t tag = 0;
+  uint32_t version = 0;
+  uint32_t size = 0;
+  uint32_t reserved = 0;
+} __attribute__((aligned(16)));
+
+// Serializes into a caller-owned buffer, nothing is allocated while saving.
+// A writer built without a buffer only measures, reporting the worst case
+// size of compressed blobs.
+class Writer {
+ public:
+  explicit Writer(Compression compression,
+                  Content content = Content::kFull);
+  Writer(std::span<std::byte> buffer, Compression compression,
+         Content content = Content::kFull);
+
+  [[nodiscard]] bool IncludesMemory() const;
+
+  void BeginSection(uint32_t tag, uint32_t version);
+  void EndSection();
+
+  template <typename T>
+  void Write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    WriteBytes(std::as_bytes(std::span(&value, 1)));
+  }
+
+  template <typename T>
+  void WriteVector(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    Write(static_cast<uint32_t>(values.size()));
+    WriteBytes(std::as_bytes(std::span(values)));
+  }
+
+  void WriteBytes(std::span<const std::byte> data);
+  // Large, mostly empty memories go through the compressor when enabled.
+  void WriteBlob(std::span<const std::byte> data);
+
+  // Fills in the header and returns the total state size.
+  size_t Finish();
+
+ private:
+  std::span<std::byte> buffer_;
+  Compression compression_;
+  Content content_;
+  bool measuring_;
+  size_t position_ = sizeof(Header);
+  size_t section_start_ = 0;
+
+  std::byte* Reserve(size_t size);
+};
+
+class Reader {
+ public:
+  explicit Reader(std::span<const std::byte> buffer);
+
+  [[nodiscard]] bool IncludesMemory() const;
+
+  // Returns the section version, throws if the next section is not `tag` or
+  // was written by a newer version than `max_version`.
+  uint32_t BeginSection(uint32_t tag, uint32_t max_version);
+  // Moves to the next section even if this one was not fully read.
+  void EndSection();
+
+  template <typename T>
+  void Read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    ReadBytes(std::as_writable_bytes(std::span(&value, 1)));
+  }
+
+  template <typename T>
+  void ReadVector(std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    uint32_t size = 0;
+    Read(size);
+    values.resize(size);
+    ReadBytes(std::as_writable_bytes(std::span(values)));
+  }
+
+  void ReadBytes(std::span<std::byte> data);
+  void ReadBlob(std::span<std::byte> data);
+  // Checks that the next blob decodes to `size` bytes and returns it still
+  // encoded, so the rest of a state can be read before anything changes.
+  // DecodeBlob then cannot fail.
+  [[nodiscard]] std::span<const std::byte> ReadEncodedBlob(size_t size);
+  void DecodeBlob(std::span<const std::byte> blob,
+                  std::span<std::byte> data) const;
+
+ private:
+  std::span<const std::byte> buffer_;
+  Compression compression_;
+  Content content_;
+  size_t position_ = sizeof(Header);
+  size_t section_end_ = 0;
+
+  const std::byte* Consume(size_t size);
+};
+
+[[nodiscard]] size_t GetCompressedBound(size_t size);
+// Run-length encodes zero runs, returns the number of bytes written.
+size_t CompressZeroRuns(std::span<const std::byte> input,
+                        std::span<std::byte> output);
+void DecompressZeroRuns(std::span<const std::byte> input,
+                        std::span<std::byte> output);
+
+void WriteFile(const std::filesystem::path& path,
+               std::span<const std::byte> data);
+
+// Read-only mapping of a state file, loading straight from the page cache.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::filesystem::path& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+
+  [[nodiscard]] std::span<const std::byte> GetData() const;
+
+ private:
+  void* data_ = nullptr;
+  size_t size_ = 0;
+};
+}  // namespace savestate
+
+#endif  // POLYSTATION_SAVESTATE_H
@@ -0,0 +1,68 @@
+#include "scratchpad.h"
+
+#include <cstddef>
+#include <gsl/util>
+
+namespace {
+constexpr uint32_t kStateTag = savestate::MakeTag("SPAD");
+constexpr uint32_t kStateVersion = 1;
+}  // namespace
+
+uint32_t scratchpad::Scratchpad::Load32(const uint32_t offset) const {
+  const auto byte_0 = std::to_integer<uint32_t>(gsl::at(data_, offset + 0));
+  const auto byte_1 = std::to_integer<uint32_t>(gsl::at(data_, offset + 1));
+  const auto byte_2 = std::to_integer<uint32_t>(gsl::at(data_, offset + 2));
+  const auto byte_3 = std::to_integer<uint32_t>(gsl::at(data_, offset + 3));
+
+  return byte_0 | byte_1 << 8U | byte_2 << 16U | byte_3 << 24U;
+}
+
+uint16_t scratchpad::Scratchpad::Load16(const uint32_t offset) const {
+  const auto byte_0 = std::to_integer<uint32_t>(gsl::at(data_, offset + 0));
+  const auto byte_1 = std::to_integer<uint32_t>(gsl::at(data_, offset + 1));
+
+  return static_cast<uint16_t>(byte_0 | byte_1 << 8U);
+}
+
+uint8_t scratchpad::Scratchpad::Load8(const uint32_t offset) const {
+  return std::to_integer<uint8_t>(gsl::at(data_, offset));
+}
+
+void scratchpad::Scratchpad::Store32(const uint32_t offset,
+                                     const uint32_t value) {
+  const unsigned char byte_0 = value & 0xFF;
+  const unsigned char byte_1 = (value >> 8U) & 0xFF;
+  const unsigned char byte_2 = (value >> 16U) & 0xFF;
+  const unsigned char byte_3 = (value >> 24U) & 0xFF;
+
+  gsl::at(data_, offset + 0) = static_cast<std::byte>(byte_0);
+  gsl::at(data_, offset + 1) = static_cast<std::byte>(byte_1);
+  gsl::at(data_, offset + 2) = static_cast<std::byte>(byte_2);
+  gsl::at(data_, offset + 3) = static_cast<std::byte>(byte_3);
+}
+
+void scratchpad::Scratchpad::Store16(const uint32_t offset,
+                                     const uint16_t value) {
+  const unsigned char byte_0 = value & 0xFF;
+  const unsigned char byte_1 = (value >> 8U) & 0xFF;
+
+  gsl::at(data_, offset + 0) = static_cast<std::byte>(byte_0);
+  gsl::at(data_, offset + 1) = static_cast<std::byte>(byte_1);
+}
+
+void scratchpad::Scratchpad::Store8(const uint32_t offset,
+                                    const uint8_t value) {
+  gsl::at(data_, offset) = static_cast<std::byte>(value);
+}
+
+void scratchpad::Scratchpad::Save(savestate::Writer& writer) const {
+  writer.BeginSection(kStateTag, kStateVersion);
+  writer.WriteBytes(data_);
+  writer.EndSection();
+}
+
+void scratchpad::Scratchpad::Load(savestate::Reader& reader) {
+  reader.BeginSection(kStateTag, kStateVersion);
+  reader.ReadBytes(data_);
+  reader.EndSection();
+}
@@ -0,0 +1,31 @@
+#ifndef POLYSTATION_SCRATCHPAD_H
+#define POLYSTATION_SCRATCHPAD_H
+#include <array>
+#include <cstdint>
+
+#include "savestate.h"
+
+namespace scratchpad {
+constexpr uint32_t kScratchpadSize = 0x400;
+
+// The 1KB data cache of the R3000A, hardwired as fast RAM. Only reachable
+// through KUSEG and KSEG0.
+class Scratchpad {
+ public:
+  [[nodiscard]] uint32_t Load32(uint32_t offset) const;
+  [[nodiscard]] uint16_t Load16(uint32_t offset) const;
+  [[nodiscard]] uint8_t Load8(uint32_t offset) const;
+
+  void Store32(uint32_t offset, uint32_t value);
+  void Store16(uint32_t offset, uint16_t value);
+  void Store8(uint32_t offset, uint8_t value);
+
+  void Save(savestate::Writer& writer) const;
+  void Load(savestate::Reader& reader);
+
+ private:
+  std::array<std::byte, kScratchpadSize> data_{};
+};
+}  // namespace scratchpad
+
+#endif  // POLYSTATION_SCRATCHPAD_H
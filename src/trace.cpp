@@ -0,0 +1,146 @@
+#include "trace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace {
+constexpr size_t kChunkSize = trace::kRecordsPerChunk * sizeof(trace::Record);
+
+off_t GetChunkOffset(const size_t chunk_index) {
+  return static_cast<off_t>(trace::kHeaderSize + chunk_index * kChunkSize);
+}
+
+// The header is filled in over zeroed bytes, so the padding up to its
+// alignment is written as zeros rather than whatever was on the stack.
+bool WriteHeader(const int descriptor, const uint64_t record_count) {
+  trace::Header header;
+  std::memset(static_cast<void*>(&header), 0, sizeof(header));
+  header.magic = trace::kMagic;
+  header.version = trace::kFormatVersion;
+  header.record_size = sizeof(trace::Record);
+  header.record_count = record_count;
+  return pwrite(descriptor, &header, sizeof(header), 0) ==
+         static_cast<ssize_t>(sizeof(header));
+}
+}  // namespace
+
+trace::Writer::Writer(const std::filesystem::path& path)
+    : descriptor_(
+          open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) {
+  if (descriptor_ < 0) {
+    throw std::runtime_error(
+        std::format("failed to create trace {}", path.string()));
+  }
+
+  if (!WriteHeader(descriptor_, 0)) {
+    close(descriptor_);
+    throw std::runtime_error(
+        std::format("failed to write trace {}", path.string()));
+  }
+}
+
+trace::Writer::~Writer() {
+  UnmapChunk();
+
+  static_cast<void>(WriteHeader(descriptor_, record_count_));
+  static_cast<void>(ftruncate(
+      descriptor_,
+      static_cast<off_t>(kHeaderSize + record_count_ * sizeof(Record))));
+  close(descriptor_);
+}
+
+void trace::Writer::Append(const Record& record) {
+  if (position_ == kRecordsPerChunk) [[unlikely]] {
+    MapNextChunk();
+  }
+  chunk_[position_++] = record;
+  record_count_++;
+}
+
+uint64_t trace::Writer::GetRecordCount() const { return record_count_; }
+
+void trace::Writer::MapNextChunk() {
+  if (chunk_ != nullptr) {
+    UnmapChunk();
+    chunk_index_++;
+  }
+
+  const off_t offset = GetChunkOffset(chunk_index_);
+  if (ftruncate(descriptor_, offset + static_cast<off_t>(kChunkSize)) != 0) {
+    throw std::runtime_error("failed to grow trace file");
+  }
+
+  void* chunk = mmap(nullptr, kChunkSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     descriptor_, offset);
+  if (chunk == MAP_FAILED) {
+    throw std::runtime_error("failed to map trace file");
+  }
+  chunk_ = static_cast<Record*>(chunk);
+  position_ = 0;
+}
+
+void trace::Writer::UnmapChunk() {
+  if (chunk_ == nullptr) {
+    return;
+  }
+  // Start writing back now, the chunk is done.
+  msync(chunk_, kChunkSize, MS_ASYNC);
+  munmap(chunk_, kChunkSize);
+  chunk_ = nullptr;
+}
+
+trace::Reader::Reader(const std::filesystem::path& path) {
+  const int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (descriptor < 0) {
+    throw std::runtime_error(
+        std::format("failed to open trace {}", path.string()));
+  }
+
+  struct stat status {};
+  if (fstat(descriptor, &status) != 0 ||
+      static_cast<size_t>(status.st_size) < kHeaderSize) {
+    close(descriptor);
+    throw std::runtime_error(
+        std::format("{} is not a trace", path.string()));
+  }
+  size_ = static_cast<size_t>(status.st_size);
+
+  data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  close(descriptor);
+  if (data_ == MAP_FAILED) {
+    data_ = nullptr;
+    throw std::runtime_error(
+        std::format("failed to map trace {}", path.string()));
+  }
+  madvise(data_, size_, MADV_SEQUENTIAL);
+
+  const auto* header = static_cast<const Header*>(data_);
+  if (header->magic != kMagic || header->version != kFormatVersion ||
+      header->record_size != sizeof(Record) ||
+      header->record_count > (size_ - kHeaderSize) / sizeof(Record)) {
+    munmap(data_, size_);
+    throw std::runtime_error(
+        std::format("{} is not a version {} trace", path.string(),
+                    kFormatVersion));
+  }
+
+  const auto* records = reinterpret_cast<const Record*>(
+      static_cast<const std::byte*>(data_) + kHeaderSize);
+  records_ = std::span(records, header->record_count);
+}
+
+trace::Reader::~Reader() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+std::span<const trace::Record> trace::Reader::GetRecords() const {
+  return records_;
+}
@@ -0,0 +1,98 @@
+#ifndef POLYSTATION_TRACE_H
+#define POLYSTATION_TRACE_H
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "savestate.h"
+
+namespace trace {
+constexpr uint32_t kMagic = savestate::MakeTag("PSXT");
+constexpr uint32_t kFormatVersion = 1;
+// Records start after one page, so every chunk maps page aligned.
+constexpr size_t kHeaderSize = 0x1000;
+// The writer grows and maps the file this many records at a time.
+constexpr size_t kRecordsPerChunk = size_t{1} << 21U;
+
+enum Flags : uint8_t {
+  kRegisterWrite = 1U << 0U,
+  kLoad = 1U << 1U,
+  kStore = 1U << 2U,
+  kException = 1U << 3U,
+};
+
+// One executed instruction.
+struct Record {
+  uint32_t pc = 0;
+  uint32_t instruction = 0;
+  // Effective address of a load or store.
+  uint32_t address = 0;
+  // Written to `register_index` with kRegisterWrite, otherwise the value
+  // stored.
+  uint32_t value = 0;
+  // Low half of the cycle count after the instruction.
+  uint32_t cycle = 0;
+  uint8_t register_index = 0;
+  uint8_t flags = 0;
+  uint16_t reserved = 0;
+} __attribute__((aligned(8)));
+
+static_assert(sizeof(Record) == 24);
+static_assert(kRecordsPerChunk * sizeof(Record) % kHeaderSize == 0);
+
+struct Header {
+  uint32_t magic = kMagic;
+  uint32_t version = kFormatVersion;
+  uint32_t record_size = sizeof(Record);
+  uint32_t reserved = 0;
+  uint64_t record_count = 0;
+} __attribute__((aligned(32)));
+
+// Appends records to a file through a sliding shared mapping, so recording
+// is a copy into memory and the kernel does the writing. The file is cut
+// to its final size when the writer is destroyed.
+class Writer {
+ public:
+  explicit Writer(const std::filesystem::path& path);
+  ~Writer();
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+  Writer(Writer&&) = delete;
+  Writer& operator=(Writer&&) = delete;
+
+  void Append(const Record& record);
+  [[nodiscard]] uint64_t GetRecordCount() const;
+
+ private:
+  int descriptor_;
+  Record* chunk_ = nullptr;
+  size_t chunk_index_ = 0;
+  size_t position_ = kRecordsPerChunk;
+  uint64_t record_count_ = 0;
+
+  void MapNextChunk();
+  void UnmapChunk();
+};
+
+// Maps a whole trace read-only for sequential scans.
+class Reader {
+ public:
+  explicit Reader(const std::filesystem::path& path);
+  ~Reader();
+
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+  Reader(Reader&&) = delete;
+  Reader& operator=(Reader&&) = delete;
+
+  [[nodiscard]] std::span<const Record> GetRecords() const;
+
+ private:
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  std::span<const Record> records_;
+};
+}  // namespace trace
+
+#endif  // POLYSTATION_TRACE_H
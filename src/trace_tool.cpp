@@ -0,0 +1,724 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <gsl/gsl>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "isa.h"
+#include "logger.h"
+#include "trace.h"
+
+namespace {
+constexpr size_t kDefaultContext = 8;
+constexpr size_t kRegisterCount = 32;
+
+// Accepted in reference logs next to r<N> and $<N>.
+constexpr std::array<std::string_view, kRegisterCount> kRegisterNames = {
+    "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3", "t0", "t1", "t2",
+    "t3",   "t4", "t5", "t6", "t7", "s0", "s1", "s2", "s3", "s4", "s5",
+    "s6",   "s7", "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"};
+
+struct Range {
+  uint32_t first = 0;
+  uint32_t last = UINT32_MAX;
+
+  [[nodiscard]] bool Contains(const uint32_t value) const {
+    return value >= first && value <= last;
+  }
+} __attribute__((aligned(8)));
+
+struct Filter {
+  size_t skip = 0;
+  size_t count = SIZE_MAX;
+  std::optional<Range> pc = std::nullopt;
+  std::optional<Range> address = std::nullopt;
+  std::optional<uint8_t> register_index = std::nullopt;
+  bool exceptions = false;
+
+  [[nodiscard]] bool Matches(const trace::Record& record) const;
+} __attribute__((aligned(64)));
+
+struct Options {
+  std::string command;
+  std::string path;
+  std::string other_path;
+  Filter filter;
+  size_t context = kDefaultContext;
+  bool compare_cycles = false;
+  // Reference register values are taken after the instruction on the line
+  // rather than before it.
+  bool registers_after = false;
+} __attribute__((aligned(128)));
+
+// One line of a reference log.
+struct ReferenceStep {
+  uint32_t pc = 0;
+  std::array<uint32_t, kRegisterCount> values{};
+  // Registers present on the line.
+  uint32_t mask = 0;
+} __attribute__((aligned(128)));
+
+// Guest registers rebuilt from the register writes of a trace.
+struct ShadowRegisters {
+  std::array<uint32_t, kRegisterCount> values{};
+  // Registers with a known value. The trace may start anywhere, so a
+  // register is only known once it has been written or first seen in the
+  // reference.
+  uint32_t known = 1;
+  // A load or coprocessor read lands after the instruction that follows
+  // it, not at its own record.
+  uint32_t pending_index = 0;
+  uint32_t pending_value = 0;
+
+  void Apply(const trace::Record& record);
+  void Write(uint32_t index, uint32_t value);
+} __attribute__((aligned(256)));
+
+// A text file mapped for one sequential pass.
+class TextLog {
+ public:
+  explicit TextLog(const std::filesystem::path& path);
+  ~TextLog();
+
+  TextLog(const TextLog&) = delete;
+  TextLog& operator=(const TextLog&) = delete;
+  TextLog(TextLog&&) = delete;
+  TextLog& operator=(TextLog&&) = delete;
+
+  [[nodiscard]] std::optional<std::string_view> NextLine();
+  [[nodiscard]] size_t GetLineNumber() const;
+
+ private:
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  size_t position_ = 0;
+  size_t line_number_ = 0;
+};
+
+void ShadowRegisters::Apply(const trace::Record& record) {
+  // As in the CPU, the delayed value lands first and a write by the
+  // instruction in the delay slot replaces it.
+  Write(pending_index, pending_value);
+  pending_index = 0;
+  if ((record.flags & trace::kRegisterWrite) == 0) {
+    return;
+  }
+
+  const bool delayed =
+      (record.flags & trace::kLoad) != 0 ||
+      (isa::GetSpec(isa::Decode(record.instruction)).flags &
+       isa::kCoprocessor) != 0;
+  if (delayed) {
+    pending_index = record.register_index;
+    pending_value = record.value;
+  } else {
+    Write(record.register_index, record.value);
+  }
+}
+
+void ShadowRegisters::Write(const uint32_t index, const uint32_t value) {
+  if (index == 0 || index >= kRegisterCount) {
+    return;
+  }
+  gsl::at(values, index) = value;
+  known |= 1U << index;
+}
+
+TextLog::TextLog(const std::filesystem::path& path) {
+  const int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (descriptor < 0) {
+    throw std::runtime_error(
+        std::format("failed to open log {}", path.string()));
+  }
+
+  struct stat status {};
+  if (fstat(descriptor, &status) != 0) {
+    close(descriptor);
+    throw std::runtime_error(
+        std::format("failed to open log {}", path.string()));
+  }
+  size_ = static_cast<size_t>(status.st_size);
+  if (size_ == 0) {
+    close(descriptor);
+    return;
+  }
+
+  data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  close(descriptor);
+  if (data_ == MAP_FAILED) {
+    data_ = nullptr;
+    throw std::runtime_error(
+        std::format("failed to map log {}", path.string()));
+  }
+  madvise(data_, size_, MADV_SEQUENTIAL);
+}
+
+TextLog::~TextLog() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+std::optional<std::string_view> TextLog::NextLine() {
+  if (position_ >= size_) {
+    return std::nullopt;
+  }
+
+  const char* start = static_cast<const char*>(data_) + position_;
+  const auto* newline =
+      static_cast<const char*>(std::memchr(start, '\n', size_ - position_));
+  const size_t length = newline == nullptr
+                            ? size_ - position_
+                            : static_cast<size_t>(newline - start);
+  position_ += length + 1;
+  line_number_++;
+
+  std::string_view line(start, length);
+  if (line.ends_with('\r')) {
+    line.remove_suffix(1);
+  }
+  return line;
+}
+
+size_t TextLog::GetLineNumber() const { return line_number_; }
+
+bool Filter::Matches(const trace::Record& record) const {
+  if (pc.has_value() && !pc->Contains(record.pc)) {
+    return false;
+  }
+  if (address.has_value() &&
+      ((record.flags & (trace::kLoad | trace::kStore)) == 0 ||
+       !address->Contains(record.address))) {
+    return false;
+  }
+  if (register_index.has_value() &&
+      ((record.flags & trace::kRegisterWrite) == 0 ||
+       record.register_index != register_index.value())) {
+    return false;
+  }
+  return !exceptions || (record.flags & trace::kException) != 0;
+}
+
+// "8001A000" or "8001A000:8001A0FF", both ends inclusive.
+Range ParseRange(const std::string_view text) {
+  const size_t separator = text.find(':');
+  Range range;
+  range.first = std::stoul(std::string(text.substr(0, separator)), nullptr, 16);
+  range.last = separator == std::string_view::npos
+                   ? range.first
+                   : std::stoul(std::string(text.substr(separator + 1)),
+                                nullptr, 16);
+  return range;
+}
+
+std::optional<Options> ParseOptions(const std::span<char*> args) {
+  if (args.size() < 3) {
+    return std::nullopt;
+  }
+
+  Options options;
+  options.command = args[1];
+  options.path = args[2];
+  size_t i = 3;
+  if (options.command == "diff") {
+    if (args.size() < 4) {
+      return std::nullopt;
+    }
+    options.other_path = args[3];
+    i = 4;
+  } else if (options.command == "compare") {
+    if (args.size() < 4) {
+      return std::nullopt;
+    }
+    options.other_path = args[3];
+    i = 4;
+  } else if (options.command != "decode") {
+    return std::nullopt;
+  }
+
+  for (; i < args.size(); i++) {
+    const std::string_view arg = args[i];
+    const bool has_value = i + 1 < args.size();
+
+    if (arg == "--exceptions") {
+      options.filter.exceptions = true;
+    } else if (arg == "--cycles") {
+      options.compare_cycles = true;
+    } else if (arg == "--after") {
+      options.registers_after = true;
+    } else if (arg == "--skip" && has_value) {
+      options.filter.skip = std::stoull(args[++i]);
+    } else if (arg == "--count" && has_value) {
+      options.filter.count = std::stoull(args[++i]);
+    } else if (arg == "--pc" && has_value) {
+      options.filter.pc = ParseRange(args[++i]);
+    } else if (arg == "--address" && has_value) {
+      options.filter.address = ParseRange(args[++i]);
+    } else if (arg == "--register" && has_value) {
+      options.filter.register_index =
+          static_cast<uint8_t>(std::stoul(args[++i]));
+    } else if (arg == "--context" && has_value) {
+      options.context = std::stoull(args[++i]);
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  return options;
+}
+
+std::string FormatRecord(const size_t index, const trace::Record& record) {
+  std::string line =
+      std::format("{:>10} {:08X} {:08X} {:08X} {:<28}", index, record.cycle,
+                  record.pc, record.instruction,
+                  isa::Disassemble(record.instruction));
+
+  if ((record.flags & trace::kException) != 0) {
+    line += " exception";
+  }
+  if ((record.flags & trace::kRegisterWrite) != 0) {
+    line += std::format(" R{}={:08X}", record.register_index, record.value);
+  }
+  if ((record.flags & trace::kLoad) != 0) {
+    line += std::format(" load [{:08X}]", record.address);
+  }
+  if ((record.flags & trace::kStore) != 0) {
+    line += std::format(" store [{:08X}]={:08X}", record.address,
+                        record.value);
+  }
+  line += '\n';
+  return line;
+}
+
+int Decode(const Options& options) {
+  const trace::Reader reader(options.path);
+  const std::span<const trace::Record> records = reader.GetRecords();
+
+  // Formatting dominates, so batch the writes.
+  constexpr size_t kFlushSize = size_t{1} << 20U;
+  std::string output;
+  size_t shown = 0;
+
+  for (size_t i = options.filter.skip;
+       i < records.size() && shown < options.filter.count; i++) {
+    if (!options.filter.Matches(records[i])) {
+      continue;
+    }
+    output += FormatRecord(i, records[i]);
+    shown++;
+    if (output.size() >= kFlushSize) {
+      std::cout << output;
+      output.clear();
+    }
+  }
+  std::cout << output;
+  return 0;
+}
+
+bool IsSameStep(const trace::Record& lhs, const trace::Record& rhs,
+                const bool compare_cycles) {
+  return lhs.pc == rhs.pc && lhs.instruction == rhs.instruction &&
+         lhs.flags == rhs.flags && lhs.register_index == rhs.register_index &&
+         lhs.value == rhs.value && lhs.address == rhs.address &&
+         (!compare_cycles || lhs.cycle == rhs.cycle);
+}
+
+int Diff(const Options& options) {
+  const trace::Reader lhs_reader(options.path);
+  const trace::Reader rhs_reader(options.other_path);
+  const std::span<const trace::Record> lhs = lhs_reader.GetRecords();
+  const std::span<const trace::Record> rhs = rhs_reader.GetRecords();
+
+  const size_t common = std::min(lhs.size(), rhs.size());
+  size_t index = 0;
+  while (index < common &&
+         IsSameStep(lhs[index], rhs[index], options.compare_cycles)) {
+    index++;
+  }
+
+  if (index == common && lhs.size() == rhs.size()) {
+    std::cout << std::format("traces match, {} instructions\n", common);
+    return 0;
+  }
+
+  const size_t first = index - std::min(index, options.context);
+  std::cout << std::format("first divergence at instruction {}\n", index);
+  for (size_t i = first; i < index; i++) {
+    std::cout << "  " << FormatRecord(i, lhs[i]);
+  }
+  if (index < lhs.size()) {
+    std::cout << "< " << FormatRecord(index, lhs[index]);
+  } else {
+    std::cout << std::format("< end of {}\n", options.path);
+  }
+  if (index < rhs.size()) {
+    std::cout << "> " << FormatRecord(index, rhs[index]);
+  } else {
+    std::cout << std::format("> end of {}\n", options.other_path);
+  }
+  return 1;
+}
+// Hex digit values, 0xFF for anything else.
+constexpr std::array<uint8_t, 256> kHexDigits = [] {
+  std::array<uint8_t, 256> digits{};
+  digits.fill(0xFF);
+  for (uint8_t i = 0; i < 10; i++) {
+    digits.at('0' + i) = i;
+  }
+  for (uint8_t i = 0; i < 6; i++) {
+    digits.at('a' + i) = 10 + i;
+    digits.at('A' + i) = 10 + i;
+  }
+  return digits;
+}();
+
+std::optional<uint32_t> ParseHex(std::string_view text) {
+  if (text.starts_with("0x") || text.starts_with("0X")) {
+    text.remove_prefix(2);
+  }
+  if (text.empty() || text.size() > 8) {
+    return std::nullopt;
+  }
+
+  uint32_t value = 0;
+  for (const char c : text) {
+    const uint8_t digit = gsl::at(kHexDigits, static_cast<unsigned char>(c));
+    if (digit == 0xFF) {
+      return std::nullopt;
+    }
+    value = value << 4U | digit;
+  }
+  return value;
+}
+
+// Letters and digits as 0-35, case folded, 0xFF for anything else.
+constexpr uint8_t GetNameCharacter(const char c) {
+  if (c >= '0' && c <= '9') {
+    return static_cast<uint8_t>(c - '0');
+  }
+  const auto lower = static_cast<char>(static_cast<unsigned char>(c) | 0x20U);
+  if (lower >= 'a' && lower <= 'z') {
+    return static_cast<uint8_t>(lower - 'a' + 10);
+  }
+  return 0xFF;
+}
+
+constexpr size_t kNameCharacters = 36;
+
+// Register index by its two character name, "zero" goes in as "ze" and
+// "s8" is another name for "fp".
+constexpr std::array<uint8_t, kNameCharacters * kNameCharacters>
+    kRegisterByName = [] {
+      std::array<uint8_t, kNameCharacters * kNameCharacters> table{};
+      table.fill(0xFF);
+      const auto set = [&table](const std::string_view name,
+                                const size_t index) {
+        table.at(GetNameCharacter(name[0]) * kNameCharacters +
+                 GetNameCharacter(name[1])) = static_cast<uint8_t>(index);
+      };
+      for (size_t i = 0; i < kRegisterCount; i++) {
+        set(kRegisterNames.at(i), i);
+      }
+      set("s8", 30);
+      return table;
+    }();
+
+// Splits reference log lines into tokens.
+constexpr std::array<bool, 256> kSeparators = [] {
+  std::array<bool, 256> separators{};
+  for (const char c : std::string_view(" \t,;|")) {
+    separators.at(static_cast<unsigned char>(c)) = true;
+  }
+  return separators;
+}();
+
+bool IsSeparator(const char c) {
+  return gsl::at(kSeparators, static_cast<unsigned char>(c));
+}
+
+std::optional<uint8_t> ParseRegister(std::string_view name) {
+  if (name.starts_with('$')) {
+    name.remove_prefix(1);
+  }
+  if (name.size() > 1 && (name[0] == 'r' || name[0] == 'R')) {
+    name.remove_prefix(1);
+  }
+
+  if (!name.empty() && name[0] >= '0' && name[0] <= '9') {
+    uint8_t index = 0;
+    const char* end = name.data() + name.size();
+    const auto [last, error] = std::from_chars(name.data(), end, index);
+    if (error != std::errc{} || last != end || index >= kRegisterCount) {
+      return std::nullopt;
+    }
+    return index;
+  }
+
+  // The only name longer than two characters.
+  if (name.size() == 4 && std::ranges::equal(name, std::string_view("zero"), {},
+                                             GetNameCharacter,
+                                             GetNameCharacter)) {
+    return 0;
+  }
+  if (name.size() != 2) {
+    return std::nullopt;
+  }
+  const uint8_t first = GetNameCharacter(name[0]);
+  const uint8_t second = GetNameCharacter(name[1]);
+  if (first == 0xFF || second == 0xFF) {
+    return std::nullopt;
+  }
+  const uint8_t index =
+      gsl::at(kRegisterByName, first * kNameCharacters + second);
+  return index == 0xFF ? std::nullopt : std::optional(index);
+}
+
+// Reference logs differ between emulators, so lines are read loosely:
+// "pc=<hex>" names the PC, otherwise the first bare 8 digit hex token is
+// taken as the PC. Tokens like "a0=<hex>", "r4:<hex>" or "$4: <hex>" give
+// register values. Lines without a PC are skipped.
+std::optional<ReferenceStep> ParseReferenceLine(const std::string_view line) {
+  ReferenceStep step;
+  std::optional<uint32_t> pc;
+  std::optional<uint32_t> bare_pc;
+  std::string_view pending_name;
+
+  size_t position = 0;
+  while (position < line.size()) {
+    while (position < line.size() && IsSeparator(line[position])) {
+      position++;
+    }
+    const size_t start = position;
+    while (position < line.size() && !IsSeparator(line[position])) {
+      position++;
+    }
+    if (start == position) {
+      break;
+    }
+    std::string_view token = line.substr(start, position - start);
+
+    std::string_view name = std::exchange(pending_name, {});
+    // Not find_first_of, which calls memchr for every character.
+    if (const auto* separator = std::ranges::find_if(
+            token, [](const char c) { return c == '=' || c == ':'; });
+        separator != token.end()) {
+      const auto split = static_cast<size_t>(separator - token.begin());
+      const std::string_view key = token.substr(0, split);
+      const std::string_view value = token.substr(split + 1);
+      if (!value.empty()) {
+        name = key;
+        token = value;
+      } else if (key.size() < 8) {
+        // "pc:" or "a0=", the value comes next.
+        pending_name = key;
+        continue;
+      } else {
+        // "BFC00000:"
+        token = key;
+      }
+    }
+
+    const std::optional<uint32_t> value = ParseHex(token);
+    if (!value.has_value()) {
+      continue;
+    }
+    if (name.empty()) {
+      if (!bare_pc.has_value() && token.size() >= 8) {
+        bare_pc = value;
+      }
+    } else if (name == "pc" || name == "PC") {
+      pc = value;
+    } else if (const std::optional<uint8_t> index = ParseRegister(name);
+               index.has_value()) {
+      gsl::at(step.values, index.value()) = value.value();
+      step.mask |= 1U << index.value();
+    }
+  }
+
+  if (!pc.has_value()) {
+    pc = bare_pc;
+  }
+  if (!pc.has_value()) {
+    return std::nullopt;
+  }
+  step.pc = pc.value();
+  return step;
+}
+
+// Registers on the reference line that disagree with ours, as a bit mask.
+uint32_t FindMismatches(const ReferenceStep& step,
+                        const ShadowRegisters& shadow) {
+  uint32_t mismatches = 0;
+  for (uint32_t mask = step.mask & shadow.known; mask != 0; mask &= mask - 1) {
+    const auto index = static_cast<size_t>(std::countr_zero(mask));
+    if (gsl::at(shadow.values, index) != gsl::at(step.values, index)) {
+      mismatches |= 1U << index;
+    }
+  }
+  return mismatches;
+}
+
+// Registers we have no value for yet are taken from the reference.
+void AdoptUnknown(const ReferenceStep& step, ShadowRegisters& shadow) {
+  for (uint32_t mask = step.mask & ~shadow.known; mask != 0; mask &= mask - 1) {
+    const auto index = static_cast<size_t>(std::countr_zero(mask));
+    gsl::at(shadow.values, index) = gsl::at(step.values, index);
+  }
+  shadow.known |= step.mask;
+}
+
+// Returns the registers that disagree, taking the unknown ones on the way.
+uint32_t CheckRegisters(const ReferenceStep& step, ShadowRegisters& shadow) {
+  const uint32_t mismatches = FindMismatches(step, shadow);
+  AdoptUnknown(step, shadow);
+  return mismatches;
+}
+
+int Compare(const Options& options) {
+  const trace::Reader reader(options.path);
+  const std::span<const trace::Record> records = reader.GetRecords();
+  TextLog log(options.other_path);
+
+  ShadowRegisters shadow;
+  size_t index = 0;
+  for (; index < std::min(options.filter.skip, records.size()); index++) {
+    shadow.Apply(records[index]);
+  }
+
+  // Last matching steps, as our record index and the reference line.
+  std::deque<std::pair<size_t, std::string_view>> context;
+  size_t steps = 0;
+  std::optional<std::string_view> line;
+
+  while ((line = log.NextLine()).has_value()) {
+    const std::optional<ReferenceStep> step = ParseReferenceLine(line.value());
+    if (!step.has_value()) {
+      continue;
+    }
+
+    // The reference may start later than our trace, line the two up on its
+    // first PC where the registers we know agree.
+    if (steps == 0) {
+      while (index < records.size() &&
+             (records[index].pc != step->pc ||
+              (!options.registers_after &&
+               FindMismatches(step.value(), shadow) != 0))) {
+        shadow.Apply(records[index++]);
+      }
+      if (index > options.filter.skip) {
+        std::cout << std::format("skipped {} instructions to reach {:08X}\n",
+                                 index - options.filter.skip, step->pc);
+      }
+    }
+
+    uint32_t mismatches = 0;
+    const bool ended = index == records.size();
+    const bool same_pc = !ended && records[index].pc == step->pc;
+    if (same_pc) {
+      if (options.registers_after) {
+        shadow.Apply(records[index]);
+        mismatches = CheckRegisters(step.value(), shadow);
+      } else {
+        mismatches = CheckRegisters(step.value(), shadow);
+        if (mismatches == 0) {
+          shadow.Apply(records[index]);
+        }
+      }
+    }
+
+    if (same_pc && mismatches == 0) {
+      context.emplace_back(index, line.value());
+      if (context.size() > options.context) {
+        context.pop_front();
+      }
+      index++;
+      steps++;
+      continue;
+    }
+
+    std::cout << std::format(
+        "first divergence at instruction {}, reference line {}\n", index,
+        log.GetLineNumber());
+    for (const auto& [record_index, reference] : context) {
+      std::cout << "  " << FormatRecord(record_index, records[record_index]);
+      std::cout << "  = " << reference << '\n';
+    }
+    if (ended) {
+      std::cout << std::format("< end of {}\n", options.path);
+    } else {
+      std::cout << "< " << FormatRecord(index, records[index]);
+    }
+    std::cout << "> " << line.value() << '\n';
+    for (; mismatches != 0; mismatches &= mismatches - 1) {
+      const auto bad = static_cast<size_t>(std::countr_zero(mismatches));
+      std::cout << std::format("  R{} ({}) ours {:08X}, reference {:08X}\n",
+                               bad, gsl::at(kRegisterNames, bad),
+                               gsl::at(shadow.values, bad),
+                               gsl::at(step->values, bad));
+    }
+    return 1;
+  }
+
+  if (steps == 0) {
+    std::cout << std::format("no instructions found in {}\n",
+                             options.other_path);
+    return 1;
+  }
+  std::cout << std::format("traces match, {} instructions\n", steps);
+  return 0;
+}
+}  // namespace
+
+int main(const int argc, char** argv) {
+  logger::Logger::init();
+  std::ios::sync_with_stdio(false);
+
+  const std::span args(argv, argc);
+  int status = 0;
+
+  try {
+    const std::optional<Options> options = ParseOptions(args);
+    if (!options.has_value()) {
+      LOG_FATAL_CORE(
+          "Usage: {0} decode <trace> [--skip N] [--count N] "
+          "[--pc <from>[:<to>]] [--address <from>[:<to>]] [--register N] "
+          "[--exceptions]\n"
+          "       {0} diff <trace> <trace> [--context N] [--cycles]\n"
+          "       {0} compare <trace> <reference log> [--skip N] "
+          "[--context N] [--after]",
+          args[0]);
+      return -1;
+    }
+
+    if (options->command == "diff") {
+      status = Diff(options.value());
+    } else if (options->command == "compare") {
+      status = Compare(options.value());
+    } else {
+      status = Decode(options.value());
+    }
+  } catch (const std::exception& e) {
+    LOG_FATAL_CORE("{}", e.what());
+    return -1;
+  }
+
+  logger::Logger::shutdown();
+
+  return status;
+}
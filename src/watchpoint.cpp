@@ -0,0 +1,323 @@
+#include "watchpoint.h"
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <format>
+#include <gsl/gsl>
+#include <mutex>
+#include <stdexcept>
+
+#include "isa.h"
+#include "logger.h"
+
+namespace {
+constexpr uint32_t kPhysicalMask = 0x1FFFFFFFU;
+// RAM is mirrored four times over the first 8 MiB.
+constexpr uint32_t kRamMirrorEnd = 0x800000;
+
+// Machines that can own watchpoints at the same time.
+constexpr size_t kMaxSets = 16;
+
+std::array<std::atomic<watchpoint::Set*>, kMaxSets> sets{};
+struct sigaction previous_action {};
+std::once_flag install_flag;
+
+bool IsWriteFault([[maybe_unused]] const void* context) {
+#if defined(__x86_64__)
+  // Bit 1 of the page fault error code.
+  constexpr greg_t kWriteAccess = 0x2;
+
+  const auto* ucontext = static_cast<const ucontext_t*>(context);
+  return (ucontext->uc_mcontext.gregs[REG_ERR] & kWriteAccess) != 0;
+#else
+  // Collect falls back to the faulting instruction to tell them apart.
+  return false;
+#endif
+}
+
+void HandleFault(const int signal, siginfo_t* info, void* context) {
+  const bool write = IsWriteFault(context);
+  for (const std::atomic<watchpoint::Set*>& slot : sets) {
+    watchpoint::Set* set = slot.load(std::memory_order_acquire);
+    if (set != nullptr && set->OnFault(info->si_addr, write)) {
+      return;
+    }
+  }
+
+  // Not a watched page, chain to the previous handler and stay installed
+  // for the next fault.
+  if ((previous_action.sa_flags & SA_SIGINFO) != 0) {
+    previous_action.sa_sigaction(signal, info, context);
+    return;
+  }
+  if (previous_action.sa_handler != SIG_DFL &&
+      previous_action.sa_handler != SIG_IGN) {
+    previous_action.sa_handler(signal);
+    return;
+  }
+  // A fault cannot be ignored, both end the process with the default
+  // action once the handler returns and the signal is unblocked.
+  struct sigaction default_action {};
+  default_action.sa_handler = SIG_DFL;
+  sigemptyset(&default_action.sa_mask);
+  sigaction(signal, &default_action, nullptr);
+  raise(signal);
+}
+
+void InstallHandler() {
+  struct sigaction action {};
+  action.sa_sigaction = HandleFault;
+  action.sa_flags = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+
+  if (sigaction(SIGSEGV, &action, &previous_action) != 0) {
+    throw std::runtime_error("failed to install the watchpoint handler");
+  }
+}
+
+uint32_t GetRamOffset(const uint32_t address) {
+  const uint32_t physical = address & kPhysicalMask;
+  if (physical >= kRamMirrorEnd) {
+    throw std::runtime_error(
+        std::format("Watchpoint at 0x{:08X} is outside RAM", address));
+  }
+  return physical % ram::kRamSize;
+}
+
+uint8_t GetAccessWidth(const isa::Operation operation) {
+  switch (operation) {
+    case isa::Operation::kLB:
+    case isa::Operation::kLBU:
+    case isa::Operation::kSB:
+      return 1;
+    case isa::Operation::kLH:
+    case isa::Operation::kLHU:
+    case isa::Operation::kSH:
+      return 2;
+    default:
+      return 4;
+  }
+}
+}  // namespace
+
+watchpoint::Set::Set(ram::Ram& ram)
+    : ram_(ram), base_(ram.GetPage(0).data()) {}
+
+watchpoint::Set::~Set() {
+  Clear();
+  if (registered_) {
+    for (std::atomic<Set*>& slot : sets) {
+      Set* expected = this;
+      slot.compare_exchange_strong(expected, nullptr);
+    }
+  }
+}
+
+void watchpoint::Set::Add(const Watchpoint& watchpoint) {
+  if (sysconf(_SC_PAGESIZE) != ram::kPageSize) {
+    throw std::runtime_error("Watchpoints need 4 KiB host pages");
+  }
+
+  const uint32_t offset = GetRamOffset(watchpoint.address);
+  if (watchpoint.length == 0 || watchpoint.length > ram::kRamSize - offset) {
+    throw std::runtime_error(std::format(
+        "Watchpoint at 0x{:08X} has an invalid length of {} bytes",
+        watchpoint.address, watchpoint.length));
+  }
+
+  if (!registered_) {
+    std::call_once(install_flag, InstallHandler);
+
+    const auto slot = std::ranges::find_if(sets, [this](auto& candidate) {
+      Set* expected = nullptr;
+      return candidate.compare_exchange_strong(expected, this);
+    });
+    if (slot == sets.end()) {
+      throw std::runtime_error("Too many machines with watchpoints");
+    }
+    registered_ = true;
+  }
+
+  watchpoints_.push_back(watchpoint);
+  UpdatePages();
+}
+
+void watchpoint::Set::Remove(const uint32_t address) {
+  const uint32_t offset = GetRamOffset(address);
+  std::erase_if(watchpoints_, [offset](const Watchpoint& watchpoint) {
+    return GetRamOffset(watchpoint.address) == offset;
+  });
+  UpdatePages();
+}
+
+void watchpoint::Set::Clear() {
+  watchpoints_.clear();
+  UpdatePages();
+}
+
+bool watchpoint::Set::IsEmpty() const { return watchpoints_.empty(); }
+
+const std::vector<watchpoint::Watchpoint>& watchpoint::Set::GetWatchpoints()
+    const {
+  return watchpoints_;
+}
+
+const std::deque<watchpoint::Hit>& watchpoint::Set::GetHits() const {
+  return hits_;
+}
+
+void watchpoint::Set::ClearHits() { hits_.clear(); }
+
+void watchpoint::Set::Arm() {
+  fault_count_.store(0, std::memory_order_relaxed);
+  for (uint32_t page = 0; page < ram::kPageCount; page++) {
+    if (gsl::at(page_kinds_, page) != 0) {
+      Protect(page);
+    }
+  }
+}
+
+bool watchpoint::Set::HasFaults() const {
+  return fault_count_.load(std::memory_order_relaxed) != 0;
+}
+
+void watchpoint::Set::Discard() {
+  const size_t total = fault_count_.load(std::memory_order_relaxed);
+  if (total > kMaxFaults) {
+    Arm();
+    return;
+  }
+  for (size_t i = 0; i < total; i++) {
+    Protect(gsl::at(faults_, i).offset / ram::kPageSize);
+  }
+  fault_count_.store(0, std::memory_order_relaxed);
+}
+
+void watchpoint::Set::Collect(const uint32_t pc, const uint32_t word,
+                              const uint32_t address) {
+  const size_t count =
+      std::min(fault_count_.load(std::memory_order_relaxed), kMaxFaults);
+
+  // Report before protecting again, reading the values may touch the pages.
+  for (size_t i = 0; i < count; i++) {
+    Report(pc, word, address, gsl::at(faults_, i));
+  }
+  Discard();
+}
+
+bool watchpoint::Set::OnFault(const void* address, const bool write) {
+  const auto host = reinterpret_cast<uintptr_t>(address);
+  const auto base = reinterpret_cast<uintptr_t>(base_);
+  if (host < base || host - base >= ram::kRamSize) {
+    return false;
+  }
+
+  const auto offset = static_cast<uint32_t>(host - base);
+  const uint32_t page = offset / ram::kPageSize;
+  if (gsl::at(page_kinds_, page) == 0) {
+    return false;
+  }
+
+  Unprotect(page);
+  const size_t index = fault_count_.fetch_add(1, std::memory_order_relaxed);
+  if (index < kMaxFaults) {
+    gsl::at(faults_, index) = Fault{.offset = offset, .write = write};
+  }
+  return true;
+}
+
+void watchpoint::Set::UpdatePages() {
+  std::array<uint8_t, ram::kPageCount> page_kinds{};
+  for (const Watchpoint& watchpoint : watchpoints_) {
+    const uint32_t offset = GetRamOffset(watchpoint.address);
+    const uint32_t last = offset + watchpoint.length - 1;
+    for (uint32_t page = offset / ram::kPageSize;
+         page <= last / ram::kPageSize; page++) {
+      gsl::at(page_kinds, page) |= watchpoint.kinds;
+    }
+  }
+
+  for (uint32_t page = 0; page < ram::kPageCount; page++) {
+    const uint8_t kinds = gsl::at(page_kinds, page);
+    if (kinds == gsl::at(page_kinds_, page)) {
+      continue;
+    }
+    gsl::at(page_kinds_, page) = kinds;
+    if (kinds == 0) {
+      Unprotect(page);
+    } else {
+      Protect(page);
+    }
+  }
+}
+
+void watchpoint::Set::Protect(const uint32_t page) const {
+  // Write-only watches keep the page readable.
+  const int protection =
+      (gsl::at(page_kinds_, page) & kRead) != 0 ? PROT_NONE : PROT_READ;
+  mprotect(base_ + page * ram::kPageSize, ram::kPageSize, protection);
+}
+
+void watchpoint::Set::Unprotect(const uint32_t page) const {
+  mprotect(base_ + page * ram::kPageSize, ram::kPageSize,
+           PROT_READ | PROT_WRITE);
+}
+
+void watchpoint::Set::Report(const uint32_t pc, const uint32_t word,
+                             const uint32_t address, const Fault& fault) {
+  Hit hit{.pc = pc, .address = fault.offset, .write = fault.write};
+
+  // A CPU access says itself how wide it was and which way it went, as
+  // long as the fault is the access itself and not a DMA it started.
+  if (const isa::Spec& spec = isa::GetSpec(isa::Decode(word));
+      (spec.flags & (isa::kLoad | isa::kStore)) != 0U) {
+    const uint32_t mask = ~(GetAccessWidth(spec.operation) - 1U);
+    const uint32_t physical = address & kPhysicalMask;
+    if (physical < kRamMirrorEnd &&
+        (physical % ram::kRamSize & mask) == (fault.offset & mask)) {
+      hit.width = GetAccessWidth(spec.operation);
+      hit.write = (spec.flags & isa::kStore) != 0U;
+      hit.address &= mask;
+    }
+  }
+
+  switch (hit.width) {
+    case 1:
+      hit.value = ram_.Load8(hit.address);
+      break;
+    case 2:
+      hit.value = ram_.Load16(hit.address);
+      break;
+    default:
+      hit.value = ram_.Load32(hit.address & ~0x3U);
+      break;
+  }
+
+  const uint8_t kind = hit.write ? kWrite : kRead;
+  const uint32_t end = hit.address + std::max<uint32_t>(hit.width, 1);
+  bool matched = false;
+  for (Watchpoint& watchpoint : watchpoints_) {
+    const uint32_t start = GetRamOffset(watchpoint.address);
+    if ((watchpoint.kinds & kind) != 0 &&
+        hit.address < start + watchpoint.length && start < end) {
+      watchpoint.hits++;
+      matched = true;
+    }
+  }
+  // Another address on a watched page.
+  if (!matched) {
+    return;
+  }
+
+  LOG_INFO_CPU("Watchpoint {} of {:08X} at PC {:08X}: width {}, value {:08X}",
+               hit.write ? "write" : "read", hit.address, hit.pc, hit.width,
+               hit.value);
+
+  hits_.push_back(hit);
+  if (hits_.size() > kMaxHits) {
+    hits_.pop_front();
+  }
+}
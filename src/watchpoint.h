@@ -0,0 +1,106 @@
+#ifndef POLYSTATION_WATCHPOINT_H
+#define POLYSTATION_WATCHPOINT_H
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "ram.h"
+
+namespace watchpoint {
+// Most recent hits kept for inspection, older ones are only logged.
+constexpr size_t kMaxHits = 256;
+// Faults recorded per instruction, DMA can touch many pages at once.
+constexpr size_t kMaxFaults = 64;
+
+enum Kind : uint8_t {
+  kRead = 1U << 0U,
+  kWrite = 1U << 1U,
+};
+
+struct Watchpoint {
+  // Any RAM mirror, matched on the RAM offset.
+  uint32_t address = 0;
+  uint32_t length = 4;
+  uint8_t kinds = kWrite;
+  unsigned long long hits = 0;
+} __attribute__((aligned(32)));
+
+struct Hit {
+  uint32_t pc = 0;
+  // RAM offset of the access.
+  uint32_t address = 0;
+  // Zero when the access did not come from a CPU load or store, e.g. DMA.
+  uint8_t width = 0;
+  bool write = false;
+  // Memory contents after the access.
+  uint32_t value = 0;
+} __attribute__((aligned(16)));
+
+// Read and write watchpoints on guest RAM. Watched pages are protected in
+// the host mapping, so accesses to every other page run untouched. A fault
+// opens the page up and lets the access complete; Collect then reports it
+// and protects the page again before the next instruction.
+class Set {
+ public:
+  explicit Set(ram::Ram& ram);
+  ~Set();
+
+  Set(const Set&) = delete;
+  Set& operator=(const Set&) = delete;
+  Set(Set&&) = delete;
+  Set& operator=(Set&&) = delete;
+
+  void Add(const Watchpoint& watchpoint);
+  void Remove(uint32_t address);
+  void Clear();
+
+  [[nodiscard]] bool IsEmpty() const;
+  [[nodiscard]] const std::vector<Watchpoint>& GetWatchpoints() const;
+  [[nodiscard]] const std::deque<Hit>& GetHits() const;
+  void ClearHits();
+
+  // Protects every watched page again, dropping faults raised by host-side
+  // accesses such as savestates. Called before each run.
+  void Arm();
+
+  [[nodiscard]] bool HasFaults() const;
+  // Protects the faulted pages again without reporting anything. The CPU
+  // calls it after fetching from a read-watched page, so the instruction's
+  // own data access faults as well.
+  void Discard();
+  // Reports the faults raised by the instruction `word` at `pc`, whose
+  // loads and stores go to `address`. Other faults, from a DMA it started,
+  // are reported without a width.
+  void Collect(uint32_t pc, uint32_t word, uint32_t address);
+
+  // Called from the SIGSEGV handler, returns false when `address` is not
+  // a watched page of this set.
+  bool OnFault(const void* address, bool write);
+
+ private:
+  struct Fault {
+    uint32_t offset = 0;
+    bool write = false;
+  } __attribute__((aligned(8)));
+
+  ram::Ram& ram_;
+  std::byte* base_;
+  std::vector<Watchpoint> watchpoints_;
+  std::deque<Hit> hits_;
+  // Per page, the accesses that have to fault.
+  std::array<uint8_t, ram::kPageCount> page_kinds_{};
+  std::array<Fault, kMaxFaults> faults_{};
+  std::atomic<size_t> fault_count_{0};
+  bool registered_ = false;
+
+  void UpdatePages();
+  void Protect(uint32_t page) const;
+  void Unprotect(uint32_t page) const;
+  void Report(uint32_t pc, uint32_t word, uint32_t address,
+              const Fault& fault);
+};
+}  // namespace watchpoint
+
+#endif  // POLYSTATION_WATCHPOINT_H
@@ -0,0 +1,93 @@
+#include "worker_pool.h"
+
+worker_pool::WorkerPool::WorkerPool(const size_t thread_count) {
+  threads_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; i++) {
+    threads_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+worker_pool::WorkerPool::~WorkerPool() {
+  {
+    const std::scoped_lock lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void worker_pool::WorkerPool::ParallelFor(
+    const size_t count, const std::function<void(size_t)>& task) {
+  // Callers sharing the pool never wait for each other, while the workers
+  // are busy with another call this one runs on its own thread.
+  std::unique_lock call_lock(call_mutex_, std::defer_lock);
+  if (threads_.empty() || count <= 1 || !call_lock.try_lock()) {
+    for (size_t i = 0; i < count; i++) {
+      task(i);
+    }
+    return;
+  }
+
+  {
+    const std::scoped_lock lock(mutex_);
+    task_ = &task;
+    count_ = count;
+    next_index_.store(0, std::memory_order_relaxed);
+    pending_workers_ = threads_.size();
+    generation_++;
+  }
+  wake_.notify_all();
+
+  RunTasks();
+
+  std::unique_lock lock(mutex_);
+  done_.wait(lock, [this] { return pending_workers_ == 0; });
+  task_ = nullptr;
+}
+
+size_t worker_pool::WorkerPool::GetThreadCount() const {
+  return threads_.size();
+}
+
+size_t worker_pool::WorkerPool::DefaultThreadCount() {
+  const unsigned int hardware_threads = std::thread::hardware_concurrency();
+  return hardware_threads > 1 ? hardware_threads - 1 : 0;
+}
+
+void worker_pool::WorkerPool::WorkerLoop() {
+  unsigned long long seen_generation = 0;
+
+  while (true) {
+    {
+      std::unique_lock lock(mutex_);
+      wake_.wait(lock, [this, seen_generation] {
+        return stopping_ || generation_ != seen_generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    RunTasks();
+
+    {
+      const std::scoped_lock lock(mutex_);
+      pending_workers_--;
+      if (pending_workers_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+}
+
+void worker_pool::WorkerPool::RunTasks() {
+  for (size_t index = next_index_.fetch_add(1, std::memory_order_relaxed);
+       index < count_;
+       index = next_index_.fetch_add(1, std::memory_order_relaxed)) {
+    (*task_)(index);
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef POLYSTATION_WORKER_POOL_H
+#define POLYSTATION_WORKER_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace worker_pool {
+class WorkerPool {
+ public:
+  // The calling thread always takes part in ParallelFor, so the default leaves
+  // one hardware thread for it.
+  explicit WorkerPool(size_t thread_count = DefaultThreadCount());
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+  WorkerPool(WorkerPool&&) = delete;
+  WorkerPool& operator=(WorkerPool&&) = delete;
+
+  // Runs task(i) for every i in [0, count) and returns once all of them have
+  // finished. Indices are handed out dynamically, so uneven tasks balance.
+  // When another thread's call holds the workers, the tasks all run on the
+  // calling thread instead of waiting.
+  void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+  [[nodiscard]] size_t GetThreadCount() const;
+
+  static size_t DefaultThreadCount();
+
+ private:
+  std::vector<std::thread> threads_;
+  std::mutex call_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(size_t)>* task_ = nullptr;
+  size_t count_ = 0;
+  std::atomic<size_t> next_index_{0};
+  size_t pending_workers_ = 0;
+  unsigned long long generation_ = 0;
+  bool stopping_ = false;
+
+  void WorkerLoop();
+  void RunTasks();
+};
+}  // namespace worker_pool
+
+#endif  // POLYSTATION_WORKER_POOL_H